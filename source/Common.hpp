@@ -14,6 +14,28 @@
 
 LANGULUS_EXCEPTION(Graphics);
 
+namespace Langulus::Traits
+{
+   LANGULUS_DEFINE_TRAIT(PipelineManifest,
+      "Path to a file, where created pipelines are recorded, and from "
+      "which pipelines are prewarmed - nothing is recorded without it");
+   LANGULUS_DEFINE_TRAIT(PipelineCache,
+      "Path to a file, where the driver's pipeline cache persists - the "
+      "cache is kept only in memory without it");
+   LANGULUS_DEFINE_TRAIT(LayerStyle,
+      "Combination of VulkanLayer::Style flags, that configure how a layer "
+      "is compiled and rendered");
+   LANGULUS_DEFINE_TRAIT(FramesInFlight,
+      "Number of frames the CPU can prepare, while the GPU still draws the "
+      "previous ones");
+   LANGULUS_DEFINE_TRAIT(BackBuffers,
+      "Number of images a renderer without a window draws to, one after "
+      "another");
+   LANGULUS_DEFINE_TRAIT(EyeSeparation,
+      "Distance between the eyes of a stereo camera, or zero for a mono one. "
+      "Negative swaps the eyes");
+}
+
 using namespace Langulus;
 using namespace Math;
 
@@ -60,6 +82,12 @@ using QueueFamilies   = TMany<uint32_t>;
 
 constexpr uint32_t VK_INDEFINITELY = ::std::numeric_limits<uint32_t>::max();
 
+/// Most frames the CPU can prepare, while the GPU still draws previous ones  
+constexpr uint32_t MaxFramesInFlight = 3;
+
+/// Most images a renderer without a window draws to                          
+constexpr uint32_t MaxBackBuffers = 8;
+
 /// These calls must be implemented for each OS individually                  
 bool CreateNativeVulkanSurfaceKHR(const VkInstance&, const A::Window*, VkSurfaceKHR&);
 
@@ -70,5 +98,6 @@ NOD() auto VkFormatToDMeta(const VkFormat&, bool& reverse) -> DMeta;
 NOD() constexpr auto AsVkStage(ShaderStage::Enum) noexcept -> VkShaderStageFlagBits;
 NOD() auto AsVkPrimitive(DMeta) -> VkPrimitiveTopology;
 NOD() auto AnyColorToVector(const Many&) -> RGBAf;
+void MatrixToFloats(const Mat4&, float*) noexcept;
 
 #include "Common.inl"
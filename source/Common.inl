@@ -345,3 +345,13 @@ RGBAf AnyColorToVector(const Many& color) {
 
    return result;
 }
+
+/// Convert a matrix to a single precision column-major array, as used by     
+/// shaders and the culling routines                                          
+///   @param from - the matrix to convert                                     
+///   @param to - [out] the sixteen floats                                    
+LANGULUS(INLINED)
+void MatrixToFloats(const Mat4& from, float* to) noexcept {
+   for (int i = 0; i < 16; ++i)
+      to[i] = static_cast<float>(from.mArray[i]);
+}
@@ -89,6 +89,20 @@ Vulkan::Vulkan(Runtime* runtime, Describe)
    // Get required extensions                                           
    auto extensions = GetRequiredExtensions();
 
+   // Extended device properties are optional, but devices need them    
+   // for multiview, so they're enabled whenever available              
+   uint32_t availableCount {};
+   vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, nullptr);
+   std::vector<VkExtensionProperties> availableExtensions(availableCount);
+   vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, availableExtensions.data());
+   for (const auto& ext : availableExtensions) {
+      if (0 == strcmp(ext.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+         extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+         mSupportsProperties2 = true;
+         break;
+      }
+   }
+
    // Setup the required validation layers                              
    #if LANGULUS_DEBUG()
       Logger::Warning(Self(), 
@@ -37,6 +37,9 @@ protected:
    bool mSupportsTransfer {};
    // True if hardware has sparse binding support                       
    bool mSupportsSparseBinding {};
+   // True if the instance has extended device properties, which        
+   // devices need for multiview                                        
+   bool mSupportsProperties2 {};
    // List of renderer components                                       
    TFactory<VulkanRenderer> mRenderers;
 
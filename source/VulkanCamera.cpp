@@ -15,13 +15,14 @@ VulkanCamera::VulkanCamera(VulkanLayer* producer, Describe descriptor)
    : Resolvable   {this} 
    , ProducedFrom {producer, descriptor} {
    VERBOSE_VULKAN("Initializing...");
+   SeekValueAux<Traits::EyeSeparation>(descriptor, mEyeSeparation);
    Couple(descriptor);
    VERBOSE_VULKAN("Initialized");
 }
 
 /// Compile the camera                                                        
 void VulkanCamera::Compile() {
-   mResolution = mProducer->mProducer->mWindow->GetSize();
+   mResolution = mProducer->mProducer->GetResolution();
 
    if (mResolution[0] <= 1)
       mResolution[0] = 1;
@@ -30,6 +31,9 @@ void VulkanCamera::Compile() {
 
    mAspectRatio = static_cast<Real>(mResolution[0])
                 / static_cast<Real>(mResolution[1]);
+   // Each eye of a stereo camera sees half of the viewport             
+   if (IsStereo())
+      mAspectRatio *= Real {0.5};
    mViewport.mMax.xy() = mResolution;
 
    if (mPerspective) {
@@ -87,6 +91,12 @@ void VulkanCamera::Compile() {
    mVulkanScissor.offset.y = int32_t(offset[1]);
 }
 
+/// Check if the camera has two eyes                                          
+///   @return true if eyes are separated                                      
+bool VulkanCamera::IsStereo() const noexcept {
+   return mEyeSeparation != 0;
+}
+
 /// Recompile the camera                                                      
 void VulkanCamera::Refresh() {
    mInstances = GatherUnits<A::Instance, Seek::Here>();
@@ -50,6 +50,7 @@ public:
 
    void Refresh();
    void Compile();
+   NOD() bool IsStereo() const noexcept;
    NOD() Mat4 GetViewTransform(const LOD&) const;
    NOD() Mat4 GetViewTransform(const Level& = {}) const;
 };
@@ -17,6 +17,14 @@ VulkanLayer::VulkanLayer(VulkanRenderer* producer, Describe descriptor)
    : Resolvable   {this} 
    , ProducedFrom {producer, descriptor} {
    VERBOSE_VULKAN("Initializing...");
+   uint32_t style;
+   if (SeekValueAux<Traits::LayerStyle>(descriptor, style))
+      mStyle = static_cast<Style>(style);
+
+   if (mStyle & Style::Occluded and not (mStyle & Style::Hierarchical))
+      mHiZ.Create(producer);
+   if (not (mStyle & (Style::DeferredLights | Style::Hierarchical)))
+      mClusters.Create(producer);
    Couple(descriptor);
    VERBOSE_VULKAN("Initialized");
 }
@@ -26,6 +34,8 @@ VulkanLayer::~VulkanLayer() {
 }
 
 void VulkanLayer::Detach() {
+   mHiZ.Destroy();
+   mClusters.Destroy();
    mSubscribers.Reset();
    mRelevantCameras.Reset();
    mRelevantLevels.Reset();
@@ -33,6 +43,7 @@ void VulkanLayer::Detach() {
 
    mCameras.Reset();
    mRenderables.Reset();
+   mIndex.Clear();
    mLights.Reset();
 
    ProducedFrom<VulkanRenderer>::Detach();
@@ -46,12 +57,162 @@ void VulkanLayer::Create(Verb& verb) {
    mLights.Create(this, verb);
 }
 
+/// Mix the levels and transformations of some instances into signatures      
+///   @param levels - [in/out] the signature of the levels                    
+///   @param transforms - [in/out] the signature of the transformations       
+///   @param instances - the instances                                        
+static void MixInstances(
+   Signature& levels, Signature& transforms,
+   const TMany<const A::Instance*>& instances
+) {
+   for (auto instance : instances) {
+      const auto level = instance->GetLevel();
+      levels.Mix(level);
+      transforms.Mix(instance->GetModelTransform(level));
+   }
+}
+
+/// Mix the structure of an entity hierarchy into a signature, because        
+/// hierarchical layers draw in the order entities appear                     
+///   @param signature - [in/out] the signature                               
+///   @param thing - the root of the hierarchy                                
+static void MixHierarchy(Signature& signature, const Thing* thing) {
+   signature.Mix(thing);
+   for (auto child : thing->GetChildren())
+      MixHierarchy(signature, child);
+}
+
+/// Compile the cameras, and check what changed since the draw list was last  
+/// generated - cameras, renderables, their instances, and lights. If         
+/// nothing did, the draw list is kept as it is. GPU culled layers draw all   
+/// instances anyway, so if their instances only moved, they can be moved     
+/// in place, unless the layer sorts them, or they occlude or shadow          
+/// anything. Occluded layers depend on the depth of previous frames, so      
+/// they're generated again for a few frames after they change, until their   
+/// occluders catch up                                                        
+///   @attention instances don't notify anyone when they move, so this reads  
+///              the transform of every instance of every renderable, camera  
+///              and light each frame - O(instances), even when nothing       
+///              changed. Only layers that can move instances in place avoid  
+///              generating the whole draw list again when one instance moves 
+void VulkanLayer::CheckChanges() {
+   CompileCameras();
+
+   Signature signature;
+   signature.Mix(mIndex.GetVersion());
+   signature.Mix(mProducer->GetResolution());
+   for (const auto& camera : mCameras) {
+      signature.Mix(&camera);
+      signature.Mix(camera.mProjection);
+      signature.Mix(camera.mResolution);
+      signature.Mix(camera.mObservableRange);
+      MixInstances(signature, signature, camera.mInstances);
+   }
+
+   // Refreshed, added, or removed renderables change the index version 
+   Signature moved;
+   for (const auto& renderable : mRenderables)
+      MixInstances(signature, moved, renderable.mInstances);
+
+   for (const auto& light : mLights) {
+      signature.Mix(&light);
+      signature.Mix(light.mColor);
+      signature.Mix(light.mRange);
+      MixInstances(signature, signature, light.mInstances);
+   }
+
+   if (mStyle & Style::Hierarchical) {
+      for (const auto& owner : GetOwners())
+         MixHierarchy(signature, owner);
+   }
+
+   const bool movable = mStyle & Style::GPUCulling
+      and mProducer->mCuller.IsSupported()
+      and not (mStyle & (Style::Hierarchical | Style::Sorted | Style::Occluded | Style::Shadowed));
+   if (not movable)
+      signature.Mix(moved.mHash);
+
+   if (signature.mHash != mSignature)
+      mChange = LayerChange::All;
+   else if (moved.mHash != mMoved)
+      mChange = LayerChange::Moved;
+   else
+      mChange = LayerChange::None;
+
+   mSignature = signature.mHash;
+   mMoved = moved.mHash;
+
+   if (mStyle & Style::Occluded) {
+      // Each frame in flight captures occluders of its own draw list,  
+      // which are culled by the occluders of an older one              
+      if (mChange != LayerChange::None)
+         mSettling = 2 * mProducer->mFramesInFlight;
+      else if (mSettling) {
+         --mSettling;
+         mChange = LayerChange::All;
+      }
+   }
+
+   // Shadows were rendered when the draw list was generated            
+   if (mChange != LayerChange::All)
+      mShadowJobs.Clear();
+}
+
+/// Move the instances of a GPU culled layer, whose instances only moved      
+/// since the draw list was generated, by setting their transformations in    
+/// the blocks of instance data, and the culling candidates, they were given  
+/// then - nothing else depends on where instances are                        
+///   @return false if any instance switched its LOD, so the draw list must   
+///           be generated again                                              
+bool VulkanLayer::MoveInstances() {
+   auto& culler = mProducer->mCuller;
+   for (const auto& slot : mSlots) {
+      const auto& staged = mStaged[slot.mStaged];
+      LOD lod {staged.mLevel, staged.mView, staged.mProjection};
+      lod.Transform(slot.mInstance->GetModelTransform(lod));
+      if (lod.GetAbsoluteIndex() != slot.mLOD)
+         return false;
+
+      slot.mPipeline->MoveInstance(slot.mBlock, lod.mModel);
+      culler.Move(slot.mCandidate, lod.mModel);
+   }
+
+   return true;
+}
+
+/// Upload the clustered lights of the draw list to the current frame in      
+/// flight, if they changed since that frame last used them                   
+/// The GPU must be done with that frame                                      
+void VulkanLayer::Upload() {
+   mClusters.Upload();
+}
+
 /// Generate the draw list for the layer                                      
+/// Cameras must already be compiled by CheckChanges()                        
 ///   @param pipelines - [out] a set of all used pipelines                    
 ///   @return true if anything renderable was generated                       
 bool VulkanLayer::Generate(PipelineSet& pipelines) {
-   CompileCameras();
+   // Occluders this frame in flight captured when it was last drawn    
+   // are available now                                                 
+   mHiZ.Resolve();
+
+   if (not (mStyle & Style::Hierarchical))
+      mIndex.NextFrame();
+   CompileShadows();
    CompileLevels();
+   if (not (mStyle & Style::Hierarchical)) {
+      SortSubscribers();
+      GenerateDraws();
+      PlanPasses();
+   }
+   else {
+      // Subscribers are drawn one by one, but their vertex shaders     
+      // still find the instance by its index                           
+      for (Offset i = 0; i < mSubscribers.GetCount() - 1; ++i) {
+         auto& sub = mSubscribers[i].sub;
+         sub.first = mProducer->mIndirect.PushInstances(&sub.instance, 1);
+      }
+   }
    return 0 != pipelines.InsertBlock(mRelevantPipelines);
 }
 
@@ -83,6 +244,15 @@ VulkanPipeline* VulkanLayer::CompileInstance(
       lod.Transform(instance->GetModelTransform(lod));
    }
 
+   return CompileTransformed(renderable, lod);
+}
+
+/// Compile a renderable at the model transformation of a LOD state           
+/// This will create or reuse a pipeline, capable of rendering it             
+///   @param renderable - the renderable to compile                           
+///   @param lod - the lod state to use, already transformed                  
+///   @return the pipeline if the renderable is relevant                      
+VulkanPipeline* VulkanLayer::CompileTransformed(const VulkanRenderable* renderable, LOD& lod) {
    // Get relevant pipeline                                             
    auto pipeline = renderable->GetOrCreatePipeline(lod, this);
    if (not pipeline)
@@ -206,25 +376,132 @@ Count VulkanLayer::CompileLevelHierarchical(
    return renderedEntities;
 }
 
-/// Compile a single level's instances batched style                          
-///   @param view - the camera view matrix                                    
-///   @param projection - the camera projection matrix                        
-///   @param level - the level to compile                                     
+/// Make a depth sorting key for an instance                                  
+///   @param view - the view transformation of the instance's level           
+///   @param model - the instance's model transformation                      
+///   @return the distance from the camera to the instance, as a key          
+static uint32_t DepthKey(const Mat4& view, const Mat4& model) {
+   float m[16];
+   MatrixToFloats(view * model, m);
+   return DepthToKey(::std::sqrt(m[12] * m[12] + m[13] * m[13] + m[14] * m[14]));
+}
+
+/// Find the visible instances of all camera levels, in parallel (used only   
+/// in batched layers). Levels are staged in the exact order CompileLevels    
+/// compiles them, each by a separate job, into its own StagedLevel - the     
+/// compilation then consumes them one by one, so the draw list is the same   
+/// as if the levels were never staged                                        
+void VulkanLayer::StageLevels() {
+   mStagedCount = 0;
+   mNextStaged = 0;
+   const auto stage = [&](const VulkanCamera* camera, Level level, const Mat4& view, const Mat4& projection) {
+      auto& staged = mStagedCount < mStaged.size()
+         ? mStaged[mStagedCount] : mStaged.emplace_back();
+      staged.mCamera = camera;
+      staged.mLevel = level;
+      staged.mView = view;
+      staged.mProjection = projection;
+      ++mStagedCount;
+   };
+
+   if (not mCameras)
+      stage(nullptr, {}, {}, {});
+   else for (const auto& camera : mCameras) {
+      if (mStyle & Style::Multilevel) {
+         for (auto level = camera.mObservableRange.mMax; level >= camera.mObservableRange.mMin; --level)
+            stage(&camera, level, camera.GetViewTransform(level), camera.mProjection);
+      }
+      else if (camera.mObservableRange.Inside(Level::Default))
+         stage(&camera, {}, camera.GetViewTransform(), camera.mProjection);
+   }
+
+   auto& jobs = *mProducer->mJobs;
+   const bool gpuCulled = (mStyle & Style::GPUCulling) and mProducer->mCuller.IsSupported();
+   if (not gpuCulled) {
+      // Each level's bounds must be up to date before any camera       
+      // queries it, and different levels can be updated in parallel    
+      mStagedLevels.clear();
+      for (Offset i = 0; i < mStagedCount; ++i) {
+         const auto level = mStaged[i].mLevel;
+         if (::std::find(mStagedLevels.begin(), mStagedLevels.end(), level) == mStagedLevels.end())
+            mStagedLevels.push_back(level);
+      }
+
+      jobs.Run(static_cast<uint32_t>(mStagedLevels.size()), [&](uint32_t i, uint32_t) {
+         mIndex.Prepare(mStagedLevels[i]);
+      });
+   }
+
+   mScratch.resize(jobs.GetWorkers());
+   jobs.Run(static_cast<uint32_t>(mStagedCount), [&](uint32_t i, uint32_t worker) {
+      StageLevel(mStaged[i], mScratch[worker], gpuCulled);
+   });
+}
+
+/// Find the visible instances of a single camera level, and transform them   
+/// to their LOD - runs on any thread, so it only reads the scene, and writes 
+/// only to the staged level                                                  
+///   @param staged - [in/out] the camera level                               
+///   @param scratch - [in/out] the worker's storage for queries              
+///   @param gpuCulled - whether instances are culled later, on the GPU       
+void VulkanLayer::StageLevel(StagedLevel& staged, LevelIndex::Scratch& scratch, bool gpuCulled) {
+   staged.mInstances.clear();
+   staged.mOccluded = 0;
+   LOD lod {staged.mLevel, staged.mView, staged.mProjection};
+
+   const auto stage = [&](const LevelIndex::Entry& entry) {
+      // Skip instances hidden behind the previous frame's depth        
+      const auto model = entry.mInstance->GetModelTransform(lod);
+      if (mStyle & Style::Occluded and mHiZ.IsOccluded(staged.mCamera, staged.mLevel, model)) {
+         ++staged.mOccluded;
+         return;
+      }
+
+      lod.Transform(model);
+      staged.mInstances.push_back({
+         entry.mRenderable, entry.mInstance, model, lod.mModel, lod.GetAbsoluteIndex(),
+         mStyle & Style::Sorted ? DepthKey(lod.mView, model) : 0u
+      });
+   };
+
+   // Only instances in this level are visited - GPU culled layers take 
+   // all of them, others only those the level's BVH finds in the       
+   // frustum, whose cached bounding boxes then pass the frustum too    
+   if (gpuCulled)
+      mIndex.ForEach(staged.mLevel, stage);
+   else
+      mIndex.Query(staged.mLevel, staged.mProjection * lod.mView, scratch, stage);
+}
+
+/// Compile a single level's instances batched style, from the next staged    
+/// camera level                                                              
 ///   @param pipesPerCamera - [out] pipeline set for the current level only   
 ///   @return 1 if anything was rendered, zero otherwise                      
-Count VulkanLayer::CompileLevelBatched(
-   const Mat4& view, const Mat4& projection, 
-   Level level, PipelineSet& pipesPerCamera
-) {
-   // Construct view and frustum   for culling                          
-   LOD lod {level, view, projection};
+Count VulkanLayer::CompileLevelBatched(PipelineSet& pipesPerCamera) {
+   const auto& staged = mStaged[mNextStaged++];
+   const auto level = staged.mLevel;
+   const auto& projection = staged.mProjection;
+
+   // Construct view and frustum for culling                            
+   LOD lod {level, staged.mView, projection};
 
-   // Iterate all renderables                                           
+   // Instances are either already culled while staging, or pushed as   
+   // candidates for the culling compute shader                         
+   auto& culler = mProducer->mCuller;
+   const bool gpuCulled = (mStyle & Style::GPUCulling) and culler.IsSupported();
+   const auto frustum = gpuCulled
+      ? culler.PushFrustum(projection * lod.mView, level) : 0;
+   mProducer->mStats.mOccluded += staged.mOccluded;
+
+   // Renderables without instances are only in the default level       
    Count renderedInstances = 0;
-   for (const auto& renderable : mRenderables) {
-      if (not renderable.mInstances) {
-         auto pipeline = CompileInstance(&renderable, nullptr, lod);
+   if (level == Level::Default) {
+      for (auto renderable : mIndex.GetUnplaced()) {
+         auto pipeline = CompileInstance(renderable, nullptr, lod);
          if (pipeline) {
+            if (mStyle & Style::Sorted)
+               pipeline->SetDepth(DepthKey(lod.mView, lod.mModel));
+
             pipeline->PushUniforms<Rate::Instance>();
             pipeline->PushUniforms<Rate::Renderable>();
             pipesPerCamera << pipeline;
@@ -232,16 +509,53 @@ Count VulkanLayer::CompileLevelBatched(
             ++renderedInstances;
          }
       }
-      else for (auto instance : renderable.mInstances) {
-         auto pipeline = CompileInstance(&renderable, instance, lod);
-         if (pipeline) {
-            pipeline->PushUniforms<Rate::Instance>();
-            pipeline->PushUniforms<Rate::Renderable>();
-            pipesPerCamera << pipeline;
-            mRelevantPipelines << pipeline;
-            ++renderedInstances;
+   }
+
+   // Instances of a renderable are staged one after another - a run of 
+   // them at the same LOD shares the pipeline, geometry, textures and  
+   // renderable uniforms, so only the run's first instance is compiled, 
+   // and the rest are copied from the staged level                     
+   const auto& instances = staged.mInstances;
+   for (Offset begin = 0, end = 0; begin < instances.size(); begin = end) {
+      const auto& first = instances[begin];
+      end = begin + 1;
+      while (end < instances.size() and instances[end].mRenderable == first.mRenderable
+      and instances[end].mLOD == first.mLOD)
+         ++end;
+
+      // The LOD state picks the run's geometry and textures, so it is  
+      // set up from the untransformed model, just like when staging    
+      lod.Transform(first.mTransform);
+      const auto pipeline = CompileTransformed(first.mRenderable, lod);
+      if (not pipeline)
+         continue;
+
+      pipesPerCamera << pipeline;
+      mRelevantPipelines << pipeline;
+
+      if (gpuCulled) {
+         mCandidates.clear();
+         for (auto i = begin; i < end; ++i) {
+            mCandidates.push_back(culler.PushCandidate(
+               instances[i].mModel, instances[i].mInstance->GetLevel(), frustum));
+         }
+      }
+
+      const auto block = pipeline->PushInstances(
+         &first, end - begin, gpuCulled ? mCandidates.data() : nullptr);
+
+      if (gpuCulled) {
+         // Remember where the instances went, in case they only move   
+         for (auto i = begin; i < end; ++i) {
+            mSlots.push_back({
+               instances[i].mInstance, pipeline, mNextStaged - 1, first.mLOD,
+               static_cast<uint32_t>(block + i - begin), mCandidates[i - begin]
+            });
          }
       }
+
+      pipeline->PushUniforms<Rate::Renderable>();
+      renderedInstances += end - begin;
    }
 
    if (renderedInstances) {
@@ -269,6 +583,10 @@ Count VulkanLayer::CompileLevels() {
    Count renderedCameras = 0;
    mRelevantLevels.Clear();
    mRelevantPipelines.Clear();
+   mSlots.clear();
+   mClusters.Clear();
+   mLightSources.clear();
+   mLitCameras.Clear();
 
    if (mStyle & Style::Hierarchical) {
       mSubscribers.Clear();
@@ -278,6 +596,7 @@ Count VulkanLayer::CompileLevels() {
       mSubscriberCountPerCamera.Clear();
       mSubscriberCountPerCamera.New(1);
    }
+   else StageLevels();
 
    if (not mCameras) {
       // No camera, so just render default level on the whole screen    
@@ -285,14 +604,14 @@ Count VulkanLayer::CompileLevels() {
       if (mStyle & Style::Hierarchical)
          CompileLevelHierarchical({}, {}, {}, pipesPerCamera);
       else
-         CompileLevelBatched({}, {}, {}, pipesPerCamera);
+         CompileLevelBatched(pipesPerCamera);
 
       if (pipesPerCamera) {
          for (auto pipeline : pipesPerCamera) {
             // Push PerCamera uniforms if required                      
             pipeline->SetUniform<Rate::Camera, Traits::Projection>(Mat4 {});
             pipeline->SetUniform<Rate::Camera, Traits::FOV>(Radians {});
-            pipeline->SetUniform<Rate::Camera, Traits::Size>(GetWindow()->GetSize());
+            pipeline->SetUniform<Rate::Camera, Traits::Size>(mProducer->GetResolution());
             if (mStyle & Style::Hierarchical)
                pipeline->PushUniforms<Rate::Camera, false>();
             else
@@ -301,6 +620,8 @@ Count VulkanLayer::CompileLevels() {
 
          if (mStyle & Style::Hierarchical)
             mSubscriberCountPerCamera.New(1);
+         else
+            CompileLights(nullptr);
          ++renderedCameras;
       }
    }
@@ -310,20 +631,18 @@ Count VulkanLayer::CompileLevels() {
       if (mStyle & Style::Multilevel) {
          // Multilevel style - tests all camera-visible levels          
          for (auto level = camera.mObservableRange.mMax; level >= camera.mObservableRange.mMin; --level) {
-            const auto view = camera.GetViewTransform(level);
             if (mStyle & Style::Hierarchical)
-               CompileLevelHierarchical(view, camera.mProjection, level, pipesPerCamera);
+               CompileLevelHierarchical(camera.GetViewTransform(level), camera.mProjection, level, pipesPerCamera);
             else
-               CompileLevelBatched(view, camera.mProjection, level, pipesPerCamera);
+               CompileLevelBatched(pipesPerCamera);
          }
       }
       else if (camera.mObservableRange.Inside(Level::Default)) {
          // Default level style - checks only if camera sees default    
-         const auto view = camera.GetViewTransform();
          if (mStyle & Style::Hierarchical)
-            CompileLevelHierarchical(view, camera.mProjection, {}, pipesPerCamera);
+            CompileLevelHierarchical(camera.GetViewTransform(), camera.mProjection, {}, pipesPerCamera);
          else
-            CompileLevelBatched(view, camera.mProjection, {}, pipesPerCamera);
+            CompileLevelBatched(pipesPerCamera);
       }
       else continue;
 
@@ -341,6 +660,8 @@ Count VulkanLayer::CompileLevels() {
 
          if (mStyle & Style::Hierarchical)
             mSubscriberCountPerCamera.New(1);
+         else
+            CompileLights(&camera);
          mRelevantCameras << &camera;
          ++renderedCameras;
       }
@@ -349,157 +670,750 @@ Count VulkanLayer::CompileLevels() {
    return renderedCameras;
 }
 
-/// Render the layer to a specific command buffer and framebuffer             
-///   @param config - where to render to                                      
-void VulkanLayer::Render(const RenderConfig& config) const {
-   if (mStyle & Style::Hierarchical)
-      RenderHierarchical(config);
+/// Compile the lights of a camera (used only in batched layers). Layers with 
+/// deferred lights keep them for RenderLights, others bin them into the      
+/// clusters of the camera. Either way, lights illuminate only the level      
+/// nearest to the camera                                                     
+///   @param camera - the camera, or nullptr if using the default one         
+void VulkanLayer::CompileLights(const VulkanCamera* camera) {
+   // Levels are stored negated                                         
+   const Level level = mRelevantLevels ? -*mRelevantLevels.last() : Level {};
+   const auto view = camera ? camera->GetViewTransform(level) : Mat4 {};
+
+   if (mStyle & Style::DeferredLights) {
+      const auto shadows = mStyle & Style::Shadowed ? &mProducer->mShadows : nullptr;
+      const auto start = mLightSources.size();
+      for (const auto& light : mLights)
+         light.Compile(view, level, mLightSources, shadows);
+      mLitCameras << LitCamera {camera, start, mLightSources.size() - start};
+      return;
+   }
+
+   mLightSources.clear();
+   for (const auto& light : mLights)
+      light.Compile(view, level, mLightSources);
+
+   if (camera)
+      mClusters.Push(camera, camera->mProjection, camera->mProjectionInverted, mLightSources);
    else
-      RenderBatched(config);
+      mClusters.Push(nullptr, {}, {}, mLightSources);
 }
 
-/// Render the layer to a specific command buffer and framebuffer             
-/// This is used only for Batched style layers, and relies on previously      
-/// compiled set of pipelines                                                 
-///   @param config - where to render to                                      
-void VulkanLayer::RenderBatched(const RenderConfig& config) const {
-   // Iterate all valid cameras                                         
-   TUnorderedMap<const VulkanPipeline*, Count> done;
+/// Request shadows for all lights, and find the ones that must be rendered   
+/// again (used only in Shadowed layers with deferred lights). Must be done   
+/// before compiling the lights, so that they find their shadows              
+void VulkanLayer::CompileShadows() {
+   mShadowLevels.clear();
+   mShadowJobs.Clear();
+   mShadowCasters.Clear();
+   if (not (mStyle & Style::Shadowed) or not (mStyle & Style::DeferredLights)
+   or mStyle & Style::Hierarchical)
+      return;
+
+   for (const auto& light : mLights) {
+      if (not light.mInstances)
+         RequestShadow(&light, {}, Level::Default, light.mRange);
+      else for (auto instance : light.mInstances) {
+         const auto level = instance->GetLevel();
+         RequestShadow(instance, instance->GetModelTransform(level), level, light.mRange);
+      }
+   }
+}
 
-   if (not mRelevantCameras) {
-      // Rendering using a fallback camera                              
-      VkViewport viewport {};
-      viewport.width = (*GetProducer()->mResolution)[0];
-      viewport.height = (*GetProducer()->mResolution)[1];
-
-      VkRect2D scissor {};
-      scissor.extent.width = static_cast<uint32_t>(viewport.width);
-      scissor.extent.height = static_cast<uint32_t>(viewport.height);
-
-      vkCmdBeginRenderPass(config.mCommands, &config.mPassBeginInfo,
-         VK_SUBPASS_CONTENTS_INLINE);
-      vkCmdSetViewport(config.mCommands, 0, 1, &viewport);
-      vkCmdSetScissor(config.mCommands, 0, 1, &scissor);
+/// Gather all renderables in a level, that might cast shadows                
+/// Each level is gathered only once per frame                                
+///   @param level - the level                                                
+///   @return the index of the level in mShadowLevels                         
+Offset VulkanLayer::GatherCasters(Level level) {
+   for (Offset i = 0; i < mShadowLevels.size(); ++i) {
+      if (mShadowLevels[i].mLevel == level)
+         return i;
+   }
+
+   auto& result = mShadowLevels.emplace_back();
+   result.mLevel = level;
+
+   const auto push = [&](const VulkanRenderable* renderable, const LOD& lod) {
+      const auto geometry = renderable->GetGeometry(lod);
+      if (not geometry)
+         return;
+
+      float m[16];
+      MatrixToFloats(lod.mModel, m);
+      result.mCasters.push_back(MakeShadowCaster(m));
+      result.mGeometry.push_back(geometry);
+   };
+
+   if (level == Level::Default) {
+      for (auto renderable : mIndex.GetUnplaced()) {
+         LOD lod {level, {}, {}};
+         lod.Transform();
+         push(renderable, lod);
+      }
+   }
+
+   mIndex.ForEach(level, [&](const LevelIndex::Entry& entry) {
+      LOD lod {level, {}, {}};
+      lod.Transform(entry.mInstance->GetModelTransform(lod));
+      push(entry.mRenderable, lod);
+   });
+
+   return mShadowLevels.size() - 1;
+}
+
+/// Request the shadow of a light, and schedule it for rendering, if it       
+/// changed since the last time it was rendered                               
+///   @param key - the light instance, or the light, if it has no instances   
+///   @param model - the light's model transformation in its level            
+///   @param level - the light's level                                        
+///   @param range - the light's range                                        
+void VulkanLayer::RequestShadow(const void* key, const Mat4& model, Level level, Real range) {
+   const auto index = GatherCasters(level);
+   float m[16];
+   MatrixToFloats(model, m);
+   const float light[4] {m[12], m[13], m[14], static_cast<float>(range)};
+
+   bool dirty;
+   const auto entry = mProducer->mShadows.Request(
+      key, light, mShadowLevels[index].mCasters, mShadowTouched, dirty);
+   if (entry < 0 or not dirty)
+      return;
+
+   mShadowJobs << ShadowJob {entry, index, mShadowCasters.GetCount(), mShadowTouched.size()};
+   for (auto caster : mShadowTouched)
+      mShadowCasters << caster;
+}
+
+/// Sort the subscribers of all relevant pipelines by their state, in order   
+/// to minimize state changes (used only in batched layers, because sorting   
+/// destroys the order in which renderables appear). Sorted layers order      
+/// them by distance to camera first                                          
+void VulkanLayer::SortSubscribers() {
+   const auto start = SteadyClock::Now();
+   const bool byDepth = mStyle & Style::Sorted;
+   for (auto pipeline : mRelevantPipelines)
+      pipeline->SortSubscribers(mSortKeys, mSortScratch, byDepth);
+   mProducer->mStats.mSortTime += SteadyClock::Now() - start;
+}
+
+/// Write indirect draw commands for all relevant pipelines (used only in     
+/// batched layers, after sorting)                                            
+void VulkanLayer::GenerateDraws() {
+   for (auto pipeline : mRelevantPipelines)
+      pipeline->GenerateDraws(mProducer->mIndirect);
+}
+
+/// Plan the render passes of a batched layer, one for each camera, by        
+/// splitting their draw lists into steps, in the exact order they're drawn   
+/// Steps are small enough to be spread between workers, that record them     
+/// Stereo cameras of forward lit layers draw both eyes at once, in the       
+/// stereo target's multiview pass, if the device has it and the back buffer  
+/// can be copied - otherwise they draw the same steps once for each eye,     
+/// which is also how layers with deferred lights draw them                   
+void VulkanLayer::PlanPasses() {
+   mPasses.clear();
+   mPassSteps.clear();
+
+   TUnorderedMap<const VulkanPipeline*, Offset> done;
+   const bool sorted = mStyle & Style::Sorted;
+   // Occluders are captured from the back buffer's depth, which the    
+   // stereo target doesn't write to                                    
+   const bool multiview = not (mStyle & Style::DeferredLights)
+      and not (mStyle & Style::Occluded)
+      and mProducer->mStereo.GetPass()
+      and mProducer->mSwapchain.IsCopyable();
+   bool anyMultiview = false;
+   bool anyStereo = false;
+
+   const auto views = [](const VulkanCamera* camera, Eye eye) {
+      float projection[16], inverse[16];
+      MatrixToFloats(camera->mProjection, projection);
+      MatrixToFloats(camera->mProjectionInverted, inverse);
+      return ViewTransforms::For(eye, projection, inverse,
+         static_cast<float>(camera->mEyeSeparation));
+   };
+
+   const auto plan = [&](VulkanPipeline* pipeline) {
+      // Draw all subscribers to the pipeline for the current level     
+      auto& begin = done[pipeline];
+      const auto end = pipeline->GetLevelEnd(begin);
+      while (begin < end) {
+         Count draws = SecondaryCommands::MinDraws;
+         const auto next = pipeline->SkipDraws(begin, end, draws);
+         mPassSteps.push_back({pipeline, begin, next, draws});
+         begin = next;
+      }
+   };
+
+   const auto planPass = [&](const VulkanCamera* camera) {
+      const auto start = mPassSteps.size();
 
       // Iterate all relevant levels                                    
-      for (const auto& level : mRelevantLevels) {
-         // Draw all subscribers to the pipeline for the current level  
-         for (auto pipeline : mRelevantPipelines)
-            done[pipeline] = pipeline->RenderLevel(done[pipeline]);
+      for (Offset level = 0; level < mRelevantLevels.GetCount(); ++level) {
+         // Each level starts by clearing depth, or by switching to     
+         // its slice of the depth range                                
+         mPassSteps.push_back({nullptr, level, 0, 0});
+
+         // Sorted layers draw blended pipelines after all opaque ones  
+         for (auto pipeline : mRelevantPipelines) {
+            if (not sorted or not pipeline->IsBlended())
+               plan(pipeline);
+         }
 
-         if (level != *mRelevantLevels.last()) {
-            // Clear depth after rendering this level (if not last)     
-            const VkClearRect rect {scissor, 0, 1};
-            vkCmdClearAttachments(config.mCommands, 1, &config.mDepthSweep, 1, &rect);
+         if (sorted) {
+            for (auto pipeline : mRelevantPipelines) {
+               if (pipeline->IsBlended())
+                  plan(pipeline);
+            }
          }
       }
 
-      // Main pass ends                                                 
-      vkCmdEndRenderPass(config.mCommands);
+      const auto count = mPassSteps.size() - start;
+      if (not camera or not camera->IsStereo()) {
+         mPasses.push_back({camera, start, count, Eye::Mono, ViewTransforms::Mono()});
+         return;
+      }
+
+      if (multiview) {
+         const auto& scissor = camera->mVulkanScissor;
+         mProducer->mStereo.Reserve(scissor.extent.width / 2, scissor.extent.height);
+         mPasses.push_back({camera, start, count, Eye::Both, views(camera, Eye::Both)});
+         anyMultiview = true;
+         return;
+      }
+
+      mPasses.push_back({camera, start, count, Eye::Left, views(camera, Eye::Left)});
+      mPasses.push_back({camera, start, count, Eye::Right, views(camera, Eye::Right)});
+      anyStereo = true;
+   };
+
+   if (not mRelevantCameras)
+      planPass(nullptr);
+   else for (auto camera : mRelevantCameras)
+      planPass(camera);
+
+   // Pipelines need variants, that move vertices to the views of the   
+   // eyes, for each way stereo cameras are drawn                       
+   for (auto pipeline : mRelevantPipelines) {
+      if (anyMultiview)
+         pipeline->PrepareStereo(true);
+      if (anyStereo)
+         pipeline->PrepareStereo(false);
    }
-   else for (const auto& camera : mRelevantCameras) {
-      // Rendering from each custom camera's point of view              
-      config.mPassBeginInfo.renderArea.extent.width = camera->mResolution[0];
-      config.mPassBeginInfo.renderArea.extent.height = camera->mResolution[1];
+}
 
-      vkCmdBeginRenderPass(config.mCommands, &config.mPassBeginInfo,
-         VK_SUBPASS_CONTENTS_INLINE);
-      vkCmdSetViewport(config.mCommands, 0, 1, &camera->mVulkanViewport);
-      vkCmdSetScissor(config.mCommands, 0, 1, &camera->mVulkanScissor);
+/// Declare the passes of the layer in the frame's render graph, along with   
+/// the resources they use. They're recorded once the graph is executed       
+///   @param graph - the frame's render graph                                 
+///   @param config - where to render to, must outlive the graph's execution  
+void VulkanLayer::Declare(VulkanGraph& graph, const RenderConfig& config) const {
+   if (mStyle & Style::Hierarchical) {
+      graph.AddPass([this, &config](RenderGraph::Pass pass) {
+         RenderHierarchical(config, pass);
+      });
+      graph.Write(config.mColor, GraphUse::Color);
+      graph.Write(config.mDepth, GraphUse::Depth);
+      return;
+   }
 
-      // Iterate all relevant levels                                    
-      for (const auto& level : mRelevantLevels) {
-         // Draw all subscribers to the pipeline for the current level  
-         for (auto pipeline : mRelevantPipelines)
-            done[pipeline] = pipeline->RenderLevel(done[pipeline]);
+   if (mShadowJobs) {
+      graph.AddPass([this, &config](RenderGraph::Pass) { RenderShadows(config); });
+      graph.Write(config.mShadows, GraphUse::Depth);
+   }
 
-         if (level != *mRelevantLevels.last()) {
-            // Clear depth after rendering this level (if not last)     
-            const VkClearRect rect {camera->mVulkanScissor, 0, 1};
-            vkCmdClearAttachments(config.mCommands, 1, &config.mDepthSweep, 1, &rect);
+   graph.AddPass([this, &config](RenderGraph::Pass pass) {
+      RenderBatched(config, pass);
+   });
+   graph.Read(config.mIndirect, GraphUse::Indirect);
+   if (mStyle & Style::Shadowed)
+      graph.Read(config.mShadows, GraphUse::Sampled);
+   graph.Write(config.mColor, GraphUse::Color);
+   graph.Write(config.mDepth, GraphUse::Depth);
+
+   // Stereo cameras, that draw both eyes at once, go over what the     
+   // layer drew for the other cameras                                  
+   for (Offset p = 0; p < mPasses.size(); ++p) {
+      if (mPasses[p].mEye == Eye::Both)
+         DeclareStereo(graph, config, p);
+   }
+
+   if (mStyle & Style::Occluded)
+      DeclareOccluders(graph, config);
+}
+
+/// Declare a stereo camera's pass, that draws both eyes at once to the       
+/// stereo target, along with copying its viewport in and out of the target   
+///   @param graph - the frame's render graph                                 
+///   @param config - where the layer is rendered to                          
+///   @param pass - index of the camera's pass                                
+void VulkanLayer::DeclareStereo(VulkanGraph& graph, const RenderConfig& config, Offset pass) const {
+   const auto& stereo = mProducer->mStereo;
+   const auto color = graph.Import(stereo.GetColor(), GraphUse::None, false);
+   const auto depth = graph.Import(stereo.GetDepth(), GraphUse::None, false);
+   const auto area = mPasses[pass].mCamera->mVulkanScissor;
+
+   graph.AddPass([this, &config, &stereo, area](RenderGraph::Pass) {
+      config.EndPass();
+      stereo.CopyIn(config.mState, mProducer->mSwapchain.GetCurrentImage(), area);
+   });
+   graph.Read(config.mColor, GraphUse::TransferRead);
+   graph.Write(color, GraphUse::TransferWrite, true);
+
+   graph.AddPass([this, &config, pass](RenderGraph::Pass) {
+      RenderStereo(config, pass);
+   });
+   graph.Read(config.mIndirect, GraphUse::Indirect);
+   graph.Write(color, GraphUse::Color);
+   graph.Write(depth, GraphUse::Depth, true);
+
+   graph.AddPass([this, &config, &stereo, area](RenderGraph::Pass) {
+      stereo.CopyOut(config.mState, mProducer->mSwapchain.GetCurrentImage(), area);
+   });
+   graph.Read(color, GraphUse::TransferRead);
+   graph.Write(config.mColor, GraphUse::TransferWrite);
+}
+
+/// Render a stereo camera's pass to the stereo target, both eyes at once     
+/// Must be recorded outside of any render pass                               
+///   @param config - where the layer is rendered to                          
+///   @param pass - index of the camera's pass                                
+void VulkanLayer::RenderStereo(const RenderConfig& config, Offset pass) const {
+   const auto& info = mPasses[pass];
+   const auto& area = info.mCamera->mVulkanScissor;
+   const auto& stereo = mProducer->mStereo;
+
+   stereo.Begin(config.mState, {area.extent.width / 2, area.extent.height});
+   RecordSteps(config.mState, config.mDepthSweep, info,
+      mClusters.GetSet(info.mCamera), info.mStart, info.mCount);
+   stereo.End(config.mState);
+}
+
+/// Declare the capture of the layer's occluders, right after the layer       
+///   @param graph - the frame's render graph                                 
+///   @param config - where the layer is rendered to                          
+void VulkanLayer::DeclareOccluders(VulkanGraph& graph, const RenderConfig& config) const {
+   if (not mRelevantLevels)
+      return;
+
+   // Eyes of a stereo camera split its depth between them, so it can't 
+   // be tested with the camera's projection                            
+   if (not mPasses.empty() and mPasses.back().mEye != Eye::Mono)
+      return;
+
+   const auto reduced = mHiZ.Prepare();
+   if (not reduced)
+      return;
+
+   // The host reads the reduced depth, once the frame is done          
+   const auto target = graph.Import(reduced, GraphUse::HostRead, false);
+   graph.AddPass([this, &config](RenderGraph::Pass) { CaptureOccluders(config); });
+   graph.Read(config.mDepth, GraphUse::ComputeRead);
+   graph.Write(target, GraphUse::ComputeWrite, true);
+
+   graph.AddPass({}, true);
+   graph.Read(target, GraphUse::HostRead);
+}
+
+/// Capture the depth of the last rendered camera and level, so that the      
+/// next frame can skip instances behind it (used only in Occluded layers)    
+///   @param config - where the layer was rendered to                         
+void VulkanLayer::CaptureOccluders(const RenderConfig& config) const {
+   // Levels are stored negated                                         
+   const Level level = -*mRelevantLevels.last();
+   if (not mRelevantCameras) {
+      mHiZ.Capture(config.mCommands, nullptr, level, {},
+         GetDepthSlice(mRelevantLevels.GetCount() - 1));
+      return;
+   }
+
+   // Cameras are rendered in the order they're iterated                
+   const VulkanCamera* last {};
+   for (auto camera : mRelevantCameras)
+      last = camera;
+
+   mHiZ.Capture(config.mCommands, last, level,
+      last->mProjection * last->GetViewTransform(level),
+      GetDepthSlice(mRelevantLevels.GetCount() - 1));
+}
+
+/// Render the shadows, that changed since they were last rendered (used      
+/// only in Shadowed layers). Must be recorded outside of any render pass     
+///   @param config - where to render to                                      
+void VulkanLayer::RenderShadows(const RenderConfig& config) const {
+   const auto& atlas = mProducer->mShadows;
+   atlas.Begin(config.mState);
+
+   for (const auto& job : mShadowJobs) {
+      const auto& level = mShadowLevels[job.mLevel];
+      for (int face = 0; face < 6; ++face) {
+         float viewProjection[16];
+         atlas.BeginFace(config.mState, job.mEntry, face, viewProjection);
+
+         for (Offset i = job.mStart; i < job.mStart + job.mCount; ++i) {
+            const auto caster = mShadowCasters[i];
+            float transform[16];
+            MultiplyMatrices(viewProjection, level.mCasters[caster].mModel, transform);
+            atlas.Draw(config.mState, level.mGeometry[caster], transform);
          }
       }
 
-      // Main pass ends                                                 
-      vkCmdEndRenderPass(config.mCommands);
+      ++mProducer->mStats.mShadowsRendered;
    }
+
+   atlas.End(config.mState);
 }
 
 /// Render the layer to a specific command buffer and framebuffer             
-/// This is used only for Hierarchical style layers, and relies on locally    
-/// compiled subscribers, rendering them in their respective order            
+/// This is used only for Batched style layers, and relies on previously      
+/// compiled set of pipelines, and the passes planned for them                
+/// All cameras draw in a single render pass, which might be shared with the  
+/// previous and next layers, unless lights are deferred - those light each   
+/// camera in a render pass of its own                                        
 ///   @param config - where to render to                                      
-void VulkanLayer::RenderHierarchical(const RenderConfig& config) const {
-   Count subscribersDone = 0;
-   auto subscriberCountPerLevel = &mSubscriberCountPerLevel[0];
+///   @param graphPass - the layer's pass in the frame's render graph         
+void VulkanLayer::RenderBatched(const RenderConfig& config, RenderGraph::Pass graphPass) const {
+   // Layers with deferred lights draw to the G-buffer first            
+   const bool deferred = mStyle & Style::DeferredLights;
+   VkRenderPassBeginInfo passInfo = config.mPassBeginInfo;
+   if (deferred) {
+      passInfo.renderPass = config.mDeferredPass;
+      passInfo.framebuffer = config.mDeferredFrame;
+      passInfo.clearValueCount = 4;
+   }
 
-   // Iterate all valid cameras                                         
-   if (not mRelevantCameras) {
-      VkViewport viewport {};
-      viewport.width  = (*GetProducer()->mResolution)[0];
-      viewport.height = (*GetProducer()->mResolution)[1];
+   // Large passes are recorded by workers, in parallel                 
+   const bool secondary = RecordPasses(config, passInfo);
+   const auto contents = secondary
+      ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+      : VK_SUBPASS_CONTENTS_INLINE;
+   bool load = config.Loads(graphPass);
+   Offset chunk = 0;
+   ::std::vector<VkCommandBuffer> commands;
+
+   if (deferred)
+      config.EndPass();
+   else
+      config.BeginPass(graphPass, contents);
+
+   for (Offset p = 0; p < mPasses.size(); ++p) {
+      // Rendering from each camera's point of view, or the fallback's  
+      // Both eyes at once are drawn in a pass of their own             
+      const auto& pass = mPasses[p];
+      const auto camera = pass.mCamera;
+      if (pass.mEye == Eye::Both)
+         continue;
+
+      if (deferred) {
+         // Cameras after the first one keep what the others drew       
+         if (camera) {
+            passInfo.renderArea.extent.width = camera->mResolution[0];
+            passInfo.renderArea.extent.height = camera->mResolution[1];
+         }
 
-      VkRect2D scissor {};
-      scissor.extent.width = static_cast<uint32_t>(viewport.width);
-      scissor.extent.height = static_cast<uint32_t>(viewport.height);
+         passInfo.renderPass = load
+            ? config.mDeferredLoadPass
+            : config.mDeferredPass;
+         vkCmdBeginRenderPass(config.mCommands, &passInfo, contents);
+         load = true;
+      }
 
-      vkCmdBeginRenderPass(config.mCommands, &config.mPassBeginInfo,
-         VK_SUBPASS_CONTENTS_INLINE);
-      vkCmdSetViewport(config.mCommands, 0, 1, &viewport);
-      vkCmdSetScissor (config.mCommands, 0, 1, &scissor);
+      if (secondary) {
+         // Execute the pass's chunks, in the order they were planned   
+         commands.clear();
+         for (; chunk < mPassChunks.size() and mPassChunks[chunk].mPass == p; ++chunk)
+            commands.push_back(mPassChunks[chunk].mCommands);
 
-      // Iterate all relevant levels                                    
-      for (const auto& level : mRelevantLevels) {
-         // Draw all subscribers to the pipeline for the current level  
-         for (Count s = 0; s < *subscriberCountPerLevel; ++s) {
-            auto& subscriber = mSubscribers[subscribersDone + s];
-            subscriber.pipeline->RenderSubscriber(subscriber.sub);
+         if (not commands.empty()) {
+            vkCmdExecuteCommands(config.mCommands,
+               static_cast<uint32_t>(commands.size()), commands.data());
          }
 
-         if (level != *mRelevantLevels.last()) {
-            // Clear depth after rendering this level (if not last)     
-            const VkClearRect rect {scissor, 0, 1};
-            vkCmdClearAttachments(config.mCommands, 1, &config.mDepthSweep, 1, &rect);
+         // Whatever the chunks bound, is unknown to the main buffer    
+         config.mState.Invalidate();
+      }
+      else {
+         RecordSteps(config.mState, config.mDepthSweep, pass,
+            mClusters.GetSet(camera), pass.mStart, pass.mCount);
+      }
+
+      if (deferred) {
+         VkViewport viewport;
+         VkRect2D scissor;
+         GetViewport(pass, viewport, scissor);
+         RenderLights(config, camera, scissor);
+         vkCmdEndRenderPass(config.mCommands);
+      }
+   }
+
+   // The next layer might continue drawing in the same pass            
+   if (not deferred)
+      config.EndGroup(graphPass);
+}
+
+/// Record the passes of a batched layer to secondary command buffers, on     
+/// all workers, if there are enough draw calls to be worth it. Each pass is  
+/// split into chunks of consecutive steps, so the draw order is preserved    
+///   @param config - where to render to                                      
+///   @param passInfo - the render pass and framebuffer, the passes continue  
+///   @return true if passes were recorded, false if they must be recorded    
+///           inline instead                                                  
+bool VulkanLayer::RecordPasses(const RenderConfig& config, const VkRenderPassBeginInfo& passInfo) const {
+   auto& jobs = *mProducer->mJobs;
+   Count draws = 0;
+   for (const auto& step : mPassSteps)
+      draws += step.mDraws;
+
+   const Count workers = jobs.GetWorkers();
+   if (workers < 2 or draws < 2 * SecondaryCommands::MinDraws)
+      return false;
+
+   // A couple of chunks per worker, so that uneven ones still keep     
+   // all workers busy                                                  
+   const auto target = ::std::max(SecondaryCommands::MinDraws, draws / (workers * 2));
+   mPassChunks.clear();
+   for (Offset p = 0; p < mPasses.size(); ++p) {
+      const auto& pass = mPasses[p];
+      if (pass.mEye == Eye::Both)
+         continue;
+
+      const auto lights = mClusters.GetSet(pass.mCamera);
+      Count chunkDraws = 0;
+      for (Offset i = pass.mStart; i < pass.mStart + pass.mCount; ++i) {
+         if (i == pass.mStart or chunkDraws >= target) {
+            mPassChunks.push_back({p, i, 0, lights, {}, 0, 0});
+            chunkDraws = 0;
          }
 
-         subscribersDone += *subscriberCountPerLevel;
-         ++subscriberCountPerLevel;
+         ++mPassChunks.back().mCount;
+         chunkDraws += mPassSteps[i].mDraws;
+      }
+   }
+
+   auto& secondary = mProducer->mSecondary;
+   secondary.Reserve(mPassChunks.size());
+   jobs.Run(static_cast<uint32_t>(mPassChunks.size()), [&](uint32_t i, uint32_t worker) {
+      auto& chunk = mPassChunks[i];
+      chunk.mCommands = secondary.Begin(worker, passInfo.renderPass, passInfo.framebuffer);
+
+      CommandState state;
+      state.Begin(chunk.mCommands, mProducer->mLayouts);
+      RecordSteps(state, config.mDepthSweep, mPasses[chunk.mPass],
+         chunk.mLights, chunk.mStart, chunk.mCount);
+      vkEndCommandBuffer(chunk.mCommands);
+
+      chunk.mIssued = state.mIssued;
+      chunk.mSkipped = state.mSkipped;
+   });
+
+   for (const auto& chunk : mPassChunks) {
+      config.mState.mIssued += chunk.mIssued;
+      config.mState.mSkipped += chunk.mSkipped;
+   }
+   return true;
+}
+
+/// Record a range of steps of a batched layer's pass - runs on any thread,   
+/// and sets its own viewport, so that it works in secondary buffers, too     
+///   @param state - the command buffer state to record to                    
+///   @param sweep - the depth clear, used before levels                      
+///   @param pass - the pass, the steps belong to                             
+///   @param lights - the clustered lights of the camera, if any              
+///   @param start - the first step                                           
+///   @param count - the number of steps                                      
+void VulkanLayer::RecordSteps(
+   CommandState& state, const VkClearAttachment& sweep,
+   const LayerPass& pass, VkDescriptorSet lights, Offset start, Count count
+) const {
+   VkViewport viewport;
+   VkRect2D scissor;
+   GetViewport(pass, viewport, scissor);
+
+   // Stereo views stay pushed between the stereo variants of material  
+   // pipelines, which share the push constant range - the camera       
+   // itself is drawn by pipelines without one                          
+   if (pass.mEye != Eye::Mono) {
+      vkCmdPushConstants(state.GetCommands(), mProducer->mViewsLayout,
+         VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pass.mViews.mViews), pass.mViews.mViews);
+   }
+
+   // Chunks might start in the middle of a level, so find its slice    
+   const bool sliced = mStyle & Style::DepthSliced;
+   if (sliced) {
+      auto level = start;
+      while (mPassSteps[level].mPipeline)
+         --level;
+
+      const auto slice = GetDepthSlice(mPassSteps[level].mBegin);
+      viewport.minDepth = slice.mMin;
+      viewport.maxDepth = slice.mMax;
+   }
+
+   vkCmdSetViewport(state.GetCommands(), 0, 1, &viewport);
+   vkCmdSetScissor(state.GetCommands(), 0, 1, &scissor);
+
+   for (Offset i = start; i < start + count; ++i) {
+      const auto& step = mPassSteps[i];
+      if (step.mPipeline) {
+         step.mPipeline->RenderRange(step.mBegin, step.mEnd, state, lights, pass.mEye);
+         continue;
       }
 
-      // Main pass ends                                                 
-      vkCmdEndRenderPass(config.mCommands);
+      // Levels of depth sliced layers only switch the depth range -    
+      // just the first one clears what other cameras and layers left   
+      if (sliced and step.mBegin) {
+         const auto slice = GetDepthSlice(step.mBegin);
+         viewport.minDepth = slice.mMin;
+         viewport.maxDepth = slice.mMax;
+         vkCmdSetViewport(state.GetCommands(), 0, 1, &viewport);
+         continue;
+      }
+
+      // Clear depth before rendering a level, inside the scissor only, 
+      // since cameras share the render pass                            
+      const VkClearRect rect {scissor, 0, 1};
+      vkCmdClearAttachments(state.GetCommands(), 1, &sweep, 1, &rect);
+   }
+}
+
+/// Get the viewport and scissor a camera renders to                          
+///   @param camera - the camera, or nullptr if using the default one         
+///   @param viewport - [out] the viewport                                    
+///   @param scissor - [out] the scissor                                      
+void VulkanLayer::GetViewport(const VulkanCamera* camera, VkViewport& viewport, VkRect2D& scissor) const {
+   if (camera) {
+      viewport = camera->mVulkanViewport;
+      scissor = camera->mVulkanScissor;
+      return;
+   }
+
+   // The fallback camera renders to the whole window                   
+   viewport = {};
+   viewport.width = (*GetProducer()->mResolution)[0];
+   viewport.height = (*GetProducer()->mResolution)[1];
+
+   scissor = {};
+   scissor.extent.width = static_cast<uint32_t>(viewport.width);
+   scissor.extent.height = static_cast<uint32_t>(viewport.height);
+}
+
+/// Get the viewport and scissor a pass renders to - eyes draw to their half  
+/// of the camera's viewport, or to the origin of their layer in the stereo   
+/// target                                                                    
+///   @param pass - the pass                                                  
+///   @param viewport - [out] the viewport                                    
+///   @param scissor - [out] the scissor                                      
+void VulkanLayer::GetViewport(const LayerPass& pass, VkViewport& viewport, VkRect2D& scissor) const {
+   GetViewport(pass.mCamera, viewport, scissor);
+   if (pass.mEye == Eye::Mono)
+      return;
+
+   viewport.width *= 0.5f;
+   scissor.extent.width /= 2;
+   if (pass.mEye == Eye::Right) {
+      viewport.x += static_cast<float>(scissor.extent.width);
+      scissor.offset.x += static_cast<int32_t>(scissor.extent.width);
+   }
+   else if (pass.mEye == Eye::Both) {
+      viewport.x -= static_cast<float>(scissor.offset.x);
+      viewport.y -= static_cast<float>(scissor.offset.y);
+      scissor.offset = {};
+   }
+}
+
+/// Get the slice of the depth range a level is drawn in                      
+///   @param level - the level's index, in the order levels are drawn         
+///   @return the slice, or the whole range, if the layer isn't depth sliced  
+DepthSlice VulkanLayer::GetDepthSlice(Offset level) const {
+   if (not (mStyle & Style::DepthSliced))
+      return {};
+   return DepthSlice::Of(level, mRelevantLevels.GetCount());
+}
+
+/// Light the G-buffer, that was just drawn (used only in batched layers      
+/// with deferred lights), with the lights compiled for the camera            
+///   @param config - where to render to                                      
+///   @param camera - the camera, or nullptr if using the default one         
+///   @param area - the rendered area, in pixels                              
+void VulkanLayer::RenderLights(
+   const RenderConfig& config, const VulkanCamera* camera, const VkRect2D& area
+) const {
+   const auto projection = camera ? camera->mProjection : Mat4 {};
+   // Lights illuminate only the nearest level, which is drawn last     
+   const auto slice = GetDepthSlice(mRelevantLevels.GetCount() - 1);
+   for (const auto& lit : mLitCameras) {
+      if (lit.mCamera != camera)
+         continue;
+
+      mProducer->mLightPass.Render(config.mState, area, projection, slice,
+         mLightSources.data() + lit.mStart, lit.mCount);
+      return;
    }
-   else for (const auto& camera : mRelevantCameras) {
-      config.mPassBeginInfo.renderArea.extent.width = camera->mResolution[0];
-      config.mPassBeginInfo.renderArea.extent.height = camera->mResolution[1];
 
-      vkCmdBeginRenderPass(config.mCommands, &config.mPassBeginInfo,
-         VK_SUBPASS_CONTENTS_INLINE);
-      vkCmdSetViewport(config.mCommands, 0, 1, &camera->mVulkanViewport);
-      vkCmdSetScissor (config.mCommands, 0, 1, &camera->mVulkanScissor);
+   mProducer->mLightPass.Render(config.mState, area, projection, slice, nullptr, 0);
+}
+
+/// Render the layer to a specific command buffer and framebuffer             
+/// This is used only for Hierarchical style layers, and relies on locally    
+/// compiled subscribers, rendering them in their respective order            
+/// All cameras draw in a single render pass, each clearing only the depth    
+/// inside its own scissor                                                    
+///   @param config - where to render to                                      
+///   @param graphPass - the layer's pass in the frame's render graph         
+void VulkanLayer::RenderHierarchical(const RenderConfig& config, RenderGraph::Pass graphPass) const {
+   Count subscribersDone = 0;
+   auto subscriberCountPerLevel = &mSubscriberCountPerLevel[0];
+   config.BeginPass(graphPass, VK_SUBPASS_CONTENTS_INLINE);
+
+   const bool sliced = mStyle & Style::DepthSliced;
+   const auto render = [&](VkViewport viewport, const VkRect2D& scissor) {
+      // Cameras only switch viewport and scissor, since they share the 
+      // render pass, and clear depth only inside the latter            
+      vkCmdSetScissor(config.mCommands, 0, 1, &scissor);
+      const VkClearRect rect {scissor, 0, 1};
+      vkCmdClearAttachments(config.mCommands, 1, &config.mDepthSweep, 1, &rect);
 
       // Iterate all relevant levels                                    
+      Offset index = 0;
       for (const auto& level : mRelevantLevels) {
+         // Depth sliced layers switch the depth range for each level,  
+         // instead of clearing depth between them                      
+         if (sliced or index == 0) {
+            const auto slice = GetDepthSlice(index);
+            viewport.minDepth = slice.mMin;
+            viewport.maxDepth = slice.mMax;
+            vkCmdSetViewport(config.mCommands, 0, 1, &viewport);
+         }
+
          // Draw all subscribers to the pipeline for the current level  
          // and camera                                                  
          for (Count s = 0; s < *subscriberCountPerLevel; ++s) {
             auto& subscriber = mSubscribers[subscribersDone + s];
-            subscriber.pipeline->RenderSubscriber(subscriber.sub);
+            subscriber.pipeline->RenderSubscriber(subscriber.sub, config.mState);
          }
 
-         if (level != *mRelevantLevels.last()) {
+         if (not sliced and level != *mRelevantLevels.last()) {
             // Clear depth after rendering this level (if not last)     
-            const VkClearRect rect {camera->mVulkanScissor, 0, 1};
             vkCmdClearAttachments(config.mCommands, 1, &config.mDepthSweep, 1, &rect);
          }
 
          subscribersDone += *subscriberCountPerLevel;
          ++subscriberCountPerLevel;
+         ++index;
       }
+   };
 
-      // Main pass ends                                                 
-      vkCmdEndRenderPass(config.mCommands);
+   // Iterate all valid cameras                                         
+   if (not mRelevantCameras) {
+      VkViewport viewport;
+      VkRect2D scissor;
+      GetViewport(nullptr, viewport, scissor);
+      render(viewport, scissor);
    }
+   else for (const auto& camera : mRelevantCameras)
+      render(camera->mVulkanViewport, camera->mVulkanScissor);
+
+   // The next layer might continue drawing in the same pass            
+   config.EndGroup(graphPass);
 }
 
 /// Get the style of a layer                                                  
@@ -513,3 +1427,51 @@ VulkanLayer::Style VulkanLayer::GetStyle() const noexcept {
 const A::Window* VulkanLayer::GetWindow() const noexcept {
    return mProducer->GetWindow();
 }
+
+/// Check if a graph pass must keep what was drawn to the back buffer, before 
+/// it - otherwise it is cleared as the render pass begins                    
+///   @param pass - the graph pass                                            
+///   @return true if the back buffer must be loaded                          
+bool RenderConfig::Loads(RenderGraph::Pass pass) const {
+   const auto use = mGraph->FindUse(pass, mColor);
+   return use and use->mLoad == GraphLoad::Load;
+}
+
+/// Begin the main render pass, unless the previous pass of the same graph    
+/// group left it open - the group needs no barriers between its passes, so   
+/// it can draw all of them without ending the render pass                    
+///   @param pass - the graph pass, that draws                                
+///   @param contents - whether the pass is recorded inline, or in secondary  
+///                     command buffers                                       
+void RenderConfig::BeginPass(RenderGraph::Pass pass, VkSubpassContents contents) const {
+   if (mPassOpen) {
+      // Secondary buffers can't be executed in an inline pass, and     
+      // vice versa                                                     
+      if (mPassContents == contents)
+         return;
+      EndPass();
+   }
+
+   auto passInfo = mPassBeginInfo;
+   passInfo.renderPass = Loads(pass) ? mLoadPass : mPass;
+   vkCmdBeginRenderPass(mCommands, &passInfo, contents);
+   mPassOpen = true;
+   mPassContents = contents;
+}
+
+/// End the main render pass, if it was left open                             
+void RenderConfig::EndPass() const {
+   if (not mPassOpen)
+      return;
+
+   vkCmdEndRenderPass(mCommands);
+   mPassOpen = false;
+}
+
+/// End the main render pass, if the graph pass is the last of its group      
+/// The next group might begin with barriers, which can't be in a pass        
+///   @param pass - the graph pass, that drew                                 
+void RenderConfig::EndGroup(RenderGraph::Pass pass) const {
+   if (mGraph->EndsGroup(pass))
+      EndPass();
+}
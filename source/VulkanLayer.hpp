@@ -10,6 +10,15 @@
 #include "VulkanRenderable.hpp"
 #include "VulkanLight.hpp"
 #include "inner/VulkanMemory.hpp"
+#include "inner/CommandState.hpp"
+#include "inner/RadixSort.hpp"
+#include "inner/HiZBuffer.hpp"
+#include "inner/VulkanGraph.hpp"
+#include "inner/LightClusters.hpp"
+#include "inner/LevelIndex.hpp"
+#include "inner/InstanceCuller.hpp"
+#include "inner/Signature.hpp"
+#include "inner/Views.hpp"
 #include <Anyness/TSet.hpp>
 
 struct LayerSubscriber {
@@ -20,7 +29,7 @@ struct LayerSubscriber {
 struct RenderConfig {
    // Command buffer to render to                                       
    VkCommandBuffer mCommands;
-   // Render pass to render to                                          
+   // Render pass to render to, clearing the back buffer and depth      
    const VkRenderPass& mPass;
    // Framebuffer to render to                                          
    const VkFramebuffer& mFrame;
@@ -28,10 +37,165 @@ struct RenderConfig {
    VkClearValue mColorClear {};
    // Depth clear values                                                
    VkClearValue mDepthClear {};
+   // G-buffer clear values, must follow the above ones                 
+   VkClearValue mGBufferClear[2] {};
    // Depth sweep                                                       
    VkClearAttachment mDepthSweep {};
    // Pass begin info                                                   
-   mutable VkRenderPassBeginInfo mPassBeginInfo {};
+   VkRenderPassBeginInfo mPassBeginInfo {};
+   // Tracks what's bound to mCommands, to skip redundant binds         
+   mutable CommandState mState {};
+   // Same, but loading the back buffer and depth                       
+   VkRenderPass mLoadPass {};
+   // Render passes and framebuffer for layers with deferred lights     
+   VkRenderPass mDeferredPass {};
+   VkRenderPass mDeferredLoadPass {};
+   VkFramebuffer mDeferredFrame {};
+   // The frame's render graph, and its resources                       
+   const RenderGraph* mGraph {};
+   RenderGraph::Resource mColor {};
+   RenderGraph::Resource mDepth {};
+   RenderGraph::Resource mShadows {};
+   RenderGraph::Resource mIndirect {};
+   // The render pass, that the last graph pass left open for the next  
+   // one in its group, and how its contents are recorded               
+   mutable bool mPassOpen {};
+   mutable VkSubpassContents mPassContents {};
+
+   NOD() bool Loads(RenderGraph::Pass) const;
+   void BeginPass(RenderGraph::Pass, VkSubpassContents) const;
+   void EndPass() const;
+   void EndGroup(RenderGraph::Pass) const;
+};
+
+/// Lights compiled for a camera of a layer with deferred lights              
+struct LitCamera {
+   const VulkanCamera* mCamera;
+   // Range in VulkanLayer::mLightSources                               
+   Offset mStart;
+   Count mCount;
+};
+
+/// All shadow casters in a level, along with their geometry                  
+struct ShadowLevel {
+   Level mLevel;
+   ShadowCasters mCasters;
+   ::std::vector<const VulkanGeometry*> mGeometry;
+};
+
+/// A shadow, that must be rendered again this frame                          
+struct ShadowJob {
+   // The shadow's entry in the ShadowAtlas                             
+   int32_t mEntry;
+   // Index in VulkanLayer::mShadowLevels                               
+   Offset mLevel;
+   // Range in VulkanLayer::mShadowCasters                              
+   Offset mStart;
+   Count mCount;
+};
+
+/// An instance found visible while staging a camera level, along with what   
+/// its pipeline needs, so that instances are pushed by copying               
+struct StagedInstance {
+   const VulkanRenderable* mRenderable;
+   const A::Instance* mInstance;
+   // The instance's own model transform, the one the LOD state made of 
+   // it, and the LOD                                                   
+   Mat4 mTransform;
+   Mat4 mModel;
+   Offset mLOD;
+   // Distance to the camera as a sortable key, used in Sorted layers   
+   uint32_t mDepth;
+};
+
+/// A camera level, whose visible instances are found in parallel with the    
+/// other levels, and later compiled in order. Each is written only by the    
+/// job that stages it, so it is that job's arena                             
+struct StagedLevel {
+   const VulkanCamera* mCamera;
+   Level mLevel;
+   Mat4 mView;
+   Mat4 mProjection;
+   ::std::vector<StagedInstance> mInstances;
+   // Number of instances rejected by occlusion culling                 
+   Count mOccluded;
+};
+
+/// A range of a pipeline's subscribers, drawn in a pass of a batched layer,  
+/// or the start of a level, which clears depth, or switches to the level's   
+/// slice of the depth range                                                  
+struct PassStep {
+   // The pipeline, or nullptr to start a level instead                 
+   const VulkanPipeline* mPipeline;
+   // Range of the pipeline's subscribers, or the index of the started  
+   // level, in the order levels are drawn                              
+   Offset mBegin;
+   Offset mEnd;
+   // Number of draw calls the range records                            
+   Count mDraws;
+};
+
+/// What changed in a layer, since its draw list was last generated           
+enum class LayerChange {
+   // Nothing, so the draw list is kept as it is                        
+   None,
+   // Only instances of a GPU culled layer moved, without switching     
+   // their LOD, so they're moved in the blocks they were given         
+   Moved,
+   // Anything else, so the draw list is generated again                
+   All
+};
+
+/// Where the part of a layer starts in the renderer's shared buffers         
+struct LayerMark {
+   // Words in the IndirectBuffer                                       
+   Count mCommands;
+   // Frustums and candidates in the InstanceCuller                     
+   InstanceCuller::Mark mCulling;
+   // Records in the ShadowAtlas                                        
+   Count mRecords;
+};
+
+/// A GPU culled instance, and where its data went, when the draw list was    
+/// generated - the data stays there until the draw list is generated again   
+struct InstanceSlot {
+   const A::Instance* mInstance;
+   VulkanPipeline* mPipeline;
+   // Index in VulkanLayer::mStaged, and the LOD the instance was at    
+   Offset mStaged;
+   Offset mLOD;
+   // Block of the instance's data in the pipeline, and its candidate   
+   uint32_t mBlock;
+   uint32_t mCandidate;
+};
+
+/// A render pass of a batched layer, from a camera's point of view           
+struct LayerPass {
+   // The camera, or nullptr if using the default one                   
+   const VulkanCamera* mCamera;
+   // Range in VulkanLayer::mPassSteps - both eyes of a stereo camera   
+   // share the same range                                              
+   Offset mStart;
+   Count mCount;
+   // What the pass draws from the camera, and the view transforms      
+   // pushed for it                                                     
+   Eye mEye;
+   ViewTransforms mViews;
+};
+
+/// Consecutive steps of a pass, recorded to a secondary command buffer       
+struct PassChunk {
+   // Index in VulkanLayer::mPasses                                     
+   Offset mPass;
+   // Range in VulkanLayer::mPassSteps                                  
+   Offset mStart;
+   Count mCount;
+   // The clustered lights of the pass's camera, if any                 
+   VkDescriptorSet mLights;
+   // The recorded commands, and the binds issued and skipped in them   
+   VkCommandBuffer mCommands;
+   Count mIssued;
+   Count mSkipped;
 };
 
 using LevelSet = TOrderedSet<Level>;
@@ -56,6 +220,7 @@ protected:
    friend struct VulkanRenderable;
    friend struct VulkanLight;
    friend struct VulkanPipeline;
+   friend struct VulkanRenderer;
 
    // List of cameras                                                   
    TFactory<VulkanCamera> mCameras;
@@ -69,6 +234,38 @@ protected:
    LevelSet mRelevantLevels;
    // A cache of relevant cameras                                       
    CameraSet mRelevantCameras;
+   // Instances of all renderables, bucketed by level, used only by     
+   // batched layers                                                    
+   LevelIndex mIndex;
+   // Signature of everything the draw list was last generated from,    
+   // and of the transformations of instances, that can move in place   
+   uint64_t mSignature {};
+   uint64_t mMoved {};
+   // What changed since the draw list was last generated               
+   LayerChange mChange {LayerChange::All};
+   // Where the layer's part of the renderer's shared buffers starts    
+   LayerMark mMark {};
+   // Where the data of GPU culled instances went                       
+   ::std::vector<InstanceSlot> mSlots;
+   // Number of frames an Occluded layer is generated again after it    
+   // changed, until its occluders catch up with the change             
+   Count mSettling {};
+
+   // Camera levels of batched layers, staged in parallel, along with   
+   // the levels they observe, and storage for each worker's queries    
+   ::std::vector<StagedLevel> mStaged;
+   Count mStagedCount {};
+   Offset mNextStaged {};
+   ::std::vector<Level> mStagedLevels;
+   ::std::vector<LevelIndex::Scratch> mScratch;
+   // Culling candidates of the run of instances being pushed           
+   ::std::vector<uint32_t> mCandidates;
+
+   // Render passes of batched layers, planned whenever the draw lists  
+   // are generated, and the parts of them recorded on workers          
+   ::std::vector<LayerPass> mPasses;
+   ::std::vector<PassStep> mPassSteps;
+   mutable ::std::vector<PassChunk> mPassChunks;
 
    // Subscribers, used only for hierarchical styled layers             
    // Otherwise, VulkanPipeline::Subscriber is used                     
@@ -76,6 +273,26 @@ protected:
    TMany<Count> mSubscriberCountPerLevel;
    TMany<Count> mSubscriberCountPerCamera;
 
+   // Reusable storage for sorting subscribers of batched layers        
+   RadixEntries mSortKeys;
+   RadixEntries mSortScratch;
+
+   // Depth pyramid of the previous frame, used only by Occluded layers 
+   mutable HiZBuffer mHiZ;
+   // Lights of the last compiled camera in forward lit layers, or of   
+   // all cameras in layers with deferred lights                        
+   LightSources mLightSources;
+   TMany<LitCamera> mLitCameras;
+   // Lights binned for each camera, used only by forward lit layers    
+   LightClusters mClusters;
+
+   // Casters of each level with shadowed lights, and the shadows that  
+   // must be rendered again, used only by Shadowed layers              
+   ::std::vector<ShadowLevel> mShadowLevels;
+   TMany<ShadowJob> mShadowJobs;
+   TMany<uint32_t> mShadowCasters;
+   ::std::vector<uint32_t> mShadowTouched;
+
    /// The layer style determines how the scene will be compiled              
    /// Combine these flags to configure the layer to your needs               
    enum Style {
@@ -105,12 +322,49 @@ protected:
       /// If enabled, will separate light computation on a different pass     
       /// Significantly improves performance on scenes with complex           
       /// lighting and shadowing, but does incur some memory costs.           
+      /// Batched layers draw albedo and normals to a G-buffer, which is      
+      /// then lit by all lights of the layer in a second subpass. Lights     
+      /// illuminate only the level nearest to the camera. Layers without     
+      /// any lights show albedo as it is. If disabled, batched layers are    
+      /// lit in place - lights are binned into a froxel grid for each        
+      /// camera, which shaders read to visit only the lights nearby          
       DeferredLights = 4,
 
       /// If enabled will sort instances by distance to camera (depth),       
-      /// before committing them for rendering                                
+      /// before committing them for rendering. Opaque pipelines are drawn    
+      /// first, front-to-back, to reject hidden fragments early, and         
+      /// blended pipelines last, back-to-front, to compose correctly.        
+      /// Ignored by hierarchical layers, which preserve their order          
       Sorted = 8,
 
+      /// If enabled, batched layers cull instances in a compute shader,      
+      /// instead of on the CPU. All instances are compiled, but only the     
+      /// visible ones get drawn. Useful for scenes with a huge number of     
+      /// instances. Ignored if the device can't dispatch compute work        
+      GPUCulling = 16,
+
+      /// If enabled, batched layers capture their depth after rendering,     
+      /// and skip instances of the next frame, that are completely behind    
+      /// it. Only the last rendered camera and level are captured, so this   
+      /// works best for single-camera layers with dense occluders. The       
+      /// previous frame's depth is used, so freshly disoccluded instances    
+      /// might appear a frame late                                           
+      Occluded = 32,
+
+      /// If enabled, lights of batched layers with deferred lights cast      
+      /// shadows. Each light gets a cube of shadow maps in the renderer's    
+      /// shared atlas, which is rendered again only when the light, or a     
+      /// renderable in its range, changes. Ignored by all other layers       
+      Shadowed = 64,
+
+      /// If enabled, multilevel layers don't clear depth between levels.     
+      /// Each level is drawn in its own slice of the depth range instead,    
+      /// nearer than the slices of all bigger levels, so that all levels     
+      /// share a single depth buffer. Saves a clear for each level, but      
+      /// splits depth precision between them, so it is best suited for       
+      /// layers with only a few levels in view                               
+      DepthSliced = 128,
+
       /// The default visual layer style                                      
       Default = Batched | Multilevel | DeferredLights
    };
@@ -122,8 +376,11 @@ public:
    ~VulkanLayer();
 
    void Create(Verb&);
+   void CheckChanges();
+   NOD() bool MoveInstances();
    bool Generate(PipelineSet&);
-   void Render(const RenderConfig&) const;
+   void Upload();
+   void Declare(VulkanGraph&, const RenderConfig&) const;
    void Detach();
 
    NOD() Style GetStyle() const noexcept;
@@ -132,12 +389,33 @@ public:
 private:
    void CompileCameras();
 
-   Count CompileLevelBatched(const Mat4&, const Mat4&, Level, PipelineSet&);
+   void StageLevels();
+   void StageLevel(StagedLevel&, LevelIndex::Scratch&, bool);
+   Count CompileLevelBatched(PipelineSet&);
    Count CompileLevelHierarchical(const Mat4&, const Mat4&, Level, PipelineSet&);
    Count CompileThing(const Thing*, LOD&, PipelineSet&);
    NOD() VulkanPipeline* CompileInstance(const VulkanRenderable*, const A::Instance*, LOD&);
+   NOD() VulkanPipeline* CompileTransformed(const VulkanRenderable*, LOD&);
    Count CompileLevels();
+   void CompileLights(const VulkanCamera*);
+   void CompileShadows();
+   NOD() Offset GatherCasters(Level);
+   void RequestShadow(const void*, const Mat4&, Level, Real);
+   void SortSubscribers();
+   void GenerateDraws();
+   void PlanPasses();
 
-   void RenderBatched(const RenderConfig&) const;
-   void RenderHierarchical(const RenderConfig&) const;
+   void RenderBatched(const RenderConfig&, RenderGraph::Pass) const;
+   NOD() bool RecordPasses(const RenderConfig&, const VkRenderPassBeginInfo&) const;
+   void RecordSteps(CommandState&, const VkClearAttachment&, const LayerPass&, VkDescriptorSet, Offset, Count) const;
+   void GetViewport(const VulkanCamera*, VkViewport&, VkRect2D&) const;
+   void GetViewport(const LayerPass&, VkViewport&, VkRect2D&) const;
+   void DeclareStereo(VulkanGraph&, const RenderConfig&, Offset) const;
+   void RenderStereo(const RenderConfig&, Offset) const;
+   NOD() DepthSlice GetDepthSlice(Offset) const;
+   void RenderHierarchical(const RenderConfig&, RenderGraph::Pass) const;
+   void DeclareOccluders(VulkanGraph&, const RenderConfig&) const;
+   void CaptureOccluders(const RenderConfig&) const;
+   void RenderShadows(const RenderConfig&) const;
+   void RenderLights(const RenderConfig&, const VulkanCamera*, const VkRect2D&) const;
 };
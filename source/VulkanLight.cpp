@@ -15,6 +15,49 @@ VulkanLight::VulkanLight(VulkanLayer* producer, Describe descriptor)
    : Resolvable   {this}
    , ProducedFrom {producer, descriptor} {
    VERBOSE_VULKAN("Initializing...");
+   SeekValueAux<Traits::Color>(descriptor, mColor);
+   SeekValueAux<Traits::Size>(descriptor, mRange);
    Couple(descriptor);
    VERBOSE_VULKAN("Initialized");
 }
+
+/// Recompile the light                                                       
+void VulkanLight::Refresh() {
+   mInstances = GatherUnits<A::Instance, Seek::Here>();
+}
+
+/// Compile the light sources, that illuminate a level                        
+///   @param view - the view transformation of the level                      
+///   @param level - the level                                                
+///   @param sources - [out] the light sources go here                        
+///   @param shadows - the atlas to look up shadows in, if any                
+void VulkanLight::Compile(
+   const Mat4& view, Level level, LightSources& sources, ShadowAtlas* shadows
+) const {
+   const auto push = [&](const void* key, const Mat4& model) {
+      float m[16];
+      MatrixToFloats(view * model, m);
+
+      LightSource source;
+      source.mPosition[0] = m[12];
+      source.mPosition[1] = m[13];
+      source.mPosition[2] = m[14];
+      source.mPosition[3] = static_cast<float>(mRange);
+      for (int i = 0; i < 4; ++i)
+         source.mColor[i] = static_cast<float>(mColor[i]);
+      if (shadows)
+         source.mShadow = shadows->PushRecord(key, view);
+      sources.push_back(source);
+   };
+
+   if (not mInstances) {
+      if (level == Level::Default)
+         push(this, {});
+      return;
+   }
+
+   for (auto instance : mInstances) {
+      if (instance->GetLevel() == level)
+         push(instance, instance->GetModelTransform(level));
+   }
+}
@@ -7,14 +7,35 @@
 ///                                                                           
 #pragma once
 #include "Common.hpp"
+#include "inner/Lighting.hpp"
+#include "inner/ShadowAtlas.hpp"
+#include <Langulus/Physical.hpp>
 
 
 ///                                                                           
 ///   Light source unit                                                       
 ///                                                                           
+/// A point light, placed by the instances of its owner. Lights without       
+/// instances are placed at the origin of the default level. Lights of        
+/// Shadowed layers get a shadow in the renderer's ShadowAtlas                
+///                                                                           
 struct VulkanLight : A::Graphics, ProducedFrom<VulkanLayer> {
    LANGULUS(ABSTRACT) false;
    LANGULUS_BASES(A::Graphics);
 
+protected:
+   friend struct VulkanLayer;
+
+   // Color of the light, can go above one for brighter lights          
+   Vec4 mColor {1, 1, 1, 1};
+   // Distance, beyond which the light has no effect                    
+   Real mRange {10};
+
+   TMany<const A::Instance*> mInstances;
+
+public:
    VulkanLight(VulkanLayer*, Describe);
+
+   void Refresh();
+   void Compile(const Mat4&, Level, LightSources&, ShadowAtlas* = nullptr) const;
 };
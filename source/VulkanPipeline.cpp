@@ -8,6 +8,18 @@
 #include "Vulkan.hpp"
 
 
+/// Check if two subscribers would bind exactly the same state, and can be    
+/// drawn by the same draw call - their instances may differ                  
+///   @param rhs - the subscriber to compare against                          
+///   @return true if both use the same offsets, samplers and geometry, and   
+///           both are culled in the same way                                 
+bool PipeSubscriber::SameState(const PipeSubscriber& rhs) const noexcept {
+   return samplerSet == rhs.samplerSet
+      and geometrySet == rhs.geometrySet
+      and (cullCandidate != 0) == (rhs.cullCandidate != 0)
+      and 0 == ::std::memcmp(offsets, rhs.offsets, sizeof(offsets));
+}
+
 /// Descriptor constructor                                                    
 ///   @param producer - the pipeline producer                                 
 ///   @param descriptor - the pipeline descriptor                             
@@ -19,13 +31,25 @@ VulkanPipeline::VulkanPipeline(VulkanRenderer* producer, Describe descriptor)
    mGeometries.New();
 
    bool predefinedMaterial = false;
+   const PipelineRecord* replay {};
+   uint32_t style = VulkanLayer::Default;
    descriptor.ForEach(
-      [this](const VulkanLayer& layer) {
+      [this, &style](const VulkanLayer& layer) {
          // Add layer preferences                                       
-         if (layer.GetStyle() & VulkanLayer::Hierarchical)
+         style = layer.GetStyle();
+         if (style & VulkanLayer::Hierarchical)
             mDepth = false;
          return Loop::NextLoop;
       },
+      [this, &replay, &style](const PipelineRecord& record) {
+         // Replay a pipeline from a manifest                           
+         replay = &record;
+         mPrimitive = record.mTopology;
+         mBlendMode = record.mBlendMode;
+         mDepth = record.mDepth;
+         style = record.mStyle;
+         return Loop::Break;
+      },
       [this, &predefinedMaterial](const A::Material& material) {
          // Create from predefined material generator                   
          GenerateShaders(material);
@@ -34,10 +58,26 @@ VulkanPipeline::VulkanPipeline(VulkanRenderer* producer, Describe descriptor)
       }
    );
 
+   // Batched layers with deferred lights draw to a G-buffer            
+   mDeferred = (style & VulkanLayer::DeferredLights)
+      and not (style & VulkanLayer::Hierarchical);
+   // Other batched layers light in place, using clustered lights       
+   mClustered = not (style & VulkanLayer::DeferredLights)
+      and not (style & VulkanLayer::Hierarchical);
+
    if (not predefinedMaterial) {
       // We must generate the material ourselves                        
       Construct material;
-      descriptor.ForEach(
+      if (replay) {
+         // The material request was recorded as code                   
+         Code {replay->mMaterial}.Parse().ForEachDeep(
+            [&](const Construct& request) {
+               material = request;
+               return Loop::Break;
+            }
+         );
+      }
+      else descriptor.ForEach(
          [&](const A::File& file) {
             // Create from file                                         
             material = FromFile(file);
@@ -64,15 +104,41 @@ VulkanPipeline::VulkanPipeline(VulkanRenderer* producer, Describe descriptor)
       LANGULUS_ASSERT(material.GetDescriptor(), Graphics,
          "Couldn't generate material request for pipeline");
 
+      // Record the pipeline, so it can be prewarmed next time, unless  
+      // the renderer has no manifest to record to                      
+      if (not replay and mProducer->mManifestPath) {
+         PipelineRecord record;
+         record.mMaterial = static_cast<Code>(material);
+         record.mTopology = mPrimitive;
+         record.mBlendMode = mBlendMode;
+         record.mDepth = mDepth;
+         record.mStyle = style;
+
+         // Manifest is line-based, and materials made from raw shader  
+         // code usually span many lines - such aren't recorded         
+         if (not Token {record.mMaterial}.contains('\n'))
+            mProducer->mManifest.Record(record);
+      }
+
       // Create the pixel shader output according to the rendering pass 
       // attachment format requirements                                 
-      for (const auto& attachment : mProducer->mPassAttachments) {
+      const auto& attachments = mDeferred
+         ? mProducer->mLightPass.GetGBuffer()
+         : mProducer->mPassAttachments;
+
+      for (const auto& attachment : attachments) {
          switch (attachment.format) {
          case VK_FORMAT_B8G8R8A8_UNORM:
             material << Traits::Output {
                Traits::Color {Rate::Pixel, MetaOf<RGBA>()}
             };
             break;
+         case VK_FORMAT_R32G32B32A32_SFLOAT:
+            // View-space normals, for deferred lights                  
+            material << Traits::Output {
+               Traits::Normal {Rate::Pixel, MetaOf<Vec4>()}
+            };
+            break;
          case VK_FORMAT_D32_SFLOAT:
          case VK_FORMAT_D16_UNORM:
             // Skip depth                                               
@@ -92,7 +158,79 @@ VulkanPipeline::VulkanPipeline(VulkanRenderer* producer, Describe descriptor)
       );
    }
 
-   // Proceed with initializing the pipeline                            
+   // Only forward lit layers bind the clustered lights                 
+   if (not mClustered and mStages[ShaderStage::Pixel]) {
+      const auto& code = mStages[ShaderStage::Pixel]->GetCode();
+      LANGULUS_ASSERT(GlslFindWord({code.GetRaw(), code.GetCount()}, "LangulusLights")
+         == ::std::string_view::npos, Graphics,
+         "Shader reads clustered lights, but its layer doesn't light in place");
+   }
+
+   // Create the uniform buffers                                        
+   CreateUniformBuffers();
+
+   // Get the pipeline layout                                           
+   std::vector<UBOLayout> relevantLayouts {
+      mStaticUBOLayout, mDynamicUBOLayout
+   };
+
+   if (mSamplersUBOLayout)
+      relevantLayouts.push_back(mSamplersUBOLayout);
+
+   if (mClustered) {
+      // Clustered lights are always at the same set, so fill the       
+      // sampler set with an empty one, if there are no samplers        
+      if (not mSamplersUBOLayout)
+         relevantLayouts.push_back(mProducer->mLayouts.GetSetLayout({}));
+      relevantLayouts.push_back(LightClusters::GetSetLayout(mProducer->mLayouts));
+   }
+
+   // Vertex shaders of the stereo variants get the view transforms as  
+   // push constants                                                    
+   mPipeLayout = mProducer->mLayouts.GetPipelineLayout(relevantLayouts);
+   mViewsPipeLayout = mProducer->mLayouts.GetPipelineLayout(relevantLayouts, true);
+
+   // By default empty input and assembly states are used               
+   mInput = {};
+   mInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+   if (mStages[ShaderStage::Vertex])
+      mInput = mStages[ShaderStage::Vertex]->CreateVertexInputState();
+
+   // Input assembly                                                    
+   mAssembly = {};
+   mAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+   mAssembly.topology = mPrimitive;
+   mAssembly.primitiveRestartEnable = VK_FALSE;
+
+   const auto pass = mDeferred
+      ? mProducer->mLightPass.GetPass()
+      : mProducer->mPass.Get();
+
+   if (mProducer->mDeferredPipelines) {
+      // Compile shaders and create the pipeline on the renderer's      
+      // compile queue, so that the frame isn't stalled. Renderables    
+      // use a fallback pipeline, until the renderer promotes this one  
+      // The job is cancelled or waited for, before the pipeline is     
+      // destroyed, so it can safely refer to it                        
+      ::std::packaged_task<VkPipeline()> compile {[this, pass] {
+         return CreatePipeline(pass);
+      }};
+      mCompilation = compile.get_future();
+      mCompileJob = mProducer->mCompiler.Submit(
+         ::std::packaged_task<void()> {::std::move(compile)});
+   }
+   else mPipeline = CreatePipeline(pass);
+}
+
+/// Compile the shaders and create the graphics pipeline                      
+/// This can run on a background job, so it must touch only state that is     
+/// already initialized by the constructor, and must not allocate through     
+/// the managed memory                                                        
+///   @param pass - the render pass the pipeline draws in                     
+///   @param views - whether vertices are moved to the views of stereo        
+///                  cameras, that are pushed as constants                    
+///   @return the graphics pipeline                                           
+VkPipeline VulkanPipeline::CreatePipeline(VkRenderPass pass, bool views) const {
    const auto device = mProducer->mDevice;
 
    // Copy the viewport state                                           
@@ -156,31 +294,18 @@ VulkanPipeline::VulkanPipeline(VulkanRenderer* producer, Describe descriptor)
    //colorBlendAttachment.alphaBlendOp = VkBlendOp::VK_BLEND_OP_SUBTRACT;
    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
+   // The G-buffer normals are never blended                            
+   VkPipelineColorBlendAttachmentState blendAttachments[2] {
+      colorBlendAttachment, colorBlendAttachment
+   };
+   blendAttachments[1].blendEnable = VK_FALSE;
+
    VkPipelineColorBlendStateCreateInfo colorBlending {};
    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
    colorBlending.logicOpEnable = VK_FALSE;//TODO
    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-   colorBlending.attachmentCount = 1;
-   colorBlending.pAttachments = &colorBlendAttachment;
-
-   // Create the uniform buffers                                        
-   CreateUniformBuffers();
-
-   // Create the pipeline layouts                                       
-   std::vector<UBOLayout> relevantLayouts {
-      mStaticUBOLayout, mDynamicUBOLayout
-   };
-
-   if (mSamplersUBOLayout)
-      relevantLayouts.push_back(mSamplersUBOLayout);
-
-   VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
-   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-   pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(relevantLayouts.size());
-   pipelineLayoutInfo.pSetLayouts = relevantLayouts.data();
-
-   if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &mPipeLayout.Get()))
-      LANGULUS_OOPS(Graphics, "Can't create pipeline layout");
+   colorBlending.attachmentCount = mDeferred ? 2 : 1;
+   colorBlending.pAttachments = blendAttachments;
 
    // Allow viewport to be dynamically set                              
    const VkDynamicState dynamicStates[] {
@@ -201,22 +326,12 @@ VulkanPipeline::VulkanPipeline(VulkanRenderer* producer, Describe descriptor)
    depthStencil.minDepthBounds = 0.0f;
    depthStencil.maxDepthBounds = 1.0f;
 
-   // By default empty input and assembly states are used               
-   mInput = {};
-   mInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-   if (mStages[ShaderStage::Vertex])
-      mInput = mStages[ShaderStage::Vertex]->CreateVertexInputState();
-
-   // Input assembly                                                    
-   mAssembly = {};
-   mAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-   mAssembly.topology = mPrimitive;
-   mAssembly.primitiveRestartEnable = VK_FALSE;
-
    // Create the pipeline                                               
-   TMany<Shader> stages;
-   for (auto shader : mStages)
-      stages << shader->Compile();
+   std::vector<Shader> stages;
+   for (auto shader : mStages) {
+      if (shader)
+         stages.push_back(shader->Compile(views));
+   }
 
    VkGraphicsPipelineCreateInfo pipelineInfo {};
    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -225,22 +340,33 @@ VulkanPipeline::VulkanPipeline(VulkanRenderer* producer, Describe descriptor)
    pipelineInfo.pMultisampleState = &multisampling;
    pipelineInfo.pColorBlendState = &colorBlending;
    pipelineInfo.pDepthStencilState = &depthStencil;
-   pipelineInfo.stageCount = static_cast<uint32_t>(stages.GetCount());
-   pipelineInfo.pStages = stages.GetRaw();
+   pipelineInfo.stageCount = static_cast<uint32_t>(stages.size());
+   pipelineInfo.pStages = stages.data();
    pipelineInfo.pVertexInputState = &mInput;
    pipelineInfo.pInputAssemblyState = &mAssembly;
    pipelineInfo.pTessellationState = nullptr;
-   pipelineInfo.layout = mPipeLayout;
-   pipelineInfo.renderPass = mProducer->mPass;
+   pipelineInfo.layout = views ? mViewsPipeLayout : mPipeLayout;
+   pipelineInfo.renderPass = pass;
    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
    pipelineInfo.pDynamicState = &dynamicState;
 
-   if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mPipeline.Get()))
+   VkPipeline pipeline {};
+   if (vkCreateGraphicsPipelines(device, mProducer->mPipelineCache, 1, &pipelineInfo, nullptr, &pipeline))
       LANGULUS_OOPS(Graphics, "Can't create graphical pipeline");
+   return pipeline;
 }
 
 /// Pipeline destruction                                                      
 VulkanPipeline::~VulkanPipeline() {
+   // Drop the compilation if it hasn't started yet, or wait for it and 
+   // take ownership of the result                                      
+   mProducer->mCompiler.Cancel(mCompileJob);
+   mCompileJob.reset();
+   if (mCompilation.valid()) {
+      try { mPipeline = mCompilation.get(); }
+      catch (...) {}
+   }
+
    // Destroy the uniform buffer objects                                
    mRelevantDynamicDescriptors.Clear();
 
@@ -251,11 +377,13 @@ VulkanPipeline::~VulkanPipeline() {
 
    mSamplerUBO.Reset();
 
-   // Destroy uniform buffer object pool                                
+   // Free the uniform buffer object sets                               
    const auto device = mProducer->mDevice;
-   if (mUBOPool) {
-      vkDestroyDescriptorPool(device, mUBOPool, nullptr);
-      mUBOPool.Reset();
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      mProducer->mLayouts.Free(mStaticUBOPool[frame], mStaticUBOSet[frame]);
+      mProducer->mLayouts.Free(mDynamicUBOPool[frame], mDynamicUBOSet[frame]);
+      mStaticUBOSet[frame].Reset();
+      mDynamicUBOSet[frame].Reset();
    }
 
    // Destroy pipeline                                                  
@@ -264,25 +392,78 @@ VulkanPipeline::~VulkanPipeline() {
       mPipeline.Reset();
    }
 
-   // Destroy pipeline layout                                           
-   if (mPipeLayout) {
-      vkDestroyPipelineLayout(device, mPipeLayout, nullptr);
-      mPipeLayout.Reset();
+   if (mStereoPipeline) {
+      vkDestroyPipeline(device, mStereoPipeline, nullptr);
+      mStereoPipeline.Reset();
    }
 
-   // Destroy every UBO layout                                          
-   if (mStaticUBOLayout) {
-      vkDestroyDescriptorSetLayout(device, mStaticUBOLayout, nullptr);
-      mStaticUBOLayout.Reset();
+   if (mMultiviewPipeline) {
+      vkDestroyPipeline(device, mMultiviewPipeline, nullptr);
+      mMultiviewPipeline.Reset();
    }
-   if (mDynamicUBOLayout) {
-      vkDestroyDescriptorSetLayout(device, mDynamicUBOLayout, nullptr);
-      mDynamicUBOLayout.Reset();
+
+   // Layouts are owned by the renderer's layout cache                  
+   mPipeLayout.Reset();
+   mViewsPipeLayout.Reset();
+   mStaticUBOLayout.Reset();
+   mDynamicUBOLayout.Reset();
+   mSamplersUBOLayout.Reset();
+}
+
+/// Check if the pipeline has been compiled, and can be used for drawing      
+///   @return true if pipeline is ready                                       
+bool VulkanPipeline::IsReady() const noexcept {
+   return static_cast<bool>(mPipeline);
+}
+
+/// Check if any shaders were generated for the pipeline                      
+///   @return true if pipeline has at least one shader stage                  
+bool VulkanPipeline::HasStages() const noexcept {
+   for (auto& shader : mStages) {
+      if (shader)
+         return true;
    }
-   if (mSamplersUBOLayout) {
-      vkDestroyDescriptorSetLayout(device, mSamplersUBOLayout, nullptr);
-      mSamplersUBOLayout.Reset();
+   return false;
+}
+
+/// Take the result of a background compilation, if it has finished           
+///   @attention rethrows any exception that occured during compilation       
+///   @param wait - whether to block until background compilation is done     
+///   @return true if pipeline has just been promoted for drawing             
+bool VulkanPipeline::Promote(bool wait) {
+   if (not mCompilation.valid())
+      return false;
+
+   using namespace ::std::chrono_literals;
+   if (not wait and mCompilation.wait_for(0s) != ::std::future_status::ready)
+      return false;
+
+   mCompileJob.reset();
+   mPipeline = mCompilation.get();
+   VERBOSE_VULKAN("Pipeline compiled in background and promoted");
+   return true;
+}
+
+/// Create the variant of the pipeline, that draws stereo cameras, unless it  
+/// already exists. Both variants share the shaders, that move vertices to    
+/// the pushed views, since gl_ViewIndex is zero without multiview            
+///   @param multiview - whether to draw both eyes at once, in the stereo     
+///                      target's multiview render pass, or one at a time,    
+///                      in the render pass of the original                   
+void VulkanPipeline::PrepareStereo(bool multiview) {
+   if (multiview) {
+      if (mMultiviewPipeline or mDeferred)
+         return;
+      mMultiviewPipeline = CreatePipeline(mProducer->mStereo.GetPass(), true);
+      return;
    }
+
+   if (mStereoPipeline)
+      return;
+   const auto pass = mDeferred
+      ? mProducer->mLightPass.GetPass()
+      : mProducer->mPass.Get();
+   mStereoPipeline = CreatePipeline(pass, true);
 }
 
 /// Create a pipeline from a file                                             
@@ -413,29 +594,16 @@ void VulkanPipeline::GenerateShaders(const A::Material& material) {
 ///   @param bindings - the bindings to combine in a single layout            
 ///   @param layout - [out] the resulting layout                              
 ///   @param set - [out] the resulting set                                    
+///   @param pool - [out] the pool the set was allocated from                 
 void VulkanPipeline::CreateDescriptorLayoutAndSet(
-   const Bindings& bindings, UBOLayout* layout, VkDescriptorSet* set
+   const Bindings& bindings, UBOLayout* layout, VkDescriptorSet* set,
+   VkDescriptorPool* pool
 ) {
-   const auto device = mProducer->mDevice;
-
-   // Combine all bindings in a single layout                           
-   VkDescriptorSetLayoutCreateInfo layoutInfo {};
-   layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-   layoutInfo.bindingCount = static_cast<uint32_t>(bindings.GetCount());
-   layoutInfo.pBindings = bindings.GetRaw();
-
-   if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, layout))
-      LANGULUS_OOPS(Graphics, "vkCreateDescriptorSetLayout failed");
+   // Combine all bindings in a single layout, or reuse an existing one 
+   *layout = mProducer->mLayouts.GetSetLayout(bindings);
 
    // Create a descriptor set                                           
-   VkDescriptorSetAllocateInfo allocInfo {};
-   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-   allocInfo.descriptorPool = mUBOPool;
-   allocInfo.descriptorSetCount = 1;
-   allocInfo.pSetLayouts = layout;
-
-   if (vkAllocateDescriptorSets(device, &allocInfo, set))
-      LANGULUS_OOPS(Graphics, "vkAllocateDescriptorSets failed");
+   *set = mProducer->mLayouts.Allocate(*layout, *pool);
 }
 
 /// Create a new sampler set                                                  
@@ -443,41 +611,44 @@ void VulkanPipeline::CreateNewSamplerSet() {
    if (not mSamplersUBOLayout)
       return;
 
-   // If last two samplers match, there is not need to create new one   
-   // Just reuse the last one                                           
-   if (mSamplerUBO.GetCount() > 1 and mSamplerUBO[-1] == mSamplerUBO[-2])
-      return;
+   // If last two samplers match, subscribers of the last one switch to 
+   // the previous one, so that they can be drawn together - the last   
+   // one can't be reused, subscribers of hierarchical layers are kept  
+   // outside, and still refer to it                                    
+   const auto last = mSamplersUsed - 1;
+   if (last and mSamplerUBO[last] == mSamplerUBO[last - 1]) {
+      for (auto s = mSubscribers.GetCount(); s-- > 0 and mSubscribers[s].samplerSet == last;)
+         mSubscribers[s].samplerSet = last - 1;
+   }
 
-   // Copy the previous sampler set                                     
-   // This will copy the samplers layout                                
-   mSamplerUBO << mSamplerUBO.Last();
-   auto& ubo = mSamplerUBO.Last();
-   ubo.mSamplersUBOSet.Reset();
-
-   // Create a new descriptor set                                       
-   VkDescriptorSetAllocateInfo allocInfo {};
-   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-   allocInfo.descriptorPool = mUBOPool;
-   allocInfo.descriptorSetCount = 1;
-   allocInfo.pSetLayouts = &mSamplersUBOLayout.Get();
-
-   if (vkAllocateDescriptorSets(mProducer->mDevice, &allocInfo, &ubo.mSamplersUBOSet.Get())) {
-      LANGULUS_OOPS(Graphics,
-         "vkAllocateDescriptorSets failed - either reserve more "
-         "items in descriptor pool, or make more pools on demand"
-      );
+   // Reuse a sampler set of previous draw lists, or create a new one   
+   // with the same uniforms - pools are made on demand                 
+   if (mSamplersUsed == mSamplerUBO.GetCount()) {
+      SamplerUBO ubo;
+      ubo.mUniforms = mSamplerUBO[0].mUniforms;
+      ubo.Create(mProducer, mSamplersUBOLayout);
+      mSamplerUBO << Abandon(ubo);
    }
 
-   mSubscribers.Last().samplerSet =
-      static_cast<uint32_t>(mSamplerUBO.GetCount() - 1);
+   // Copy the previous samplers                                        
+   auto& ubo = mSamplerUBO[mSamplersUsed];
+   const auto& previous = mSamplerUBO[last];
+   for (Offset i = 0; i < ubo.mSamplers.GetCount(); ++i)
+      ubo.mSamplers[i] = previous.mSamplers[i];
+   ubo.mFresh = 0;
+
+   mSubscribers.Last().samplerSet = mSamplersUsed++;
 }
 
 /// Create a new geometry set                                                 
 void VulkanPipeline::CreateNewGeometrySet() {
-   // If last two geometries match, there is not need to create new one 
-   // Just reuse the last one                                           
-   if (mGeometries.GetCount() > 1 and mGeometries[-1] == mGeometries[-2])
-      return;
+   // If last two geometries match, subscribers of the last one switch  
+   // to the previous one, just like sampler sets                       
+   const auto last = static_cast<uint32_t>(mGeometries.GetCount() - 1);
+   if (last and mGeometries[last] == mGeometries[last - 1]) {
+      for (auto s = mSubscribers.GetCount(); s-- > 0 and mSubscribers[s].geometrySet == last;)
+         mSubscribers[s].geometrySet = last - 1;
+   }
 
    // For now, only cached geometry is kept, no real set of             
    // properties is required per geometry                               
@@ -488,31 +659,9 @@ void VulkanPipeline::CreateNewGeometrySet() {
 
 /// Create uniform buffers                                                    
 void VulkanPipeline::CreateUniformBuffers() {
-   const auto device = mProducer->mDevice;
    LANGULUS_ASSERT(mUniforms, Graphics, "No uniforms/inputs provided by generator");
 
-   // Create descriptor pools                                           
-   static constinit VkDescriptorPoolSize poolSizes[] {
-      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, RefreshRate::StaticUniformCount },
-      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, RefreshRate::DynamicUniformCount },
-      { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 8 },
-      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 8 },
-      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 8 }
-   };
-
-   // All sets use the same pool                                        
-   VkDescriptorPoolCreateInfo pool {};
-   pool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-   pool.poolSizeCount = sizeof(poolSizes) / sizeof(VkDescriptorPoolSize);
-   pool.pPoolSizes = poolSizes;
-   pool.maxSets = 8;
-   pool.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-   if (vkCreateDescriptorPool(device, &pool, nullptr, &mUBOPool.Get())) {
-      LANGULUS_OOPS(Graphics,
-         "Can't create UBO pool, so creation of vulkan material fails");
-   }
-
+   // Descriptor sets are allocated from the renderer's shared pools    
    // Create the static sets (0)                                        
    {
       // For each static uniform rate (set = 0)...                      
@@ -552,14 +701,24 @@ void VulkanPipeline::CreateUniformBuffers() {
          bindings << binding;
       }
 
-      CreateDescriptorLayoutAndSet(bindings, &mStaticUBOLayout.Get(), &mStaticUBOSet.Get());
+      CreateDescriptorLayoutAndSet(bindings, &mStaticUBOLayout.Get(), &mStaticUBOSet[0].Get(), &mStaticUBOPool[0]);
+
+      // Each frame in flight points to its own buffers                 
+      for (uint32_t frame = 1; frame < mProducer->mFramesInFlight; ++frame)
+         mStaticUBOSet[frame] = mProducer->mLayouts.Allocate(mStaticUBOLayout, mStaticUBOPool[frame]);
    }
 
-   // Create the dynamic sets (0)                                       
+   // Create the dynamic sets (1)                                       
+   // Instance data is in a storage buffer, indexed by the instance     
+   // being drawn, so that many instances are drawn by one draw call -  
+   // vertex shaders find the instance among the indices in the         
+   // indirect buffer, that follow all dynamic uniforms                 
    {
       Bindings bindings;
+      constexpr auto instanceRate = Rate::Instance.GetDynamicUniformIndex();
       for (Offset rate = 0; rate < RefreshRate::DynamicUniformCount; ++rate) {
          auto& ubo = mDynamicUBO[rate];
+         ubo.mStorage = rate == instanceRate;
 
          // Add relevant inputs                                         
          const auto index = RefreshRate(RefreshRate::DynamicUniformBegin + rate).GetInputIndex();
@@ -587,14 +746,27 @@ void VulkanPipeline::CreateUniformBuffers() {
          // Create the binding for this rate                            
          VkDescriptorSetLayoutBinding binding {};
          binding.binding = decltype(binding.binding) (rate);
-         binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+         binding.descriptorType = ubo.mStorage
+            ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+            : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
          binding.descriptorCount = 1;
          binding.stageFlags = ubo.mStages;
          bindings << binding;
-         mRelevantDynamicDescriptors << &ubo;
+         if (not ubo.mStorage)
+            mRelevantDynamicDescriptors << &ubo;
       }
 
-      CreateDescriptorLayoutAndSet(bindings, &mDynamicUBOLayout.Get(), &mDynamicUBOSet.Get());
+      VkDescriptorSetLayoutBinding indices {};
+      indices.binding = IndirectBuffer::InstancesBinding;
+      indices.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      indices.descriptorCount = 1;
+      indices.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+      bindings << indices;
+
+      CreateDescriptorLayoutAndSet(bindings, &mDynamicUBOLayout.Get(), &mDynamicUBOSet[0].Get(), &mDynamicUBOPool[0]);
+
+      for (uint32_t frame = 1; frame < mProducer->mFramesInFlight; ++frame)
+         mDynamicUBOSet[frame] = mProducer->mLayouts.Allocate(mDynamicUBOLayout, mDynamicUBOPool[frame]);
    }
 
    // Finally, set the samplers for Rate::PerRenderable only (set = 2) 
@@ -608,9 +780,7 @@ void VulkanPipeline::CreateUniformBuffers() {
       }
 
       if (ubo.mUniforms) {
-         // Set any default samplers if available                       
          Bindings bindings;
-         ubo.Create(mProducer, mUBOPool);
 
          for (auto& uniform : ubo.mUniforms) {
             // Find out where the UBO is used                           
@@ -634,40 +804,56 @@ void VulkanPipeline::CreateUniformBuffers() {
             bindings << binding;
          }
 
-         mSamplerUBO << Abandon(ubo);
+         mSamplersUBOLayout = mProducer->mLayouts.GetSetLayout(bindings);
 
-         CreateDescriptorLayoutAndSet(
-            bindings, 
-            &mSamplersUBOLayout.Get(), 
-            &mSamplerUBO.Last().mSamplersUBOSet.Get()
-         );
+         // Set any default samplers if available                       
+         ubo.Create(mProducer, mSamplersUBOLayout);
+         mSamplerUBO << Abandon(ubo);
+         mSamplersUsed = 1;
       }
    }
 
    UpdateUniformBuffers();
 }
 
-/// Upload uniform buffers to VRAM                                            
+/// Upload uniform buffers to VRAM, in the buffers of the frame in flight     
 void VulkanPipeline::UpdateUniformBuffers() const {
    BufferUpdates writes;
+   const auto frame = mProducer->GetFrame();
 
    // Gather required static updates                                    
    uint32_t binding {};
    for (auto& it : mStaticUBO) {
-      it.Update(binding, mStaticUBOSet, writes);
+      it.Update(binding, mStaticUBOSet[frame], frame, writes);
       ++binding;
    }
 
    // Gather required dynamic updates                                   
    binding = 0;
    for (auto& it : mDynamicUBO) {
-      it.Update(binding, mDynamicUBOSet, writes);
+      it.Update(binding, mDynamicUBOSet[frame], frame, writes);
       ++binding;
    }
 
+   // Point to the instance indices, if the indirect buffer moved       
+   const auto& indirect = mProducer->mIndirect;
+   VkDescriptorBufferInfo indices {indirect.GetBuffer(), 0, VK_WHOLE_SIZE};
+   if (indirect.GetVersion() and mIndicesBound[frame] != indirect.GetVersion()) {
+      mIndicesBound[frame] = indirect.GetVersion();
+
+      writes.New();
+      auto& write = writes.Last();
+      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      write.dstSet = mDynamicUBOSet[frame];
+      write.dstBinding = IndirectBuffer::InstancesBinding;
+      write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      write.descriptorCount = 1;
+      write.pBufferInfo = &indices;
+   }
+
    // Gather required sampler set updates                               
-   for (auto& samplerSet : mSamplerUBO)
-      samplerSet.Update(writes);
+   for (uint32_t i = 0; i < mSamplersUsed; ++i)
+      mSamplerUBO[i].Update(frame, writes);
 
    if (writes) {
       // Commit all gathered updates to VRAM                            
@@ -679,31 +865,17 @@ void VulkanPipeline::UpdateUniformBuffers() const {
    }
 }
 
-/// Draw all subscribers of a given level (used in batched rendering)         
-///   @param offset - the subscriber to start from                            
-///   @return the number of rendered subscribers                              
-Count VulkanPipeline::RenderLevel(const Offset& offset) const {
-   // Bind the pipeline                                                 
-   vkCmdBindPipeline(
-      mProducer->GetRenderCB(), 
-      VK_PIPELINE_BIND_POINT_GRAPHICS,
-      mPipeline
-   );
-
-   // Bind static uniform buffer (set 0)                                
-   vkCmdBindDescriptorSets(
-      mProducer->GetRenderCB(),
-      VK_PIPELINE_BIND_POINT_GRAPHICS,
-      mPipeLayout, 0, 1, &mStaticUBOSet.Get(), 0, nullptr
-   );
-
+/// Find where the subscribers of a level end (used in batched rendering)     
+///   @param offset - the subscriber the level starts from                    
+///   @return the first subscriber after the level                            
+Offset VulkanPipeline::GetLevelEnd(Offset offset) const {
    // Get the initial state to check for interrupts                     
    const auto& initial = mSubscribers[offset];
    const auto r = GetRelevantDynamicUBOIndexOfRate<Rate::Level>();
 
    // And for each subscriber...                                        
    Offset i = offset;
-   for (; i < mSubscribers.GetCount() - 1; ++i) {
+   while (i < mSubscribers.GetCount() - 1) {
       auto& sub = mSubscribers[i];
 
       // Abort immediately on lower than level rate change              
@@ -712,71 +884,97 @@ Count VulkanPipeline::RenderLevel(const Offset& offset) const {
             return i;
       }
 
-      // Bind dynamic uniform buffers (set 1)                           
-      vkCmdBindDescriptorSets(
-         mProducer->GetRenderCB(),
-         VK_PIPELINE_BIND_POINT_GRAPHICS,
-         mPipeLayout, 1, 1, &mDynamicUBOSet.Get(),
-         static_cast<uint32_t>(mRelevantDynamicDescriptors.GetCount()),
-         sub.offsets
-      );
+      // Subscribers merged in an indirect draw are skipped             
+      i += sub.drawCount ? sub.drawCount : 1;
+   }
 
-      // Bind the sampler states (set 2)                                
-      //TODO optimize this via push constants, instead of using a       
-      // dedicated sampler set for each draw call :(                    
-      // read more about the forementioned implementation:              
-      // http://kylehalladay.com/blog/tutorial/vulkan/2018/01/28/Textue-Arrays-Vulkan.html
-      if (mSamplersUBOLayout) {
-         vkCmdBindDescriptorSets(
-            mProducer->GetRenderCB(),
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            mPipeLayout, 2, 1, 
-            &mSamplerUBO[sub.samplerSet].mSamplersUBOSet.Get(),
-            0, nullptr
-         );
-      }
+   return i;
+}
 
-      if (mGeometries[sub.geometrySet]) {
-         // Vertex/index buffers available, draw them                   
-         //TODO bind any geometry-dependent uniforms here               
-         mGeometries[sub.geometrySet]->Bind();
-         mGeometries[sub.geometrySet]->Render();
-      }
-      else {
-         // No geometry available, so simulate a triangle draw          
-         // Pipelines usually have a streamless vertex shader bound in  
-         // such cases, that draws a zoomed in fullscreen triangle      
-         auto cmdbuffer = mProducer->GetRenderCB();
-         vkCmdDraw(cmdbuffer, 3, 1, 0, 0);
-      }
+/// Skip a number of draw calls in a range of subscribers                     
+///   @param begin - the subscriber to start from                             
+///   @param end - the subscriber to stop at                                  
+///   @param draws - [in/out] the number of draw calls to skip, replaced by   
+///                  the number of draw calls actually skipped                
+///   @return the subscriber after the skipped draw calls                     
+Offset VulkanPipeline::SkipDraws(Offset begin, Offset end, Count& draws) const {
+   Count skipped = 0;
+   Offset i = begin;
+   while (i < end and skipped < draws) {
+      // Subscribers merged in an indirect draw are skipped             
+      const auto& sub = mSubscribers[i];
+      i += sub.drawCount ? sub.drawCount : 1;
+      ++skipped;
    }
 
+   draws = skipped;
    return i;
 }
 
+/// Draw a range of subscribers of a single level (used in batched rendering) 
+///   @param begin - the subscriber to start from                             
+///   @param end - the subscriber to stop at, as found by GetLevelEnd or      
+///                SkipDraws                                                  
+///   @param state - the command buffer state, used to skip redundant binds   
+///   @param lights - the clustered lights of the current camera, if any      
+///   @param eye - what the range is drawn from the camera - stereo eyes need 
+///                the variants prepared for them                             
+void VulkanPipeline::RenderRange(
+   Offset begin, Offset end, CommandState& state, VkDescriptorSet lights, Eye eye
+) const {
+   // Bind the pipeline, and the layout its sets are bound with         
+   VkPipeline pipeline = mPipeline;
+   VkPipelineLayout layout = mPipeLayout;
+   if (eye == Eye::Both)
+      pipeline = mMultiviewPipeline;
+   else if (eye != Eye::Mono)
+      pipeline = mStereoPipeline;
+   if (eye != Eye::Mono)
+      layout = mViewsPipeLayout;
+
+   LANGULUS_ASSERT(pipeline, Graphics, "Pipeline variant wasn't prepared");
+   state.BindPipeline(pipeline);
+
+   // Bind static uniform buffer (set 0)                                
+   state.BindSet(layout, 0, mStaticUBOSet[mProducer->GetFrame()]);
+
+   // Bind the clustered lights (set 3)                                 
+   if (mClustered and lights)
+      state.BindSet(layout, LightClusters::SetIndex, lights);
+
+   // Subscribers merged in an indirect draw are skipped                
+   Offset i = begin;
+   while (i < end) {
+      const auto& sub = mSubscribers[i];
+      RenderDraw(sub, state, layout);
+      i += sub.drawCount ? sub.drawCount : 1;
+   }
+}
+
 /// Draw a single subscriber (used in hierarchical drawing)                   
 ///   @param sub - the subscriber to render                                   
+///   @param state - the command buffer state, used to skip redundant binds   
 ///   @attention sub should contain byte offsets for this pipeline's UBOs     
-void VulkanPipeline::RenderSubscriber(const PipeSubscriber& sub) const {
+void VulkanPipeline::RenderSubscriber(const PipeSubscriber& sub, CommandState& state) const {
    // Bind the pipeline                                                 
-   vkCmdBindPipeline(
-      mProducer->GetRenderCB(), 
-      VK_PIPELINE_BIND_POINT_GRAPHICS, 
-      mPipeline
-   );
+   state.BindPipeline(mPipeline);
 
    // Bind static uniform buffer (set 0)                                
-   vkCmdBindDescriptorSets(
-      mProducer->GetRenderCB(),
-      VK_PIPELINE_BIND_POINT_GRAPHICS,
-      mPipeLayout, 0, 1, &mStaticUBOSet.Get(), 0, nullptr
-   );
+   state.BindSet(mPipeLayout, 0, mStaticUBOSet[mProducer->GetFrame()]);
 
+   RenderDraw(sub, state, mPipeLayout);
+}
+
+/// Bind the per-subscriber sets and geometry, and issue the draw call        
+///   @param sub - the subscriber to render                                   
+///   @param state - the command buffer state, used to skip redundant binds   
+///   @param layout - the layout of the bound variant of the pipeline         
+void VulkanPipeline::RenderDraw(
+   const PipeSubscriber& sub, CommandState& state, VkPipelineLayout layout
+) const {
    // Bind dynamic uniform buffers (set 1)                              
-   vkCmdBindDescriptorSets(
-      mProducer->GetRenderCB(),
-      VK_PIPELINE_BIND_POINT_GRAPHICS,
-      mPipeLayout, 1, 1, &mDynamicUBOSet.Get(),
+   state.BindSet(
+      layout, 1, mDynamicUBOSet[mProducer->GetFrame()],
       static_cast<uint32_t>(mRelevantDynamicDescriptors.GetCount()),
       sub.offsets
    );
@@ -786,42 +984,238 @@ void VulkanPipeline::RenderSubscriber(const PipeSubscriber& sub) const {
    // dedicated sampler set for each draw call :(                       
    // read more about the forementioned implementation:                 
    // http://kylehalladay.com/blog/tutorial/vulkan/2018/01/28/Textue-Arrays-Vulkan.html
-   if (mSamplersUBOLayout) {
-      vkCmdBindDescriptorSets(
-         mProducer->GetRenderCB(),
-         VK_PIPELINE_BIND_POINT_GRAPHICS,
-         mPipeLayout, 2, 1, 
-         &mSamplerUBO[sub.samplerSet].mSamplersUBOSet.Get(),
-         0, nullptr
-      );
-   }
+   if (mSamplersUBOLayout)
+      state.BindSet(layout, 2, mSamplerUBO[sub.samplerSet].mSamplersUBOSet[mProducer->GetFrame()]);
+
+   // Runs are drawn by their indirect command, whose instance count    
+   // might be set by the culler. Without indirect commands, that start 
+   // at an instance, runs are drawn directly                           
+   const auto indirect = mProducer->mIndirect.GetBuffer();
+   const bool drawIndirect = sub.drawCount
+      and mProducer->mPhysicalFeatures.drawIndirectFirstInstance;
+   const auto instances = sub.drawCount ? sub.drawCount : 1;
 
    if (mGeometries[sub.geometrySet]) {
       // Vertex/index buffers available, draw them                      
       //TODO bind any geometry-dependent uniforms here                  
-      mGeometries[sub.geometrySet]->Bind();
-      mGeometries[sub.geometrySet]->Render();
+      mGeometries[sub.geometrySet]->Bind(state);
+      if (drawIndirect)
+         mGeometries[sub.geometrySet]->RenderIndirect(state, indirect, sub.drawOffset);
+      else
+         mGeometries[sub.geometrySet]->Render(state, sub.first, instances);
    }
    else {
       // No geometry available, so simulate a triangle draw             
       // Pipelines usually have a streamless vertex shader bound in     
       // such cases, that draws a zoomed in fullscreen triangle         
-      auto cmdbuffer = mProducer->GetRenderCB();
-      vkCmdDraw(cmdbuffer, 3, 1, 0, 0);
+      if (drawIndirect)
+         vkCmdDrawIndirect(state.GetCommands(), indirect, sub.drawOffset, 1, 0);
+      else
+         vkCmdDraw(state.GetCommands(), 3, instances, 0, sub.first);
+   }
+}
+
+/// Write an indirect draw command for each run of subscribers with the same  
+/// state, so that each run is drawn by a single draw call. The indices of    
+/// the run's instances are written along with the command, which starts at   
+/// the first of them. Runs culled on the GPU start with no instances - the   
+/// culler appends the visible ones, over the indices written here            
+/// Must be called after sorting, and after all subscribers are pushed        
+///   @param buffer - the indirect buffer to write commands to                
+void VulkanPipeline::GenerateDraws(IndirectBuffer& buffer) {
+   // Last subscriber is always the one being filled                    
+   const auto count = mSubscribers.GetCount() - 1;
+   const bool indirect = mProducer->mPhysicalFeatures.drawIndirectFirstInstance;
+
+   const auto push = [&](const PipeSubscriber& sub, uint32_t instanceCount) {
+      if (mGeometries[sub.geometrySet])
+         return mGeometries[sub.geometrySet]->PushIndirect(buffer, instanceCount, sub.first);
+      return buffer.Push(VkDrawIndirectCommand {3, instanceCount, 0, sub.first});
+   };
+
+   Offset i = 0;
+   while (i < count) {
+      auto& lead = mSubscribers[i];
+      Offset end = i + 1;
+      while (end < count and lead.SameState(mSubscribers[end]))
+         ++end;
+      lead.drawCount = static_cast<uint32_t>(end - i);
+
+      // Sorting usually scatters the instances of a run, so they're    
+      // found by their indices                                         
+      mRunInstances.Clear();
+      for (Offset j = i; j < end; ++j)
+         mRunInstances << mSubscribers[j].instance;
+      lead.first = buffer.PushInstances(mRunInstances.GetRaw(), mRunInstances.GetCount());
+
+      if (not indirect) {
+         // Runs are drawn directly, starting at their first instance   
+         i = end;
+         continue;
+      }
+
+      if (lead.cullCandidate) {
+         // The culler counts the visible instances                     
+         lead.drawOffset = push(lead, 0);
+         for (Offset j = i; j < end; ++j) {
+            const auto& sub = mSubscribers[j];
+            mProducer->mCuller.Assign(sub.cullCandidate - 1,
+               lead.drawOffset, lead.first, sub.instance);
+         }
+      }
+      else lead.drawOffset = push(lead, lead.drawCount);
+      i = end;
+   }
+}
+
+/// Set the distance to camera of the subscriber being filled                 
+/// Must be called before pushing the instance uniforms                       
+///   @param depth - the distance, as made by DepthToKey                      
+void VulkanPipeline::SetDepth(uint32_t depth) {
+   mSubscribers.Last().depth = depth;
+}
+
+/// Push a run of staged instances, that share all other state with the       
+/// subscriber being filled. Blocks of instance data are allocated for the    
+/// whole run at once, and transforms and depths are copied straight from     
+/// the staged level                                                          
+///   @param instances - the first instance of the run                        
+///   @param count - the number of instances in the run                       
+///   @param candidates - the culling candidate of each instance, or nullptr  
+///                       if they're culled on the CPU                        
+///   @return the block of instance data of the first instance, the others    
+///           follow it                                                       
+uint32_t VulkanPipeline::PushInstances(
+   const StagedInstance* instances, Count count, const uint32_t* candidates
+) {
+   constexpr auto rate = Rate::Instance.GetDynamicUniformIndex();
+   auto& ubo = mDynamicUBO[rate];
+   const auto first = GetInstanceBlock();
+   ubo.Reallocate(ubo.mUsedCount + count);
+   mSubscribers.Reserve(mSubscribers.GetCount() + count);
+
+   for (Offset i = 0; i < count; ++i) {
+      ubo.template Set<Traits::Transform>(instances[i].mModel);
+      auto& subscriber = mSubscribers.Last();
+      subscriber.depth = instances[i].mDepth;
+      if (candidates)
+         subscriber.cullCandidate = candidates[i] + 1;
+      PushUniforms<Rate::Instance>();
+   }
+
+   return first;
+}
+
+/// Get the block of instance data of the subscriber being filled - blocks    
+/// stay where they are, even when subscribers are sorted                     
+///   @return the index of the block                                          
+uint32_t VulkanPipeline::GetInstanceBlock() const noexcept {
+   return mSubscribers.Last().instance;
+}
+
+/// Move an instance, that was already pushed, by setting the transformation  
+/// in its block of instance data                                             
+///   @param block - the block, as returned by GetInstanceBlock               
+///   @param model - the new model transformation                             
+void VulkanPipeline::MoveInstance(uint32_t block, const Mat4& model) {
+   constexpr auto rate = Rate::Instance.GetDynamicUniformIndex();
+   mDynamicUBO[rate].template SetAt<Traits::Transform>(model, block);
+}
+
+/// Check if the pipeline blends with what's already drawn                    
+///   @return true if drawing order matters for the pipeline                  
+bool VulkanPipeline::IsBlended() const noexcept {
+   return mBlendMode != BlendMode::Opaque;
+}
+
+/// Sort subscribers of each level by their state, so that subscribers using  
+/// the same geometry and samplers are drawn one after another, and their     
+/// binds are skipped by the CommandState (used in batched rendering)         
+/// Subscribers are never moved across levels, cameras or rates above these   
+/// When sorting by depth, opaque pipelines are drawn front-to-back, to       
+/// maximize early depth rejection, and blended ones back-to-front, to        
+/// compose correctly - state is only used to break ties                      
+///   @param keys - [in/out] temporary storage, reused between calls          
+///   @param scratch - [in/out] temporary storage, reused between calls       
+///   @param byDepth - whether to sort by distance to camera first            
+void VulkanPipeline::SortSubscribers(RadixEntries& keys, RadixEntries& scratch, bool byDepth) {
+   // Last subscriber is always the one being filled                    
+   const auto count = mSubscribers.GetCount() - 1;
+   if (count < 2)
+      return;
+
+   const auto r = GetRelevantDynamicUBOIndexOfRate<Rate::Level>();
+   const auto ri = GetRelevantDynamicUBOIndexOfRate<Rate::Renderable>();
+   const bool hasRenderableOffset = mDynamicUBO[Rate::Renderable.GetDynamicUniformIndex()].IsValid();
+   const bool backToFront = IsBlended();
+   TMany<PipeSubscriber> sorted;
+
+   Offset begin = 0;
+   while (begin < count) {
+      // Find the range of subscribers, that GetLevelEnd would find     
+      // at once - all have the same offsets up to the level rate       
+      const auto& initial = mSubscribers[begin];
+      Offset end = begin + 1;
+      for (; end < count; ++end) {
+         bool interrupted = false;
+         for (Offset s = 0; s <= r and not interrupted; ++s)
+            interrupted = initial.offsets[s] != mSubscribers[end].offsets[s];
+         if (interrupted)
+            break;
+      }
+
+      if (end - begin > 1) {
+         // Key: geometry set (20 bits), sampler set (20 bits), and the 
+         // renderable's dynamic offset (24 bits) in that significance  
+         // When sorting by depth - depth (32 bits), geometry set (16   
+         // bits), and sampler set (16 bits) instead                    
+         keys.clear();
+         for (Offset i = begin; i < end; ++i) {
+            const auto& sub = mSubscribers[i];
+            if (byDepth) {
+               const uint64_t depth = backToFront ? ~sub.depth : sub.depth;
+               keys.push_back({
+                  (depth << 32)
+                | (static_cast<uint64_t>(sub.geometrySet & 0xFFFF) << 16)
+                | (static_cast<uint64_t>(sub.samplerSet  & 0xFFFF)),
+                  static_cast<uint32_t>(i)
+               });
+               continue;
+            }
+
+            const uint64_t offset = hasRenderableOffset ? sub.offsets[ri] : 0;
+            keys.push_back({
+               (static_cast<uint64_t>(sub.geometrySet & 0xFFFFF) << 44)
+             | (static_cast<uint64_t>(sub.samplerSet  & 0xFFFFF) << 24)
+             | (offset & 0xFFFFFF),
+               static_cast<uint32_t>(i)
+            });
+         }
+
+         RadixSort(keys, scratch);
+
+         sorted.Clear();
+         for (const auto& key : keys)
+            sorted << mSubscribers[key.mIndex];
+         for (Offset i = begin; i < end; ++i)
+            mSubscribers[i] = sorted[i - begin];
+      }
+
+      begin = end;
    }
 }
 
 /// Reset the used dynamic uniform buffers and the subscribers                
 void VulkanPipeline::ResetUniforms() {
-   if (mSamplerUBO) {
-      // Always keep one sampler set in use, free the rest back to pool 
-      mSamplerUBO.Clear();
-      mSamplerUBO.New(1);
-   }
+   // Always keep one sampler set in use, the rest are reused by the    
+   // next draw lists, instead of being freed while frames in flight    
+   // might still be using them                                         
+   if (mSamplerUBO)
+      mSamplersUsed = 1;
 
    // Reset dynamic UBO's usage, keep the allocated space and values    
-   for (auto ubo : mRelevantDynamicDescriptors)
-      ubo->mUsedCount = 0;
+   for (auto& ubo : mDynamicUBO)
+      ubo.mUsedCount = 0;
 
    // Subscribers should be always at least one                         
    mSubscribers.Clear();
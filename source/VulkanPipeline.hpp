@@ -7,9 +7,20 @@
 ///                                                                           
 #pragma once
 #include "inner/UBO.hpp"
+#include "inner/PipelineManifest.hpp"
+#include "inner/CommandState.hpp"
+#include "inner/IndirectBuffer.hpp"
+#include "inner/LightClusters.hpp"
+#include "inner/RadixSort.hpp"
+#include "inner/CompileQueue.hpp"
+#include "inner/Views.hpp"
 #include <Math/Blend.hpp>
 #include <Langulus/Mesh.hpp>
 #include <Langulus/IO.hpp>
+#include <future>
+
+
+struct StagedInstance;
 
 
 ///                                                                           
@@ -19,6 +30,23 @@ struct PipeSubscriber {
    uint32_t offsets[RefreshRate::DynamicUniformCount] {};
    uint32_t samplerSet {};
    uint32_t geometrySet {};
+   // Index of the instance's block in the instance storage buffer      
+   uint32_t instance {};
+   // The first instance of the draw call - the word of the indirect    
+   // buffer, where the indices of the instances it draws start         
+   uint32_t first {};
+   // Number of consecutive subscribers with identical state, drawn     
+   // as instances of a single draw call (zero if drawn alone) - if     
+   // they're culled on the GPU, only the visible ones are drawn        
+   uint32_t drawCount {};
+   // Byte offset of the indirect command inside the indirect buffer    
+   uint32_t drawOffset {};
+   // Index of the GPU culling candidate plus one (zero if CPU culled)  
+   uint32_t cullCandidate {};
+   // Distance to the camera as a sortable key, used in Sorted layers   
+   uint32_t depth {};
+
+   NOD() bool SameState(const PipeSubscriber&) const noexcept;
 };
 
 
@@ -30,41 +58,60 @@ struct VulkanPipeline : A::Graphics, ProducedFrom<VulkanRenderer> {
    LANGULUS_BASES(A::Graphics);
 
 private:
-   using Bindings = TMany<VkDescriptorSetLayoutBinding>;
-
-   void CreateDescriptorLayoutAndSet(const Bindings&, UBOLayout*, VkDescriptorSet*);
+   void CreateDescriptorLayoutAndSet(const Bindings&, UBOLayout*, VkDescriptorSet*, VkDescriptorPool*);
    void CreateUniformBuffers();
    void CreateNewSamplerSet();
    void CreateNewGeometrySet();
+   NOD() VkPipeline CreatePipeline(VkRenderPass, bool views = false) const;
+   void RenderDraw(const PipeSubscriber&, CommandState&, VkPipelineLayout) const;
 
    TMany<TMany<Trait>> mUniforms;
 
    // Shaders                                                           
    Ref<const VulkanShader> mStages[ShaderStage::Counter];
-   // The graphics pipeline                                             
+   // The graphics pipeline, available once compiled                    
    Own<VkPipeline> mPipeline;
-   // The rendering pipeline layout                                     
+   // The graphics pipeline, while being compiled in the background, and 
+   // the queued job that compiles it                                   
+   ::std::future<VkPipeline> mCompilation;
+   CompileQueue::Ticket mCompileJob;
+   // The same pipeline, moving vertices to the views of stereo cameras,
+   // for drawing one eye at a time, and both eyes at once              
+   Own<VkPipeline> mStereoPipeline;
+   Own<VkPipeline> mMultiviewPipeline;
+   // The rendering pipeline layout, shared with all pipelines of the   
+   // same uniform signature, and the one with the views pushed to the  
+   // stereo variants                                                   
    Own<VkPipelineLayout> mPipeLayout;
+   Own<VkPipelineLayout> mViewsPipeLayout;
 
-   // Pool for UBO sets                                                 
-   Own<VkDescriptorPool> mUBOPool;
-
-   // UBO set layouts                                                   
+   // UBO set layouts, shared in the same way                           
    Own<UBOLayout> mStaticUBOLayout;
    Own<UBOLayout> mDynamicUBOLayout;
    Own<UBOLayout> mSamplersUBOLayout;
 
-   // Sets of uniform buffer objects                                    
-   Own<VkDescriptorSet> mStaticUBOSet;
-   Own<VkDescriptorSet> mDynamicUBOSet;
+   // Sets of uniform buffer objects for each frame in flight, and the  
+   // pools they came from                                              
+   Own<VkDescriptorSet> mStaticUBOSet[MaxFramesInFlight];
+   Own<VkDescriptorSet> mDynamicUBOSet[MaxFramesInFlight];
+   VkDescriptorPool mStaticUBOPool[MaxFramesInFlight] {};
+   VkDescriptorPool mDynamicUBOPool[MaxFramesInFlight] {};
 
    // Uniform buffer objects for each RefreshRate                       
    DataUBO<false> mStaticUBO[RefreshRate::StaticUniformCount];
    DataUBO<true> mDynamicUBO[RefreshRate::DynamicUniformCount];
    TMany<DataUBO<true>*> mRelevantDynamicDescriptors;
+   // Indices of the instances of a run, while generating draws         
+   TMany<uint32_t> mRunInstances;
+   // Version of the indirect buffer, that each frame's dynamic set     
+   // points to for instance indices                                    
+   mutable uint32_t mIndicesBound[MaxFramesInFlight] {};
 
-   // Sets and samplers for textures                                    
+   // Sets and samplers for textures, and how many of them the draw     
+   // lists use - the rest are kept from previous draw lists, since     
+   // frames in flight might still be reading them                      
    TMany<SamplerUBO> mSamplerUBO;
+   uint32_t mSamplersUsed {};
 
    // Vertex input descriptor                                           
    VertexInput mInput {};
@@ -76,6 +123,10 @@ private:
    BlendMode mBlendMode {BlendMode::Alpha};
    // Toggle depth testing and writing                                  
    bool mDepth {true};
+   // Whether the pipeline writes to the G-buffer of a deferred layer   
+   bool mDeferred {};
+   // Whether the pipeline reads the clustered lights of a forward layer
+   bool mClustered {};
 
    // Subscribers                                                       
    TMany<PipeSubscriber> mSubscribers;
@@ -91,9 +142,25 @@ public:
    VulkanPipeline(VulkanRenderer*, Describe);
    ~VulkanPipeline();
 
-   NOD() Count RenderLevel(const Offset&) const;
-   void RenderSubscriber(const PipeSubscriber&) const;
+   NOD() bool IsReady() const noexcept;
+   NOD() bool HasStages() const noexcept;
+   bool Promote(bool wait = false);
+   void PrepareStereo(bool multiview);
+
+   NOD() Offset GetLevelEnd(Offset) const;
+   NOD() Offset SkipDraws(Offset, Offset, Count&) const;
+   void RenderRange(Offset, Offset, CommandState&, VkDescriptorSet = {}, Eye = Eye::Mono) const;
+   void RenderSubscriber(const PipeSubscriber&, CommandState&) const;
    void ResetUniforms();
+   void SortSubscribers(RadixEntries&, RadixEntries&, bool byDepth = false);
+   void GenerateDraws(IndirectBuffer&);
+   void SetDepth(uint32_t);
+   void MoveInstance(uint32_t, const Mat4&);
+   uint32_t PushInstances(const StagedInstance*, Count, const uint32_t*);
+
+   NOD() uint32_t GetInstanceBlock() const noexcept;
+
+   NOD() bool IsBlended() const noexcept;
 
    /// Set any kind of uniform                                                
    ///   @tparam RATE - the rate of the trait to set                          
@@ -107,8 +174,10 @@ public:
       if constexpr (CT::Same<DATA, VulkanTexture>) {
          static_assert(RATE == Rate::Renderable,
             "Setting a texture requires Rate::Renderable");
-         // Set the sampler with the given index                        
-         mSamplerUBO[mSubscribers.Last().samplerSet].Set(value, index);
+         // Set the sampler with the given index, if pipeline samples   
+         // any textures at all - fallback pipelines usually don't      
+         if (mSamplerUBO)
+            mSamplerUBO[mSubscribers.Last().samplerSet].Set(value, index);
       }
       else if constexpr (CT::Same<DATA, VulkanGeometry>) {
          static_assert(RATE == Rate::Renderable,
@@ -150,6 +219,15 @@ public:
 
          mDynamicUBO[rate].Push();
 
+         if constexpr (RATE != Rate::Instance) {
+            // The subscriber being filled was made when the previous   
+            // instance was pushed, before this rate advanced           
+            if (mDynamicUBO[rate].IsValid()) {
+               mSubscribers.Last().offsets[GetRelevantDynamicUBOIndexOfRate<RATE>()]
+                  = mDynamicUBO[rate].GetOffset();
+            }
+         }
+
          if constexpr (RATE == Rate::Renderable) {
             // When pushing PerRenderable state, create new sampler set 
             // and a new geometry set for next SetUniform calls         
@@ -159,10 +237,14 @@ public:
 
          if constexpr (RATE == Rate::Instance) {
             // Push a new subscriber only on new instance               
+            // Instance data isn't bound at an offset, it is indexed by 
+            // the instance being drawn instead                         
             PipeSubscriber newSubscriber = mSubscribers.Last();
             Offset i = 0;
             for (auto ubo : mRelevantDynamicDescriptors)
                newSubscriber.offsets[i++] = ubo->GetOffset();
+            newSubscriber.instance = static_cast<uint32_t>(mDynamicUBO[rate].mUsedCount);
+            newSubscriber.cullCandidate = 0;
 
             if constexpr (SUBSCRIBE)
                mSubscribers << newSubscriber;
@@ -16,6 +16,7 @@ VulkanRenderable::VulkanRenderable(VulkanLayer* producer, Describe descriptor)
    : Resolvable   {this} 
    , ProducedFrom {producer, descriptor} {
    VERBOSE_VULKAN("Initializing...");
+   producer->mIndex.Insert(this);
    Couple(descriptor);
    VERBOSE_VULKAN("Initialized");
 }
@@ -26,10 +27,12 @@ VulkanRenderable::~VulkanRenderable() {
 
 /// Reset the renderable, releasing all used content and pipelines            
 void VulkanRenderable::Detach() {
+   mProducer->mIndex.Remove(this);
    for (auto& lod : mLOD) {
       lod.mGeometry.Reset();
       lod.mTexture.Reset();
       lod.mPipeline.Reset();
+      lod.mFallback.Reset();
    }
 
    mMaterialContent.Reset();
@@ -83,20 +86,22 @@ VulkanTexture* VulkanRenderable::GetTexture(const LOD& lod) const {
 }
 
 /// Create GPU pipeline able to utilize geometry, textures and shaders        
+/// Pipelines are compiled in background, so until the pipeline is ready,     
+/// a fallback pipeline for the same vertex layout might be returned instead  
 ///   @param lod - information used to extract the best LOD                   
 ///   @param layer - additional settings might be provided by the used layer  
-///   @return the pipeline                                                    
+///   @return the pipeline, or nullptr if nothing can be drawn yet            
 VulkanPipeline* VulkanRenderable::GetOrCreatePipeline(
    const LOD& lod, const VulkanLayer* layer
 ) const {
    // Always return the predefined pipeline if available                
    if (mPredefinedPipeline)
-      return mPredefinedPipeline;
+      return GetReadyPipeline(mPredefinedPipeline, lod, layer);
 
    // Always return the cached pipeline if available                    
    const auto i = lod.GetAbsoluteIndex();
    if (mLOD[i].mPipeline)
-      return mLOD[i].mPipeline;
+      return GetReadyPipeline(mLOD[i].mPipeline, lod, layer);
 
    // Construct a pipeline                                              
    bool usingGlobalPipeline = false;
@@ -144,9 +149,30 @@ VulkanPipeline* VulkanRenderable::GetOrCreatePipeline(
    });
 
    if (mPredefinedPipeline)
-      return mPredefinedPipeline;
+      return GetReadyPipeline(mPredefinedPipeline, lod, layer);
    else
-      return mLOD[i].mPipeline;
+      return GetReadyPipeline(mLOD[i].mPipeline, lod, layer);
+}
+
+/// Make sure a pipeline is compiled before it is used for drawing            
+///   @param pipeline - the pipeline to check                                 
+///   @param lod - information used to extract the best LOD                   
+///   @param layer - additional settings might be provided by the used layer  
+///   @return the pipeline if ready, or a fallback pipeline for the same      
+///           vertex layout, or nullptr if renderable should be skipped       
+VulkanPipeline* VulkanRenderable::GetReadyPipeline(
+   VulkanPipeline* pipeline, const LOD& lod, const VulkanLayer* layer
+) const {
+   if (not pipeline or pipeline->IsReady())
+      return pipeline;
+
+   const auto i = lod.GetAbsoluteIndex();
+   if (not mLOD[i].mFallback and mGeometryContent) {
+      mLOD[i].mFallback = GetRenderer()->GetFallbackPipeline(
+         mGeometryContent->GetLOD(lod), layer);
+   }
+
+   return mLOD[i].mFallback;
 }
 
 /// Called when owner changes components/traits                               
@@ -164,6 +190,7 @@ void VulkanRenderable::Refresh() {
 
    for (auto instance : mInstances)
       mLevelRange.Embrace(instance->GetLevel());
+   mProducer->mIndex.Insert(this);
 
    // Attempt extracting pipeline/material/geometry/textures from owners
    const auto pipeline = SeekUnit<VulkanPipeline, Seek::Here>();
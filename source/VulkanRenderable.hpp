@@ -23,6 +23,7 @@ struct VulkanRenderable final : A::Renderable, ProducedFrom<VulkanLayer> {
 
 protected:
    friend struct VulkanLayer;
+   friend struct LevelIndex;
 
    // Precompiled instances and levels, updated on Refresh()            
    TMany<const A::Instance*> mInstances;
@@ -37,8 +38,11 @@ protected:
       Ref<VulkanGeometry> mGeometry;
       Ref<VulkanTexture> mTexture;
       Ref<VulkanPipeline> mPipeline;
+      Ref<VulkanPipeline> mFallback;
    } mLOD[LOD::IndexCount];
 
+   NOD() VulkanPipeline* GetReadyPipeline(VulkanPipeline*, const LOD&, const VulkanLayer*) const;
+
 public:
    VulkanRenderable(VulkanLayer*, Describe);
    ~VulkanRenderable();
@@ -8,6 +8,8 @@
 #include "Vulkan.hpp"
 #include <Langulus/Platform.hpp>
 #include <set>
+#include <fstream>
+#include <iterator>
 
 
 /// Descriptor constructor                                                    
@@ -21,18 +23,35 @@ VulkanRenderer::VulkanRenderer(Vulkan* producer, Describe descriptor)
 
    // Retrieve relevant traits from the environment                     
    mWindow = SeekUnitAux<A::Window>(descriptor);
-   LANGULUS_ASSERT(mWindow, Construct,
-      "No window available for renderer - did you create a window component "
-      "_before_ creating the renderer?");
-   if (not SeekValueAux<Traits::Size>(descriptor, mResolution))
+   if (not SeekValueAux<Traits::Size>(descriptor, mResolution) and mWindow)
       mResolution = mWindow->GetSize();
 
+   // Without a window, the renderer draws offscreen, to images of the  
+   // given size - if there's no size either, it is device-only         
+   const bool offscreen = not mWindow
+      and (*mResolution)[0] >= 1 and (*mResolution)[1] >= 1;
+   if (not mWindow and not offscreen) {
+      Logger::Warning(Self(),
+         "No window or size available for renderer - did you create a window "
+         "component _before_ creating the renderer? Renderer will be "
+         "device-only, and can only be used for prewarming pipelines");
+   }
+
    SeekValueAux<Traits::Time>(descriptor, mTime);
    SeekValueAux<Traits::MousePosition>(descriptor, mMousePosition);
    SeekValueAux<Traits::MouseScroll>(descriptor, mMouseScroll);
+   SeekValueAux<Traits::PipelineManifest>(descriptor, mManifestPath);
+   SeekValueAux<Traits::PipelineCache>(descriptor, mPipelineCachePath);
+   if (SeekValueAux<Traits::FramesInFlight>(descriptor, mFramesInFlight))
+      mFramesInFlight = ::std::clamp(mFramesInFlight, 1u, MaxFramesInFlight);
+
+   // Each frame in flight draws to its own image offscreen, so that an 
+   // image is reused only after the GPU is done with it                
+   SeekValueAux<Traits::BackBuffers>(descriptor, mBackBuffers);
+   mBackBuffers = ::std::clamp(mBackBuffers, mFramesInFlight, MaxBackBuffers);
 
    // Create native surface                                             
-   if (not CreateNativeVulkanSurfaceKHR(GetVulkanInstance(), mWindow, mSurface)) {
+   if (mWindow and not CreateNativeVulkanSurfaceKHR(GetVulkanInstance(), mWindow, mSurface)) {
       Detach();
       LANGULUS_OOPS(Graphics, "Error creating window surface");
    }
@@ -51,7 +70,7 @@ VulkanRenderer::VulkanRenderer(Vulkan* producer, Describe descriptor)
 
    // Not all queues support presenting. Find one that does.            
    std::vector<VkBool32> supportsPresent(queueCount);
-   for (uint32_t i = 0; i < queueCount; i++) {
+   for (uint32_t i = 0; i < queueCount and mSurface; i++) {
       if (vkGetPhysicalDeviceSurfaceSupportKHR(adapter, i, mSurface, &supportsPresent[i])) {
          Detach();
          LANGULUS_OOPS(Graphics, "vkGetPhysicalDeviceSurfaceSupportKHR failed");
@@ -78,6 +97,10 @@ VulkanRenderer::VulkanRenderer(Vulkan* producer, Describe descriptor)
          mTransferIndex = i;
    }
 
+   // Offscreen and device-only renderers never present                 
+   if (not mSurface)
+      mPresentIndex = mGraphicIndex;
+
    if (mGraphicIndex == UINT32_MAX or mPresentIndex == UINT32_MAX) {
       Detach();
       LANGULUS_OOPS(Graphics,
@@ -118,14 +141,41 @@ VulkanRenderer::VulkanRenderer(Vulkan* producer, Describe descriptor)
 
    // Create the device with required graphics & presentation           
    std::vector<const char*> extensions;
-   extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+   if (mSurface)
+      extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+   // Stereo cameras draw both eyes at once, if the device has          
+   // multiview - its feature is mandatory, where the extension is      
+   if (mProducer->mSupportsProperties2) {
+      uint32_t availableCount {};
+      vkEnumerateDeviceExtensionProperties(adapter, nullptr, &availableCount, nullptr);
+      std::vector<VkExtensionProperties> available(availableCount);
+      vkEnumerateDeviceExtensionProperties(adapter, nullptr, &availableCount, available.data());
+      for (const auto& ext : available) {
+         if (0 == strcmp(ext.extensionName, VK_KHR_MULTIVIEW_EXTENSION_NAME)) {
+            extensions.push_back(VK_KHR_MULTIVIEW_EXTENSION_NAME);
+            mMultiview = true;
+            break;
+         }
+      }
+   }
+
+   VkPhysicalDeviceMultiviewFeaturesKHR multiviewFeatures {};
+   multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES_KHR;
+   multiviewFeatures.multiview = VK_TRUE;
 
    // Specify required features here                                    
    VkPhysicalDeviceFeatures deviceFeatures {};
    deviceFeatures.fillModeNonSolid = VK_TRUE;
 
+   // Runs of instances are drawn by indirect commands, that start at   
+   // their first instance - used only if available                     
+   vkGetPhysicalDeviceFeatures(adapter, &mPhysicalFeatures);
+   deviceFeatures.drawIndirectFirstInstance = mPhysicalFeatures.drawIndirectFirstInstance;
+
    VkDeviceCreateInfo deviceInfo {};
    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+   deviceInfo.pNext = mMultiview ? &multiviewFeatures : nullptr;
    deviceInfo.pQueueCreateInfos = queueCreateInfos.data();
    deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
    deviceInfo.pEnabledFeatures = &deviceFeatures;
@@ -147,6 +197,9 @@ VulkanRenderer::VulkanRenderer(Vulkan* producer, Describe descriptor)
    }
 
    mVRAM.Initialize(adapter, mDevice, mTransferIndex);
+   mLayouts.Initialize(mDevice);
+   mViewsLayout = mLayouts.GetPipelineLayout({}, true);
+   mIndirect.Create(this);
 
    vkGetDeviceQueue(mDevice, mGraphicIndex, 0, &mRenderQueue.Get());
    vkGetDeviceQueue(mDevice, mPresentIndex, 0, &mPresentQueue.Get());
@@ -162,9 +215,25 @@ VulkanRenderer::VulkanRenderer(Vulkan* producer, Describe descriptor)
       LANGULUS_OOPS(Graphics, "Can't create command pool for rendering");
    }
 
-   const auto format = mSwapchain.GetSurfaceFormat();
+   // Create a command pool for each worker, that records passes        
+   try { mSecondary.Create(this, mJobs->GetWorkers(), mFramesInFlight); }
+   catch (...) {
+      Detach();
+      throw;
+   }
+
+   // Create the pipeline cache, reusing any previously saved data      
+   CreatePipelineCache();
+
+   // Offscreen and device-only renderers use the same format a window  
+   // usually has                                                       
+   const auto format = mSurface ? mSwapchain.GetSurfaceFormat()
+      : VkSurfaceFormatKHR {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
 
    // Define color attachment for the back buffer                       
+   // It starts undefined, so the pass itself transitions the acquired  
+   // image from VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, and the frame turns it
+   // back, once all passes are done with it                            
    VkAttachmentDescription colorAttachment {};
    colorAttachment.format = format.format;
    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -181,7 +250,8 @@ VulkanRenderer::VulkanRenderer(Vulkan* producer, Describe descriptor)
    depthAttachment.format = VK_FORMAT_D32_SFLOAT;
    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+   // Depth is stored, so that occluders can be captured from it        
+   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -204,13 +274,23 @@ VulkanRenderer::VulkanRenderer(Vulkan* producer, Describe descriptor)
    subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
    // Create the main render pass                                       
+   // The layout transition waits for the stage, at which the image is  
+   // acquired, and for any previous use of the depth, which all frames 
+   // in flight share. The loading variant is begun right after passes  
+   // that drew to the same color, so their writes are waited for too   
    VkSubpassDependency dependency {};
    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
    dependency.dstSubpass = 0;
-   dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-   dependency.srcAccessMask = 0;
-   dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+   dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                           | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+   dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+   dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                           | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+                            | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+                            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
    VkRenderPassCreateInfo renderPassInfo {};
    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -226,33 +306,135 @@ VulkanRenderer::VulkanRenderer(Vulkan* producer, Describe descriptor)
       LANGULUS_OOPS(Graphics, "Can't create main rendering pass");
    }
 
-   // Create the swap chain                                             
-   try { mSwapchain.Create(format, mFamilies); }
+   // Create a variant of it, for layers that draw over what previous   
+   // ones left - it is compatible with the same framebuffers. Loaded   
+   // contents must be in the layouts the render graph left them in     
+   VkAttachmentDescription loadAttachments[2] {
+      mPassAttachments[0], mPassAttachments[1]
+   };
+   for (auto& attachment : loadAttachments) {
+      attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+      attachment.initialLayout = attachment.finalLayout;
+   }
+   renderPassInfo.pAttachments = loadAttachments;
+
+   if (vkCreateRenderPass(mDevice, &renderPassInfo, nullptr, &mLoadPass.Get())) {
+      Detach();
+      LANGULUS_OOPS(Graphics, "Can't create main loading pass");
+   }
+
+   // Create the deferred lights pass, before the swapchain creates     
+   // framebuffers for it                                               
+   try { mLightPass.Create(this); }
    catch (...) {
       Detach();
       throw;
    }
 
+   // Create the shadow atlas, that deferred lights read                
+   try { mShadows.Create(this); }
+   catch (...) {
+      Detach();
+      throw;
+   }
+
+   // Create the target of stereo cameras, that draw both eyes at once  
+   if (mMultiview) {
+      try { mStereo.Create(this, format.format); }
+      catch (...) {
+         Detach();
+         throw;
+      }
+   }
+
+   // Create the swap chain, or the images to draw to offscreen         
+   if (mSurface or offscreen) {
+      try { mSwapchain.Create(format, mFamilies); }
+      catch (...) {
+         Detach();
+         throw;
+      }
+   }
+
    // Get device properties                                             
    vkGetPhysicalDeviceProperties(adapter, &mPhysicalProperties);
 
-   // Get device features                                               
-   vkGetPhysicalDeviceFeatures(adapter, &mPhysicalFeatures);
+   // Create timestamp queries for measuring GPU time, if supported     
+   if (mPhysicalProperties.limits.timestampComputeAndGraphics) {
+      VkQueryPoolCreateInfo queryInfo {};
+      queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+      queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+      queryInfo.queryCount = 2 * MaxFramesInFlight;
+
+      if (vkCreateQueryPool(mDevice, &queryInfo, nullptr, &mTimestamps)) {
+         Logger::Warning(Self(), "Can't create timestamp queries - GPU time won't be measured");
+         mTimestamps = nullptr;
+      }
+   }
+
+   // Create the culling compute pipeline                               
+   try { mCuller.Create(this); }
+   catch (...) {
+      Detach();
+      throw;
+   }
 
    Couple(descriptor);
+
+   // Create all pipelines that were recorded in previous runs - only   
+   // after coupling, since their materials are generated by modules    
+   // the renderer's owners have loaded. A manifest that can't be       
+   // replayed only costs us the prewarming                             
+   if (mManifestPath) {
+      try { Prewarm(mManifestPath); }
+      catch (...) {
+         Logger::Warning(Self(), "Can't prewarm pipelines from: ", mManifestPath);
+      }
+   }
+
    VERBOSE_VULKAN("Initialized");
 }
 
 /// Destroy anything created                                                  
 void VulkanRenderer::Detach() {
+   // Frames might still be in flight, using any of the resources below 
+   if (mDevice)
+      vkDeviceWaitIdle(mDevice);
+
+   mRelevantPipes.Reset();
+   mLayersSignature = {};
+   mGenerated.Reset();
    mLayers.Reset();
    mWindow.Reset();
 
+   // Pipelines might still be compiling in the background, so make     
+   // sure they're done with the device before it is destroyed          
+   mPipelines.Reset();
+
+   // Remember all pipelines for next time                              
+   if (mManifestPath and mManifest.IsDirty())
+      mManifest.Save(mManifestPath);
+
    if (mDevice) {
       vkDeviceWaitIdle(mDevice);
       mSwapchain.Destroy();
+      mLightPass.Destroy();
+      mShadows.Destroy();
+      mStereo.Destroy();
+      mBarriers = {};
+      mCuller.Destroy();
+      if (mTimestamps)
+         vkDestroyQueryPool(mDevice, mTimestamps, nullptr);
+      mTimestamps = nullptr;
+      DestroyPipelineCache();
+      mLayouts.Destroy();
+      mViewsLayout = {};
+      mIndirect.Destroy();
       if (mPass)
          vkDestroyRenderPass(mDevice, mPass, nullptr);
+      if (mLoadPass)
+         vkDestroyRenderPass(mDevice, mLoadPass, nullptr);
+      mSecondary.Destroy();
       if (mCommandPool)
          vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
       mVRAM.Destroy();
@@ -277,10 +459,11 @@ VulkanRenderer::~VulkanRenderer() {
 void VulkanRenderer::Refresh() {
    // Resize swapchain from the environment                             
    const Scale2 previousResolution = *mResolution;
-   if (not SeekValue<Traits::Size>(mResolution))
+   if (not SeekValue<Traits::Size>(mResolution) and mWindow)
       mResolution = mWindow->GetSize();
 
-   if (*mResolution != previousResolution) {
+   if (*mResolution != previousResolution
+   and (mSurface or mSwapchain.IsOffscreen())) {
       mSwapchain.Recreate(mFamilies);
       vkDeviceWaitIdle(mDevice);
    }
@@ -289,6 +472,23 @@ void VulkanRenderer::Refresh() {
    SeekValue<Traits::Time>(mTime);
    SeekValue<Traits::MousePosition>(mMousePosition);
    SeekValue<Traits::MouseScroll>(mMouseScroll);
+
+   // Prewarm pipelines, if a different manifest was provided, for      
+   // example when loading a new level                                  
+   const auto previousManifest = mManifestPath;
+   SeekValue<Traits::PipelineManifest>(mManifestPath);
+   if (mManifestPath != previousManifest) {
+      if (previousManifest and mManifest.IsDirty())
+         mManifest.Save(previousManifest);
+
+      // A manifest that can't be replayed only costs us the prewarming 
+      if (mManifestPath) {
+         try { Prewarm(mManifestPath); }
+         catch (...) {
+            Logger::Warning(Self(), "Can't prewarm pipelines from: ", mManifestPath);
+         }
+      }
+   }
 }
 
 /// Introduce renderables, cameras, lights, shaders, textures, geometry       
@@ -302,37 +502,84 @@ void VulkanRenderer::Create(Verb& verb) {
    mTextures.Create(this, verb);
 }
 
-/// Interpret the renderer as an A::Texture, i.e. take a screenshot           
+/// Interpret the renderer as an A::Texture, i.e. take a screenshot, or as    
+/// Time, i.e. the time the GPU spent on the last measured frame              
 ///   @param verb - interpret verb                                            
 void VulkanRenderer::Interpret(Verb& verb) {
+   // Device-only renderers have nothing to take a screenshot of        
+   if (not mSurface and not mSwapchain.IsOffscreen())
+      return;
+
    verb.ForEach([&](DMeta meta) {
       if (meta->template CastsTo<A::Image>())
          verb << mSwapchain.TakeScreenshot().Get();
+      else if (meta->template CastsTo<Time>())
+         verb << mStats.mGPUTime;
    });
 }
 
 /// Render an object, along with all of its children                          
 /// Rendering pipeline depends on each entity's components                    
 void VulkanRenderer::Draw() {
-   if (mWindow->IsMinimized())
+   // Let a few more queued pipelines start compiling - the rest wait   
+   // for the next frames, so that compilation doesn't flood the device 
+   mCompiler.Release(mCompileBudget);
+
+   // Device-only renderers have nothing to draw to                     
+   if (not mSurface and not mSwapchain.IsOffscreen())
+      return;
+   if (mWindow and mWindow->IsMinimized())
       return;
 
-   // Wait for previous present to finish                               
-   vkQueueWaitIdle(mPresentQueue);
+   // Move on to the next frame in flight, and wait only until the GPU  
+   // is done with its previous use - the other frames keep drawing     
+   mSwapchain.NextFrame();
+   const auto frame = mSwapchain.GetFrame();
 
-   // Reset all pipelines that already exist                            
-   for (auto& pipe : mPipelines)
-      pipe.ResetUniforms();
+   // Passes recorded by workers for that frame are done, too           
+   mSecondary.Reset(frame);
 
-   // Generate the draw lists for all layers                            
-   // This will populate uniform buffers for all relevant pipelines     
-   PipelineSet relevantPipes;
+   // Culling results of that frame are available, too                  
+   mCuller.Validate();
+
+   // Start using any pipelines that finished compiling in background   
+   // Renderables switch from their fallbacks, so draw lists change     
+   const bool promoted = PromotePipelines();
+   mStats = {};
+
+   // Timestamps of that frame are available, too                       
+   mStats.mGPUTime = ReadGPUTime(frame);
+
+   // Every layer must be checked, so that their signatures are current 
+   Signature layers;
+   for (auto& layer : mLayers) {
+      layer.CheckChanges();
+      layers.Mix(&layer);
+   }
+
+   const bool relayered = layers.mHash != mLayersSignature;
+   mLayersSignature = layers.mHash;
+
+   // Shadows, that didn't fit in the atlas, get room only when all     
+   // draw lists are generated again. Draw lists are only read while    
+   // recording, and everything the GPU reads has a copy for each frame 
+   // in flight, uploaded when that frame comes around, so the other    
+   // frames keep drawing the previous draw lists meanwhile             
+   GenerateLayers(promoted or relayered or mShadows.IsFull());
+
+   // Upload the indirect draw commands, shadows and clustered lights   
+   // first, if they changed since this frame was last drawn -          
+   // pipelines point to the indirect buffer for instance indices       
+   mIndirect.Upload();
+   mShadows.Upload();
    for (auto& layer : mLayers)
-      layer.Generate(relevantPipes);
+      layer.Upload();
 
-   // Upload any uniform buffer changes to VRAM                         
-   // Once this data is uploaded, we're free to prepare the next frame  
-   for (auto pipe : relevantPipes) {
+   // Upload any uniform buffer changes to VRAM, in the buffers of this 
+   // frame in flight - only the ones that changed since this frame was 
+   // last drawn are uploaded, which are just the tick rate ones, when  
+   // the draw lists were reused                                        
+   for (auto pipe : mRelevantPipes) {
       pipe->SetUniform<Rate::Tick, Traits::Time>(
          mTime->Current());
       pipe->SetUniform<Rate::Tick, Traits::MousePosition>(
@@ -350,6 +597,10 @@ void VulkanRenderer::Draw() {
       GetRenderCB(), mPass, mSwapchain.GetFramebuffer()
    };
 
+   config.mLoadPass = mLoadPass;
+   config.mDeferredPass = mLightPass.GetPass();
+   config.mDeferredLoadPass = mLightPass.GetLoadPass();
+   config.mDeferredFrame = mSwapchain.GetDeferredFramebuffer();
    config.mColorClear.color = {{1.0f, 0.0f, 0.0f, 1.0f}};
    config.mDepthClear.depthStencil = {1.0f, 0};
    config.mDepthSweep.colorAttachment = VK_ATTACHMENT_UNUSED;
@@ -363,32 +614,370 @@ void VulkanRenderer::Draw() {
    config.mPassBeginInfo.renderArea.extent.height = static_cast<uint32_t>((*mResolution)[1]);
    config.mPassBeginInfo.clearValueCount = 2;
    config.mPassBeginInfo.pClearValues = &config.mColorClear;
+   config.mState.Begin(config.mCommands, mLayouts);
+   mBarriers.Flush(config.mCommands);
+
+   if (mTimestamps) {
+      vkCmdResetQueryPool(config.mCommands, mTimestamps, 2 * frame, 2);
+      vkCmdWriteTimestamp(config.mCommands,
+         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mTimestamps, 2 * frame);
+   }
+
+   // Declare all passes of the frame, along with what they use - the   
+   // barriers between them are derived when the graph is compiled      
+   mGraph.Reset();
+   config.mGraph = &mGraph;
+   config.mColor = mGraph.Import(mSwapchain.GetCurrentImage(), GraphUse::None, false);
+   config.mDepth = mGraph.Import(mSwapchain.GetDepthImage(), GraphUse::None, false);
+   config.mShadows = mGraph.Import(mShadows.GetImage(), GraphUse::Sampled, true);
+   config.mIndirect = mGraph.Import(mIndirect.GetBuffer(), GraphUse::Indirect, true);
+
+   // Cull instances before any indirect draw reads them - they're      
+   // appended to commands, restored to their pristine state first      
+   if (mCuller.IsActive()) {
+      mGraph.AddPass([&](RenderGraph::Pass) { mIndirect.Restore(config.mCommands); });
+      mGraph.Write(config.mIndirect, GraphUse::TransferWrite);
+      mGraph.AddPass([&](RenderGraph::Pass) { mCuller.Dispatch(config.mCommands); });
+      mGraph.Write(config.mIndirect, GraphUse::ComputeWrite);
+   }
 
    if (mLayers) {
       // Render all layers                                              
       for (const auto& layer : mLayers)
-         layer.Render(config);
+         layer.Declare(mGraph, config);
    }
    else {
       // No layers available, so just clear screen                      
-      VkViewport viewport {};
-      viewport.width = (*mResolution)[0];
-      viewport.height = (*mResolution)[1];
+      mGraph.AddPass([&](RenderGraph::Pass pass) { ClearScreen(config, pass); });
+      mGraph.Write(config.mColor, GraphUse::Color, true);
+      mGraph.Write(config.mDepth, GraphUse::Depth, true);
+   }
+
+   // Culling results are validated on the host                         
+   if (mCuller.IsActive() and mCuller.IsValidating()) {
+      mGraph.AddPass({}, true);
+      mGraph.Read(config.mIndirect, GraphUse::HostRead);
+   }
 
-      VkRect2D scissor {};
-      scissor.extent.width = static_cast<uint32_t>(viewport.width);
-      scissor.extent.height = static_cast<uint32_t>(viewport.height);
+   // Whatever ends up in the back buffer is presented, or kept as a    
+   // transfer source offscreen, ready to be copied from                
+   mGraph.AddPass({}, true);
+   mGraph.Read(config.mColor, mSwapchain.IsOffscreen()
+      ? GraphUse::TransferRead : GraphUse::Present);
 
-      vkCmdBeginRenderPass(config.mCommands, &config.mPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-      vkCmdSetViewport(config.mCommands, 0, 1, &viewport);
-      vkCmdSetScissor(config.mCommands, 0, 1, &scissor);
-      vkCmdEndRenderPass(config.mCommands);
+   mGraph.Compile();
+   mGraph.Execute(config.mCommands);
+
+   if (mTimestamps) {
+      vkCmdWriteTimestamp(config.mCommands,
+         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mTimestamps, 2 * frame + 1);
+      mTimestampsPending[frame] = true;
    }
 
+   mStats.mBindsIssued = config.mState.mIssued;
+   mStats.mBindsSkipped = config.mState.mSkipped;
+
    // Swap buffers and conclude this frame                              
    mSwapchain.EndRendering();
 }
 
+/// Clear the screen, when there are no layers to draw                        
+///   @param config - where to render to                                      
+///   @param pass - the clearing pass in the frame's render graph             
+void VulkanRenderer::ClearScreen(const RenderConfig& config, RenderGraph::Pass pass) const {
+   VkViewport viewport {};
+   viewport.width = (*mResolution)[0];
+   viewport.height = (*mResolution)[1];
+
+   VkRect2D scissor {};
+   scissor.extent.width = static_cast<uint32_t>(viewport.width);
+   scissor.extent.height = static_cast<uint32_t>(viewport.height);
+
+   config.BeginPass(pass, VK_SUBPASS_CONTENTS_INLINE);
+   vkCmdSetViewport(config.mCommands, 0, 1, &viewport);
+   vkCmdSetScissor(config.mCommands, 0, 1, &scissor);
+   config.EndGroup(pass);
+}
+
+/// Read the timestamps, written while drawing the frame in flight the last   
+/// time it came around                                                       
+///   @param frame - the frame in flight, which the GPU must be done with     
+///   @return the time the GPU spent on the frame, or zero if unavailable     
+Time VulkanRenderer::ReadGPUTime(uint32_t frame) {
+   if (not mTimestampsPending[frame])
+      return {};
+   mTimestampsPending[frame] = false;
+
+   // Not waiting for results - the frame's fence was waited for        
+   uint64_t stamps[2] {};
+   if (vkGetQueryPoolResults(mDevice, mTimestamps, 2 * frame, 2, sizeof(stamps),
+      stamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+      return {};
+
+   const auto ns = static_cast<double>(stamps[1] - stamps[0])
+      * mPhysicalProperties.limits.timestampPeriod;
+   return ::std::chrono::nanoseconds {static_cast<int64_t>(ns)};
+}
+
+/// Generate the draw lists of the layers, that changed since they were last  
+/// generated. Each layer uses its own pipelines, but all of them share the   
+/// indirect buffer, the culling candidates and the shadow records, each      
+/// using a part of them, in the order their draw lists were generated.       
+/// Layers before the first changed one keep their parts, pipelines and       
+/// uniform blocks as they are, while the rest are generated again - the      
+/// changed layers last, so that the layers, which change every frame, end    
+/// up after the ones that don't. Layers, whose instances only moved, move    
+/// them in place instead                                                     
+///   @param all - whether to generate all layers again, because layers or    
+///                the pipelines they use changed, or shadows didn't fit      
+void VulkanRenderer::GenerateLayers(bool all) {
+   TMany<VulkanLayer*> order;
+   Offset first = 0;
+   if (all) {
+      for (auto& layer : mLayers)
+         order << &layer;
+   }
+   else {
+      first = mGenerated.GetCount();
+      for (Offset i = 0; i < first; ++i) {
+         const auto layer = mGenerated[i];
+         if (layer->mChange == LayerChange::Moved) {
+            if (layer->MoveInstances())
+               ++mStats.mLayersMoved;
+            else
+               layer->mChange = LayerChange::All;
+         }
+
+         if (layer->mChange == LayerChange::All)
+            first = i;
+      }
+
+      if (first == mGenerated.GetCount())
+         return;
+
+      // Layers after the first changed one, that didn't change, go     
+      // before the changed ones                                        
+      for (Offset i = 0; i < mGenerated.GetCount(); ++i) {
+         if (i < first or mGenerated[i]->mChange != LayerChange::All)
+            order << mGenerated[i];
+      }
+
+      for (Offset i = first; i < mGenerated.GetCount(); ++i) {
+         if (mGenerated[i]->mChange == LayerChange::All)
+            order << mGenerated[i];
+      }
+   }
+
+   if (first == 0) {
+      // Reset all pipelines that already exist                         
+      for (auto& pipe : mPipelines)
+         pipe.ResetUniforms();
+      mIndirect.Clear();
+      mCuller.Clear();
+      mShadows.Clear();
+   }
+   else {
+      // Discard the parts of the layers, that are generated again      
+      const auto& mark = mGenerated[first]->mMark;
+      mIndirect.Truncate(mark.mCommands);
+      mCuller.Truncate(mark.mCulling);
+      mShadows.Truncate(mark.mRecords);
+      for (Offset i = first; i < mGenerated.GetCount(); ++i) {
+         for (auto pipe : mGenerated[i]->mRelevantPipelines)
+            pipe->ResetUniforms();
+      }
+   }
+
+   // Generate the draw lists of the rest of the layers                 
+   // This will populate uniform buffers for all relevant pipelines     
+   mRelevantPipes.Clear();
+   for (Offset i = 0; i < order.GetCount(); ++i) {
+      const auto layer = order[i];
+      if (i < first) {
+         for (auto pipe : layer->mRelevantPipelines)
+            mRelevantPipes << pipe;
+         continue;
+      }
+
+      layer->mMark = {
+         mIndirect.GetCommands().GetCount(),
+         mCuller.GetMark(),
+         mShadows.GetRecordCount()
+      };
+      layer->Generate(mRelevantPipes);
+      ++mStats.mLayersGenerated;
+   }
+
+   mGenerated = Abandon(order);
+}
+
+/// Promote pipelines that were compiled in background since last frame       
+/// At most mPipelineBudget pipelines are promoted per frame, the rest will   
+/// wait for the next frames, while their renderables use fallbacks           
+///   @return true if any pipeline was promoted                               
+bool VulkanRenderer::PromotePipelines() {
+   Count promoted = 0;
+   for (auto& pipeline : mPipelines) {
+      if (promoted >= mPipelineBudget)
+         break;
+      if (pipeline.Promote())
+         ++promoted;
+   }
+
+   return promoted > 0;
+}
+
+/// Compile all pipelines recorded in a manifest, before they're needed       
+/// Pipelines are compiled in parallel on the compile queue, and this call    
+/// blocks until all of them are done, so it's best done on startup or on     
+/// level load. Any pipelines created later will be added to the manifest     
+/// Prewarming only fills the pipeline cache and the shader library - the     
+/// pipelines are made from records, which real requests never match, so      
+/// they're destroyed right after compiling. Pipelines requested afterwards   
+/// are then created from the cache, without compiling anything               
+///   @param filename - the manifest file                                     
+void VulkanRenderer::Prewarm(const Text& filename) {
+   mManifest.Load(filename);
+   const auto& records = mManifest.GetRecords();
+   if (not records)
+      return;
+
+   VERBOSE_VULKAN_TAB("Prewarming ", records.GetCount(), " pipelines from ", filename);
+   const auto start = SteadyClock::Now();
+
+   // Creating deferred pipelines only generates shaders and layouts    
+   // on this thread - actual compilation happens on the compile queue  
+   // They're kept out of the pipeline factory                          
+   ::std::vector<::std::unique_ptr<VulkanPipeline>> prewarmed;
+   for (auto& record : records) {
+      const auto construct = Construct::From<VulkanPipeline>(record);
+      try {
+         auto pipeline = ::std::make_unique<VulkanPipeline>(
+            this, construct.GetDescriptor());
+
+         // A pipeline without shaders means its material couldn't be   
+         // generated, and it would only warm up an empty pipeline      
+         if (not pipeline->HasStages()) {
+            Logger::Error(Self(), "Prewarmed pipeline has no shaders: ", record.mMaterial);
+            continue;
+         }
+         prewarmed.push_back(::std::move(pipeline));
+      }
+      catch (...) {
+         Logger::Error(Self(), "Can't prewarm pipeline from: ", record.mMaterial);
+      }
+   }
+
+   // Wait for all of them, there's no frame to stall yet, so all of    
+   // them may start compiling at once                                  
+   mCompiler.Release(mCompiler.GetQueued());
+   for (auto& pipeline : prewarmed) {
+      try { pipeline->Promote(true); }
+      catch (...) {
+         Logger::Error(Self(), "Prewarmed pipeline failed to compile");
+      }
+   }
+
+   VERBOSE_VULKAN("Prewarming took ", SteadyClock::Now() - start);
+}
+
+/// Create the pipeline cache, initializing it from the cache file, if any    
+void VulkanRenderer::CreatePipelineCache() {
+   ::std::vector<char> data;
+   if (mPipelineCachePath) {
+      ::std::ifstream file {
+         ::std::string {Token {mPipelineCachePath}}, ::std::ios::binary
+      };
+
+      if (file) {
+         data.assign(
+            ::std::istreambuf_iterator<char> {file},
+            ::std::istreambuf_iterator<char> {}
+         );
+      }
+   }
+
+   // The driver validates the data header and ignores it if it doesn't 
+   // match the current device, so no need to check it ourselves        
+   VkPipelineCacheCreateInfo cacheInfo {};
+   cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+   cacheInfo.initialDataSize = data.size();
+   cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+   if (vkCreatePipelineCache(mDevice, &cacheInfo, nullptr, &mPipelineCache.Get())) {
+      // Retry without the initial data, in case it was corrupted       
+      cacheInfo.initialDataSize = 0;
+      cacheInfo.pInitialData = nullptr;
+      if (vkCreatePipelineCache(mDevice, &cacheInfo, nullptr, &mPipelineCache.Get()))
+         LANGULUS_OOPS(Graphics, "Can't create pipeline cache");
+   }
+}
+
+/// Save the pipeline cache to the cache file, if any, and destroy it         
+void VulkanRenderer::DestroyPipelineCache() {
+   if (not mPipelineCache)
+      return;
+
+   size_t size {};
+   if (mPipelineCachePath
+   and not vkGetPipelineCacheData(mDevice, mPipelineCache, &size, nullptr) and size) {
+      ::std::vector<char> data(size);
+      if (not vkGetPipelineCacheData(mDevice, mPipelineCache, &size, data.data())) {
+         ::std::ofstream file {
+            ::std::string {Token {mPipelineCachePath}},
+            ::std::ios::binary | ::std::ios::trunc
+         };
+
+         if (file)
+            file.write(data.data(), static_cast<::std::streamsize>(size));
+         else
+            Logger::Warning(Self(), "Can't write pipeline cache: ", mPipelineCachePath);
+      }
+   }
+
+   vkDestroyPipelineCache(mDevice, mPipelineCache, nullptr);
+   mPipelineCache.Reset();
+}
+
+/// Get a cheap pipeline, that can draw a mesh with its vertex layout only    
+/// Used in place of pipelines that are still being compiled in background    
+/// Fallbacks are created immediately - they're usually trivial, and their    
+/// generated shaders are shared by all meshes of the same vertex layout      
+///   @param mesh - the mesh to draw                                          
+///   @param layer - the layer, that might influence the pipeline             
+///   @return the fallback pipeline, or nullptr if it isn't ready either      
+VulkanPipeline* VulkanRenderer::GetFallbackPipeline(
+   const A::Mesh* mesh, const VulkanLayer* layer
+) {
+   if (not mesh)
+      return nullptr;
+
+   auto construct = Construct::From<VulkanPipeline>();
+   construct << mesh;
+   if (layer)
+      construct << layer;
+
+   // Fallbacks are never deferred                                      
+   const auto deferred = mDeferredPipelines;
+   mDeferredPipelines = false;
+   Verbs::Create creator {&construct};
+   try { Create(creator); }
+   catch (...) {
+      mDeferredPipelines = deferred;
+      throw;
+   }
+   mDeferredPipelines = deferred;
+
+   VulkanPipeline* result {};
+   creator->ForEachDeep([&](VulkanPipeline& p) {
+      result = &p;
+   });
+
+   // A pipeline with the same descriptor might have already been       
+   // requested for deferred compilation - don't use it before ready    
+   return result and result->IsReady() ? result : nullptr;
+}
+
 /// Get the vulkan library instance                                           
 ///   @return the instance handle                                             
 VkInstance VulkanRenderer::GetVulkanInstance() const noexcept {
@@ -415,12 +1004,26 @@ Offset VulkanRenderer::GetOuterUBOAlignment() const noexcept {
    );
 }
 
+/// Get hardware dependent outer alignment for storage buffers                
+///   @return the alignment                                                   
+Offset VulkanRenderer::GetOuterStorageAlignment() const noexcept {
+   return static_cast<Offset>(
+      mPhysicalProperties.limits.minStorageBufferOffsetAlignment
+   );
+}
+
 /// Get the command buffer for the current frame                              
 ///   @return the command buffer                                              
 VkCommandBuffer VulkanRenderer::GetRenderCB() const noexcept {
    return mSwapchain.GetRenderCB();
 }
 
+/// Get the frame in flight, that is being prepared                           
+///   @return the frame index, below the number of frames in flight           
+uint32_t VulkanRenderer::GetFrame() const noexcept {
+   return mSwapchain.GetFrame();
+}
+
 /// Get the current resolution                                                
 ///   @return the resolution                                                  
 const Scale2& VulkanRenderer::GetResolution() const noexcept {
@@ -431,4 +1034,10 @@ const Scale2& VulkanRenderer::GetResolution() const noexcept {
 ///   @return the surface                                                     
 VkSurfaceKHR VulkanRenderer::GetSurface() const noexcept {
    return mSurface;
+}
+
+/// Get the statistics, gathered while drawing the last frame                 
+///   @return the statistics                                                  
+const RendererStats& VulkanRenderer::GetStats() const noexcept {
+   return mStats;
 }
\ No newline at end of file
@@ -13,12 +13,59 @@
 #include "inner/VulkanTexture.hpp"
 #include "inner/VulkanShader.hpp"
 #include "inner/VulkanSwapchain.hpp"
+#include "inner/VulkanLayouts.hpp"
+#include "inner/IndirectBuffer.hpp"
+#include "inner/InstanceCuller.hpp"
+#include "inner/HiZBuffer.hpp"
+#include "inner/LightPass.hpp"
+#include "inner/ShadowAtlas.hpp"
+#include "inner/StereoTarget.hpp"
+#include "inner/JobPool.hpp"
+#include "inner/CompileQueue.hpp"
+#include "inner/SecondaryCommands.hpp"
+#include "inner/Barriers.hpp"
+#include "inner/VulkanGraph.hpp"
 #include <Flow/Verbs/Create.hpp>
 #include <Flow/Verbs/Interpret.hpp>
 #include <Math/Gradient.hpp>
 #include <Entity/Pin.hpp>
 
 
+///                                                                           
+///   Renderer statistics, gathered while drawing the last frame              
+///                                                                           
+struct RendererStats {
+   // Time spent sorting subscribers                                    
+   Time mSortTime {};
+   // Number of vkCmdBind* calls issued                                 
+   Count mBindsIssued {};
+   // Number of vkCmdBind* calls skipped, because they were redundant   
+   Count mBindsSkipped {};
+   // Number of instances tested by the culling compute shader          
+   Count mCullCandidates {};
+   // Number of instances rejected by hierarchical-Z occlusion culling  
+   Count mOccluded {};
+   // Time the GPU spent on the previous frame, zero if not measured    
+   Time mGPUTime {};
+   // Number of lights drawn by deferred layers                         
+   Count mLightsDrawn {};
+   // Number of light-cluster overlaps in forward lit layers            
+   Count mLightOverlaps {};
+   // Number of lights with a shadow in the atlas                       
+   Count mShadowMaps {};
+   // Number of shadows rendered again, instead of reused from the atlas
+   Count mShadowsRendered {};
+   // Bytes of the shadow atlas, and how many of them are handed out    
+   Size mShadowAtlasBytes {};
+   Size mShadowAtlasUsed {};
+   // Number of layers, whose draw lists were generated again, instead  
+   // of reused from the previous frame                                 
+   Count mLayersGenerated {};
+   // Number of layers, whose instances were moved in place             
+   Count mLayersMoved {};
+};
+
+
 ///                                                                           
 ///   Vulkan renderer                                                         
 ///                                                                           
@@ -41,6 +88,14 @@ protected:
    friend struct VulkanCamera;
    friend struct VulkanSwapchain;
    friend struct VulkanLayer;
+   friend struct IndirectBuffer;
+   friend struct InstanceCuller;
+   friend struct HiZBuffer;
+   friend struct LightPass;
+   friend struct LightClusters;
+   friend struct ShadowAtlas;
+   friend struct StereoTarget;
+   friend struct SecondaryCommands;
 
 protected:
    //                                                                   
@@ -62,10 +117,23 @@ protected:
    Own<VkDevice> mDevice;
    // VRAM memory properties                                            
    VulkanMemory mVRAM;
+   // Descriptor set layouts, pipeline layouts, and descriptor pools    
+   VulkanLayouts mLayouts;
+   // Indirect draw commands, generated while compiling the frame       
+   IndirectBuffer mIndirect;
+   // Culls instances of GPUCulling styled layers in a compute shader   
+   InstanceCuller mCuller;
    // Physical device properties                                        
    VkPhysicalDeviceProperties mPhysicalProperties {};
-   // Physical device features                                          
+   // Physical device features - the optional ones the renderer uses    
+   // are enabled, whenever they're available                           
    VkPhysicalDeviceFeatures mPhysicalFeatures {};
+   // Timestamps at the start and end of each frame in flight, for      
+   // measuring GPU time                                                
+   VkQueryPool mTimestamps {};
+   // Whether timestamps of a frame in flight were written, and await   
+   // reading                                                           
+   bool mTimestampsPending[MaxFramesInFlight] {};
 
    // The swapchain interface                                           
    VulkanSwapchain mSwapchain;
@@ -73,6 +141,19 @@ protected:
    // The main rendering pass                                           
    TMany<VkAttachmentDescription> mPassAttachments;
    Own<VkRenderPass> mPass;
+   // Same as the main pass, but continues drawing over the back buffer 
+   Own<VkRenderPass> mLoadPass;
+   // The rendering pass of layers with deferred lights                 
+   LightPass mLightPass;
+   // Shadows of all lights in Shadowed layers                          
+   ShadowAtlas mShadows;
+   // Whether the device has multiview, and the target stereo cameras   
+   // draw both eyes to at once                                         
+   bool mMultiview {};
+   StereoTarget mStereo;
+   // Layout, that the view transforms of stereo variants of material   
+   // pipelines are pushed with - all of them share the constant range  
+   VkPipelineLayout mViewsLayout {};
 
    // Graphics family                                                   
    uint32_t mGraphicIndex {};
@@ -105,6 +186,56 @@ protected:
    // Texture content mirror, keeps RAM/VRAM synchronized               
    TFactoryUnique<VulkanTexture> mTextures;
 
+   // Whether pipelines are compiled on background jobs                 
+   bool mDeferredPipelines {true};
+   // Statistics for the last frame                                     
+   RendererStats mStats;
+   // Pipelines used by the current draw lists, and a signature of the  
+   // layers they were generated for                                    
+   PipelineSet mRelevantPipes;
+   uint64_t mLayersSignature {};
+   // Layers in the order their draw lists were generated, which is the 
+   // order of their parts in the shared buffers                        
+   TMany<VulkanLayer*> mGenerated;
+   // Workers, that stage the camera levels of batched layers, and      
+   // record their passes                                               
+   ::std::unique_ptr<JobPool> mJobs = ::std::make_unique<JobPool>();
+   // A few threads, that compile pipelines in the background           
+   CompileQueue mCompiler;
+   // Command pools of the workers, for recording passes in parallel    
+   SecondaryCommands mSecondary;
+   // Transitions of images created between frames, recorded at the     
+   // start of the next frame                                           
+   Barriers mBarriers;
+   // Passes of the frame being recorded, and what they use             
+   VulkanGraph mGraph;
+
+   // Max number of background-compiled pipelines, that are promoted    
+   // for drawing each frame, so that frame time remains stable         
+   Count mPipelineBudget {4};
+   // Max number of queued pipelines, that start compiling each frame   
+   Count mCompileBudget {4};
+   // Number of frames the CPU can prepare, while the GPU still draws   
+   // the previous ones                                                 
+   uint32_t mFramesInFlight {2};
+   // Number of images drawn to, when there's no window to present to   
+   uint32_t mBackBuffers {2};
+
+   // Driver's pipeline cache, persisted between runs only if the       
+   // PipelineCache trait provides a file for it                        
+   Own<VkPipelineCache> mPipelineCache;
+   Text mPipelineCachePath;
+   // Every distinct pipeline created, recorded and persisted between   
+   // runs only if the PipelineManifest trait provides a file for it    
+   PipelineManifest mManifest;
+   Text mManifestPath;
+
+   void CreatePipelineCache();
+   void DestroyPipelineCache();
+   Time ReadGPUTime(uint32_t);
+   void GenerateLayers(bool);
+   void ClearScreen(const RenderConfig&, RenderGraph::Pass) const;
+
 public:
    VulkanRenderer(Vulkan*, Describe);
    ~VulkanRenderer();
@@ -116,12 +247,19 @@ public:
    void Interpret(Verb&);
 
    void Draw();
+   bool PromotePipelines();
+   void Prewarm(const Text&);
+
+   NOD() VulkanPipeline* GetFallbackPipeline(const A::Mesh*, const VulkanLayer*);
 
    NOD() VkInstance GetVulkanInstance() const noexcept;
    NOD() VkPhysicalDevice GetAdapter() const noexcept;
    NOD() const A::Window* GetWindow() const noexcept;
    NOD() Offset GetOuterUBOAlignment() const noexcept;
+   NOD() Offset GetOuterStorageAlignment() const noexcept;
    NOD() VkCommandBuffer GetRenderCB() const noexcept;
+   NOD() uint32_t GetFrame() const noexcept;
    NOD() const Scale2& GetResolution() const noexcept;
    NOD() VkSurfaceKHR GetSurface() const noexcept;
+   NOD() const RendererStats& GetStats() const noexcept;
 };
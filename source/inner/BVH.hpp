@@ -0,0 +1,246 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "Culling.hpp"
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+
+///                                                                           
+///   Bounding sphere of an instance, relative to its level                   
+///                                                                           
+struct BoundingSphere {
+   float mCenter[3];
+   float mRadius;
+};
+
+using BoundingSpheres = ::std::vector<BoundingSphere>;
+
+
+///                                                                           
+///   Bounding volume hierarchy of spheres                                    
+///                                                                           
+/// A binary tree of boxes, built by splitting spheres in half along the      
+/// longest axis of their centers. Moving spheres only refit the boxes, and   
+/// the tree is rebuilt when refitting makes it much looser than it was.      
+/// Frustum queries visit exactly the spheres that IsVisible would accept,    
+/// but skip whole subtrees that are outside, and test nothing in subtrees    
+/// that are completely inside                                                
+///                                                                           
+struct BVH {
+   static constexpr uint32_t LeafSize = 4;
+
+   /// A box, and either its children (if mCount is zero), or its spheres     
+   struct Node {
+      float mMin[3];
+      // Index of the left child (the right one follows it), or of the  
+      // first sphere in mOrder, if this is a leaf                      
+      uint32_t mFirst;
+      float mMax[3];
+      uint32_t mCount;
+   };
+
+   ::std::vector<Node> mNodes;
+   // Sphere indices, grouped by leaf                                   
+   ::std::vector<uint32_t> mOrder;
+   // Surface of the root box, when the tree was last built             
+   float mBuiltArea {};
+
+private:
+   /// Get half the surface of a box                                          
+   static float AreaOf(const Node& node) noexcept {
+      const float d[3] {
+         node.mMax[0] - node.mMin[0],
+         node.mMax[1] - node.mMin[1],
+         node.mMax[2] - node.mMin[2]
+      };
+      return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+   }
+
+   /// Fit a node's box around a range of spheres                             
+   void FitLeaf(Node& node, const BoundingSpheres& spheres) const noexcept {
+      for (int a = 0; a < 3; ++a) {
+         node.mMin[a] = +INFINITY;
+         node.mMax[a] = -INFINITY;
+      }
+
+      for (uint32_t i = node.mFirst; i < node.mFirst + node.mCount; ++i) {
+         const auto& sphere = spheres[mOrder[i]];
+         for (int a = 0; a < 3; ++a) {
+            node.mMin[a] = ::std::min(node.mMin[a], sphere.mCenter[a] - sphere.mRadius);
+            node.mMax[a] = ::std::max(node.mMax[a], sphere.mCenter[a] + sphere.mRadius);
+         }
+      }
+   }
+
+   /// Fit a node's box around its children                                   
+   void FitParent(Node& node) const noexcept {
+      const auto& l = mNodes[node.mFirst];
+      const auto& r = mNodes[node.mFirst + 1];
+      for (int a = 0; a < 3; ++a) {
+         node.mMin[a] = ::std::min(l.mMin[a], r.mMin[a]);
+         node.mMax[a] = ::std::max(l.mMax[a], r.mMax[a]);
+      }
+   }
+
+   /// Split a range of mOrder into a subtree                                 
+   ///   @param index - the node to fill                                      
+   ///   @param first, count - the range of mOrder                            
+   void Split(uint32_t index, uint32_t first, uint32_t count, const BoundingSpheres& spheres) {
+      if (count <= LeafSize) {
+         mNodes[index].mFirst = first;
+         mNodes[index].mCount = count;
+         FitLeaf(mNodes[index], spheres);
+         return;
+      }
+
+      // Split at the median of the longest axis of the centers         
+      float lo[3] {+INFINITY, +INFINITY, +INFINITY};
+      float hi[3] {-INFINITY, -INFINITY, -INFINITY};
+      for (uint32_t i = first; i < first + count; ++i) {
+         const auto& c = spheres[mOrder[i]].mCenter;
+         for (int a = 0; a < 3; ++a) {
+            lo[a] = ::std::min(lo[a], c[a]);
+            hi[a] = ::std::max(hi[a], c[a]);
+         }
+      }
+
+      int axis = 0;
+      if (hi[1] - lo[1] > hi[axis] - lo[axis])
+         axis = 1;
+      if (hi[2] - lo[2] > hi[axis] - lo[axis])
+         axis = 2;
+
+      const auto begin = mOrder.begin() + first;
+      const auto half = count / 2;
+      ::std::nth_element(begin, begin + half, begin + count,
+         [&](uint32_t a, uint32_t b) {
+            return spheres[a].mCenter[axis] < spheres[b].mCenter[axis];
+         });
+
+      const auto left = static_cast<uint32_t>(mNodes.size());
+      mNodes.resize(mNodes.size() + 2);
+      mNodes[index].mFirst = left;
+      mNodes[index].mCount = 0;
+      Split(left, first, half, spheres);
+      Split(left + 1, first + half, count - half, spheres);
+      FitParent(mNodes[index]);
+   }
+
+public:
+   /// Build the tree from scratch                                            
+   ///   @param spheres - the spheres                                         
+   void Build(const BoundingSpheres& spheres) {
+      const auto count = static_cast<uint32_t>(spheres.size());
+      mOrder.resize(count);
+      for (uint32_t i = 0; i < count; ++i)
+         mOrder[i] = i;
+
+      mNodes.clear();
+      mBuiltArea = 0;
+      if (not count)
+         return;
+
+      mNodes.reserve(count / LeafSize * 2 + 1);
+      mNodes.resize(1);
+      Split(0, 0, count, spheres);
+      mBuiltArea = AreaOf(mNodes[0]);
+   }
+
+   /// Fit the boxes around moved spheres, keeping the tree as it is          
+   /// Children always follow their parents, so one backwards sweep is enough 
+   ///   @param spheres - the spheres, same count as when built               
+   ///   @return false if the tree got much looser, and should be rebuilt     
+   bool Refit(const BoundingSpheres& spheres) noexcept {
+      for (auto node = mNodes.rbegin(); node != mNodes.rend(); ++node) {
+         if (node->mCount)
+            FitLeaf(*node, spheres);
+         else
+            FitParent(*node);
+      }
+
+      return mNodes.empty() or AreaOf(mNodes[0]) <= mBuiltArea * 2;
+   }
+
+   /// Visit all spheres, that are at least partially inside a frustum        
+   ///   @param frustum - the frustum, in the same space as the spheres       
+   ///   @param spheres - the spheres the tree was built or refit for         
+   ///   @param visit - called with the index of each visible sphere          
+   template<class F>
+   void Query(const CullFrustum& frustum, const BoundingSpheres& spheres, F&& visit) const {
+      if (mNodes.empty())
+         return;
+
+      // Each entry carries the planes, that its box isn't yet known to 
+      // be completely inside of                                        
+      struct Pending {
+         uint32_t mNode;
+         uint32_t mPlanes;
+      };
+
+      Pending stack[64];
+      uint32_t top = 0;
+      stack[top++] = {0, 0x3F};
+
+      while (top) {
+         const auto [index, incoming] = stack[--top];
+         const auto& node = mNodes[index];
+
+         auto planes = incoming;
+         bool outside = false;
+         for (int p = 0; p < 6 and not outside; ++p) {
+            if (not (planes & (1u << p)))
+               continue;
+
+            // Nearest and farthest corners along the plane normal      
+            const auto& plane = frustum.mPlanes[p];
+            float near = plane[3], far = plane[3];
+            for (int a = 0; a < 3; ++a) {
+               const auto lo = plane[a] * node.mMin[a];
+               const auto hi = plane[a] * node.mMax[a];
+               near += ::std::min(lo, hi);
+               far += ::std::max(lo, hi);
+            }
+
+            if (far < 0)
+               outside = true;
+            else if (near >= 0)
+               planes &= ~(1u << p);
+         }
+
+         if (outside)
+            continue;
+
+         if (not node.mCount) {
+            stack[top++] = {node.mFirst + 1, planes};
+            stack[top++] = {node.mFirst, planes};
+            continue;
+         }
+
+         for (uint32_t i = node.mFirst; i < node.mFirst + node.mCount; ++i) {
+            const auto& sphere = spheres[mOrder[i]];
+            bool visible = true;
+            for (int p = 0; p < 6 and visible; ++p) {
+               if (not (planes & (1u << p)))
+                  continue;
+
+               const auto& plane = frustum.mPlanes[p];
+               visible = plane[0] * sphere.mCenter[0]
+                       + plane[1] * sphere.mCenter[1]
+                       + plane[2] * sphere.mCenter[2]
+                       + plane[3] >= -sphere.mRadius;
+            }
+
+            if (visible)
+               visit(mOrder[i]);
+         }
+      }
+   }
+};
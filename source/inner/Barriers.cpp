@@ -0,0 +1,139 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Barriers.hpp"
+#include <algorithm>
+
+
+/// Transition the whole image to a layout, for the given access              
+/// The image's state is updated right away, so it must not be transitioned   
+/// in another command buffer, before this batch is flushed                   
+///   @param image - the image to transition                                  
+///   @param layout - the layout the image is needed in                       
+///   @param access - how the image is accessed next                          
+///   @param stages - the stages, in which it is accessed                     
+void Barriers::Transition(
+   const VulkanImage& image, VkImageLayout layout,
+   VkAccessFlags access, VkPipelineStageFlags stages
+) {
+   const auto handle = image.GetImage();
+   auto found = ::std::find_if(mImages.begin(), mImages.end(),
+      [handle](const VkImageMemoryBarrier& b) { return b.image == handle; });
+
+   // Reads after reads in the same layout can overlap, but the last    
+   // write has to be visible to any stage or access, that the barrier  
+   // after it didn't cover                                             
+   if (image.mLayout == layout and not ((image.mAccess | access) & WriteAccess)) {
+      if (not (stages & ~image.mStages) and not (access & ~image.mAccess))
+         return;
+
+      if (found != mImages.end()) {
+         // Widen the barrier, that is still in this batch              
+         found->dstAccessMask |= access;
+      }
+      else {
+         // Chain after the last write, and the reads it was made       
+         // visible to, which include any layout transition after it    
+         auto& barrier = mImages.emplace_back();
+         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+         barrier.srcAccessMask = image.mWriteAccess;
+         barrier.dstAccessMask = access;
+         barrier.oldLayout = barrier.newLayout = layout;
+         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+         barrier.image = handle;
+         barrier.subresourceRange = image.GetRange();
+
+         const auto source = image.mWriteStages | image.mStages;
+         mSource |= source ? source : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+      }
+
+      mDestination |= stages;
+      image.mAccess |= access;
+      image.mStages |= stages;
+      return;
+   }
+
+   // Only writes have to be made available, reads just have to finish  
+   // before the next access starts                                     
+   mSource |= image.mStages ? image.mStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+   mDestination |= stages;
+
+   // An image, that is already transitioned in this batch, just goes   
+   // straight to the new layout - nothing can use the one in between   
+   if (found == mImages.end()) {
+      auto& barrier = mImages.emplace_back();
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barrier.srcAccessMask = image.mAccess & WriteAccess;
+      barrier.oldLayout = image.mLayout;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.image = handle;
+      barrier.subresourceRange = image.GetRange();
+      found = mImages.end() - 1;
+   }
+
+   found->newLayout = layout;
+   found->dstAccessMask |= access;
+
+   image.mLayout = layout;
+   image.mAccess = access;
+   image.mStages = stages;
+   if (access & WriteAccess) {
+      image.mWriteAccess = access & WriteAccess;
+      image.mWriteStages = stages;
+   }
+}
+
+/// Make accesses to a buffer visible to the following ones                   
+/// Buffers don't track their state, so both sides are explicit               
+///   @param buffer - the buffer                                              
+///   @param fromAccess - the previous access                                 
+///   @param fromStages - the stages of the previous access                   
+///   @param toAccess - the next access                                       
+///   @param toStages - the stages of the next access                         
+void Barriers::Buffer(
+   VkBuffer buffer,
+   VkAccessFlags fromAccess, VkPipelineStageFlags fromStages,
+   VkAccessFlags toAccess, VkPipelineStageFlags toStages
+) {
+   auto& barrier = mBuffers.emplace_back();
+   barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+   barrier.srcAccessMask = fromAccess;
+   barrier.dstAccessMask = toAccess;
+   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   barrier.buffer = buffer;
+   barrier.size = VK_WHOLE_SIZE;
+
+   mSource |= fromStages;
+   mDestination |= toStages;
+}
+
+/// Record all accumulated barriers as a single pipeline barrier              
+/// Must be recorded outside of a render pass                                 
+///   @param commands - the command buffer to record to                       
+void Barriers::Flush(VkCommandBuffer commands) {
+   if (IsEmpty())
+      return;
+
+   vkCmdPipelineBarrier(commands, mSource, mDestination, 0,
+      0, nullptr,
+      static_cast<uint32_t>(mBuffers.size()), mBuffers.data(),
+      static_cast<uint32_t>(mImages.size()), mImages.data()
+   );
+
+   mImages.clear();
+   mBuffers.clear();
+   mSource = mDestination = 0;
+}
+
+/// Check if there are any barriers to flush                                  
+///   @return true if nothing was accumulated                                 
+bool Barriers::IsEmpty() const noexcept {
+   return mImages.empty() and mBuffers.empty();
+}
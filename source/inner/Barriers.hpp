@@ -0,0 +1,35 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "VulkanBuffer.hpp"
+
+
+///                                                                           
+///   Pipeline barrier batcher                                                
+///                                                                           
+/// Accumulates image transitions and buffer barriers, and flushes them as a  
+/// single vkCmdPipelineBarrier into whichever command buffer is recorded.    
+/// Images remember their layout and last access, so a transition only says   
+/// what the image is needed for next. Reads that follow reads in the same    
+/// layout need no barrier, unless they're in stages or accesses, that the    
+/// last write wasn't made visible to yet                                     
+///                                                                           
+struct Barriers {
+private:
+   ::std::vector<VkImageMemoryBarrier> mImages;
+   ::std::vector<VkBufferMemoryBarrier> mBuffers;
+   VkPipelineStageFlags mSource {};
+   VkPipelineStageFlags mDestination {};
+
+public:
+   void Transition(const VulkanImage&, VkImageLayout, VkAccessFlags, VkPipelineStageFlags);
+   void Buffer(VkBuffer, VkAccessFlags, VkPipelineStageFlags, VkAccessFlags, VkPipelineStageFlags);
+   void Flush(VkCommandBuffer);
+
+   NOD() bool IsEmpty() const noexcept;
+};
@@ -0,0 +1,140 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "CommandState.hpp"
+#include <cstring>
+
+
+/// Start tracking a command buffer, that has just begun recording            
+///   @param commands - the command buffer                                    
+///   @param layouts - the cache of the pipeline layouts sets are bound with  
+void CommandState::Begin(VkCommandBuffer commands, const VulkanLayouts& layouts) {
+   mCommands = commands;
+   mLayouts = &layouts;
+   mIssued = mSkipped = 0;
+   Invalidate();
+}
+
+/// Forget everything that is bound, so the next binds are always issued      
+/// Use this whenever commands are recorded without going through the state   
+void CommandState::Invalidate() {
+   mPipeline = {};
+   mKeysOf = {};
+   mKeys = {};
+   for (auto& set : mSets)
+      set = {};
+   for (uint32_t i = 0; i < MaxVertexBuffers; ++i) {
+      mVertexBuffers[i] = {};
+      mVertexOffsets[i] = {};
+   }
+   mIndexBuffer = {};
+   mIndexOffset = {};
+   mIndexType = VK_INDEX_TYPE_MAX_ENUM;
+}
+
+/// Bind a graphics pipeline, unless it is already bound                      
+/// Binding a pipeline doesn't disturb any bound descriptor sets              
+///   @param pipeline - the pipeline to bind                                  
+void CommandState::BindPipeline(VkPipeline pipeline) {
+   if (mPipeline == pipeline) {
+      ++mSkipped;
+      return;
+   }
+
+   vkCmdBindPipeline(mCommands, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+   mPipeline = pipeline;
+   ++mIssued;
+}
+
+/// Bind a descriptor set, unless the same set with the same dynamic          
+/// offsets is already bound with a pipeline layout compatible for it         
+///   @param layout - the pipeline layout                                     
+///   @param index - the set index                                            
+///   @param set - the descriptor set                                         
+///   @param offsetCount - number of dynamic offsets                          
+///   @param offsets - the dynamic offsets                                    
+void CommandState::BindSet(
+   VkPipelineLayout layout, uint32_t index, VkDescriptorSet set,
+   uint32_t offsetCount, const uint32_t* offsets
+) {
+   LANGULUS_ASSERT(index < MaxSets, Graphics, "Set index out of range");
+   LANGULUS_ASSERT(offsetCount <= MaxOffsets, Graphics, "Too many offsets");
+
+   // Layouts that aren't from the cache are only compatible with       
+   // themselves                                                        
+   if (mKeysOf != layout) {
+      const auto keys = mLayouts ? mLayouts->GetSetKeys(layout) : nullptr;
+      mKeys = keys ? *keys : VulkanLayouts::SetKeys {};
+      mKeysOf = layout;
+   }
+
+   const auto compatible = [&](const BoundSet& other, uint32_t at) {
+      return other.mLayout == layout or (other.mKey and other.mKey == mKeys[at]);
+   };
+
+   auto& bound = mSets[index];
+   if (compatible(bound, index) and bound.mSet == set
+   and bound.mOffsetCount == offsetCount
+   and (not offsetCount or 0 == ::std::memcmp(bound.mOffsets, offsets, offsetCount * sizeof(uint32_t)))) {
+      ++mSkipped;
+      return;
+   }
+
+   vkCmdBindDescriptorSets(
+      mCommands, VK_PIPELINE_BIND_POINT_GRAPHICS,
+      layout, index, 1, &set, offsetCount, offsets
+   );
+   ++mIssued;
+
+   // Sets bound with a pipeline layout, that isn't compatible for them, 
+   // might have been disturbed                                         
+   for (uint32_t at = 0; at < MaxSets; ++at) {
+      if (mSets[at].mLayout and not compatible(mSets[at], at))
+         mSets[at] = {};
+   }
+
+   bound.mLayout = layout;
+   bound.mKey = mKeys[index];
+   bound.mSet = set;
+   bound.mOffsetCount = offsetCount;
+   if (offsetCount)
+      ::std::memcpy(bound.mOffsets, offsets, offsetCount * sizeof(uint32_t));
+}
+
+/// Bind a vertex buffer, unless it is already bound                          
+///   @param binding - the binding slot                                       
+///   @param buffer - the buffer                                              
+///   @param offset - the offset inside the buffer                            
+void CommandState::BindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset) {
+   LANGULUS_ASSERT(binding < MaxVertexBuffers, Graphics, "Binding out of range");
+   if (mVertexBuffers[binding] == buffer and mVertexOffsets[binding] == offset) {
+      ++mSkipped;
+      return;
+   }
+
+   vkCmdBindVertexBuffers(mCommands, binding, 1, &buffer, &offset);
+   mVertexBuffers[binding] = buffer;
+   mVertexOffsets[binding] = offset;
+   ++mIssued;
+}
+
+/// Bind an index buffer, unless it is already bound                          
+///   @param buffer - the buffer                                              
+///   @param offset - the offset inside the buffer                            
+///   @param type - the index type                                            
+void CommandState::BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType type) {
+   if (mIndexBuffer == buffer and mIndexOffset == offset and mIndexType == type) {
+      ++mSkipped;
+      return;
+   }
+
+   vkCmdBindIndexBuffer(mCommands, buffer, offset, type);
+   mIndexBuffer = buffer;
+   mIndexOffset = offset;
+   mIndexType = type;
+   ++mIssued;
+}
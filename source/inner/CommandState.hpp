@@ -0,0 +1,71 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "VulkanLayouts.hpp"
+
+
+///                                                                           
+///   Command buffer state tracker                                            
+///                                                                           
+/// Remembers what is currently bound to a command buffer - the pipeline,     
+/// the descriptor sets with their dynamic offsets, and the vertex/index      
+/// buffers, and skips any vkCmdBind* that wouldn't change anything. Sets     
+/// stay bound when switching to another pipeline layout, as long as the      
+/// layouts are compatible up to them                                         
+///                                                                           
+struct CommandState {
+   static constexpr uint32_t MaxSets = VulkanLayouts::MaxSets;
+   static constexpr uint32_t MaxOffsets = RefreshRate::DynamicUniformCount;
+   static constexpr uint32_t MaxVertexBuffers = 16;
+
+private:
+   VkCommandBuffer mCommands {};
+   VkPipeline mPipeline {};
+
+   // Where compatibility keys of pipeline layouts come from, and the   
+   // keys of the last layout sets were bound with                      
+   const VulkanLayouts* mLayouts {};
+   VkPipelineLayout mKeysOf {};
+   VulkanLayouts::SetKeys mKeys {};
+
+   // A bound descriptor set, the layout it was bound with, and the     
+   // layout's compatibility key for it                                 
+   struct BoundSet {
+      VkPipelineLayout mLayout {};
+      uint32_t mKey {};
+      VkDescriptorSet mSet {};
+      uint32_t mOffsetCount {};
+      uint32_t mOffsets[MaxOffsets] {};
+   } mSets[MaxSets];
+
+   // Bound vertex buffers, and their offsets                           
+   VkBuffer mVertexBuffers[MaxVertexBuffers] {};
+   VkDeviceSize mVertexOffsets[MaxVertexBuffers] {};
+
+   // Bound index buffer, its offset and type                           
+   VkBuffer mIndexBuffer {};
+   VkDeviceSize mIndexOffset {};
+   VkIndexType mIndexType {VK_INDEX_TYPE_MAX_ENUM};
+
+public:
+   // Number of vkCmdBind* calls issued, and skipped as redundant       
+   Count mIssued {};
+   Count mSkipped {};
+
+   void Begin(VkCommandBuffer, const VulkanLayouts&);
+   void Invalidate();
+
+   NOD() VkCommandBuffer GetCommands() const noexcept {
+      return mCommands;
+   }
+
+   void BindPipeline(VkPipeline);
+   void BindSet(VkPipelineLayout, uint32_t, VkDescriptorSet, uint32_t = 0, const uint32_t* = nullptr);
+   void BindVertexBuffer(uint32_t, VkBuffer, VkDeviceSize);
+   void BindIndexBuffer(VkBuffer, VkDeviceSize, VkIndexType);
+};
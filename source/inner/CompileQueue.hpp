@@ -0,0 +1,169 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <future>
+
+
+///                                                                           
+///   Queue of background compilations                                        
+///                                                                           
+/// A fixed number of threads run the queued jobs in the order they were      
+/// submitted. Jobs don't start as soon as they're submitted - each frame     
+/// releases only a few of them, so that a burst of new pipelines doesn't     
+/// flood the device with compilations. Jobs that haven't started yet can be  
+/// cancelled, and cancelling a running job waits for it to finish, so that   
+/// whatever it uses can be safely destroyed afterwards                       
+///                                                                           
+struct CompileQueue {
+   /// A submitted job                                                        
+   struct Job {
+      ::std::packaged_task<void()> mWork;
+      bool mRunning {};
+      bool mDone {};
+   };
+
+   using Ticket = ::std::shared_ptr<Job>;
+
+private:
+   ::std::vector<::std::thread> mThreads;
+   // Jobs in the order they were submitted                             
+   ::std::deque<Ticket> mQueue;
+   // Number of jobs at the front of the queue, that may start          
+   size_t mReleased {};
+
+   ::std::mutex mMutex;
+   ::std::condition_variable mWake;
+   ::std::condition_variable mDone;
+   bool mStop {};
+
+   /// Run released jobs, until the queue is destroyed                        
+   void Loop() noexcept {
+      ::std::unique_lock lock {mMutex};
+      while (true) {
+         mWake.wait(lock, [&] { return mStop or mReleased; });
+         if (mStop)
+            return;
+
+         auto job = ::std::move(mQueue.front());
+         mQueue.pop_front();
+         --mReleased;
+         job->mRunning = true;
+
+         // Exceptions are kept in the job's future                     
+         lock.unlock();
+         job->mWork();
+         lock.lock();
+
+         job->mRunning = false;
+         job->mDone = true;
+         mDone.notify_all();
+      }
+   }
+
+public:
+   /// Create the queue                                                       
+   ///   @param threads - the number of compiling threads; zero uses a        
+   ///                    quarter of the hardware threads, since the rest     
+   ///                    are busy preparing frames                           
+   explicit CompileQueue(uint32_t threads = 0) {
+      if (not threads)
+         threads = ::std::max(1u, ::std::thread::hardware_concurrency() / 4);
+
+      for (uint32_t t = 0; t < threads; ++t)
+         mThreads.emplace_back([this] { Loop(); });
+   }
+
+   CompileQueue(const CompileQueue&) = delete;
+   CompileQueue& operator = (const CompileQueue&) = delete;
+
+   ~CompileQueue() {
+      {
+         ::std::lock_guard lock {mMutex};
+         mStop = true;
+      }
+
+      mWake.notify_all();
+      for (auto& thread : mThreads)
+         thread.join();
+   }
+
+   /// Get the number of compiling threads                                    
+   ///   @return the number of threads                                        
+   uint32_t GetThreads() const noexcept {
+      return static_cast<uint32_t>(mThreads.size());
+   }
+
+   /// Queue a job, that starts once released                                 
+   ///   @param work - the job                                                
+   ///   @return the ticket of the job, used for cancelling it                
+   Ticket Submit(::std::packaged_task<void()>&& work) {
+      auto job = ::std::make_shared<Job>();
+      job->mWork = ::std::move(work);
+
+      ::std::lock_guard lock {mMutex};
+      mQueue.push_back(job);
+      return job;
+   }
+
+   /// Allow more of the queued jobs to start                                 
+   ///   @param count - the max number of jobs to release                     
+   ///   @return the number of jobs released                                  
+   size_t Release(size_t count) {
+      size_t released;
+      {
+         ::std::lock_guard lock {mMutex};
+         released = ::std::min(count, mQueue.size() - mReleased);
+         mReleased += released;
+      }
+
+      if (released)
+         mWake.notify_all();
+      return released;
+   }
+
+   /// Get the number of jobs, that haven't started yet                       
+   ///   @return the number of queued jobs                                    
+   size_t GetQueued() {
+      ::std::lock_guard lock {mMutex};
+      return mQueue.size();
+   }
+
+   /// Make sure a job isn't running, and never will be                       
+   /// A job that hasn't started is dropped, which breaks the promise of its  
+   /// future. A running job is waited for                                    
+   ///   @param job - the ticket of the job                                   
+   void Cancel(const Ticket& job) {
+      if (not job)
+         return;
+
+      ::std::unique_lock lock {mMutex};
+      mDone.wait(lock, [&] { return not job->mRunning; });
+      if (job->mDone)
+         return;
+
+      const auto found = ::std::find(mQueue.begin(), mQueue.end(), job);
+      if (found == mQueue.end())
+         return;
+
+      // Released jobs are at the front, so the released count drops    
+      // only if this one was among them                                
+      if (static_cast<size_t>(found - mQueue.begin()) < mReleased)
+         --mReleased;
+      mQueue.erase(found);
+      job->mDone = true;
+      job->mWork = {};
+   }
+};
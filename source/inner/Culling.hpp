@@ -0,0 +1,532 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <bit>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) or defined(_M_X64) or defined(_M_AMD64)
+   #include <emmintrin.h>
+   #define VULKAN_CULLING_SSE 1
+   #define VULKAN_CULLING_NEON 0
+#elif defined(__ARM_NEON) or defined(_M_ARM64)
+   #include <arm_neon.h>
+   #define VULKAN_CULLING_SSE 0
+   #define VULKAN_CULLING_NEON 1
+#else
+   #define VULKAN_CULLING_SSE 0
+   #define VULKAN_CULLING_NEON 0
+#endif
+
+#define VULKAN_CULLING_SIMD (VULKAN_CULLING_SSE or VULKAN_CULLING_NEON)
+
+#if VULKAN_CULLING_NEON
+   /// Gather a bit of each lane of a comparison result, like _mm_movemask_ps 
+   ///   @param mask - lanes with all bits either set or cleared              
+   ///   @return a bit for each set lane                                      
+   inline uint32_t NeonMask(uint32x4_t mask) noexcept {
+      static constexpr uint32_t Bits[4] {1, 2, 4, 8};
+      const auto bits = vandq_u32(mask, vld1q_u32(Bits));
+      const auto pairs = vpadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+      return vget_lane_u32(vpadd_u32(pairs, pairs), 0);
+   }
+#endif
+
+/// Marks a candidate, whose result isn't written anywhere                    
+constexpr uint32_t CullNoCommand = 0xFFFFFFFF;
+
+
+///                                                                           
+///   The frustum of a single camera level, as seen by the culling shader     
+///                                                                           
+/// Planes are normalized, and a point p is inside a plane if                 
+/// dot(plane.xyz, p) + plane.w >= 0. The layout matches std430               
+///                                                                           
+struct CullFrustum {
+   float mPlanes[6][4];
+   int32_t mLevel;
+   uint32_t mPadding[3];
+};
+
+
+///                                                                           
+///   Bounding sphere of a single instance, relative to its level's view      
+///                                                                           
+/// Visible candidates are appended to the draw command they belong to - the  
+/// mCommand-th word of the indirect buffer is the command's instanceCount,   
+/// which is atomically incremented, and mInstance is written at that slot    
+/// of the command's instance indices, which start at the mFirst-th word.     
+/// The layout matches std430                                                 
+///                                                                           
+struct CullCandidate {
+   float mCenter[3];
+   float mRadius;
+   int32_t mLevel;
+   uint32_t mFrustum;
+   uint32_t mCommand;
+   uint32_t mFirst;
+   uint32_t mInstance;
+   uint32_t mPadding[3];
+};
+
+using CullFrustums = ::std::vector<CullFrustum>;
+using CullCandidates = ::std::vector<CullCandidate>;
+
+
+/// Extract the frustum planes of a view-projection matrix                    
+/// Clip space depth is assumed to be in the [0;1] range, as in Vulkan        
+///   @param m - the column-major view-projection matrix                      
+///   @param level - the level the frustum observes                           
+///   @return the frustum                                                     
+inline CullFrustum MakeCullFrustum(const float* m, int32_t level) {
+   // Rows of the matrix                                                
+   auto row = [m](int r, int c) { return m[c * 4 + r]; };
+
+   CullFrustum result {};
+   result.mLevel = level;
+   // Left, right, bottom, top, near, and far planes                    
+   for (int c = 0; c < 4; ++c) {
+      result.mPlanes[0][c] = row(3, c) + row(0, c);
+      result.mPlanes[1][c] = row(3, c) - row(0, c);
+      result.mPlanes[2][c] = row(3, c) + row(1, c);
+      result.mPlanes[3][c] = row(3, c) - row(1, c);
+      result.mPlanes[4][c] = row(2, c);
+      result.mPlanes[5][c] = row(3, c) - row(2, c);
+   }
+
+   for (auto& plane : result.mPlanes) {
+      const auto length = ::std::sqrt(
+         plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+      if (length > 0) {
+         for (auto& component : plane)
+            component /= length;
+      }
+   }
+
+   return result;
+}
+
+/// Make a bounding sphere of a model transformation, assuming the geometry   
+/// is normalized to the [-0.5;0.5] box, as all Langulus geometry is          
+///   @param m - the column-major model matrix                                
+///   @param level - the level of the instance                                
+///   @param frustum - index of the frustum to test against                   
+///   @return the candidate, not yet assigned to any command                  
+inline CullCandidate MakeCullCandidate(const float* m, int32_t level, uint32_t frustum) {
+   CullCandidate result {};
+   result.mCenter[0] = m[12];
+   result.mCenter[1] = m[13];
+   result.mCenter[2] = m[14];
+
+   // Exact for rotated and scaled boxes, a bit loose for sheared ones  
+   float sum = 0;
+   for (int i = 0; i < 12; ++i) {
+      if (i % 4 != 3)
+         sum += m[i] * m[i];
+   }
+
+   result.mRadius = 0.5f * ::std::sqrt(sum);
+   result.mLevel = level;
+   result.mFrustum = frustum;
+   result.mCommand = CullNoCommand;
+   return result;
+}
+
+/// Test a candidate against its frustum - this is exactly what the culling   
+/// compute shader does, and is used to validate its results                  
+///   @param frustum - the frustum                                            
+///   @param candidate - the candidate                                        
+///   @return true if the candidate is visible                                
+inline bool IsVisible(const CullFrustum& frustum, const CullCandidate& candidate) {
+   if (candidate.mLevel != frustum.mLevel)
+      return false;
+
+   for (const auto& plane : frustum.mPlanes) {
+      const auto distance = plane[0] * candidate.mCenter[0]
+                          + plane[1] * candidate.mCenter[1]
+                          + plane[2] * candidate.mCenter[2]
+                          + plane[3];
+      if (distance < -candidate.mRadius)
+         return false;
+   }
+
+   return true;
+}
+
+/// Cull all candidates on the CPU, appending the visible ones to their       
+/// commands in the order of candidates - the GPU appends in any order        
+///   @param frustums - the frustums                                          
+///   @param candidates - the candidates                                      
+///   @param words - [in/out] the indirect buffer, as 32bit words, with the   
+///                  instance counts of all commands at zero                  
+inline void CullReference(
+   const CullFrustums& frustums, const CullCandidates& candidates, uint32_t* words
+) {
+   for (const auto& candidate : candidates) {
+      if (candidate.mCommand == CullNoCommand)
+         continue;
+      if (not IsVisible(frustums[candidate.mFrustum], candidate))
+         continue;
+
+      const auto slot = words[candidate.mCommand]++;
+      words[candidate.mFirst + slot] = candidate.mInstance;
+   }
+}
+
+/// Compare culling results, regardless of the order in which visible         
+/// candidates were appended to their commands                                
+///   @param candidates - the candidates                                      
+///   @param expected - the indirect buffer, as culled by CullReference       
+///   @param results - the indirect buffer, as culled by the GPU              
+///   @return the number of commands, whose instances differ                  
+inline size_t CullMismatches(
+   const CullCandidates& candidates, const uint32_t* expected, const uint32_t* results
+) {
+   // Each command, along with where its instances start                
+   ::std::vector<::std::pair<uint32_t, uint32_t>> commands;
+   for (const auto& candidate : candidates) {
+      if (candidate.mCommand != CullNoCommand)
+         commands.push_back({candidate.mCommand, candidate.mFirst});
+   }
+
+   ::std::sort(commands.begin(), commands.end());
+   commands.erase(::std::unique(commands.begin(), commands.end()), commands.end());
+
+   size_t mismatches = 0;
+   ::std::vector<uint32_t> lhs, rhs;
+   for (const auto& [command, first] : commands) {
+      if (expected[command] != results[command]) {
+         ++mismatches;
+         continue;
+      }
+
+      lhs.assign(expected + first, expected + first + expected[command]);
+      rhs.assign(results + first, results + first + results[command]);
+      ::std::sort(lhs.begin(), lhs.end());
+      ::std::sort(rhs.begin(), rhs.end());
+      if (lhs != rhs)
+         ++mismatches;
+   }
+
+   return mismatches;
+}
+
+
+///                                                                           
+///   Bounding boxes of instances, relative to their level                    
+///                                                                           
+/// A structure of arrays, so that four boxes are tested against a plane at   
+/// once. The arrays are always padded to a multiple of four                  
+///                                                                           
+struct CullBoxes {
+   ::std::vector<float> mMin[3];
+   ::std::vector<float> mMax[3];
+   size_t mCount {};
+
+   /// Change the number of boxes - new ones are undefined                    
+   ///   @param count - the number of boxes                                   
+   void Resize(size_t count) {
+      mCount = count;
+      for (int a = 0; a < 3; ++a) {
+         mMin[a].resize((count + 3) & ~size_t {3});
+         mMax[a].resize((count + 3) & ~size_t {3});
+      }
+   }
+
+   /// Fit a box around a model transformation, assuming the geometry is      
+   /// normalized to the [-0.5;0.5] box, as all Langulus geometry is          
+   ///   @param i - the box index                                             
+   ///   @param m - the column-major model matrix                             
+   void Set(size_t i, const float* m) noexcept {
+      for (int a = 0; a < 3; ++a) {
+         const auto extent = 0.5f * (
+            ::std::abs(m[a]) + ::std::abs(m[4 + a]) + ::std::abs(m[8 + a]));
+         mMin[a][i] = m[12 + a] - extent;
+         mMax[a][i] = m[12 + a] + extent;
+      }
+   }
+
+   /// Copy a box from another set                                            
+   ///   @param i - the box index                                             
+   ///   @param from - the other set                                          
+   ///   @param j - the box index in the other set                            
+   void Copy(size_t i, const CullBoxes& from, size_t j) noexcept {
+      for (int a = 0; a < 3; ++a) {
+         mMin[a][i] = from.mMin[a][j];
+         mMax[a][i] = from.mMax[a][j];
+      }
+   }
+};
+
+/// Test a box against a frustum, one plane at a time                         
+///   @param frustum - the frustum                                            
+///   @param boxes - the boxes                                                
+///   @param i - the box index                                                
+///   @return true if the box is at least partially inside                    
+inline bool IsVisible(const CullFrustum& frustum, const CullBoxes& boxes, size_t i) {
+   for (const auto& plane : frustum.mPlanes) {
+      // The corner farthest along the plane's normal                   
+      float far = plane[3];
+      for (int a = 0; a < 3; ++a) {
+         far += ::std::max(plane[a] * boxes.mMin[a][i], plane[a] * boxes.mMax[a][i]);
+      }
+
+      if (far < 0)
+         return false;
+   }
+
+   return true;
+}
+
+/// Test four consecutive boxes against some planes of a frustum              
+///   @param frustum - the frustum                                            
+///   @param boxes - the boxes                                                
+///   @param first - the first box, must be a multiple of four                
+///   @param planes - a bit for each plane to test                            
+///   @param simd - whether to test all four boxes at once, or one by one     
+///   @return a bit for each visible box - bits past the end are undefined    
+inline uint32_t CullFour(
+   const CullFrustum& frustum, const CullBoxes& boxes,
+   size_t first, uint32_t planes, bool simd = VULKAN_CULLING_SIMD
+) {
+   #if VULKAN_CULLING_SSE
+      if (simd) {
+         __m128 min[3], max[3];
+         for (int a = 0; a < 3; ++a) {
+            min[a] = _mm_loadu_ps(&boxes.mMin[a][first]);
+            max[a] = _mm_loadu_ps(&boxes.mMax[a][first]);
+         }
+
+         auto visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+         for (int p = 0; p < 6; ++p) {
+            if (not (planes & (1u << p)))
+               continue;
+
+            const auto& plane = frustum.mPlanes[p];
+            auto far = _mm_set1_ps(plane[3]);
+            for (int a = 0; a < 3; ++a) {
+               const auto n = _mm_set1_ps(plane[a]);
+               far = _mm_add_ps(far, _mm_max_ps(
+                  _mm_mul_ps(n, min[a]), _mm_mul_ps(n, max[a])));
+            }
+
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(far, _mm_setzero_ps()));
+         }
+
+         return static_cast<uint32_t>(_mm_movemask_ps(visible));
+      }
+   #elif VULKAN_CULLING_NEON
+      if (simd) {
+         float32x4_t min[3], max[3];
+         for (int a = 0; a < 3; ++a) {
+            min[a] = vld1q_f32(&boxes.mMin[a][first]);
+            max[a] = vld1q_f32(&boxes.mMax[a][first]);
+         }
+
+         auto visible = vdupq_n_u32(0xFFFFFFFF);
+         for (int p = 0; p < 6; ++p) {
+            if (not (planes & (1u << p)))
+               continue;
+
+            const auto& plane = frustum.mPlanes[p];
+            auto far = vdupq_n_f32(plane[3]);
+            for (int a = 0; a < 3; ++a) {
+               const auto n = vdupq_n_f32(plane[a]);
+               far = vaddq_f32(far, vmaxq_f32(
+                  vmulq_f32(n, min[a]), vmulq_f32(n, max[a])));
+            }
+
+            visible = vandq_u32(visible, vcgeq_f32(far, vdupq_n_f32(0)));
+         }
+
+         return NeonMask(visible);
+      }
+   #endif
+
+   uint32_t mask = 0;
+   for (uint32_t lane = 0; lane < 4; ++lane) {
+      bool visible = true;
+      for (int p = 0; p < 6 and visible; ++p) {
+         if (not (planes & (1u << p)))
+            continue;
+
+         const auto& plane = frustum.mPlanes[p];
+         float far = plane[3];
+         for (int a = 0; a < 3; ++a) {
+            far += ::std::max(plane[a] * boxes.mMin[a][first + lane],
+                              plane[a] * boxes.mMax[a][first + lane]);
+         }
+         visible = far >= 0;
+      }
+
+      if (visible)
+         mask |= 1u << lane;
+   }
+
+   return mask;
+}
+
+/// Cull all boxes against a frustum                                          
+///   @param frustum - the frustum                                            
+///   @param boxes - the boxes                                                
+///   @param visible - [out] indices of the visible boxes, must have room     
+///                    for all of them                                        
+///   @param simd - whether to test four boxes at once, or one by one         
+///   @return the number of visible boxes                                     
+inline size_t CullBatch(
+   const CullFrustum& frustum, const CullBoxes& boxes,
+   uint32_t* visible, bool simd = VULKAN_CULLING_SIMD
+) {
+   size_t count = 0;
+   for (size_t first = 0; first < boxes.mCount; first += 4) {
+      auto mask = CullFour(frustum, boxes, first, 0x3F, simd);
+      if (boxes.mCount - first < 4)
+         mask &= (1u << (boxes.mCount - first)) - 1;
+
+      while (mask) {
+         const auto lane = static_cast<uint32_t>(::std::countr_zero(mask));
+         visible[count++] = static_cast<uint32_t>(first + lane);
+         mask &= mask - 1;
+      }
+   }
+
+   return count;
+}
+
+
+///                                                                           
+///   Depth pyramid for hierarchical-Z occlusion culling                      
+///                                                                           
+/// Each level holds the farthest depth of a 2x2 block of the previous one,   
+/// so a single texel conservatively bounds everything behind it. The base    
+/// level is itself already reduced on the GPU, each texel covering a tile    
+/// of the depth buffer. Depth is expected to be in the [0;1] range, where    
+/// zero is nearest                                                           
+///                                                                           
+struct DepthPyramid {
+   struct Level {
+      uint32_t mWidth;
+      uint32_t mHeight;
+      ::std::vector<float> mTexels;
+
+      float At(uint32_t x, uint32_t y) const {
+         return mTexels[y * mWidth + x];
+      }
+   };
+
+   ::std::vector<Level> mLevels;
+
+   /// Build the pyramid from a reduced depth buffer                          
+   ///   @param texels - the base level, row by row                           
+   ///   @param width - number of texels in a row                             
+   ///   @param height - number of rows                                       
+   void Build(const float* texels, uint32_t width, uint32_t height) {
+      mLevels.resize(1);
+      mLevels[0].mWidth = width;
+      mLevels[0].mHeight = height;
+      mLevels[0].mTexels.assign(texels, texels + width * height);
+
+      while (mLevels.back().mWidth > 1 or mLevels.back().mHeight > 1) {
+         const auto& prev = mLevels.back();
+         Level next;
+         next.mWidth = (prev.mWidth + 1) / 2;
+         next.mHeight = (prev.mHeight + 1) / 2;
+         next.mTexels.resize(next.mWidth * next.mHeight);
+
+         for (uint32_t y = 0; y < next.mHeight; ++y) {
+            for (uint32_t x = 0; x < next.mWidth; ++x) {
+               // Odd sizes clamp to the last row/column                
+               const auto x0 = x * 2, x1 = ::std::min(x0 + 1, prev.mWidth - 1);
+               const auto y0 = y * 2, y1 = ::std::min(y0 + 1, prev.mHeight - 1);
+               next.mTexels[y * next.mWidth + x] = ::std::max(
+                  ::std::max(prev.At(x0, y0), prev.At(x1, y0)),
+                  ::std::max(prev.At(x0, y1), prev.At(x1, y1))
+               );
+            }
+         }
+
+         mLevels.push_back(::std::move(next));
+      }
+   }
+
+   /// Check if the pyramid is built                                          
+   ///   @return true if occlusion can be tested                              
+   bool IsValid() const noexcept {
+      return not mLevels.empty();
+   }
+
+   /// Test if a bounding sphere is completely behind the depth in pyramid    
+   /// Spheres that cross the near plane, or leave the screen are never       
+   /// considered occluded - frustum culling takes care of those              
+   ///   @param viewProjection - the column-major view-projection matrix      
+   ///   @param center - the sphere center                                    
+   ///   @param radius - the sphere radius                                    
+   ///   @return true if the sphere is certainly occluded                     
+   bool IsOccluded(const float* viewProjection, const float* center, float radius) const {
+      if (mLevels.empty())
+         return false;
+
+      // Project the corners of the sphere's bounding box               
+      const auto& m = viewProjection;
+      float minX = 1, minY = 1, maxX = -1, maxY = -1, minZ = 1;
+      for (int corner = 0; corner < 8; ++corner) {
+         const float p[3] {
+            center[0] + (corner & 1 ? radius : -radius),
+            center[1] + (corner & 2 ? radius : -radius),
+            center[2] + (corner & 4 ? radius : -radius)
+         };
+
+         const auto w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+         if (w <= 0)
+            return false;
+
+         const auto x = (m[0] * p[0] + m[4] * p[1] + m[8]  * p[2] + m[12]) / w;
+         const auto y = (m[1] * p[0] + m[5] * p[1] + m[9]  * p[2] + m[13]) / w;
+         const auto z = (m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]) / w;
+         minX = ::std::min(minX, x);
+         maxX = ::std::max(maxX, x);
+         minY = ::std::min(minY, y);
+         maxY = ::std::max(maxY, y);
+         minZ = ::std::min(minZ, z);
+      }
+
+      if (minX < -1 or minY < -1 or maxX > 1 or maxY > 1 or minZ < 0)
+         return false;
+
+      // Convert to texels of the base level                            
+      const auto& base = mLevels[0];
+      auto x0 = static_cast<uint32_t>((minX * 0.5f + 0.5f) * base.mWidth);
+      auto x1 = static_cast<uint32_t>((maxX * 0.5f + 0.5f) * base.mWidth);
+      auto y0 = static_cast<uint32_t>((minY * 0.5f + 0.5f) * base.mHeight);
+      auto y1 = static_cast<uint32_t>((maxY * 0.5f + 0.5f) * base.mHeight);
+      x0 = ::std::min(x0, base.mWidth - 1);
+      x1 = ::std::min(x1, base.mWidth - 1);
+      y0 = ::std::min(y0, base.mHeight - 1);
+      y1 = ::std::min(y1, base.mHeight - 1);
+
+      // Pick the level, where the rectangle covers at most 2x2 texels  
+      size_t level = 0;
+      while (level + 1 < mLevels.size() and (x1 - x0 > 1 or y1 - y0 > 1)) {
+         x0 /= 2; x1 /= 2;
+         y0 /= 2; y1 /= 2;
+         ++level;
+      }
+
+      const auto& l = mLevels[level];
+      float farthest = 0;
+      for (auto y = y0; y <= y1; ++y) {
+         for (auto x = x0; x <= x1; ++x)
+            farthest = ::std::max(farthest, l.At(x, y));
+      }
+
+      return minZ > farthest;
+   }
+};
@@ -0,0 +1,64 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include <cstddef>
+
+
+///                                                                           
+///   A slice of the depth range                                              
+///                                                                           
+/// Multilevel layers draw their levels from the biggest one, down to the     
+/// camera's. Instead of clearing depth between levels, each level can be     
+/// drawn in a slice of the depth range, that is nearer than the slices of    
+/// all levels before it. Nearer levels then always cover the bigger ones,    
+/// exactly as if depth was cleared, while all levels share a single depth    
+/// buffer. Each level gets only a part of the depth precision, though        
+///                                                                           
+struct DepthSlice {
+   float mMin = 0;
+   float mMax = 1;
+
+   /// Get the slice of a level                                               
+   ///   @param index - the level's index, in the order levels are drawn      
+   ///   @param count - the number of drawn levels                            
+   ///   @return the slice                                                    
+   static DepthSlice Of(size_t index, size_t count) noexcept {
+      if (count < 2)
+         return {};
+
+      // The last level is drawn nearest                                
+      const auto size = 1.0f / static_cast<float>(count);
+      const auto slot = static_cast<float>(count - 1 - index);
+      return {slot * size, index == 0 ? 1.0f : (slot + 1) * size};
+   }
+
+   /// Squeeze a projection's depth into the slice, the same way a viewport   
+   /// with the slice's depth range does                                      
+   ///   @param m - [in/out] a column-major projection                        
+   void Apply(float* m) const noexcept {
+      const auto size = mMax - mMin;
+      for (int column = 0; column < 4; ++column) {
+         auto& z = m[column * 4 + 2];
+         z = z * size + m[column * 4 + 3] * mMin;
+      }
+   }
+
+   /// Undo the slice on the inverse of a projection, so that depth read      
+   /// back from the slice unprojects correctly                               
+   ///   @param inverse - [in/out] a column-major inverse projection          
+   void Unapply(float* inverse) const noexcept {
+      const auto size = mMax - mMin;
+      for (int row = 0; row < 4; ++row) {
+         auto& z = inverse[8 + row];
+         z /= size;
+         inverse[12 + row] -= z * mMin;
+      }
+   }
+
+   bool operator == (const DepthSlice&) const = default;
+};
@@ -0,0 +1,105 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include <cctype>
+#include <string>
+#include <string_view>
+
+///                                                                           
+///   Helpers for finding things in GLSL code, used when injecting code into  
+/// material shaders. They don't understand comments or the preprocessor,     
+/// which generated shaders don't rely on                                     
+///                                                                           
+
+/// Check if a character can be part of an identifier                         
+inline bool GlslIsIdentifier(char c) noexcept {
+   return ::std::isalnum(static_cast<unsigned char>(c)) or c == '_';
+}
+
+/// Skip whitespace                                                           
+///   @return the first character after whitespace                            
+inline size_t GlslSkipSpace(::std::string_view code, size_t i) noexcept {
+   while (i < code.size() and ::std::isspace(static_cast<unsigned char>(code[i])))
+      ++i;
+   return i;
+}
+
+/// Read an identifier                                                        
+///   @return the identifier, empty if there's none at i                      
+inline ::std::string_view GlslIdentifier(::std::string_view code, size_t i) noexcept {
+   size_t end = i;
+   while (end < code.size() and GlslIsIdentifier(code[end]))
+      ++end;
+   return code.substr(i, end - i);
+}
+
+/// Find a whole word                                                         
+///   @return the position of the word, or npos                               
+inline size_t GlslFindWord(::std::string_view code, ::std::string_view word, size_t from = 0) noexcept {
+   auto i = code.find(word, from);
+   while (i != ::std::string_view::npos) {
+      const bool before = i > 0 and GlslIsIdentifier(code[i - 1]);
+      const bool after = i + word.size() < code.size() and GlslIsIdentifier(code[i + word.size()]);
+      if (not before and not after)
+         return i;
+      i = code.find(word, i + 1);
+   }
+   return i;
+}
+
+/// Read an integer assigned to a layout qualifier, like 'binding = 3'        
+///   @return the value, or -1 if the qualifier isn't there                   
+inline int GlslQualifier(::std::string_view layout, ::std::string_view name) noexcept {
+   const auto i = GlslFindWord(layout, name);
+   if (i == ::std::string_view::npos)
+      return -1;
+
+   auto j = GlslSkipSpace(layout, i + name.size());
+   if (j >= layout.size() or layout[j] != '=')
+      return -1;
+
+   j = GlslSkipSpace(layout, j + 1);
+   int value = -1;
+   while (j < layout.size() and ::std::isdigit(static_cast<unsigned char>(layout[j])))
+      value = (value < 0 ? 0 : value * 10) + (layout[j++] - '0');
+   return value;
+}
+
+/// Find where the leading #version and #extension directives end             
+///   @return the position after them                                         
+inline size_t GlslHeaderEnd(::std::string_view code) noexcept {
+   size_t i = 0;
+   while (true) {
+      const auto line = GlslSkipSpace(code, i);
+      if (code.compare(line, 8, "#version") and code.compare(line, 10, "#extension"))
+         return i;
+
+      const auto end = code.find('\n', line);
+      if (end == ::std::string_view::npos)
+         return code.size();
+      i = end + 1;
+   }
+}
+
+/// Find the definition of the main function, which is the last one           
+///   @return the position of 'main', or npos                                 
+inline size_t GlslFindMain(::std::string_view code) noexcept {
+   size_t found = ::std::string_view::npos;
+   for (auto i = GlslFindWord(code, "main"); i != ::std::string_view::npos; i = GlslFindWord(code, "main", i + 1)) {
+      const auto open = GlslSkipSpace(code, i + 4);
+      if (open >= code.size() or code[open] != '(')
+         continue;
+
+      auto type = i;
+      while (type > 0 and ::std::isspace(static_cast<unsigned char>(code[type - 1])))
+         --type;
+      if (type >= 4 and code.substr(type - 4, 4) == "void")
+         found = i;
+   }
+   return found;
+}
@@ -0,0 +1,283 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "HiZBuffer.hpp"
+#include "../Vulkan.hpp"
+#include <shaderc/shaderc.hpp>
+
+/// Size of the depth buffer tile, reduced to a single texel                  
+constexpr uint32_t HiZTile = 16;
+/// Size of the reduction workgroup in each dimension                         
+constexpr uint32_t HiZGroupSize = 8;
+
+/// The reduction compute shader                                              
+static constexpr char HiZShader[] = R"(
+   #version 450
+   layout(local_size_x = 8, local_size_y = 8) in;
+
+   layout(set = 0, binding = 0) uniform sampler2D depth;
+
+   layout(std430, set = 0, binding = 1) writeonly buffer Reduced {
+      float texels[];
+   };
+
+   void main() {
+      const ivec2 size = textureSize(depth, 0);
+      const ivec2 reduced = (size + 15) / 16;
+      const ivec2 id = ivec2(gl_GlobalInvocationID.xy);
+      if (any(greaterThanEqual(id, reduced)))
+         return;
+
+      const ivec2 begin = id * 16;
+      const ivec2 end = min(begin + 16, size);
+      float farthest = 0.0;
+      for (int y = begin.y; y < end.y; ++y) {
+         for (int x = begin.x; x < end.x; ++x)
+            farthest = max(farthest, texelFetch(depth, ivec2(x, y), 0).r);
+      }
+
+      texels[id.y * reduced.x + id.x] = farthest;
+   }
+)";
+
+
+/// Create the reduction pipeline                                             
+///   @param renderer - the renderer                                          
+void HiZBuffer::Create(VulkanRenderer* renderer) {
+   mRenderer = renderer;
+   const auto device = renderer->mDevice.Get();
+
+   shaderc::Compiler compiler;
+   shaderc::CompileOptions options;
+   const auto assembly = compiler.CompileGlslToSpv(
+      HiZShader, sizeof(HiZShader) - 1,
+      shaderc_glsl_compute_shader, "hiz", options
+   );
+
+   if (assembly.GetCompilationStatus() != shaderc_compilation_status_success) {
+      Logger::Error("Hi-Z shader compilation error: ", assembly.GetErrorMessage());
+      LANGULUS_THROW(Graphics, "Hi-Z shader compilation failed");
+   }
+
+   VkShaderModuleCreateInfo moduleInfo {};
+   moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+   moduleInfo.codeSize = (assembly.cend() - assembly.cbegin()) * sizeof(uint32_t);
+   moduleInfo.pCode = assembly.cbegin();
+
+   VkShaderModule module {};
+   if (vkCreateShaderModule(device, &moduleInfo, nullptr, &module))
+      LANGULUS_THROW(Graphics, "vkCreateShaderModule failed for Hi-Z shader");
+
+   // Depth is only fetched, filtering doesn't matter                   
+   VkSamplerCreateInfo samplerInfo {};
+   samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+   samplerInfo.magFilter = VK_FILTER_NEAREST;
+   samplerInfo.minFilter = VK_FILTER_NEAREST;
+   samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+   samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+   samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+   samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+   if (vkCreateSampler(device, &samplerInfo, nullptr, &mSampler.Get())) {
+      vkDestroyShaderModule(device, module, nullptr);
+      LANGULUS_THROW(Graphics, "Can't create Hi-Z sampler");
+   }
+
+   // The depth buffer, and the reduced depth                           
+   Bindings bindings;
+   VkDescriptorSetLayoutBinding info {};
+   info.binding = 0;
+   info.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+   info.descriptorCount = 1;
+   info.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+   bindings << info;
+   info.binding = 1;
+   info.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+   bindings << info;
+
+   mSetLayout = renderer->mLayouts.GetSetLayout(bindings);
+   mPipeLayout = renderer->mLayouts.GetPipelineLayout({mSetLayout});
+   for (uint32_t frame = 0; frame < renderer->mFramesInFlight; ++frame)
+      mSet[frame] = renderer->mLayouts.Allocate(mSetLayout, mPool[frame]);
+
+   VkComputePipelineCreateInfo pipelineInfo {};
+   pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+   pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+   pipelineInfo.stage.module = module;
+   pipelineInfo.stage.pName = "main";
+   pipelineInfo.layout = mPipeLayout;
+
+   const auto result = vkCreateComputePipelines(
+      device, renderer->mPipelineCache, 1, &pipelineInfo, nullptr, &mPipeline.Get());
+   vkDestroyShaderModule(device, module, nullptr);
+   if (result)
+      LANGULUS_THROW(Graphics, "Can't create Hi-Z pipeline");
+}
+
+/// Destroy the pipeline and free the VRAM                                    
+void HiZBuffer::Destroy() {
+   if (not mRenderer)
+      return;
+
+   const auto device = mRenderer->mDevice.Get();
+   if (mPipeline) {
+      vkDestroyPipeline(device, mPipeline, nullptr);
+      mPipeline.Reset();
+   }
+
+   if (mSampler) {
+      vkDestroySampler(device, mSampler, nullptr);
+      mSampler.Reset();
+   }
+
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      if (mSet[frame]) {
+         mRenderer->mLayouts.Free(mPool[frame], mSet[frame]);
+         mSet[frame].Reset();
+      }
+
+      if (mReduced[frame].IsValid())
+         mRenderer->mVRAM.DestroyBuffer(mReduced[frame]);
+      mAllocated[frame] = 0;
+   }
+
+   mPending = 0;
+   mPyramid.mLevels.clear();
+   mRenderer = nullptr;
+}
+
+/// Make room for the reduced depth of the current frame in flight, and point 
+/// the reduction at it                                                       
+/// Must be called before the capture is recorded                             
+///   @return the buffer, the reduction writes to, or nothing if unsupported  
+VkBuffer HiZBuffer::Prepare() {
+   if (not mPipeline)
+      return VK_NULL_HANDLE;
+
+   const auto frame = mRenderer->GetFrame();
+   auto& reduced = mReduced[frame];
+   auto& allocated = mAllocated[frame];
+
+   const auto& swapchain = mRenderer->mSwapchain;
+   const auto& depth = swapchain.GetDepthImage();
+   const auto& info = depth.GetImageCreateInfo();
+   mWidth = (info.extent.width + HiZTile - 1) / HiZTile;
+   mHeight = (info.extent.height + HiZTile - 1) / HiZTile;
+
+   const Size bytes = mWidth * mHeight * sizeof(float);
+   if (allocated < bytes) {
+      if (reduced.IsValid())
+         mRenderer->mVRAM.DestroyBuffer(reduced);
+
+      allocated = bytes;
+      reduced = mRenderer->mVRAM.CreateBuffer(
+         nullptr, VkDeviceSize {allocated},
+         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+      );
+   }
+
+   // The depth view changes when the swapchain is recreated, so always 
+   // update the set - the frame's previous use is done with it anyways 
+   VkDescriptorImageInfo imageInfo {};
+   imageInfo.sampler = mSampler;
+   imageInfo.imageView = swapchain.GetDepthView();
+   imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+   const VkDescriptorBufferInfo bufferInfo {reduced.GetBuffer(), 0, bytes};
+
+   VkWriteDescriptorSet writes[2] {};
+   for (auto& write : writes) {
+      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      write.dstSet = mSet[frame];
+      write.descriptorCount = 1;
+   }
+   writes[0].dstBinding = 0;
+   writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+   writes[0].pImageInfo = &imageInfo;
+   writes[1].dstBinding = 1;
+   writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+   writes[1].pBufferInfo = &bufferInfo;
+   vkUpdateDescriptorSets(mRenderer->mDevice, 2, writes, 0, nullptr);
+   return reduced.GetBuffer();
+}
+
+/// Record the reduction of the depth buffer                                  
+/// Must be recorded outside of a render pass, after Prepare, with the depth  
+/// readable in compute shaders                                               
+///   @param commands - the command buffer to record to                       
+///   @param camera - the camera, whose view was rendered last                
+///   @param level - the level, that was rendered last                        
+///   @param viewProjection - the view-projection of that camera level        
+///   @param slice - the slice of the depth range, the level was drawn in     
+void HiZBuffer::Capture(
+   VkCommandBuffer commands, const VulkanCamera* camera, Level level,
+   const Mat4& viewProjection, const DepthSlice& slice
+) {
+   if (not mPipeline)
+      return;
+
+   const auto frame = mRenderer->GetFrame();
+   vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+   vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_COMPUTE,
+      mPipeLayout, 0, 1, &mSet[frame].Get(), 0, nullptr);
+   vkCmdDispatch(commands,
+      (mWidth + HiZGroupSize - 1) / HiZGroupSize,
+      (mHeight + HiZGroupSize - 1) / HiZGroupSize, 1);
+
+   auto& captured = mCaptured[frame];
+   captured.mCamera = camera;
+   captured.mLevel = static_cast<int32_t>(level);
+   captured.mWidth = mWidth;
+   captured.mHeight = mHeight;
+   MatrixToFloats(viewProjection, captured.mViewProjection);
+   slice.Apply(captured.mViewProjection);
+   mPending |= 1u << frame;
+}
+
+/// Build the depth pyramid from the current frame in flight's last capture   
+/// Must be called after the GPU is done with that frame                      
+void HiZBuffer::Resolve() {
+   const auto frame = mRenderer->GetFrame();
+   const auto bit = 1u << frame;
+   if (not (mPending & bit))
+      return;
+   mPending &= ~bit;
+
+   const auto& captured = mCaptured[frame];
+   mCamera = captured.mCamera;
+   mLevel = captured.mLevel;
+   ::std::copy(captured.mViewProjection, captured.mViewProjection + 16, mViewProjection);
+
+   const auto bytes = captured.mWidth * captured.mHeight * sizeof(float);
+   const auto texels = reinterpret_cast<const float*>(mReduced[frame].Lock(0, bytes));
+   if (not texels) {
+      mPyramid.mLevels.clear();
+      return;
+   }
+
+   mPyramid.Build(texels, captured.mWidth, captured.mHeight);
+   mReduced[frame].Unlock();
+}
+
+/// Test if an instance is occluded by what was captured                      
+/// Only instances seen by the same camera on the same level can be tested    
+/// The view of the frame in flight's previous use is used, so that fast      
+/// moving cameras might show freshly disoccluded instances a few frames late 
+///   @param camera - the camera, that is being compiled                      
+///   @param level - the level, that is being compiled                        
+///   @param model - the instance's model transformation                      
+///   @return true if the instance is certainly occluded                      
+bool HiZBuffer::IsOccluded(const VulkanCamera* camera, Level level, const Mat4& model) const {
+   if (not mPyramid.IsValid() or camera != mCamera
+   or static_cast<int32_t>(level) != mLevel)
+      return false;
+
+   float m[16];
+   MatrixToFloats(model, m);
+   const auto sphere = MakeCullCandidate(m, mLevel, 0);
+   return mPyramid.IsOccluded(mViewProjection, sphere.mCenter, sphere.mRadius);
+}
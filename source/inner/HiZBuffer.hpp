@@ -0,0 +1,69 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "VulkanBuffer.hpp"
+#include "Culling.hpp"
+#include "DepthSlice.hpp"
+
+
+///                                                                           
+///   Hierarchical-Z buffer                                                   
+///                                                                           
+/// Captures the depth buffer after a layer is rendered, reducing it to a     
+/// coarse grid of farthest depths in a compute shader. Each frame in flight  
+/// has its own grid - once that frame comes around again, the GPU is done    
+/// with it, so the grid is read back and built into a depth pyramid, against 
+/// which the frame's instances are tested, before they enter the draw list   
+///                                                                           
+struct HiZBuffer {
+private:
+   VulkanRenderer* mRenderer {};
+
+   // The reduction compute pipeline                                    
+   UBOLayout mSetLayout {};
+   VkPipelineLayout mPipeLayout {};
+   Own<VkPipeline> mPipeline;
+   Own<VkDescriptorSet> mSet[MaxFramesInFlight];
+   VkDescriptorPool mPool[MaxFramesInFlight] {};
+   Own<VkSampler> mSampler;
+
+   // The reduced depth of each frame in flight, written by the GPU,    
+   // read by the CPU                                                   
+   VulkanBuffer mReduced[MaxFramesInFlight];
+   Size mAllocated[MaxFramesInFlight] {};
+   uint32_t mWidth {};
+   uint32_t mHeight {};
+   // A bit for each frame in flight, whose capture awaits resolving    
+   uint32_t mPending {};
+
+   // What the depth buffer contained, when each frame captured it      
+   struct Captured {
+      const VulkanCamera* mCamera;
+      int32_t mLevel;
+      float mViewProjection[16];
+      uint32_t mWidth;
+      uint32_t mHeight;
+   };
+
+   Captured mCaptured[MaxFramesInFlight] {};
+
+   // What the depth pyramid was built from                             
+   const VulkanCamera* mCamera {};
+   int32_t mLevel {};
+   float mViewProjection[16] {};
+   DepthPyramid mPyramid;
+
+public:
+   void Create(VulkanRenderer*);
+   void Destroy();
+   NOD() VkBuffer Prepare();
+   void Capture(VkCommandBuffer, const VulkanCamera*, Level, const Mat4&, const DepthSlice& = {});
+   void Resolve();
+
+   NOD() bool IsOccluded(const VulkanCamera*, Level, const Mat4&) const;
+};
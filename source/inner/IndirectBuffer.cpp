@@ -0,0 +1,159 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "IndirectBuffer.hpp"
+#include "../Vulkan.hpp"
+
+
+/// Initialize the indirect buffer                                            
+///   @param renderer - the renderer                                          
+void IndirectBuffer::Create(VulkanRenderer* renderer) {
+   mRenderer = renderer;
+}
+
+/// Free the VRAM                                                             
+void IndirectBuffer::Destroy() {
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      if (mBuffer[frame].IsValid())
+         mRenderer->mVRAM.DestroyBuffer(mBuffer[frame]);
+      mAllocated[frame] = mUploaded[frame] = 0;
+   }
+
+   mFresh = 0;
+   mRAM.Reset();
+}
+
+/// Discard all commands, retaining the allocated memory                      
+/// Buffers of the frames in flight are left alone, until their frame comes   
+/// around and uploads the new commands                                       
+void IndirectBuffer::Clear() {
+   mRAM.Clear();
+   mFresh = 0;
+}
+
+/// Discard the commands after some number of words, keeping the ones         
+/// before - these belong to draw lists, that were kept as they are           
+///   @param words - the number of words to keep                              
+void IndirectBuffer::Truncate(Count words) {
+   mRAM.Trim(words);
+   mFresh = 0;
+}
+
+/// Push a command                                                            
+///   @param command - the command                                            
+///   @param bytes - size of the command, must be a multiple of 4             
+///   @return the byte offset of the command inside the buffer                
+uint32_t IndirectBuffer::Push(const void* command, Size bytes) {
+   const auto offset = static_cast<uint32_t>(mRAM.GetCount() * sizeof(uint32_t));
+   const auto words = static_cast<const uint32_t*>(command);
+   for (Offset i = 0; i < bytes / sizeof(uint32_t); ++i)
+      mRAM << words[i];
+   return offset;
+}
+
+/// Push a non-indexed draw command                                           
+///   @param command - the command                                            
+///   @return the byte offset of the command inside the buffer                
+uint32_t IndirectBuffer::Push(const VkDrawIndirectCommand& command) {
+   return Push(&command, sizeof(command));
+}
+
+/// Push an indexed draw command                                              
+///   @param command - the command                                            
+///   @return the byte offset of the command inside the buffer                
+uint32_t IndirectBuffer::Push(const VkDrawIndexedIndirectCommand& command) {
+   return Push(&command, sizeof(command));
+}
+
+/// Push the indices of the instances drawn by a command                      
+///   @param instances - the instance indices                                 
+///   @param count - the number of instances                                  
+///   @return the word index of the first instance, used as the command's     
+///           firstInstance                                                   
+uint32_t IndirectBuffer::PushInstances(const uint32_t* instances, Count count) {
+   const auto first = static_cast<uint32_t>(mRAM.GetCount());
+   for (Offset i = 0; i < count; ++i)
+      mRAM << instances[i];
+   return first;
+}
+
+/// Upload all commands to the VRAM of the current frame in flight, along     
+/// with their pristine copy, if they changed since that frame last used them 
+/// The GPU must be done with that frame, since its buffer might be           
+/// reallocated                                                               
+void IndirectBuffer::Upload() {
+   const auto frame = mRenderer->GetFrame();
+   const auto bit = 1u << frame;
+   if (mFresh & bit)
+      return;
+   mFresh |= bit;
+
+   const auto bytes = mRAM.GetCount() * sizeof(uint32_t);
+   mUploaded[frame] = bytes;
+   if (not bytes)
+      return;
+
+   auto& buffer = mBuffer[frame];
+   if (mAllocated[frame] < bytes * 2) {
+      // No way to resize VRAM in place, so free the previous buffer    
+      if (buffer.IsValid())
+         mRenderer->mVRAM.DestroyBuffer(buffer);
+
+      // Allocate with some headroom, to avoid doing it every frame     
+      // Usable as storage, so that culling shaders can modify commands 
+      mAllocated[frame] = bytes * 4;
+      buffer = mRenderer->mVRAM.CreateBuffer(
+         nullptr, VkDeviceSize {mAllocated[frame]},
+         VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+       | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+      );
+      ++mVersion[frame];
+   }
+
+   buffer.Upload(0, bytes, mRAM.GetRaw());
+   buffer.Upload(bytes, bytes, mRAM.GetRaw());
+}
+
+/// Record copying the pristine commands over the ones in use, discarding     
+/// whatever the culling shader appended to them in a previous frame          
+/// Must be recorded outside of a render pass                                 
+///   @param commands - the command buffer to record to                       
+void IndirectBuffer::Restore(VkCommandBuffer commands) const {
+   const auto frame = mRenderer->GetFrame();
+   const auto bytes = mUploaded[frame];
+   if (not bytes)
+      return;
+
+   const auto buffer = mBuffer[frame].GetBuffer();
+   const VkBufferCopy region {bytes, 0, bytes};
+   vkCmdCopyBuffer(commands, buffer, buffer, 1, &region);
+}
+
+/// Get the VRAM buffer of the current frame in flight                        
+///   @return the buffer handle                                               
+VkBuffer IndirectBuffer::GetBuffer() const noexcept {
+   return mBuffer[mRenderer->GetFrame()].GetBuffer();
+}
+
+/// Get the version of the VRAM buffer of the current frame in flight         
+///   @return the number of times the buffer was allocated                    
+uint32_t IndirectBuffer::GetVersion() const noexcept {
+   return mVersion[mRenderer->GetFrame()];
+}
+
+/// Get the VRAM buffer of the current frame in flight                        
+///   @return the buffer                                                      
+const VulkanBuffer& IndirectBuffer::GetVRAM() const noexcept {
+   return mBuffer[mRenderer->GetFrame()];
+}
+
+/// Get the commands, as they were pushed for the current frame               
+///   @return the commands, as 32bit words                                    
+const TMany<uint32_t>& IndirectBuffer::GetCommands() const noexcept {
+   return mRAM;
+}
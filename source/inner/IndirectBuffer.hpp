@@ -0,0 +1,66 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "VulkanBuffer.hpp"
+
+
+///                                                                           
+///   Indirect draw buffer                                                    
+///                                                                           
+/// Gathers VkDrawIndirectCommand and VkDrawIndexedIndirectCommand records    
+/// while compiling a frame, and uploads them to VRAM at once, so they can    
+/// be consumed by vkCmdDraw*Indirect. Refilled every frame                   
+/// Commands are followed by the indices of the instances they draw - the     
+/// firstInstance of a command is the word, where its indices start, and      
+/// vertex shaders read the instance's data through them. The culling shader  
+/// appends visible instances there, counting them in the commands, so a      
+/// pristine copy of everything is kept after the commands, and copied over   
+/// them before each dispatch. Each frame in flight has its own buffer,       
+/// uploaded when that frame comes around, so commands can change while the   
+/// GPU still draws the other frames                                          
+///                                                                           
+struct IndirectBuffer {
+   // Binding of the instance indices in the dynamic set of pipelines,  
+   // right after the dynamic uniforms                                  
+   static constexpr uint32_t InstancesBinding = RefreshRate::DynamicUniformCount;
+
+private:
+   VulkanRenderer* mRenderer {};
+   // Commands of the current draw lists, packed as 32bit words         
+   TMany<uint32_t> mRAM;
+   // A bit for each frame in flight, whose buffer holds current mRAM   
+   uint32_t mFresh {};
+
+   // Commands in the VRAM of each frame in flight                      
+   VulkanBuffer mBuffer[MaxFramesInFlight];
+   // Number of bytes allocated in each VRAM buffer                     
+   Size mAllocated[MaxFramesInFlight] {};
+   // Number of bytes uploaded, and where their pristine copy starts    
+   Size mUploaded[MaxFramesInFlight] {};
+   // Incremented whenever a buffer is reallocated, so that sets that   
+   // point to it know they're outdated - zero until first allocated    
+   uint32_t mVersion[MaxFramesInFlight] {};
+
+   NOD() uint32_t Push(const void*, Size);
+
+public:
+   void Create(VulkanRenderer*);
+   void Destroy();
+   void Clear();
+   void Truncate(Count);
+   void Upload();
+   void Restore(VkCommandBuffer) const;
+
+   NOD() uint32_t Push(const VkDrawIndirectCommand&);
+   NOD() uint32_t Push(const VkDrawIndexedIndirectCommand&);
+   NOD() uint32_t PushInstances(const uint32_t*, Count);
+   NOD() VkBuffer GetBuffer() const noexcept;
+   NOD() uint32_t GetVersion() const noexcept;
+   NOD() const VulkanBuffer& GetVRAM() const noexcept;
+   NOD() const TMany<uint32_t>& GetCommands() const noexcept;
+};
@@ -0,0 +1,388 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "InstanceCuller.hpp"
+#include "../Vulkan.hpp"
+#include <shaderc/shaderc.hpp>
+
+/// Number of candidates tested by a single workgroup                         
+constexpr uint32_t CullGroupSize = 64;
+
+/// The culling compute shader - must do exactly what IsVisible does          
+static constexpr char CullShader[] = R"(
+   #version 450
+   layout(local_size_x = 64) in;
+
+   struct Frustum {
+      vec4 planes[6];
+      ivec4 level;
+   };
+
+   struct Candidate {
+      vec4 sphere;
+      int level;
+      uint frustum;
+      uint command;
+      uint first;
+      uint instance;
+   };
+
+   layout(std430, set = 0, binding = 0) readonly buffer Frustums {
+      Frustum frustums[];
+   };
+
+   layout(std430, set = 0, binding = 1) readonly buffer Candidates {
+      Candidate candidates[];
+   };
+
+   layout(std430, set = 0, binding = 2) buffer Commands {
+      uint words[];
+   };
+
+   void main() {
+      const uint i = gl_GlobalInvocationID.x;
+      if (i >= candidates.length())
+         return;
+
+      const Candidate c = candidates[i];
+      if (c.command == 0xFFFFFFFFu)
+         return;
+
+      const Frustum f = frustums[c.frustum];
+      bool visible = c.level == f.level.x;
+      for (int p = 0; p < 6 && visible; ++p)
+         visible = dot(f.planes[p].xyz, c.sphere.xyz) + f.planes[p].w >= -c.sphere.w;
+      if (!visible)
+         return;
+
+      const uint slot = atomicAdd(words[c.command], 1u);
+      words[c.first + slot] = c.instance;
+   }
+)";
+
+
+/// Create the culling pipeline                                               
+/// If the renderer's graphics queue can't do compute work, indirect draws    
+/// can't start at an instance, or the shader fails to compile, GPU culling   
+/// is disabled, and layers cull on the CPU                                   
+///   @param renderer - the renderer                                          
+void InstanceCuller::Create(VulkanRenderer* renderer) {
+   mRenderer = renderer;
+   const auto device = renderer->mDevice.Get();
+   const auto adapter = renderer->GetAdapter();
+
+   // Commands find the indices of the instances they draw by their     
+   // first instance                                                    
+   if (not renderer->mPhysicalFeatures.drawIndirectFirstInstance) {
+      Logger::Warning("Indirect draws can't start at an instance - GPU culling is disabled");
+      return;
+   }
+
+   uint32_t queueCount {};
+   vkGetPhysicalDeviceQueueFamilyProperties(adapter, &queueCount, nullptr);
+   ::std::vector<VkQueueFamilyProperties> queueProperties(queueCount);
+   vkGetPhysicalDeviceQueueFamilyProperties(adapter, &queueCount, queueProperties.data());
+   if (not (queueProperties[renderer->mGraphicIndex].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+      Logger::Warning("Graphics queue doesn't support compute - GPU culling is disabled");
+      return;
+   }
+
+   // Software devices are slow anyway, so validating costs little      
+   mValidate = renderer->mPhysicalProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+
+   shaderc::Compiler compiler;
+   shaderc::CompileOptions options;
+   const auto assembly = compiler.CompileGlslToSpv(
+      CullShader, sizeof(CullShader) - 1,
+      shaderc_glsl_compute_shader, "culling", options
+   );
+
+   if (assembly.GetCompilationStatus() != shaderc_compilation_status_success) {
+      Logger::Error("Culling shader compilation error: ", assembly.GetErrorMessage());
+      Logger::Warning("GPU culling is disabled");
+      return;
+   }
+
+   VkShaderModuleCreateInfo moduleInfo {};
+   moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+   moduleInfo.codeSize = (assembly.cend() - assembly.cbegin()) * sizeof(uint32_t);
+   moduleInfo.pCode = assembly.cbegin();
+
+   VkShaderModule module {};
+   if (vkCreateShaderModule(device, &moduleInfo, nullptr, &module))
+      LANGULUS_THROW(Graphics, "vkCreateShaderModule failed for culling shader");
+
+   // Frustums, candidates, and the indirect buffer                     
+   Bindings bindings;
+   for (uint32_t binding = 0; binding < 3; ++binding) {
+      VkDescriptorSetLayoutBinding info {};
+      info.binding = binding;
+      info.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      info.descriptorCount = 1;
+      info.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+      bindings << info;
+   }
+
+   mSetLayout = renderer->mLayouts.GetSetLayout(bindings);
+   mPipeLayout = renderer->mLayouts.GetPipelineLayout({mSetLayout});
+   for (uint32_t frame = 0; frame < renderer->mFramesInFlight; ++frame)
+      mSet[frame] = renderer->mLayouts.Allocate(mSetLayout, mPool[frame]);
+
+   VkComputePipelineCreateInfo pipelineInfo {};
+   pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+   pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+   pipelineInfo.stage.module = module;
+   pipelineInfo.stage.pName = "main";
+   pipelineInfo.layout = mPipeLayout;
+
+   const auto result = vkCreateComputePipelines(
+      device, renderer->mPipelineCache, 1, &pipelineInfo, nullptr, &mPipeline.Get());
+   vkDestroyShaderModule(device, module, nullptr);
+   if (result)
+      LANGULUS_THROW(Graphics, "Can't create culling pipeline");
+
+   mSupported = true;
+}
+
+/// Destroy the pipeline and free the VRAM                                    
+/// Layouts are owned by the renderer, and destroyed with it                  
+void InstanceCuller::Destroy() {
+   if (not mRenderer)
+      return;
+
+   const auto device = mRenderer->mDevice.Get();
+   if (mPipeline) {
+      vkDestroyPipeline(device, mPipeline, nullptr);
+      mPipeline.Reset();
+   }
+
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      if (mSet[frame]) {
+         mRenderer->mLayouts.Free(mPool[frame], mSet[frame]);
+         mSet[frame].Reset();
+      }
+
+      if (mFrustumBuffer[frame].IsValid())
+         mRenderer->mVRAM.DestroyBuffer(mFrustumBuffer[frame]);
+      if (mCandidateBuffer[frame].IsValid())
+         mRenderer->mVRAM.DestroyBuffer(mCandidateBuffer[frame]);
+
+      mFrustumsAllocated[frame] = mCandidatesAllocated[frame] = 0;
+      mIndirectBound[frame] = 0;
+   }
+
+   mSupported = false;
+   mPending = mFresh = 0;
+   mFrustums.clear();
+   mCandidates.clear();
+}
+
+/// Discard all frustums and candidates, retaining the allocated memory       
+/// Results of previous dispatches can't be validated against new candidates, 
+/// so they're dropped, too                                                   
+void InstanceCuller::Clear() {
+   mFrustums.clear();
+   mCandidates.clear();
+   mPending = mFresh = 0;
+}
+
+/// Discard the frustums and candidates pushed after a mark, keeping the      
+/// ones before - these belong to draw lists, that were kept as they are      
+///   @param mark - the mark                                                  
+void InstanceCuller::Truncate(const Mark& mark) {
+   mFrustums.resize(mark.mFrustums);
+   mCandidates.resize(mark.mCandidates);
+   mPending = mFresh = 0;
+}
+
+/// Check if GPU culling is available                                         
+///   @return true if layers can use GPU culling                              
+bool InstanceCuller::IsSupported() const noexcept {
+   return mSupported;
+}
+
+/// Check if there is anything to cull this frame                             
+///   @return true if Dispatch records anything                               
+bool InstanceCuller::IsActive() const noexcept {
+   return mSupported and not mCandidates.empty();
+}
+
+/// Check if results are read back and validated against the CPU              
+///   @return true if Validate reads back results                             
+bool InstanceCuller::IsValidating() const noexcept {
+   return mSupported and mValidate;
+}
+
+/// Get the number of frustums and candidates pushed so far                   
+///   @return the mark, where the next pushed ones start                      
+InstanceCuller::Mark InstanceCuller::GetMark() const noexcept {
+   return {mFrustums.size(), mCandidates.size()};
+}
+
+/// Push the frustum of a camera level                                        
+///   @param viewProjection - the view-projection matrix of the level         
+///   @param level - the level                                                
+///   @return the index of the frustum                                        
+uint32_t InstanceCuller::PushFrustum(const Mat4& viewProjection, Level level) {
+   float m[16];
+   MatrixToFloats(viewProjection, m);
+   mFrustums.push_back(MakeCullFrustum(m, static_cast<int32_t>(level)));
+   return static_cast<uint32_t>(mFrustums.size() - 1);
+}
+
+/// Push an instance to be culled                                             
+///   @param model - the model transformation, relative to the level          
+///   @param level - the level the instance is in                             
+///   @param frustum - the frustum to test against                            
+///   @return the index of the candidate                                      
+uint32_t InstanceCuller::PushCandidate(const Mat4& model, Level level, uint32_t frustum) {
+   float m[16];
+   MatrixToFloats(model, m);
+   mCandidates.push_back(MakeCullCandidate(m, static_cast<int32_t>(level), frustum));
+   return static_cast<uint32_t>(mCandidates.size() - 1);
+}
+
+/// Assign a candidate to the indirect command, which draws it if visible     
+/// Candidates that aren't assigned don't write any results                   
+///   @param candidate - the candidate index                                  
+///   @param drawOffset - byte offset of the command in the indirect buffer   
+///   @param first - the command's first instance                             
+///   @param instance - the index of the candidate's instance data            
+void InstanceCuller::Assign(uint32_t candidate, uint32_t drawOffset, uint32_t first, uint32_t instance) {
+   // instanceCount is the second word in both indexed and non-indexed  
+   // indirect commands                                                 
+   auto& c = mCandidates[candidate];
+   c.mCommand = drawOffset / sizeof(uint32_t) + 1;
+   c.mFirst = first;
+   c.mInstance = instance;
+}
+
+/// Move a candidate, that was already pushed, keeping its level, frustum,    
+/// and the command it is assigned to                                         
+///   @param candidate - the candidate index                                  
+///   @param model - the new model transformation, relative to the level      
+void InstanceCuller::Move(uint32_t candidate, const Mat4& model) {
+   float m[16];
+   MatrixToFloats(model, m);
+   auto& c = mCandidates[candidate];
+   const auto moved = MakeCullCandidate(m, c.mLevel, c.mFrustum);
+   for (int i = 0; i < 3; ++i)
+      c.mCenter[i] = moved.mCenter[i];
+   c.mRadius = moved.mRadius;
+   mFresh = 0;
+}
+
+/// Upload data to a host visible storage buffer, reallocating if required    
+///   @param buffer - [in/out] the buffer                                     
+///   @param allocated - [in/out] number of bytes allocated for the buffer    
+///   @param data - the data to upload                                        
+///   @param bytes - number of bytes to upload                                
+void InstanceCuller::Upload(VulkanBuffer& buffer, Size& allocated, const void* data, Size bytes) {
+   if (allocated < bytes) {
+      if (buffer.IsValid())
+         mRenderer->mVRAM.DestroyBuffer(buffer);
+
+      allocated = bytes * 2;
+      buffer = mRenderer->mVRAM.CreateBuffer(
+         nullptr, VkDeviceSize {allocated},
+         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+      );
+   }
+
+   buffer.Upload(0, bytes, data);
+}
+
+/// Upload all candidates for the current frame in flight, and record the     
+/// culling dispatch                                                          
+/// Must be recorded outside of a render pass, after the indirect buffer      
+/// was restored to its pristine commands - the frame's render graph places   
+/// the barriers against the copy and the indirect draws                      
+///   @param commands - the command buffer to record to                       
+void InstanceCuller::Dispatch(VkCommandBuffer commands) {
+   if (not IsActive())
+      return;
+
+   // Candidates only change along with the draw lists, so they're      
+   // uploaded only if they changed since this frame last used them,    
+   // and the set is updated if any buffer was reallocated              
+   const auto frame = mRenderer->GetFrame();
+   const auto bit = 1u << frame;
+   const auto& indirect = mRenderer->mIndirect;
+   if (not (mFresh & bit) or mIndirectBound[frame] != indirect.GetVersion()) {
+      const auto frustumBytes = mFrustums.size() * sizeof(CullFrustum);
+      const auto candidateBytes = mCandidates.size() * sizeof(CullCandidate);
+      Upload(mFrustumBuffer[frame], mFrustumsAllocated[frame], mFrustums.data(), frustumBytes);
+      Upload(mCandidateBuffer[frame], mCandidatesAllocated[frame], mCandidates.data(), candidateBytes);
+
+      const VkDescriptorBufferInfo buffers[3] {
+         {mFrustumBuffer[frame].GetBuffer(), 0, frustumBytes},
+         {mCandidateBuffer[frame].GetBuffer(), 0, candidateBytes},
+         {indirect.GetBuffer(), 0, VK_WHOLE_SIZE}
+      };
+
+      VkWriteDescriptorSet writes[3] {};
+      for (uint32_t i = 0; i < 3; ++i) {
+         writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+         writes[i].dstSet = mSet[frame];
+         writes[i].dstBinding = i;
+         writes[i].descriptorCount = 1;
+         writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+         writes[i].pBufferInfo = &buffers[i];
+      }
+
+      vkUpdateDescriptorSets(mRenderer->mDevice, 3, writes, 0, nullptr);
+      mIndirectBound[frame] = indirect.GetVersion();
+      mFresh |= bit;
+   }
+
+   const auto count = static_cast<uint32_t>(mCandidates.size());
+   vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+   vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_COMPUTE,
+      mPipeLayout, 0, 1, &mSet[frame].Get(), 0, nullptr);
+   vkCmdDispatch(commands, (count + CullGroupSize - 1) / CullGroupSize, 1, 1);
+
+   mRenderer->mStats.mCullCandidates = count;
+   mPending |= bit;
+}
+
+/// Compare the results of the current frame in flight's last dispatch        
+/// against the CPU reference                                                 
+/// Must be called after the GPU is done with the frame, and before its       
+/// indirect buffer is restored - the other frames are left alone             
+void InstanceCuller::Validate() {
+   const auto bit = 1u << mRenderer->GetFrame();
+   if (not (mPending & bit))
+      return;
+   mPending &= ~bit;
+   if (not mValidate)
+      return;
+
+   // Cull a copy of the commands, as they were before the dispatch     
+   const auto& commands = mRenderer->mIndirect.GetCommands();
+   ::std::vector<uint32_t> expected {
+      commands.GetRaw(), commands.GetRaw() + commands.GetCount()
+   };
+   CullReference(mFrustums, mCandidates, expected.data());
+
+   const auto& vram = mRenderer->mIndirect.GetVRAM();
+   const auto bytes = expected.size() * sizeof(uint32_t);
+   const auto results = reinterpret_cast<const uint32_t*>(vram.Lock(0, bytes));
+   if (not results) {
+      Logger::Error("Can't read back culling results");
+      return;
+   }
+
+   // Visible instances are appended in any order on the GPU            
+   const auto mismatches = CullMismatches(mCandidates, expected.data(), results);
+   vram.Unlock();
+   if (mismatches) {
+      Logger::Error("GPU culling differs from the CPU reference for ",
+         mismatches, " draw commands");
+   }
+}
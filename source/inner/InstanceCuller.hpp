@@ -0,0 +1,82 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "VulkanBuffer.hpp"
+#include "Culling.hpp"
+
+
+///                                                                           
+///   GPU instance culler                                                     
+///                                                                           
+/// Gathers the bounds of all instances of GPUCulling styled layers, along    
+/// with the frustums of all camera levels, and tests them in a compute       
+/// shader, right before the frame is drawn. Visible instances are appended   
+/// to the indirect command they belong to, which counts them, so a single    
+/// command draws all visible instances of a pipeline's run, and culled ones  
+/// cost nothing. Each frame in flight has its own buffers and set, uploaded  
+/// when that frame comes around, and culls into its own indirect buffer      
+///                                                                           
+struct InstanceCuller {
+   /// Number of frustums and candidates, pushed before a layer's own         
+   struct Mark {
+      size_t mFrustums;
+      size_t mCandidates;
+   };
+
+private:
+   VulkanRenderer* mRenderer {};
+   // Whether the graphics queue can dispatch compute work              
+   bool mSupported {};
+   // Whether results are read back and validated against the CPU       
+   // reference implementation - enabled on software devices            
+   bool mValidate {};
+   // A bit for each frame in flight, whose dispatch of the current     
+   // candidates awaits validation                                      
+   uint32_t mPending {};
+   // A bit for each frame in flight, whose buffers hold the current    
+   // frustums and candidates                                           
+   uint32_t mFresh {};
+
+   // The culling compute pipeline, and a set for each frame in flight  
+   UBOLayout mSetLayout {};
+   VkPipelineLayout mPipeLayout {};
+   Own<VkPipeline> mPipeline;
+   Own<VkDescriptorSet> mSet[MaxFramesInFlight];
+   VkDescriptorPool mPool[MaxFramesInFlight] {};
+   // Version of the indirect buffer, that each set points to           
+   uint32_t mIndirectBound[MaxFramesInFlight] {};
+
+   // Frustums and candidates of the current draw lists                 
+   CullFrustums mFrustums;
+   CullCandidates mCandidates;
+
+   // Frustums and candidates in the VRAM of each frame in flight       
+   VulkanBuffer mFrustumBuffer[MaxFramesInFlight];
+   VulkanBuffer mCandidateBuffer[MaxFramesInFlight];
+   Size mFrustumsAllocated[MaxFramesInFlight] {};
+   Size mCandidatesAllocated[MaxFramesInFlight] {};
+
+   void Upload(VulkanBuffer&, Size&, const void*, Size);
+
+public:
+   void Create(VulkanRenderer*);
+   void Destroy();
+   void Clear();
+   void Truncate(const Mark&);
+   void Dispatch(VkCommandBuffer);
+   void Validate();
+
+   NOD() bool IsSupported() const noexcept;
+   NOD() bool IsActive() const noexcept;
+   NOD() bool IsValidating() const noexcept;
+   NOD() Mark GetMark() const noexcept;
+   NOD() uint32_t PushFrustum(const Mat4&, Level);
+   NOD() uint32_t PushCandidate(const Mat4&, Level, uint32_t);
+   void Assign(uint32_t, uint32_t, uint32_t, uint32_t);
+   void Move(uint32_t, const Mat4&);
+};
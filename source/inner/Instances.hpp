@@ -0,0 +1,222 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "Glsl.hpp"
+#include <cstdint>
+
+
+///                                                                           
+///   Shader stages, as far as instance data is concerned                     
+///                                                                           
+enum class InstanceStage : uint8_t {
+   Vertex,
+   Geometry,
+   Pixel,
+   Other
+};
+
+/// Location of the varying, that passes the instance index from the vertex   
+/// stage to later ones                                                       
+constexpr uint32_t InstanceLocation = 15;
+
+
+///                                                                           
+///   A uniform block, as found in GLSL code                                  
+///                                                                           
+struct UniformBlock {
+   // Where the declaration starts and ends, including the semicolon    
+   size_t mBegin {::std::string_view::npos};
+   size_t mEnd {};
+   // Everything between the braces                                     
+   ::std::string_view mMembers;
+   // The instance name, empty if members are accessed directly         
+   ::std::string_view mInstance;
+
+   explicit operator bool() const noexcept {
+      return mBegin != ::std::string_view::npos;
+   }
+};
+
+
+/// Find the uniform block at a set and binding                               
+///   @param code - the GLSL code                                             
+///   @param set - the descriptor set of the block                            
+///   @param binding - the binding of the block                               
+///   @return the block, or an invalid one if not found                       
+inline UniformBlock FindUniformBlock(::std::string_view code, int set, int binding) {
+   constexpr auto npos = ::std::string_view::npos;
+
+   for (auto i = GlslFindWord(code, "layout"); i != npos; i = GlslFindWord(code, "layout", i + 1)) {
+      const auto open = GlslSkipSpace(code, i + 6);
+      if (open >= code.size() or code[open] != '(')
+         continue;
+      const auto close = code.find(')', open);
+      if (close == npos)
+         break;
+
+      const auto layout = code.substr(open + 1, close - open - 1);
+      if (GlslQualifier(layout, "set") != set or GlslQualifier(layout, "binding") != binding)
+         continue;
+
+      // Only 'uniform Name { ... } instance;' blocks are of interest   
+      auto j = GlslSkipSpace(code, close + 1);
+      if (GlslIdentifier(code, j) != "uniform")
+         continue;
+      j = GlslSkipSpace(code, j + 7);
+      const auto name = GlslIdentifier(code, j);
+      j = GlslSkipSpace(code, j + name.size());
+      if (name.empty() or j >= code.size() or code[j] != '{')
+         continue;
+
+      const auto end = code.find('}', j);
+      if (end == npos)
+         break;
+
+      UniformBlock block;
+      block.mMembers = code.substr(j + 1, end - j - 1);
+      j = GlslSkipSpace(code, end + 1);
+      block.mInstance = GlslIdentifier(code, j);
+      j = GlslSkipSpace(code, j + block.mInstance.size());
+      if (j >= code.size() or code[j] != ';')
+         continue;
+
+      block.mBegin = i;
+      block.mEnd = j + 1;
+      return block;
+   }
+
+   return {};
+}
+
+/// Turn the uniform block of instance data into an array of structures in a  
+/// storage buffer, indexed by the instance being drawn. The vertex stage     
+/// finds the index among the indices of the instances its draw call draws,   
+/// which start at its first instance, so a single draw call can draw any     
+/// instances, in any order. The vertex stage always passes the index on, in  
+/// case any later stage reads the data - geometry stages forward it with     
+/// each emitted vertex                                                       
+///   @param code - the GLSL code of the shader                               
+///   @param stage - the stage of the shader                                  
+///   @param set - the descriptor set of the instance data                    
+///   @param binding - the binding of the instance data                       
+///   @param indices - the binding of the instance indices, in the same set   
+///   @return the new code                                                    
+inline ::std::string InjectInstances(
+   ::std::string_view code, InstanceStage stage, int set, int binding, int indices
+) {
+   const auto location = ::std::to_string(InstanceLocation);
+   ::std::string result {code};
+
+   const auto block = FindUniformBlock(code, set, binding);
+   if (block) {
+      // Members go to a structure, without their layout qualifiers     
+      ::std::string members;
+      ::std::string defines;
+      auto rest = block.mMembers;
+      while (true) {
+         const auto semicolon = rest.find(';');
+         if (semicolon == ::std::string_view::npos)
+            break;
+
+         auto member = rest.substr(0, semicolon);
+         rest.remove_prefix(semicolon + 1);
+         const auto start = GlslSkipSpace(member, 0);
+         member.remove_prefix(start);
+         if (member.empty())
+            continue;
+
+         if (GlslIdentifier(member, 0) == "layout") {
+            const auto close = member.find(')');
+            member.remove_prefix(close == ::std::string_view::npos ? member.size() : close + 1);
+            member.remove_prefix(GlslSkipSpace(member, 0));
+         }
+
+         // The member's name is the last identifier, before any array  
+         auto nameEnd = member.find('[');
+         if (nameEnd == ::std::string_view::npos)
+            nameEnd = member.size();
+         while (nameEnd > 0 and not GlslIsIdentifier(member[nameEnd - 1]))
+            --nameEnd;
+         auto nameBegin = nameEnd;
+         while (nameBegin > 0 and GlslIsIdentifier(member[nameBegin - 1]))
+            --nameBegin;
+
+         const auto name = ::std::string {member.substr(nameBegin, nameEnd - nameBegin)};
+         members += "   ";
+         members.append(member);
+         members += ";\n";
+         if (block.mInstance.empty() and not name.empty())
+            defines += "#define " + name + " LangulusInstances[LangulusInstance]." + name + "\n";
+      }
+
+      if (not block.mInstance.empty()) {
+         defines += "#define ";
+         defines.append(block.mInstance);
+         defines += " LangulusInstances[LangulusInstance]\n";
+      }
+
+      ::std::string replacement =
+         "struct LangulusInstanceData {\n" + members + "};\n"
+         "layout(std430, set = " + ::std::to_string(set)
+       + ", binding = " + ::std::to_string(binding) + ") readonly buffer LangulusInstanceBuffer {\n"
+         "   LangulusInstanceData LangulusInstances[];\n"
+         "};\n";
+
+      switch (stage) {
+      case InstanceStage::Vertex:
+         // Defined along with the indices                              
+         break;
+      case InstanceStage::Geometry:
+         replacement += "#define LangulusInstance LangulusInstanceIn[0]\n";
+         break;
+      case InstanceStage::Pixel:
+         replacement += "layout(location = " + location + ") flat in uint LangulusInstance;\n";
+         break;
+      default:
+         replacement += "#define LangulusInstance 0\n";
+      }
+
+      replacement += defines;
+      result.replace(block.mBegin, block.mEnd - block.mBegin, replacement);
+   }
+
+   if (stage == InstanceStage::Vertex) {
+      // Rename the main function, and call it from a new one, that     
+      // passes the instance index on                                   
+      const auto main = GlslFindMain(result);
+      if (main == ::std::string::npos)
+         return result;
+
+      result.replace(main, 4, "LangulusInstancedMain");
+      result += "\nlayout(location = " + location + ") flat out uint LangulusInstanceOut;\n"
+                "void main() {\n"
+                "   LangulusInstanceOut = LangulusInstance;\n"
+                "   LangulusInstancedMain();\n"
+                "}\n";
+
+      // The index is read from the indices, before anything uses it    
+      result.insert(GlslHeaderEnd(result),
+         "layout(std430, set = " + ::std::to_string(set)
+       + ", binding = " + ::std::to_string(indices) + ") readonly buffer LangulusDrawnBuffer {\n"
+         "   uint LangulusDrawn[];\n"
+         "};\n"
+         "#define LangulusInstance LangulusDrawn[gl_InstanceIndex]\n"
+      );
+   }
+   else if (stage == InstanceStage::Geometry) {
+      // Each emitted vertex carries the index of the instance          
+      const auto header = GlslHeaderEnd(result);
+      result.insert(header,
+         "layout(location = " + location + ") flat in uint LangulusInstanceIn[];\n"
+         "layout(location = " + location + ") flat out uint LangulusInstanceOut;\n"
+         "#define EmitVertex() do { LangulusInstanceOut = LangulusInstanceIn[0]; EmitVertex(); } while (false)\n"
+      );
+   }
+
+   return result;
+}
@@ -0,0 +1,161 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+
+///                                                                           
+///   Pool of worker threads, that run batches of independent jobs            
+///                                                                           
+/// Each batch is split into one contiguous slice of job indices per worker.  
+/// Workers take jobs from the front of their own slice, and when it runs     
+/// out, steal single jobs from the slices of others, so uneven jobs still    
+/// keep all workers busy. The thread that runs a batch works on it, too,     
+/// as worker zero. Jobs must not throw, and must not run batches themselves  
+///                                                                           
+struct JobPool {
+private:
+   /// A worker's slice of the batch                                          
+   struct alignas(64) Slice {
+      ::std::atomic<uint32_t> mNext;
+      uint32_t mEnd;
+   };
+
+   ::std::vector<::std::thread> mThreads;
+   ::std::unique_ptr<Slice[]> mSlices;
+   uint32_t mWorkers {1};
+
+   // The batch being run, type erased                                  
+   void (*mInvoke)(void*, uint32_t, uint32_t) {};
+   void* mContext {};
+
+   ::std::mutex mMutex;
+   ::std::condition_variable mWake;
+   ::std::condition_variable mDone;
+   uint64_t mGeneration {};
+   uint32_t mBusy {};
+   bool mStop {};
+
+   /// Run jobs until there are none left in any slice                        
+   ///   @param worker - the worker index                                     
+   void Work(uint32_t worker) noexcept {
+      for (uint32_t i = 0; i < mWorkers; ++i) {
+         // Own slice first, then the others, in order                  
+         auto& slice = mSlices[(worker + i) % mWorkers];
+         while (true) {
+            const auto job = slice.mNext.fetch_add(1, ::std::memory_order_relaxed);
+            if (job >= slice.mEnd)
+               break;
+            mInvoke(mContext, job, worker);
+         }
+      }
+   }
+
+   /// Wait for batches and work on them, until the pool is destroyed         
+   ///   @param worker - the worker index                                     
+   void Loop(uint32_t worker) noexcept {
+      uint64_t seen = 0;
+      while (true) {
+         {
+            ::std::unique_lock lock {mMutex};
+            mWake.wait(lock, [&] { return mStop or mGeneration != seen; });
+            if (mStop)
+               return;
+            seen = mGeneration;
+         }
+
+         Work(worker);
+
+         ::std::lock_guard lock {mMutex};
+         if (--mBusy == 0)
+            mDone.notify_one();
+      }
+   }
+
+public:
+   /// Create the pool                                                        
+   ///   @param workers - the number of workers, including the thread that    
+   ///                    runs batches; zero uses one per hardware thread     
+   explicit JobPool(uint32_t workers = 0) {
+      if (not workers)
+         workers = ::std::max(1u, ::std::thread::hardware_concurrency());
+
+      mWorkers = workers;
+      mSlices = ::std::make_unique<Slice[]>(workers);
+      for (uint32_t w = 1; w < workers; ++w)
+         mThreads.emplace_back([this, w] { Loop(w); });
+   }
+
+   JobPool(const JobPool&) = delete;
+   JobPool& operator = (const JobPool&) = delete;
+
+   ~JobPool() {
+      {
+         ::std::lock_guard lock {mMutex};
+         mStop = true;
+      }
+
+      mWake.notify_all();
+      for (auto& thread : mThreads)
+         thread.join();
+   }
+
+   /// Get the number of workers, including the thread that runs batches      
+   ///   @return the number of workers                                        
+   uint32_t GetWorkers() const noexcept {
+      return mWorkers;
+   }
+
+   /// Run a batch of jobs, and wait for all of them to finish                
+   ///   @param count - the number of jobs                                    
+   ///   @param job - called with each job index, and the index of the        
+   ///                worker running it, which is below GetWorkers()          
+   template<class F>
+   void Run(uint32_t count, F&& job) {
+      if (not count)
+         return;
+
+      mContext = &job;
+      mInvoke = [](void* context, uint32_t index, uint32_t worker) {
+         (*static_cast<::std::remove_reference_t<F>*>(context))(index, worker);
+      };
+
+      // Split the jobs evenly, a single job isn't worth waking anyone  
+      const auto workers = count < 2 ? 1 : mWorkers;
+      for (uint32_t w = 0; w < mWorkers; ++w) {
+         const auto begin = static_cast<uint32_t>(uint64_t {count} * w / workers);
+         const auto end = static_cast<uint32_t>(uint64_t {count} * (w + 1) / workers);
+         mSlices[w].mNext.store(w < workers ? begin : count, ::std::memory_order_relaxed);
+         mSlices[w].mEnd = w < workers ? end : count;
+      }
+
+      if (workers > 1) {
+         {
+            ::std::lock_guard lock {mMutex};
+            mBusy = mWorkers - 1;
+            ++mGeneration;
+         }
+         mWake.notify_all();
+      }
+
+      Work(0);
+
+      if (workers > 1) {
+         ::std::unique_lock lock {mMutex};
+         mDone.wait(lock, [&] { return mBusy == 0; });
+      }
+   }
+};
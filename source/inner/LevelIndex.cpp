@@ -0,0 +1,154 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "LevelIndex.hpp"
+#include "../Vulkan.hpp"
+
+
+/// Insert all instances of a renderable, replacing any previous ones         
+///   @param renderable - the renderable                                      
+void LevelIndex::Insert(const VulkanRenderable* renderable) {
+   Remove(renderable);
+   ++mVersion;
+   if (not renderable->mInstances) {
+      mUnplaced.push_back(renderable);
+      return;
+   }
+
+   auto& levels = mLevels[renderable];
+   for (auto instance : renderable->mInstances) {
+      const auto level = static_cast<int32_t>(instance->GetLevel());
+      auto& bucket = mBuckets[level];
+      bucket.mEntries.push_back({renderable, instance});
+      bucket.mDirty = true;
+
+      if (::std::find(levels.begin(), levels.end(), level) == levels.end())
+         levels.push_back(level);
+   }
+}
+
+/// Remove all instances of a renderable                                      
+///   @param renderable - the renderable                                      
+void LevelIndex::Remove(const VulkanRenderable* renderable) {
+   ++mVersion;
+   ::std::erase(mUnplaced, renderable);
+
+   const auto found = mLevels.find(renderable);
+   if (found == mLevels.end())
+      return;
+
+   for (auto level : found->second) {
+      const auto bucket = mBuckets.find(level);
+      if (bucket == mBuckets.end())
+         continue;
+
+      ::std::erase_if(bucket->second.mEntries, [renderable](const Entry& entry) {
+         return entry.mRenderable == renderable;
+      });
+
+      if (bucket->second.mEntries.empty())
+         mBuckets.erase(bucket);
+      else
+         bucket->second.mDirty = true;
+   }
+
+   mLevels.erase(found);
+}
+
+/// Forget all renderables                                                    
+void LevelIndex::Clear() {
+   ++mVersion;
+   mBuckets.clear();
+   mLevels.clear();
+   mUnplaced.clear();
+   mStale.clear();
+}
+
+/// Start a new frame, so that spheres are updated the next time their level  
+/// is looked up. Instances, that changed their level, are moved to their     
+/// new bucket here - this only reads their levels, which is much cheaper     
+/// than compiling them                                                       
+void LevelIndex::NextFrame() {
+   ++mFrame;
+
+   mStale.clear();
+   for (const auto& [level, bucket] : mBuckets) {
+      for (const auto& entry : bucket.mEntries) {
+         if (static_cast<int32_t>(entry.mInstance->GetLevel()) != level)
+            mStale.push_back(entry.mRenderable);
+      }
+   }
+
+   ::std::sort(mStale.begin(), mStale.end());
+   mStale.erase(::std::unique(mStale.begin(), mStale.end()), mStale.end());
+   for (auto renderable : mStale)
+      Insert(renderable);
+}
+
+/// Find the bucket of a level                                                
+///   @param level - the level                                                
+///   @return the bucket, or nullptr if the level has no instances            
+LevelIndex::Bucket* LevelIndex::Find(Level level) noexcept {
+   const auto found = mBuckets.find(static_cast<int32_t>(level));
+   return found == mBuckets.end() ? nullptr : &found->second;
+}
+
+/// Update the bounds and the tree of a level, if not yet done this frame     
+/// Must be done before querying the level                                    
+///   @param level - the level                                                
+void LevelIndex::Prepare(Level level) {
+   const auto bucket = Find(level);
+   if (not bucket or bucket->mFrame == mFrame)
+      return;
+
+   bucket->mFrame = mFrame;
+   const auto count = bucket->mEntries.size();
+   if (bucket->mDirty) {
+      // Entries were shuffled, so forget all cached transforms - NaNs  
+      // never compare equal, so every bound is remade below            
+      bucket->mSpheres.resize(count);
+      bucket->mBoxes.Resize(count);
+      bucket->mModels.assign(count * 16, NAN);
+   }
+
+   bool moved = false;
+   for (size_t i = 0; i < count; ++i) {
+      float m[16];
+      MatrixToFloats(bucket->mEntries[i].mInstance->GetModelTransform(level), m);
+      const auto cached = bucket->mModels.data() + i * 16;
+      if (::std::equal(m, m + 16, cached))
+         continue;
+
+      ::std::copy(m, m + 16, cached);
+      const auto candidate = MakeCullCandidate(m, 0, 0);
+      auto& sphere = bucket->mSpheres[i];
+      ::std::copy(candidate.mCenter, candidate.mCenter + 3, sphere.mCenter);
+      sphere.mRadius = candidate.mRadius;
+      bucket->mBoxes.Set(i, m);
+      moved = true;
+   }
+
+   // Moving instances only loosen the tree, until it's worth rebuilding
+   if (bucket->mDirty or (moved and not bucket->mTree.Refit(bucket->mSpheres))) {
+      bucket->mTree.Build(bucket->mSpheres);
+      bucket->mDirty = false;
+   }
+}
+
+/// Get the renderables without instances                                     
+///   @return the renderables                                                 
+const ::std::vector<const VulkanRenderable*>& LevelIndex::GetUnplaced() const noexcept {
+   return mUnplaced;
+}
+
+/// Get the version of the index, which changes whenever renderables are      
+/// inserted or removed - including when they're refreshed, or when any of    
+/// their instances changes its level                                         
+///   @return the version                                                     
+uint64_t LevelIndex::GetVersion() const noexcept {
+   return mVersion;
+}
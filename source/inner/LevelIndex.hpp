@@ -0,0 +1,124 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "../Common.hpp"
+#include "BVH.hpp"
+#include <unordered_map>
+
+
+///                                                                           
+///   Per-level index of a layer's renderables                                
+///                                                                           
+/// Buckets all instances of a layer by their level, so that compiling a      
+/// level never touches instances of other levels. Each bucket has a BVH of   
+/// its instances, refit at most once per frame, the first time the level is  
+/// looked up. Renderables are reinserted when they're refreshed, and when    
+/// any of their instances changes its level. Each bucket also caches the     
+/// bounding boxes of its instances, updated only for instances that moved,   
+/// which replace A::Instance::Cull for everything the BVH lets through       
+/// Different levels can be prepared in parallel, and prepared levels can be  
+/// queried in parallel, as long as each query has its own Scratch            
+///                                                                           
+struct LevelIndex {
+   /// A single instance of a renderable                                      
+   struct Entry {
+      const VulkanRenderable* mRenderable;
+      const A::Instance* mInstance;
+   };
+
+   /// Reusable storage for frustum queries                                   
+   struct Scratch {
+      ::std::vector<uint32_t> mSurvivors;
+      ::std::vector<uint32_t> mVisible;
+      CullBoxes mGathered;
+   };
+
+private:
+   struct Bucket {
+      ::std::vector<Entry> mEntries;
+      BoundingSpheres mSpheres;
+      CullBoxes mBoxes;
+      // Model transforms the bounds were made from, 16 floats each     
+      ::std::vector<float> mModels;
+      BVH mTree;
+      // Whether entries changed since the tree was built               
+      bool mDirty = true;
+      // The frame, in which the spheres were last updated              
+      uint64_t mFrame {};
+   };
+
+   ::std::unordered_map<int32_t, Bucket> mBuckets;
+   // Levels each renderable has instances in                           
+   ::std::unordered_map<const VulkanRenderable*, ::std::vector<int32_t>> mLevels;
+   // Renderables without instances, drawn only in the default level    
+   ::std::vector<const VulkanRenderable*> mUnplaced;
+   // Reusable storage for renderables, that must be reinserted         
+   ::std::vector<const VulkanRenderable*> mStale;
+   uint64_t mFrame = 1;
+   // Bumped whenever renderables are inserted or removed               
+   uint64_t mVersion {};
+
+   NOD() Bucket* Find(Level) noexcept;
+
+public:
+   void Insert(const VulkanRenderable*);
+   void Remove(const VulkanRenderable*);
+   void Clear();
+   void NextFrame();
+   void Prepare(Level);
+
+   NOD() const ::std::vector<const VulkanRenderable*>& GetUnplaced() const noexcept;
+   NOD() uint64_t GetVersion() const noexcept;
+
+   /// Visit all instances in a level                                         
+   ///   @param level - the level                                             
+   ///   @param visit - called with each Entry                                
+   template<class F>
+   void ForEach(Level level, F&& visit) {
+      const auto bucket = Find(level);
+      if (not bucket)
+         return;
+
+      for (const auto& entry : bucket->mEntries)
+         visit(entry);
+   }
+
+   /// Visit the instances in a level, that are at least partially inside a   
+   /// frustum. The BVH skips whole groups of bounding spheres, and the       
+   /// boxes of the remaining instances are then tested four at a time        
+   /// The level must be prepared this frame                                  
+   ///   @param level - the level                                             
+   ///   @param viewProjection - the camera's view-projection in that level   
+   ///   @param scratch - [in/out] storage for the query                      
+   ///   @param visit - called with each visible Entry                        
+   template<class F>
+   void Query(Level level, const Mat4& viewProjection, Scratch& scratch, F&& visit) {
+      const auto bucket = Find(level);
+      if (not bucket)
+         return;
+
+      float m[16];
+      MatrixToFloats(viewProjection, m);
+      const auto frustum = MakeCullFrustum(m, 0);
+      auto& survivors = scratch.mSurvivors;
+      survivors.clear();
+      bucket->mTree.Query(frustum, bucket->mSpheres, [&](uint32_t i) {
+         survivors.push_back(i);
+      });
+
+      // Gather the survivors' boxes, so they can be tested together    
+      scratch.mGathered.Resize(survivors.size());
+      for (size_t i = 0; i < survivors.size(); ++i)
+         scratch.mGathered.Copy(i, bucket->mBoxes, survivors[i]);
+
+      scratch.mVisible.resize(survivors.size());
+      const auto visible = CullBatch(frustum, scratch.mGathered, scratch.mVisible.data());
+      for (size_t i = 0; i < visible; ++i)
+         visit(bucket->mEntries[survivors[scratch.mVisible[i]]]);
+   }
+};
@@ -0,0 +1,204 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "LightClusters.hpp"
+#include "../Vulkan.hpp"
+
+/// Storage buffer offsets can't be aligned to more than that                 
+constexpr uint32_t ClusterAlignment = 256;
+
+
+/// Initialize the clusters                                                   
+///   @param renderer - the renderer                                          
+void LightClusters::Create(VulkanRenderer* renderer) {
+   mRenderer = renderer;
+   mSetLayout = GetSetLayout(renderer->mLayouts);
+}
+
+/// Free the VRAM and the sets                                                
+void LightClusters::Destroy() {
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      for (Offset i = 0; i < mSets[frame].GetCount(); ++i)
+         mRenderer->mLayouts.Free(mPools[frame][i], mSets[frame][i]);
+      mSets[frame].Reset();
+      mPools[frame].Reset();
+
+      for (int i = 0; i < 3; ++i) {
+         if (mBuffers[frame][i].IsValid())
+            mRenderer->mVRAM.DestroyBuffer(mBuffers[frame][i]);
+         mAllocated[frame][i] = 0;
+      }
+   }
+
+   for (auto& stream : mRAM)
+      stream.Reset();
+   mSections.Reset();
+   mFresh = 0;
+}
+
+/// Discard all grids, retaining the allocated memory                         
+/// Streams of the frames in flight are left alone, until their frame comes   
+/// around and uploads the new grids                                          
+void LightClusters::Clear() {
+   for (auto& stream : mRAM)
+      stream.Clear();
+   mSections.Clear();
+   mFresh = 0;
+}
+
+/// Get the descriptor set layout, that all forward lit pipelines share       
+///   @param layouts - the layout cache                                       
+///   @return the layout                                                      
+UBOLayout LightClusters::GetSetLayout(VulkanLayouts& layouts) {
+   Bindings bindings;
+   for (uint32_t i = 0; i < 3; ++i) {
+      VkDescriptorSetLayoutBinding binding {};
+      binding.binding = i;
+      binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      binding.descriptorCount = 1;
+      binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+      bindings << binding;
+   }
+
+   return layouts.GetSetLayout(bindings);
+}
+
+/// Append data to one of the streams                                         
+///   @param stream - the stream index                                        
+///   @param data - the data                                                  
+///   @param bytes - size of the data, must be a multiple of 4                
+void LightClusters::Push(uint32_t stream, const void* data, Size bytes) {
+   const auto words = static_cast<const uint32_t*>(data);
+   for (Offset i = 0; i < bytes / sizeof(uint32_t); ++i)
+      mRAM[stream] << words[i];
+}
+
+/// Bin lights into the grid of a camera                                      
+///   @param camera - the camera, or nullptr if using the default one         
+///   @param projection - the camera projection                               
+///   @param inverse - the inverted camera projection                         
+///   @param lights - the lights, relative to the camera's view               
+void LightClusters::Push(
+   const VulkanCamera* camera, const Mat4& projection,
+   const Mat4& inverse, const LightSources& lights
+) {
+   float p[16];
+   MatrixToFloats(projection, p);
+   if (mGrid.mRanges.empty() or not ::std::equal(p, p + 16, mProjection)) {
+      float i[16];
+      MatrixToFloats(inverse, i);
+      mGrid.Build(p, i);
+      ::std::copy(p, p + 16, mProjection);
+   }
+
+   mGrid.Assign(lights);
+
+   // Each section must start at an aligned offset                      
+   Section section {camera};
+   for (uint32_t s = 0; s < 3; ++s) {
+      while (mRAM[s].GetCount() % (ClusterAlignment / sizeof(uint32_t)))
+         mRAM[s] << 0u;
+      section.mOffsets[s] = static_cast<uint32_t>(mRAM[s].GetCount() * sizeof(uint32_t));
+   }
+
+   Push(0, &mGrid.mHeader, sizeof(ClusterHeader));
+   Push(0, lights.data(), lights.size() * sizeof(LightSource));
+   Push(1, mGrid.mRanges.data(), mGrid.mRanges.size() * sizeof(ClusterRange));
+
+   // Storage buffers can't be empty, so an empty index list gets a     
+   // dummy index, that no range refers to                              
+   if (mGrid.mIndices.empty())
+      mRAM[2] << 0u;
+   else
+      Push(2, mGrid.mIndices.data(), mGrid.mIndices.size() * sizeof(uint32_t));
+
+   for (uint32_t s = 0; s < 3; ++s) {
+      section.mSizes[s] = static_cast<uint32_t>(
+         mRAM[s].GetCount() * sizeof(uint32_t) - section.mOffsets[s]);
+   }
+
+   mSections << section;
+   mRenderer->mStats.mLightOverlaps += mGrid.mIndices.size();
+}
+
+/// Upload all grids to the VRAM of the current frame in flight, if they      
+/// changed since that frame last used them, and point each camera's set to   
+/// its grid                                                                  
+/// The GPU must be done with that frame, since its streams and sets change   
+void LightClusters::Upload() {
+   const auto frame = mRenderer->GetFrame();
+   const auto bit = 1u << frame;
+   if (mFresh & bit)
+      return;
+   mFresh |= bit;
+
+   if (not mSections)
+      return;
+
+   auto vram = mBuffers[frame];
+   auto allocated = mAllocated[frame];
+   for (uint32_t s = 0; s < 3; ++s) {
+      const auto bytes = mRAM[s].GetCount() * sizeof(uint32_t);
+      if (allocated[s] < bytes) {
+         // No way to resize VRAM in place, so free the previous buffer 
+         if (vram[s].IsValid())
+            mRenderer->mVRAM.DestroyBuffer(vram[s]);
+
+         // Allocate with some headroom, to avoid doing it every frame  
+         allocated[s] = bytes * 2;
+         vram[s] = mRenderer->mVRAM.CreateBuffer(
+            nullptr, VkDeviceSize {allocated[s]},
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+         );
+      }
+
+      vram[s].Upload(0, bytes, mRAM[s].GetRaw());
+   }
+
+   // Buffers might have been reallocated, so always update the sets    
+   // of this frame - grids are uploaded only along with the draw lists 
+   auto& sets = mSets[frame];
+   while (sets.GetCount() < mSections.GetCount()) {
+      VkDescriptorPool pool {};
+      sets << mRenderer->mLayouts.Allocate(mSetLayout, pool);
+      mPools[frame] << pool;
+   }
+
+   for (Offset i = 0; i < mSections.GetCount(); ++i) {
+      const auto& section = mSections[i];
+      VkDescriptorBufferInfo buffers[3];
+      VkWriteDescriptorSet writes[3] {};
+      for (uint32_t s = 0; s < 3; ++s) {
+         buffers[s] = {
+            vram[s].GetBuffer(), section.mOffsets[s], section.mSizes[s]
+         };
+
+         writes[s].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+         writes[s].dstSet = sets[i];
+         writes[s].dstBinding = s;
+         writes[s].descriptorCount = 1;
+         writes[s].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+         writes[s].pBufferInfo = &buffers[s];
+      }
+
+      vkUpdateDescriptorSets(mRenderer->mDevice, 3, writes, 0, nullptr);
+   }
+}
+
+/// Get the set, that binds the grid of a camera                              
+///   @param camera - the camera, or nullptr if using the default one         
+///   @return the set of the current frame in flight, or a null handle if the 
+///           camera has no grid                                              
+VkDescriptorSet LightClusters::GetSet(const VulkanCamera* camera) const {
+   const auto& sets = mSets[mRenderer->GetFrame()];
+   for (Offset i = 0; i < mSections.GetCount(); ++i) {
+      if (mSections[i].mCamera == camera)
+         return sets[i];
+   }
+   return {};
+}
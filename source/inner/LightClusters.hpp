@@ -0,0 +1,69 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "VulkanBuffer.hpp"
+#include "Lighting.hpp"
+
+
+///                                                                           
+///   Clustered lights                                                        
+///                                                                           
+/// Bins the lights of a forward lit layer into a froxel grid for each of     
+/// its cameras, and uploads the grids as storage buffers. Pipelines of such  
+/// layers bind the grid of the camera they're drawn from at set 3:           
+///   binding 0 - the ClusterHeader, followed by all LightSources             
+///   binding 1 - a ClusterRange for each cluster                             
+///   binding 2 - the light indices, that the ranges refer to                 
+/// Pixel shaders read them by calling LangulusLights, see InjectClusters     
+/// Refilled along with the draw lists. Each frame in flight has its own      
+/// streams and sets, uploaded when that frame comes around                   
+///                                                                           
+struct LightClusters {
+   static constexpr uint32_t SetIndex = 3;
+
+private:
+   VulkanRenderer* mRenderer {};
+   UBOLayout mSetLayout {};
+
+   // Reused between cameras, rebuilt only if the projection changes    
+   ClusterGrid mGrid;
+   float mProjection[16] {};
+
+   // Grids of all cameras of the current draw lists, as 32bit words,   
+   // one stream for each binding                                       
+   TMany<uint32_t> mRAM[3];
+   // A bit for each frame in flight, whose streams hold current grids  
+   uint32_t mFresh {};
+   // The same streams in the VRAM of each frame in flight              
+   VulkanBuffer mBuffers[MaxFramesInFlight][3];
+   Size mAllocated[MaxFramesInFlight][3] {};
+
+   // Where each camera's grid is in the streams, and the set that      
+   // binds it in each frame in flight                                  
+   struct Section {
+      const VulkanCamera* mCamera;
+      uint32_t mOffsets[3];
+      uint32_t mSizes[3];
+   };
+
+   TMany<Section> mSections;
+   TMany<VkDescriptorSet> mSets[MaxFramesInFlight];
+   TMany<VkDescriptorPool> mPools[MaxFramesInFlight];
+
+   void Push(uint32_t, const void*, Size);
+
+public:
+   void Create(VulkanRenderer*);
+   void Destroy();
+   void Clear();
+   void Push(const VulkanCamera*, const Mat4&, const Mat4&, const LightSources&);
+   void Upload();
+
+   NOD() VkDescriptorSet GetSet(const VulkanCamera*) const;
+   NOD() static UBOLayout GetSetLayout(VulkanLayouts&);
+};
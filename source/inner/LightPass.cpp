@@ -0,0 +1,599 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "LightPass.hpp"
+#include "../Vulkan.hpp"
+#include <shaderc/shaderc.hpp>
+
+/// Ambient light of layers that have lights - layers without any lights      
+/// show their albedo as it is                                                
+constexpr float DeferredAmbient = 0.1f;
+
+/// Push constants of the light shaders                                       
+struct LightConstants {
+   float mInverseProjection[16];
+   // Offset and size of the lit area, in pixels                        
+   float mArea[4];
+   LightSource mLight;
+};
+
+/// Draws a triangle, that covers the whole screen                            
+static constexpr char LightVertexShader[] = R"(
+   #version 450
+
+   void main() {
+      const vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+      gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+   }
+)";
+
+/// Lights a single pixel of the G-buffer - lights without range are ambient  
+static constexpr char LightFragmentShader[] = R"(
+   #version 450
+   layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput albedo;
+   layout(input_attachment_index = 1, set = 0, binding = 1) uniform subpassInput normal;
+   layout(input_attachment_index = 2, set = 0, binding = 2) uniform subpassInput depth;
+   layout(set = 0, binding = 3) uniform sampler2D shadowAtlas;
+
+   struct Shadow {
+      mat4 toLight;
+      vec4 faces[6];
+      vec4 depth;
+   };
+
+   layout(std430, set = 0, binding = 4) readonly buffer Shadows {
+      Shadow shadows[];
+   };
+
+   layout(push_constant) uniform Constants {
+      mat4 inverseProjection;
+      vec4 area;
+      vec4 position;
+      vec4 color;
+      ivec4 shadow;
+   };
+
+   layout(location = 0) out vec4 result;
+
+   // Pick the cube face of the light's shadow, same as ShadowFaceMatrix
+   // does, and test the view-space position against it                 
+   float Shadowing(const vec3 view) {
+      if (shadow.x < 0)
+         return 1.0;
+
+      const Shadow s = shadows[shadow.x];
+      const vec3 v = (s.toLight * vec4(view, 1.0)).xyz;
+      const vec3 a = abs(v);
+      int face;
+      float major;
+      vec2 uv;
+      if (a.x >= a.y && a.x >= a.z) {
+         face = v.x > 0.0 ? 0 : 1;
+         major = a.x;
+         uv = vec2(v.x > 0.0 ? -v.z : v.z, -v.y);
+      }
+      else if (a.y >= a.z) {
+         face = v.y > 0.0 ? 2 : 3;
+         major = a.y;
+         uv = vec2(v.x, v.y > 0.0 ? v.z : -v.z);
+      }
+      else {
+         face = v.z > 0.0 ? 4 : 5;
+         major = a.z;
+         uv = vec2(v.z > 0.0 ? v.x : -v.x, -v.y);
+      }
+
+      // Stay half a texel inside the face, so neighbours never bleed in
+      const vec4 rect = s.faces[face];
+      const vec2 texel = 0.5 / vec2(textureSize(shadowAtlas, 0));
+      const vec2 at = clamp(rect.xy + (uv / major * 0.5 + 0.5) * rect.zw,
+         rect.xy + texel, rect.xy + rect.zw - texel);
+
+      const float n = s.depth.x;
+      const float f = s.depth.y;
+      const float z = f / (f - n) - f * n / ((f - n) * major);
+      return texture(shadowAtlas, at).r < z ? 0.0 : 1.0;
+   }
+
+   void main() {
+      // Nothing was drawn where albedo is transparent                  
+      const vec4 surface = subpassLoad(albedo);
+      if (surface.a == 0.0)
+         discard;
+
+      if (position.w <= 0.0) {
+         result = vec4(surface.rgb * color.rgb, surface.a);
+         return;
+      }
+
+      // Reconstruct the view-space position from depth                 
+      const vec2 uv = (gl_FragCoord.xy - area.xy) / area.zw;
+      const vec4 clip = vec4(uv * 2.0 - 1.0, subpassLoad(depth).r, 1.0);
+      const vec4 view = inverseProjection * clip;
+      const vec3 toLight = position.xyz - view.xyz / view.w;
+      const float distance = length(toLight);
+      if (distance >= position.w)
+         discard;
+
+      const vec3 n = normalize(subpassLoad(normal).xyz);
+      const float lambert = max(dot(n, toLight / distance), 0.0);
+      const float falloff = 1.0 - distance / position.w;
+      const float lit = lambert * falloff * falloff * Shadowing(view.xyz / view.w);
+      result = vec4(surface.rgb * color.rgb * lit, 0.0);
+   }
+)";
+
+
+/// Compile a light shader to a module                                        
+///   @param device - the device                                              
+///   @param code - the GLSL code                                             
+///   @param size - the code length                                           
+///   @param kind - the shader stage                                          
+///   @return the module                                                      
+static VkShaderModule CompileLightShader(
+   VkDevice device, const char* code, Size size, shaderc_shader_kind kind
+) {
+   shaderc::Compiler compiler;
+   shaderc::CompileOptions options;
+   const auto assembly = compiler.CompileGlslToSpv(code, size, kind, "light", options);
+   if (assembly.GetCompilationStatus() != shaderc_compilation_status_success) {
+      Logger::Error("Light shader compilation error: ", assembly.GetErrorMessage());
+      LANGULUS_THROW(Graphics, "Light shader compilation failed");
+   }
+
+   VkShaderModuleCreateInfo moduleInfo {};
+   moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+   moduleInfo.codeSize = (assembly.cend() - assembly.cbegin()) * sizeof(uint32_t);
+   moduleInfo.pCode = assembly.cbegin();
+
+   VkShaderModule module {};
+   if (vkCreateShaderModule(device, &moduleInfo, nullptr, &module))
+      LANGULUS_THROW(Graphics, "vkCreateShaderModule failed for light shader");
+   return module;
+}
+
+/// Create the render pass and the light pipelines                            
+/// Must be called after the main pass attachments are defined                
+///   @param renderer - the renderer                                          
+void LightPass::Create(VulkanRenderer* renderer) {
+   mRenderer = renderer;
+   const auto device = renderer->mDevice.Get();
+
+   // Back buffer and depth, same as in the main pass                   
+   TMany<VkAttachmentDescription> attachments;
+   attachments << renderer->mPassAttachments[0];
+   attachments << renderer->mPassAttachments[1];
+
+   // Albedo and normals are never stored, they live only in the pass   
+   VkAttachmentDescription gbuffer {};
+   gbuffer.format = VK_FORMAT_B8G8R8A8_UNORM;
+   gbuffer.samples = VK_SAMPLE_COUNT_1_BIT;
+   gbuffer.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+   gbuffer.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+   gbuffer.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+   gbuffer.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+   gbuffer.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+   gbuffer.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+   mGBuffer.Clear();
+   mGBuffer << gbuffer;
+   gbuffer.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+   mGBuffer << gbuffer;
+   for (const auto& it : mGBuffer)
+      attachments << it;
+
+   // The G-buffer subpass writes albedo, normals and depth             
+   const VkAttachmentReference gbufferRefs[] {
+      {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+      {3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}
+   };
+   const VkAttachmentReference depthRef {
+      1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+   };
+
+   // The light subpass reads them, and writes to the back buffer       
+   const VkAttachmentReference inputRefs[] {
+      {2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+      {3, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+      {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL}
+   };
+   const VkAttachmentReference colorRef {
+      0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+   };
+
+   VkSubpassDescription subpasses[2] {};
+   subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+   subpasses[0].colorAttachmentCount = 2;
+   subpasses[0].pColorAttachments = gbufferRefs;
+   subpasses[0].pDepthStencilAttachment = &depthRef;
+   subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+   subpasses[1].inputAttachmentCount = 3;
+   subpasses[1].pInputAttachments = inputRefs;
+   subpasses[1].colorAttachmentCount = 1;
+   subpasses[1].pColorAttachments = &colorRef;
+
+   VkSubpassDependency dependencies[2] {};
+   // Same as the main pass' dependency                                 
+   dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+   dependencies[0].dstSubpass = 0;
+   dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                                | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+   dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                 | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+   dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                                | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+   dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+                                 | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                 | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+                                 | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+   // Region-local, so tiled GPUs never leave the tile between subpasses
+   dependencies[1].srcSubpass = 0;
+   dependencies[1].dstSubpass = 1;
+   dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                                | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+   dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                 | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+   dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+   dependencies[1].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+   dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+   VkRenderPassCreateInfo passInfo {};
+   passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+   passInfo.attachmentCount = static_cast<uint32_t>(attachments.GetCount());
+   passInfo.pAttachments = attachments.GetRaw();
+   passInfo.subpassCount = 2;
+   passInfo.pSubpasses = subpasses;
+   passInfo.dependencyCount = 2;
+   passInfo.pDependencies = dependencies;
+
+   if (vkCreateRenderPass(device, &passInfo, nullptr, &mPass.Get()))
+      LANGULUS_THROW(Graphics, "Can't create deferred lights pass");
+
+   // Same as the main loading pass, the G-buffer is still cleared      
+   for (int i = 0; i < 2; ++i) {
+      attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+      attachments[i].initialLayout = attachments[i].finalLayout;
+   }
+
+   if (vkCreateRenderPass(device, &passInfo, nullptr, &mLoadPass.Get()))
+      LANGULUS_THROW(Graphics, "Can't create deferred lights loading pass");
+
+   // Albedo, normals, and depth as input attachments, followed by the  
+   // shadow atlas and the shadow records                               
+   Bindings bindings;
+   for (uint32_t i = 0; i < 5; ++i) {
+      VkDescriptorSetLayoutBinding info {};
+      info.binding = i;
+      info.descriptorType = i < 3 ? VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT
+         : i == 3 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+         : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      info.descriptorCount = 1;
+      info.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+      bindings << info;
+   }
+
+   mSetLayout = renderer->mLayouts.GetSetLayout(bindings);
+   for (uint32_t frame = 0; frame < renderer->mFramesInFlight; ++frame)
+      mSet[frame] = renderer->mLayouts.Allocate(mSetLayout, mPool[frame]);
+
+   // Each light is pushed as constants, layouts with push constants    
+   // aren't shared, so this one is owned here                          
+   VkPushConstantRange constants {};
+   constants.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+   constants.size = sizeof(LightConstants);
+
+   VkPipelineLayoutCreateInfo layoutInfo {};
+   layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+   layoutInfo.setLayoutCount = 1;
+   layoutInfo.pSetLayouts = &mSetLayout;
+   layoutInfo.pushConstantRangeCount = 1;
+   layoutInfo.pPushConstantRanges = &constants;
+
+   if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &mPipeLayout.Get()))
+      LANGULUS_THROW(Graphics, "Can't create light pipeline layout");
+
+   Shader stages[2] {};
+   stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+   stages[0].module = CompileLightShader(device, LightVertexShader,
+      sizeof(LightVertexShader) - 1, shaderc_glsl_vertex_shader);
+   stages[0].pName = "main";
+   stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+   try {
+      stages[1].module = CompileLightShader(device, LightFragmentShader,
+         sizeof(LightFragmentShader) - 1, shaderc_glsl_fragment_shader);
+   }
+   catch (...) {
+      vkDestroyShaderModule(device, stages[0].module, nullptr);
+      throw;
+   }
+   stages[1].pName = "main";
+
+   try {
+      mAmbientPipeline = CreatePipeline(stages, false);
+      mLightPipeline = CreatePipeline(stages, true);
+   }
+   catch (...) {
+      vkDestroyShaderModule(device, stages[0].module, nullptr);
+      vkDestroyShaderModule(device, stages[1].module, nullptr);
+      throw;
+   }
+
+   vkDestroyShaderModule(device, stages[0].module, nullptr);
+   vkDestroyShaderModule(device, stages[1].module, nullptr);
+}
+
+/// Create a pipeline for the light subpass                                   
+///   @param stages - the vertex and fragment stages                          
+///   @param additive - whether to add to the back buffer, or overwrite it    
+///   @return the pipeline                                                    
+VkPipeline LightPass::CreatePipeline(const Shader* stages, bool additive) const {
+   VkPipelineVertexInputStateCreateInfo input {};
+   input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+   VkPipelineInputAssemblyStateCreateInfo assembly {};
+   assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+   assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+   VkPipelineViewportStateCreateInfo viewportState {};
+   viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+   viewportState.viewportCount = 1;
+   viewportState.scissorCount = 1;
+
+   VkPipelineRasterizationStateCreateInfo rasterizer {};
+   rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+   rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+   rasterizer.cullMode = VK_CULL_MODE_NONE;
+   rasterizer.lineWidth = 1.0f;
+
+   VkPipelineMultisampleStateCreateInfo multisampling {};
+   multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+   multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+   // Lights only add color, the ambient pass decides the alpha         
+   VkPipelineColorBlendAttachmentState blend {};
+   blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT
+      | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT;
+   if (additive) {
+      blend.blendEnable = VK_TRUE;
+      blend.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+      blend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+      blend.colorBlendOp = VK_BLEND_OP_ADD;
+   }
+   else blend.colorWriteMask |= VK_COLOR_COMPONENT_A_BIT;
+
+   VkPipelineColorBlendStateCreateInfo colorBlending {};
+   colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+   colorBlending.attachmentCount = 1;
+   colorBlending.pAttachments = &blend;
+
+   const VkDynamicState dynamicStates[] {
+      VK_DYNAMIC_STATE_VIEWPORT,
+      VK_DYNAMIC_STATE_SCISSOR
+   };
+
+   VkPipelineDynamicStateCreateInfo dynamicState {};
+   dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+   dynamicState.dynamicStateCount = 2;
+   dynamicState.pDynamicStates = dynamicStates;
+
+   VkGraphicsPipelineCreateInfo pipelineInfo {};
+   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+   pipelineInfo.stageCount = 2;
+   pipelineInfo.pStages = stages;
+   pipelineInfo.pVertexInputState = &input;
+   pipelineInfo.pInputAssemblyState = &assembly;
+   pipelineInfo.pViewportState = &viewportState;
+   pipelineInfo.pRasterizationState = &rasterizer;
+   pipelineInfo.pMultisampleState = &multisampling;
+   pipelineInfo.pColorBlendState = &colorBlending;
+   pipelineInfo.pDynamicState = &dynamicState;
+   pipelineInfo.layout = mPipeLayout;
+   pipelineInfo.renderPass = mPass;
+   pipelineInfo.subpass = 1;
+
+   VkPipeline pipeline {};
+   if (vkCreateGraphicsPipelines(mRenderer->mDevice, mRenderer->mPipelineCache,
+      1, &pipelineInfo, nullptr, &pipeline))
+      LANGULUS_THROW(Graphics, "Can't create light pipeline");
+   return pipeline;
+}
+
+/// Destroy the render pass and the light pipelines                           
+void LightPass::Destroy() {
+   if (not mRenderer)
+      return;
+
+   const auto device = mRenderer->mDevice.Get();
+   if (mAmbientPipeline) {
+      vkDestroyPipeline(device, mAmbientPipeline, nullptr);
+      mAmbientPipeline.Reset();
+   }
+
+   if (mLightPipeline) {
+      vkDestroyPipeline(device, mLightPipeline, nullptr);
+      mLightPipeline.Reset();
+   }
+
+   if (mPipeLayout) {
+      vkDestroyPipelineLayout(device, mPipeLayout, nullptr);
+      mPipeLayout.Reset();
+   }
+
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      if (mSet[frame]) {
+         mRenderer->mLayouts.Free(mPool[frame], mSet[frame]);
+         mSet[frame].Reset();
+      }
+   }
+
+   if (mPass) {
+      vkDestroyRenderPass(device, mPass, nullptr);
+      mPass.Reset();
+   }
+
+   if (mLoadPass) {
+      vkDestroyRenderPass(device, mLoadPass, nullptr);
+      mLoadPass.Reset();
+   }
+
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      for (auto& view : mBoundViews[frame])
+         view = {};
+      mBoundShadows[frame] = {};
+   }
+   mGBuffer.Reset();
+   mRenderer = nullptr;
+}
+
+/// Point the input attachments of the current frame in flight's set to the   
+/// swapchain's current G-buffer, and the shadow bindings to the current      
+/// shadow atlas and the frame's records                                      
+/// The views change only when the swapchain is recreated, and the atlas      
+/// and records only while compiling, neither of which happens while          
+/// recording, so the set is never updated after being bound                  
+void LightPass::UpdateSet() const {
+   const auto frame = mRenderer->GetFrame();
+   const auto& swapchain = mRenderer->mSwapchain;
+   const auto& shadows = mRenderer->mShadows;
+   const VkImageView views[4] {
+      swapchain.GetAlbedoView(),
+      swapchain.GetNormalView(),
+      swapchain.GetDepthView(),
+      shadows.GetView()
+   };
+   const VkBuffer records = shadows.GetRecords();
+
+   if (0 == ::std::memcmp(views, mBoundViews[frame], sizeof(views))
+   and records == mBoundShadows[frame])
+      return;
+
+   VkDescriptorImageInfo images[4] {};
+   VkWriteDescriptorSet writes[5] {};
+   for (uint32_t i = 0; i < 4; ++i) {
+      images[i].imageView = views[i];
+      images[i].imageLayout = i >= 2
+         ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+         : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+      writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[i].dstSet = mSet[frame];
+      writes[i].dstBinding = i;
+      writes[i].descriptorCount = 1;
+      writes[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+      writes[i].pImageInfo = &images[i];
+   }
+
+   images[3].sampler = shadows.GetSampler();
+   writes[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+   VkDescriptorBufferInfo buffer {};
+   buffer.buffer = records;
+   buffer.range = VK_WHOLE_SIZE;
+   writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+   writes[4].dstSet = mSet[frame];
+   writes[4].dstBinding = 4;
+   writes[4].descriptorCount = 1;
+   writes[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+   writes[4].pBufferInfo = &buffer;
+
+   vkUpdateDescriptorSets(mRenderer->mDevice, 5, writes, 0, nullptr);
+   ::std::memcpy(mBoundViews[frame], views, sizeof(views));
+   mBoundShadows[frame] = records;
+}
+
+/// Advance to the light subpass, and draw all lights                         
+/// Must be recorded right after the G-buffer subpass of a deferred layer     
+///   @param state - the command buffer state                                 
+///   @param area - the rendered area, in pixels                              
+///   @param projection - the projection of the lit level                     
+///   @param slice - the slice of the depth range, the lit level was drawn in 
+///   @param lights - the lights, relative to the view of the lit level       
+///   @param count - the number of lights                                     
+void LightPass::Render(
+   CommandState& state, const VkRect2D& area, const Mat4& projection,
+   const DepthSlice& slice, const LightSource* lights, Count count
+) const {
+   const auto commands = state.GetCommands();
+   vkCmdNextSubpass(commands, VK_SUBPASS_CONTENTS_INLINE);
+   UpdateSet();
+
+   LightConstants constants {};
+   MatrixToFloats(projection.Invert(), constants.mInverseProjection);
+   slice.Unapply(constants.mInverseProjection);
+   constants.mArea[0] = static_cast<float>(area.offset.x);
+   constants.mArea[1] = static_cast<float>(area.offset.y);
+   constants.mArea[2] = static_cast<float>(area.extent.width);
+   constants.mArea[3] = static_cast<float>(area.extent.height);
+
+   // The ambient light overwrites everything that was drawn            
+   const float ambient = count ? DeferredAmbient : 1.0f;
+   constants.mLight = {{0, 0, 0, 0}, {ambient, ambient, ambient, 1}};
+   state.BindPipeline(mAmbientPipeline);
+   state.BindSet(mPipeLayout, 0, mSet[mRenderer->GetFrame()]);
+   vkCmdSetScissor(commands, 0, 1, &area);
+   vkCmdPushConstants(commands, mPipeLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+      0, sizeof(constants), &constants);
+   vkCmdDraw(commands, 3, 1, 0, 0);
+
+   if (not count)
+      return;
+
+   // Each light adds to the pixels inside its range                    
+   float m[16];
+   MatrixToFloats(projection, m);
+   state.BindPipeline(mLightPipeline);
+
+   for (Count i = 0; i < count; ++i) {
+      const auto& light = lights[i];
+      float rect[4];
+      if (not ProjectSphere(m, light.mPosition, light.mPosition[3], rect))
+         continue;
+
+      // Normalized device coordinates to pixels of the area            
+      const auto w = static_cast<float>(area.extent.width);
+      const auto h = static_cast<float>(area.extent.height);
+      const auto x0 = static_cast<int32_t>((rect[0] * 0.5f + 0.5f) * w);
+      const auto y0 = static_cast<int32_t>((rect[1] * 0.5f + 0.5f) * h);
+      const auto x1 = static_cast<int32_t>(::std::ceil((rect[2] * 0.5f + 0.5f) * w));
+      const auto y1 = static_cast<int32_t>(::std::ceil((rect[3] * 0.5f + 0.5f) * h));
+      if (x1 <= x0 or y1 <= y0)
+         continue;
+
+      const VkRect2D scissor {
+         {area.offset.x + x0, area.offset.y + y0},
+         {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)}
+      };
+
+      constants.mLight = light;
+      vkCmdSetScissor(commands, 0, 1, &scissor);
+      vkCmdPushConstants(commands, mPipeLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+         0, sizeof(constants), &constants);
+      vkCmdDraw(commands, 3, 1, 0, 0);
+      ++mRenderer->mStats.mLightsDrawn;
+   }
+}
+
+/// Get the render pass, that all pipelines of deferred layers draw in        
+///   @return the render pass                                                 
+VkRenderPass LightPass::GetPass() const noexcept {
+   return mPass;
+}
+
+/// Get the render pass, that deferred layers draw in, when they must keep    
+/// what was drawn to the back buffer before them                             
+///   @return the render pass, compatible with the one from GetPass()         
+VkRenderPass LightPass::GetLoadPass() const noexcept {
+   return mLoadPass;
+}
+
+/// Get the G-buffer attachments, that pipelines of deferred layers write     
+///   @return the albedo and normals attachment descriptions                  
+const TMany<VkAttachmentDescription>& LightPass::GetGBuffer() const noexcept {
+   return mGBuffer;
+}
@@ -0,0 +1,59 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "CommandState.hpp"
+#include "Lighting.hpp"
+#include "DepthSlice.hpp"
+
+
+///                                                                           
+///   Deferred light pass                                                     
+///                                                                           
+/// A render pass of two subpasses, used by layers with deferred lights.      
+/// The first one fills a G-buffer of albedo and normals, along with depth.   
+/// The second one reads them back as input attachments, so that tiled GPUs   
+/// can keep the whole G-buffer on-chip, and accumulates all lights into      
+/// the back buffer. Each light is drawn only inside the screen rectangle     
+/// its range covers, so lighting cost scales with lit pixels. Lights with    
+/// shadows test against their cube faces in the renderer's ShadowAtlas       
+///                                                                           
+struct LightPass {
+private:
+   VulkanRenderer* mRenderer {};
+
+   // The render pass, and the G-buffer attachments it writes           
+   Own<VkRenderPass> mPass;
+   // Same, but loads the back buffer and depth, instead of clearing    
+   Own<VkRenderPass> mLoadPass;
+   TMany<VkAttachmentDescription> mGBuffer;
+
+   // The light pipelines, and the input attachments they read          
+   UBOLayout mSetLayout {};
+   Own<VkPipelineLayout> mPipeLayout;
+   Own<VkPipeline> mAmbientPipeline;
+   Own<VkPipeline> mLightPipeline;
+   // A set for each frame in flight, since each has its own records    
+   Own<VkDescriptorSet> mSet[MaxFramesInFlight];
+   VkDescriptorPool mPool[MaxFramesInFlight] {};
+
+   // The views and records that are currently in each set              
+   mutable VkImageView mBoundViews[MaxFramesInFlight][4] {};
+   mutable VkBuffer mBoundShadows[MaxFramesInFlight] {};
+
+   NOD() VkPipeline CreatePipeline(const Shader*, bool additive) const;
+   void UpdateSet() const;
+
+public:
+   void Create(VulkanRenderer*);
+   void Destroy();
+   void Render(CommandState&, const VkRect2D&, const Mat4&, const DepthSlice&, const LightSource*, Count) const;
+
+   NOD() VkRenderPass GetPass() const noexcept;
+   NOD() VkRenderPass GetLoadPass() const noexcept;
+   NOD() const TMany<VkAttachmentDescription>& GetGBuffer() const noexcept;
+};
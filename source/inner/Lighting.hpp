@@ -0,0 +1,499 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "Glsl.hpp"
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) or defined(_M_X64) or defined(_M_AMD64)
+   #include <emmintrin.h>
+   #define VULKAN_CLUSTERS_SSE 1
+   #define VULKAN_CLUSTERS_NEON 0
+#elif defined(__ARM_NEON) or defined(_M_ARM64)
+   #include <arm_neon.h>
+   #define VULKAN_CLUSTERS_SSE 0
+   #define VULKAN_CLUSTERS_NEON 1
+#else
+   #define VULKAN_CLUSTERS_SSE 0
+   #define VULKAN_CLUSTERS_NEON 0
+#endif
+
+#define VULKAN_CLUSTERS_SIMD (VULKAN_CLUSTERS_SSE or VULKAN_CLUSTERS_NEON)
+
+
+///                                                                           
+///   A point light, as seen by the light shaders                             
+///                                                                           
+/// Position is relative to the view of the level being lit, and the light    
+/// has no effect beyond its range. The layout matches std430                 
+///                                                                           
+struct LightSource {
+   // View-space position in xyz, range in w                            
+   float mPosition[4];
+   // Color, premultiplied by intensity, in rgb                         
+   float mColor[4];
+   // Index of the light's ShadowRecord, or -1 if it casts no shadows   
+   int32_t mShadow = -1;
+   int32_t mPadding[3] {};
+};
+
+using LightSources = ::std::vector<LightSource>;
+
+
+/// Find the screen rectangle, that a sphere covers                           
+/// Spheres that cross the near plane cover the whole screen                  
+///   @param projection - the column-major projection matrix                  
+///   @param center - the view-space sphere center                            
+///   @param radius - the sphere radius                                       
+///   @param rect - [out] min x, min y, max x, max y in normalized device     
+///                 coordinates, clamped to the [-1;1] range                  
+///   @return false if the sphere is completely off screen                    
+inline bool ProjectSphere(
+   const float* projection, const float* center, float radius, float* rect
+) {
+   // Project the corners of the sphere's bounding box                  
+   const auto& m = projection;
+   constexpr auto infinity = ::std::numeric_limits<float>::infinity();
+   float minX = infinity, minY = infinity, maxX = -infinity, maxY = -infinity;
+   int behind = 0;
+   for (int corner = 0; corner < 8; ++corner) {
+      const float p[3] {
+         center[0] + (corner & 1 ? radius : -radius),
+         center[1] + (corner & 2 ? radius : -radius),
+         center[2] + (corner & 4 ? radius : -radius)
+      };
+
+      const auto w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+      if (w <= 0) {
+         ++behind;
+         continue;
+      }
+
+      const auto x = (m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12]) / w;
+      const auto y = (m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13]) / w;
+      minX = ::std::min(minX, x);
+      maxX = ::std::max(maxX, x);
+      minY = ::std::min(minY, y);
+      maxY = ::std::max(maxY, y);
+   }
+
+   if (behind == 8)
+      return false;
+
+   if (behind) {
+      // Crosses the near plane, projection is unreliable               
+      rect[0] = rect[1] = -1;
+      rect[2] = rect[3] = 1;
+      return true;
+   }
+
+   if (maxX < -1 or maxY < -1 or minX > 1 or minY > 1)
+      return false;
+
+   rect[0] = ::std::max(minX, -1.0f);
+   rect[1] = ::std::max(minY, -1.0f);
+   rect[2] = ::std::min(maxX, 1.0f);
+   rect[3] = ::std::min(maxY, 1.0f);
+   return true;
+}
+
+
+///                                                                           
+///   Parameters of a cluster grid, as seen by the forward shaders            
+///                                                                           
+/// A fragment's cluster is found by its normalized device x and y, mapped    
+/// to Width x Height tiles, and by its view-space depth along mAxis, mapped  
+/// to Depth exponential slices:                                              
+///   slice = clamp(floor(log(depth / mNear) * mScale), 0, Depth - 1)         
+/// The layout matches std430                                                 
+///                                                                           
+struct ClusterHeader {
+   // The column-major projection, that the grid was built for          
+   float mProjection[16];
+   float mAxis[3];
+   float mNear;
+   float mScale;
+   uint32_t mWidth;
+   uint32_t mHeight;
+   uint32_t mDepth;
+};
+
+
+///                                                                           
+///   The lights of a single cluster, as a range in the light index list      
+///                                                                           
+struct ClusterRange {
+   uint32_t mOffset;
+   uint32_t mCount;
+};
+
+
+///                                                                           
+///   A froxel grid                                                           
+///                                                                           
+/// Divides a camera's view frustum into clusters - screen tiles, sliced      
+/// exponentially by depth - and bins point lights into the clusters they     
+/// touch. Forward shaders then iterate only the lights of their fragment's   
+/// cluster, so lighting cost doesn't grow with the number of lights in the   
+/// scene, but with the number of lights that overlap. Clusters are tested    
+/// against lights four at a time, where SSE2 or NEON is available, falling   
+/// back to one at a time otherwise                                           
+///                                                                           
+struct ClusterGrid {
+   static constexpr uint32_t Width = 16;
+   static constexpr uint32_t Height = 9;
+   static constexpr uint32_t Depth = 24;
+   static constexpr uint32_t Count = Width * Height * Depth;
+
+   ClusterHeader mHeader {};
+   // Light ranges of each cluster, and the light indices they refer to 
+   ::std::vector<ClusterRange> mRanges;
+   ::std::vector<uint32_t> mIndices;
+
+   /// Get the index of a cluster                                             
+   ///   @param x, y - the screen tile                                        
+   ///   @param z - the depth slice                                           
+   ///   @return the index of the cluster                                     
+   static constexpr uint32_t Index(uint32_t x, uint32_t y, uint32_t z) noexcept {
+      return (z * Height + y) * Width + x;
+   }
+
+   /// Get the depth slice, that contains a view-space depth                  
+   ///   @param depth - the depth along the view axis                         
+   ///   @return the slice                                                    
+   uint32_t SliceOf(float depth) const noexcept {
+      if (depth <= mHeader.mNear)
+         return 0;
+      const auto slice = ::std::log(depth / mHeader.mNear) * mHeader.mScale;
+      return static_cast<uint32_t>(::std::min(slice, Depth - 1.0f));
+   }
+
+   void Build(const float* projection, const float* inverseProjection);
+   void Assign(const LightSources&, bool simd = VULKAN_CLUSTERS_SIMD);
+
+private:
+   // View-space bounds of all clusters, as structures of arrays, so    
+   // that consecutive clusters in a row can be loaded at once. Padded  
+   // by three, so that the last ones can be loaded too                 
+   ::std::vector<float> mMin[3];
+   ::std::vector<float> mMax[3];
+   // Depth of each slice's near side, and the far side of the last one 
+   float mSlices[Depth + 1] {};
+   // Cluster and light index of each overlap, reused every frame       
+   ::std::vector<uint64_t> mOverlaps;
+
+   uint32_t TestRow(uint32_t, uint32_t, const float*, float, bool) const noexcept;
+};
+
+/// Divide the frustum of a projection into clusters                          
+/// Must be called whenever the projection changes, before assigning lights   
+///   @param projection - the column-major projection matrix                  
+///   @param inverseProjection - its inverse                                  
+inline void ClusterGrid::Build(
+   const float* projection, const float* inverseProjection
+) {
+   ::std::copy(projection, projection + 16, mHeader.mProjection);
+
+   // Bring a point from normalized device to view space                
+   const auto& m = inverseProjection;
+   auto unproject = [m](float x, float y, float z, float* out) {
+      const auto w = m[3] * x + m[7] * y + m[11] * z + m[15];
+      out[0] = (m[0] * x + m[4] * y + m[8] * z + m[12]) / w;
+      out[1] = (m[1] * x + m[5] * y + m[9] * z + m[13]) / w;
+      out[2] = (m[2] * x + m[6] * y + m[10] * z + m[14]) / w;
+   };
+   auto dot = [](const float* a, const float* b) {
+      return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+   };
+
+   // The view axis goes from the center of the near plane to the far   
+   // one. Reversed depth swaps the planes, so orient it by distance    
+   float nearCenter[3], farCenter[3];
+   unproject(0, 0, 0, nearCenter);
+   unproject(0, 0, 1, farCenter);
+   auto& axis = mHeader.mAxis;
+   for (int i = 0; i < 3; ++i)
+      axis[i] = farCenter[i] - nearCenter[i];
+   const auto length = ::std::sqrt(dot(axis, axis));
+   for (int i = 0; i < 3; ++i)
+      axis[i] /= length;
+
+   auto nearDepth = dot(nearCenter, axis);
+   auto farDepth = dot(farCenter, axis);
+   if (::std::abs(nearDepth) > ::std::abs(farDepth)) {
+      for (int i = 0; i < 3; ++i)
+         axis[i] = -axis[i];
+      ::std::swap(nearDepth, farDepth);
+      nearDepth = -nearDepth;
+      farDepth = -farDepth;
+   }
+
+   // Slices are exponential, so that clusters stay roughly cubic.      
+   // Orthographic projections might start at zero depth, so the first  
+   // slice is stretched to cover it                                    
+   mHeader.mNear = ::std::max(nearDepth, farDepth / 1000);
+   mHeader.mScale = Depth / ::std::log(farDepth / mHeader.mNear);
+   mHeader.mWidth = Width;
+   mHeader.mHeight = Height;
+   mHeader.mDepth = Depth;
+
+   for (uint32_t z = 0; z <= Depth; ++z)
+      mSlices[z] = mHeader.mNear * ::std::pow(farDepth / mHeader.mNear, float(z) / Depth);
+   mSlices[0] = nearDepth;
+
+   // Unproject the tile corners on both planes, and find the bounds    
+   // of each cluster by intersecting the corner lines with the slices  
+   constexpr uint32_t corners = (Width + 1) * (Height + 1);
+   float nearCorners[corners][3], farCorners[corners][3];
+   for (uint32_t y = 0; y <= Height; ++y) {
+      for (uint32_t x = 0; x <= Width; ++x) {
+         const auto nx = 2.0f * x / Width - 1;
+         const auto ny = 2.0f * y / Height - 1;
+         unproject(nx, ny, 0, nearCorners[y * (Width + 1) + x]);
+         unproject(nx, ny, 1, farCorners[y * (Width + 1) + x]);
+      }
+   }
+
+   auto pointAt = [&](uint32_t corner, float depth, float* out) {
+      const auto a = nearCorners[corner];
+      const auto b = farCorners[corner];
+      const float d[3] {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      const auto t = (depth - dot(a, axis)) / dot(d, axis);
+      for (int i = 0; i < 3; ++i)
+         out[i] = a[i] + d[i] * t;
+   };
+
+   for (int i = 0; i < 3; ++i) {
+      mMin[i].assign(Count + 3, 0);
+      mMax[i].assign(Count + 3, 0);
+   }
+
+   constexpr auto infinity = ::std::numeric_limits<float>::infinity();
+   for (uint32_t z = 0; z < Depth; ++z) {
+      for (uint32_t y = 0; y < Height; ++y) {
+         for (uint32_t x = 0; x < Width; ++x) {
+            const auto index = Index(x, y, z);
+            float lo[3] {infinity, infinity, infinity};
+            float hi[3] {-infinity, -infinity, -infinity};
+
+            for (uint32_t c = 0; c < 8; ++c) {
+               const auto corner = (y + (c >> 1 & 1)) * (Width + 1) + x + (c & 1);
+               float p[3];
+               pointAt(corner, mSlices[z + (c >> 2)], p);
+               for (int i = 0; i < 3; ++i) {
+                  lo[i] = ::std::min(lo[i], p[i]);
+                  hi[i] = ::std::max(hi[i], p[i]);
+               }
+            }
+
+            for (int i = 0; i < 3; ++i) {
+               mMin[i][index] = lo[i];
+               mMax[i][index] = hi[i];
+            }
+         }
+      }
+   }
+}
+
+/// Test a sphere against a row of consecutive clusters                       
+///   @param first - index of the first cluster                               
+///   @param count - number of clusters to test, at most four                 
+///   @param center - the view-space sphere center                            
+///   @param radius2 - the squared sphere radius                              
+///   @param simd - whether to test all four clusters at once                 
+///   @return a bit for each overlapping cluster                              
+inline uint32_t ClusterGrid::TestRow(
+   uint32_t first, uint32_t count, const float* center, float radius2, bool simd
+) const noexcept {
+   #if VULKAN_CLUSTERS_SSE
+      if (simd) {
+         // Squared distance from the sphere center to each box         
+         const auto zero = _mm_setzero_ps();
+         auto distance = zero;
+         for (int i = 0; i < 3; ++i) {
+            const auto c = _mm_set1_ps(center[i]);
+            const auto below = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMin[i][first]), c), zero);
+            const auto above = _mm_max_ps(_mm_sub_ps(c, _mm_loadu_ps(&mMax[i][first])), zero);
+            const auto d = _mm_add_ps(below, above);
+            distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+         }
+
+         const auto mask = static_cast<uint32_t>(_mm_movemask_ps(
+            _mm_cmple_ps(distance, _mm_set1_ps(radius2))));
+         return mask & ((1u << count) - 1);
+      }
+   #elif VULKAN_CLUSTERS_NEON
+      if (simd) {
+         // Squared distance from the sphere center to each box         
+         const auto zero = vdupq_n_f32(0);
+         auto distance = zero;
+         for (int i = 0; i < 3; ++i) {
+            const auto c = vdupq_n_f32(center[i]);
+            const auto below = vmaxq_f32(vsubq_f32(vld1q_f32(&mMin[i][first]), c), zero);
+            const auto above = vmaxq_f32(vsubq_f32(c, vld1q_f32(&mMax[i][first])), zero);
+            const auto d = vaddq_f32(below, above);
+            distance = vaddq_f32(distance, vmulq_f32(d, d));
+         }
+
+         // Gather a bit of each lane, like _mm_movemask_ps             
+         static constexpr uint32_t Bits[4] {1, 2, 4, 8};
+         const auto bits = vandq_u32(
+            vcleq_f32(distance, vdupq_n_f32(radius2)), vld1q_u32(Bits));
+         const auto pairs = vpadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+         const auto mask = vget_lane_u32(vpadd_u32(pairs, pairs), 0);
+         return mask & ((1u << count) - 1);
+      }
+   #endif
+
+   uint32_t mask = 0;
+   for (uint32_t x = 0; x < count; ++x) {
+      float distance = 0;
+      for (int i = 0; i < 3; ++i) {
+         const auto d = ::std::max(mMin[i][first + x] - center[i], 0.0f)
+                      + ::std::max(center[i] - mMax[i][first + x], 0.0f);
+         distance += d * d;
+      }
+      mask |= static_cast<uint32_t>(distance <= radius2) << x;
+   }
+   return mask;
+}
+
+/// Bin lights into the clusters they overlap                                 
+///   @param lights - the lights, with view-space positions                   
+///   @param simd - whether to test four clusters at once, or one by one      
+inline void ClusterGrid::Assign(const LightSources& lights, bool simd) {
+   mOverlaps.clear();
+   mRanges.assign(Count, {});
+   mIndices.clear();
+
+   const auto& axis = mHeader.mAxis;
+   for (uint32_t l = 0; l < lights.size(); ++l) {
+      const auto center = lights[l].mPosition;
+      const auto radius = center[3];
+      const auto depth = center[0] * axis[0] + center[1] * axis[1] + center[2] * axis[2];
+      if (depth + radius < mSlices[0] or depth - radius > mSlices[Depth])
+         continue;
+
+      // Narrow down to the clusters, that the light's bounds cover     
+      float rect[4];
+      if (not ProjectSphere(mHeader.mProjection, center, radius, rect))
+         continue;
+
+      auto tile = [](float ndc, uint32_t count) {
+         const auto t = static_cast<int>((ndc * 0.5f + 0.5f) * count);
+         return static_cast<uint32_t>(::std::clamp(t, 0, int(count) - 1));
+      };
+
+      const auto x0 = tile(rect[0], Width), x1 = tile(rect[2], Width);
+      const auto y0 = tile(rect[1], Height), y1 = tile(rect[3], Height);
+      const auto z0 = SliceOf(depth - radius), z1 = SliceOf(depth + radius);
+      const auto radius2 = radius * radius;
+
+      for (uint32_t z = z0; z <= z1; ++z) {
+         for (uint32_t y = y0; y <= y1; ++y) {
+            for (uint32_t x = x0; x <= x1; x += simd ? 4 : 1) {
+               const auto first = Index(x, y, z);
+               const auto count = simd ? ::std::min(x1 - x + 1, 4u) : 1u;
+               auto mask = TestRow(first, count, center, radius2, simd);
+               for (uint32_t bit = 0; mask; ++bit, mask >>= 1) {
+                  if (mask & 1) {
+                     mOverlaps.push_back(
+                        (static_cast<uint64_t>(first + bit) << 32) | l);
+                  }
+               }
+            }
+         }
+      }
+   }
+
+   // Count the lights of each cluster, and pack their indices in       
+   // cluster order - lights keep their order inside a cluster          
+   for (auto overlap : mOverlaps)
+      ++mRanges[overlap >> 32].mCount;
+
+   uint32_t offset = 0;
+   for (auto& range : mRanges) {
+      range.mOffset = offset;
+      offset += range.mCount;
+      range.mCount = 0;
+   }
+
+   mIndices.resize(offset);
+   for (auto overlap : mOverlaps) {
+      auto& range = mRanges[overlap >> 32];
+      mIndices[range.mOffset + range.mCount++] = static_cast<uint32_t>(overlap);
+   }
+}
+
+/// Declare the clustered lights in a pixel shader of a forward lit layer,    
+/// along with a function, that lights a surface by the lights of its         
+/// cluster, the same way the deferred light pass does:                       
+///   vec3 LangulusLights(vec3 position, vec3 normal)                         
+/// Position and normal are in view space, and the result is the light, that  
+/// reaches the surface. Only shaders, that call the function, get anything   
+/// injected, since the buffers are bound only to pipelines of such layers    
+///   @param code - the GLSL code of the pixel shader                         
+///   @param set - the descriptor set of the clusters                         
+///   @return the new code                                                    
+inline ::std::string InjectClusters(::std::string_view code, int set) {
+   ::std::string result {code};
+   if (GlslFindWord(code, "LangulusLights") == ::std::string_view::npos)
+      return result;
+
+   const auto layout = "layout(std430, set = " + ::std::to_string(set) + ", binding = ";
+   result.insert(GlslHeaderEnd(result),
+      "struct LangulusLight {\n"
+      "   vec4 position;\n"
+      "   vec4 color;\n"
+      "   ivec4 shadow;\n"
+      "};\n"
+    + layout + "0) readonly buffer LangulusClusterHeader {\n"
+      "   mat4 LangulusClusterProjection;\n"
+      "   vec3 LangulusClusterAxis;\n"
+      "   float LangulusClusterNear;\n"
+      "   float LangulusClusterScale;\n"
+      "   uint LangulusClusterWidth;\n"
+      "   uint LangulusClusterHeight;\n"
+      "   uint LangulusClusterDepth;\n"
+      "   LangulusLight LangulusClusterLights[];\n"
+      "};\n"
+    + layout + "1) readonly buffer LangulusClusterRanges {\n"
+      "   uvec2 LangulusClusterRange[];\n"
+      "};\n"
+    + layout + "2) readonly buffer LangulusClusterIndices {\n"
+      "   uint LangulusClusterIndex[];\n"
+      "};\n"
+      "vec3 LangulusLights(vec3 position, vec3 normal) {\n"
+      "   const vec4 clip = LangulusClusterProjection * vec4(position, 1.0);\n"
+      "   const vec2 tiles = vec2(LangulusClusterWidth, LangulusClusterHeight);\n"
+      "   const uvec2 tile = uvec2(clamp((clip.xy / clip.w * 0.5 + 0.5) * tiles, vec2(0.0), tiles - 1.0));\n"
+      "   const float depth = dot(position, LangulusClusterAxis);\n"
+      "   const uint slice = depth <= LangulusClusterNear ? 0u : uint(min(\n"
+      "      log(depth / LangulusClusterNear) * LangulusClusterScale,\n"
+      "      float(LangulusClusterDepth - 1u)));\n"
+      "   const uvec2 range = LangulusClusterRange[\n"
+      "      (slice * LangulusClusterHeight + tile.y) * LangulusClusterWidth + tile.x];\n"
+      "   vec3 lit = vec3(0.0);\n"
+      "   for (uint i = range.x; i < range.x + range.y; ++i) {\n"
+      "      const LangulusLight light = LangulusClusterLights[LangulusClusterIndex[i]];\n"
+      "      const vec3 toLight = light.position.xyz - position;\n"
+      "      const float distance = length(toLight);\n"
+      "      if (distance >= light.position.w)\n"
+      "         continue;\n"
+      "      const float lambert = max(dot(normal, toLight / max(distance, 1e-6)), 0.0);\n"
+      "      const float falloff = 1.0 - distance / light.position.w;\n"
+      "      lit += light.color.rgb * lambert * falloff * falloff;\n"
+      "   }\n"
+      "   return lit;\n"
+      "}\n"
+   );
+   return result;
+}
@@ -0,0 +1,114 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "PipelineManifest.hpp"
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+/// Get the hash of a record                                                  
+///   @return the hash                                                        
+Hash PipelineRecord::GetHash() const noexcept {
+   return HashOf(mMaterial, mTopology, mBlendMode, mDepth, mStyle);
+}
+
+/// Compare two records                                                       
+///   @param rhs - the record to compare against                              
+///   @return true if both records produce the same pipeline                  
+bool PipelineRecord::operator == (const PipelineRecord& rhs) const noexcept {
+   return mTopology == rhs.mTopology
+      and mBlendMode == rhs.mBlendMode
+      and mDepth == rhs.mDepth
+      and mStyle == rhs.mStyle
+      and mMaterial == rhs.mMaterial;
+}
+
+/// Record a pipeline, unless an identical one is already recorded            
+///   @param record - the pipeline record                                     
+void PipelineManifest::Record(const PipelineRecord& record) {
+   const auto hash = record.GetHash();
+   if (mHashes.Contains(hash))
+      return;
+
+   mHashes << hash;
+   mRecords << record;
+   mDirty = true;
+}
+
+/// Load records from a manifest file, merging them with the current ones     
+/// Each line contains a single record in the following format:               
+///   <style> <blend> <depth> <topology> <material code>                      
+/// Corrupted lines are skipped with a warning, the rest are still loaded     
+///   @param filename - the manifest file                                     
+void PipelineManifest::Load(const Text& filename) {
+   ::std::ifstream file {::std::string {Token {filename}}};
+   if (not file)
+      return;
+
+   const bool wasDirty = mDirty;
+   ::std::string line;
+   Count number = 0;
+   while (::std::getline(file, line)) {
+      ++number;
+      if (line.empty())
+         continue;
+
+      ::std::istringstream stream {line};
+      unsigned style, blend, depth, topology;
+      ::std::string material;
+      if (not (stream >> style >> blend >> depth >> topology)
+      or not ::std::getline(stream >> ::std::ws, material)) {
+         Logger::Warning("Skipping corrupted line ", number,
+            " of pipeline manifest: ", filename);
+         continue;
+      }
+
+      PipelineRecord record;
+      record.mMaterial = Text {Token {material}};
+      record.mTopology = static_cast<Topology>(topology);
+      record.mBlendMode = static_cast<BlendMode>(blend);
+      record.mDepth = depth != 0;
+      record.mStyle = style;
+      Record(record);
+   }
+
+   // Records that come from the file don't need saving                 
+   mDirty = wasDirty;
+}
+
+/// Save all records to a manifest file, overwriting it                       
+///   @param filename - the manifest file                                     
+void PipelineManifest::Save(const Text& filename) {
+   ::std::ofstream file {::std::string {Token {filename}}, ::std::ios::trunc};
+   if (not file) {
+      Logger::Warning("Can't write pipeline manifest: ", filename);
+      return;
+   }
+
+   for (auto& record : mRecords) {
+      file << record.mStyle << ' '
+           << static_cast<unsigned>(record.mBlendMode) << ' '
+           << (record.mDepth ? 1 : 0) << ' '
+           << static_cast<unsigned>(record.mTopology) << ' '
+           << Token {record.mMaterial} << '\n';
+   }
+
+   mDirty = false;
+}
+
+/// Get all records                                                           
+///   @return the records                                                     
+const TMany<PipelineRecord>& PipelineManifest::GetRecords() const noexcept {
+   return mRecords;
+}
+
+/// Check if there are records that aren't saved yet                          
+///   @return true if manifest changed since it was last loaded or saved      
+bool PipelineManifest::IsDirty() const noexcept {
+   return mDirty;
+}
@@ -0,0 +1,59 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "../Common.hpp"
+#include <Math/Blend.hpp>
+#include <Anyness/TSet.hpp>
+
+
+///                                                                           
+///   Pipeline record                                                         
+///                                                                           
+/// Everything needed to recreate a pipeline without the content that         
+/// originally requested it - used for prewarming pipelines before they're    
+/// actually needed                                                           
+///                                                                           
+struct PipelineRecord {
+   // The material generator request, serialized as code                
+   Text mMaterial;
+   // Topology                                                          
+   Topology mTopology {VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+   // Blending mode                                                     
+   BlendMode mBlendMode {BlendMode::Alpha};
+   // Depth testing and writing                                         
+   bool mDepth {true};
+   // Style of the layer, that requested the pipeline                   
+   uint32_t mStyle {};
+
+   NOD() Hash GetHash() const noexcept;
+   NOD() bool operator == (const PipelineRecord&) const noexcept;
+};
+
+
+///                                                                           
+///   Pipeline manifest                                                       
+///                                                                           
+/// A list of every distinct pipeline the renderer has created. Can be saved  
+/// to a file and replayed later, in order to create the pipelines (and fill  
+/// the pipeline cache) before the first frame that needs them                
+///                                                                           
+struct PipelineManifest {
+private:
+   TMany<PipelineRecord> mRecords;
+   TUnorderedSet<Hash> mHashes;
+   // Set when records change since last Load/Save                      
+   bool mDirty {};
+
+public:
+   void Record(const PipelineRecord&);
+   void Load(const Text&);
+   void Save(const Text&);
+
+   NOD() const TMany<PipelineRecord>& GetRecords() const noexcept;
+   NOD() bool IsDirty() const noexcept;
+};
@@ -0,0 +1,83 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+///                                                                           
+///   A sortable key, and the index of the element it was made for            
+///                                                                           
+struct RadixEntry {
+   uint64_t mKey;
+   uint32_t mIndex;
+};
+
+using RadixEntries = ::std::vector<RadixEntry>;
+
+
+/// Stable LSD radix sort of entries by their 64-bit keys, one byte per pass  
+/// Passes, in which all keys have the same byte, are skipped, so sorting     
+/// keys that use only a few of their bits costs only a few passes            
+///   @param entries - [in/out] the entries to sort                           
+///   @param scratch - [in/out] temporary storage, reused between calls       
+inline void RadixSort(RadixEntries& entries, RadixEntries& scratch) {
+   const auto count = entries.size();
+   if (count < 2)
+      return;
+
+   // Build histograms for all eight bytes in a single sweep            
+   uint32_t histograms[8][256];
+   ::std::memset(histograms, 0, sizeof(histograms));
+   for (const auto& entry : entries) {
+      for (int byte = 0; byte < 8; ++byte)
+         ++histograms[byte][(entry.mKey >> (byte * 8)) & 0xFF];
+   }
+
+   scratch.resize(count);
+   auto* source = &entries;
+   auto* target = &scratch;
+
+   for (int byte = 0; byte < 8; ++byte) {
+      auto& histogram = histograms[byte];
+
+      // Skip the pass if all keys share the same byte                  
+      const auto first = (entries[0].mKey >> (byte * 8)) & 0xFF;
+      if (histogram[first] == count)
+         continue;
+
+      // Turn counts into offsets                                       
+      uint32_t sum = 0;
+      for (auto& bucket : histogram) {
+         const auto c = bucket;
+         bucket = sum;
+         sum += c;
+      }
+
+      // Scatter                                                        
+      for (const auto& entry : *source)
+         (*target)[histogram[(entry.mKey >> (byte * 8)) & 0xFF]++] = entry;
+
+      ::std::swap(source, target);
+   }
+
+   // Make sure the result ends up in entries                           
+   if (source != &entries)
+      entries.swap(scratch);
+}
+
+/// Make a sortable key of a distance - non-negative floats compare exactly   
+/// like their bit patterns do, so no quantization range is required          
+///   @param distance - the distance, must not be negative                    
+///   @return the key                                                         
+inline uint32_t DepthToKey(float distance) noexcept {
+   uint32_t bits;
+   ::std::memcpy(&bits, &distance, sizeof(bits));
+   return bits;
+}
@@ -0,0 +1,377 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+
+///                                                                           
+///   How a pass uses a resource                                              
+///                                                                           
+enum class GraphUse : uint8_t {
+   // Not used yet, i.e. the resource has no contents                   
+   None,
+   // Drawn to as a color attachment                                    
+   Color,
+   // Drawn to as a depth attachment                                    
+   Depth,
+   // Read in fragment shaders                                          
+   Sampled,
+   // Read in compute shaders                                           
+   ComputeRead,
+   // Written in compute shaders                                        
+   ComputeWrite,
+   // Read as indirect draw commands                                    
+   Indirect,
+   // Copied from                                                       
+   TransferRead,
+   // Copied to                                                         
+   TransferWrite,
+   // Read by the host, after the frame is done                         
+   HostRead,
+   // Presented                                                         
+   Present
+};
+
+/// Check if a use writes to the resource                                     
+///   @param use - the use                                                    
+///   @return true if the resource is written                                 
+constexpr bool IsWrite(GraphUse use) noexcept {
+   return use == GraphUse::Color
+       or use == GraphUse::Depth
+       or use == GraphUse::ComputeWrite
+       or use == GraphUse::TransferWrite;
+}
+
+/// Check if a use is a render pass attachment                                
+///   @param use - the use                                                    
+///   @return true if the resource is an attachment                           
+constexpr bool IsAttachment(GraphUse use) noexcept {
+   return use == GraphUse::Color or use == GraphUse::Depth;
+}
+
+/// Check if a use can happen inside a render pass                            
+///   @param use - the use                                                    
+///   @return true if the use is a graphics one                               
+constexpr bool IsGraphics(GraphUse use) noexcept {
+   return IsAttachment(use)
+       or use == GraphUse::Sampled
+       or use == GraphUse::Indirect;
+}
+
+///                                                                           
+///   What a pass does with the previous contents of an attachment            
+///                                                                           
+enum class GraphLoad : uint8_t {
+   DontCare, Load, Clear
+};
+
+
+///                                                                           
+///   Render graph                                                            
+///                                                                           
+/// Passes are declared in the order they're recorded, along with the         
+/// resources they read and write. Compiling the graph culls passes, whose    
+/// results nobody needs, and for each use finds the previous one, so that    
+/// barriers can be derived from them. It also picks load and store ops for   
+/// attachments, and groups consecutive passes, that draw to the same         
+/// attachments, so they can share a render pass. All resources live outside  
+/// of the graph - the G-buffer lives in lazily allocated memory of the light 
+/// pass, and depth pyramids persist between frames, so nothing would alias.  
+/// The graph is rebuilt every frame, reusing its allocations                 
+///                                                                           
+struct RenderGraph {
+   using Resource = uint32_t;
+   using Pass = uint32_t;
+   static constexpr uint32_t None = ~uint32_t {};
+
+   /// A resource, used by a pass                                             
+   struct Use {
+      Resource mResource;
+      GraphUse mUse;
+      // Whether all previous contents are overwritten                  
+      bool mClear;
+      // Compiled: the previous use in the graph, or the use before it  
+      GraphUse mPrevious;
+      // Compiled: what to do with the attachment's contents            
+      GraphLoad mLoad;
+      bool mStore;
+   };
+
+   /// A pass, and the range of its uses                                      
+   struct PassInfo {
+      ::std::function<void(Pass)> mRecord;
+      uint32_t mStart;
+      uint32_t mCount;
+      // Passes with side effects are never culled                      
+      bool mSideEffects;
+      // Compiled: whether the pass is skipped                          
+      bool mCulled;
+      // Compiled: the first pass of the group it belongs to            
+      Pass mGroup;
+   };
+
+   /// A resource, that lives outside of the graph                            
+   struct ResourceInfo {
+      // How the resource was used before the graph, if it was          
+      GraphUse mInitial;
+      // Whether contents are needed after the graph                    
+      bool mOutput;
+   };
+
+private:
+   ::std::vector<PassInfo> mPasses;
+   ::std::vector<Use> mUses;
+   ::std::vector<ResourceInfo> mResources;
+
+   // Compile scratch, kept between frames                              
+   ::std::vector<uint8_t> mNeeded;
+   ::std::vector<uint32_t> mLastUse;
+
+   /// Add a use to the last declared pass                                    
+   void AddUse(Resource resource, GraphUse use, bool clear) {
+      mUses.push_back({resource, use, clear, GraphUse::None, GraphLoad::DontCare, false});
+      ++mPasses.back().mCount;
+   }
+
+   /// Check if a pass can continue the render pass of a group                
+   ///   @param group - the first pass of the group                           
+   ///   @param last - the last pass in the group                             
+   ///   @param pass - the pass that might join                               
+   ///   @return true if it can join                                          
+   bool CanJoin(Pass group, Pass last, Pass pass) const {
+      const auto& info = mPasses[pass];
+      const auto& head = mPasses[group];
+
+      // Only graphics work continues a render pass, and clearing an    
+      // attachment would need a new one                                
+      uint32_t attachments = 0;
+      for (uint32_t i = info.mStart; i < info.mStart + info.mCount; ++i) {
+         const auto& use = mUses[i];
+         if (not IsGraphics(use.mUse) or (IsAttachment(use.mUse) and use.mClear))
+            return false;
+         if (not IsAttachment(use.mUse))
+            continue;
+
+         // Attachments must be exactly the group's ones                
+         ++attachments;
+         const auto begin = mUses.begin() + head.mStart;
+         const auto end = begin + head.mCount;
+         if (end == ::std::find_if(begin, end, [&](const Use& other) {
+            return other.mResource == use.mResource and other.mUse == use.mUse;
+         })) return false;
+      }
+
+      uint32_t groupAttachments = 0;
+      for (uint32_t i = head.mStart; i < head.mStart + head.mCount; ++i)
+         groupAttachments += IsAttachment(mUses[i].mUse);
+      if (not attachments or attachments != groupAttachments)
+         return false;
+
+      // Anything read outside of attachments must not be written by    
+      // the group, there is no barrier between its passes              
+      for (uint32_t i = info.mStart; i < info.mStart + info.mCount; ++i) {
+         const auto& use = mUses[i];
+         if (IsAttachment(use.mUse))
+            continue;
+
+         for (Pass p = group; p <= last; ++p) {
+            const auto& other = mPasses[p];
+            if (other.mCulled)
+               continue;
+
+            for (uint32_t j = other.mStart; j < other.mStart + other.mCount; ++j) {
+               if (mUses[j].mResource == use.mResource and IsWrite(mUses[j].mUse))
+                  return false;
+            }
+         }
+      }
+
+      return true;
+   }
+
+public:
+   /// Forget all passes and resources, keeping the allocations               
+   void Reset() {
+      mPasses.clear();
+      mUses.clear();
+      mResources.clear();
+   }
+
+   /// Add a resource, that lives outside of the graph                        
+   ///   @param initial - how it was last used, or None if it has no          
+   ///                    contents yet                                        
+   ///   @param output - whether its contents are needed after the graph      
+   ///   @return the resource                                                 
+   Resource Import(GraphUse initial, bool output) {
+      mResources.push_back({initial, output});
+      return static_cast<Resource>(mResources.size() - 1);
+   }
+
+   /// Add a pass after all others                                            
+   ///   @param record - records the pass, once the graph is executed, and    
+   ///                   is told which pass it is, to look up its uses        
+   ///   @param sideEffects - whether the pass must never be culled           
+   ///   @return the pass                                                     
+   Pass AddPass(::std::function<void(Pass)> record, bool sideEffects = false) {
+      mPasses.push_back({::std::move(record), static_cast<uint32_t>(mUses.size()), 0, sideEffects, false, None});
+      return static_cast<Pass>(mPasses.size() - 1);
+   }
+
+   /// Declare that the last added pass reads a resource                      
+   ///   @param resource - the resource                                       
+   ///   @param use - how it's read                                           
+   void Read(Resource resource, GraphUse use) {
+      AddUse(resource, use, false);
+   }
+
+   /// Declare that the last added pass writes a resource                     
+   ///   @param resource - the resource                                       
+   ///   @param use - how it's written                                        
+   ///   @param clear - whether the previous contents are all overwritten,    
+   ///                  otherwise they're kept where not drawn to             
+   void Write(Resource resource, GraphUse use, bool clear = false) {
+      AddUse(resource, use, clear);
+   }
+
+   /// Cull, order and group the passes                                       
+   void Compile() {
+      // Walk backwards, keeping passes that write something needed     
+      // later, and making whatever they read needed                    
+      mNeeded.assign(mResources.size(), 0);
+      for (Resource r = 0; r < mResources.size(); ++r)
+         mNeeded[r] = mResources[r].mOutput;
+
+      for (auto p = static_cast<Pass>(mPasses.size()); p-- > 0;) {
+         auto& pass = mPasses[p];
+         const auto begin = mUses.begin() + pass.mStart;
+         const auto end = begin + pass.mCount;
+
+         bool keep = pass.mSideEffects;
+         for (auto use = begin; use != end and not keep; ++use)
+            keep = IsWrite(use->mUse) and mNeeded[use->mResource];
+
+         pass.mCulled = not keep;
+         if (not keep)
+            continue;
+
+         // Attachments are stored only if someone needs them later     
+         for (auto use = begin; use != end; ++use)
+            use->mStore = IsWrite(use->mUse) and mNeeded[use->mResource];
+         for (auto use = begin; use != end; ++use) {
+            if (use->mClear)
+               mNeeded[use->mResource] = 0;
+         }
+         for (auto use = begin; use != end; ++use) {
+            if (not use->mClear)
+               mNeeded[use->mResource] = 1;
+         }
+      }
+
+      // Walk forwards, chaining the uses of each resource, and finding 
+      // which contents can be loaded                                   
+      mLastUse.assign(mResources.size(), None);
+
+      Pass group = None, last = None;
+      for (Pass p = 0; p < mPasses.size(); ++p) {
+         auto& pass = mPasses[p];
+         if (pass.mCulled)
+            continue;
+
+         // Join the previous group, or start a new one                 
+         if (group != None and CanJoin(group, last, p))
+            pass.mGroup = group;
+         else
+            pass.mGroup = group = p;
+         last = p;
+
+         for (uint32_t i = pass.mStart; i < pass.mStart + pass.mCount; ++i) {
+            auto& use = mUses[i];
+            const auto& resource = mResources[use.mResource];
+            auto& lastUse = mLastUse[use.mResource];
+            use.mPrevious = lastUse == None
+               ? resource.mInitial : mUses[lastUse].mUse;
+
+            if (use.mClear)
+               use.mLoad = GraphLoad::Clear;
+            else if (use.mPrevious != GraphUse::None)
+               use.mLoad = GraphLoad::Load;
+            else
+               use.mLoad = GraphLoad::DontCare;
+
+            // The last use is tracked by its index, so that several    
+            // uses of the same resource in a pass chain, too           
+            lastUse = i;
+         }
+      }
+   }
+
+   /// Run all passes, that weren't culled, in order                          
+   ///   @param prepare - called with each pass, before it's recorded         
+   template<class F>
+   void Execute(F&& prepare) {
+      for (Pass p = 0; p < mPasses.size(); ++p) {
+         const auto& pass = mPasses[p];
+         if (pass.mCulled)
+            continue;
+
+         prepare(p);
+         if (pass.mRecord)
+            pass.mRecord(p);
+      }
+   }
+
+   /// Get a pass                                                             
+   const PassInfo& GetPass(Pass pass) const noexcept {
+      return mPasses[pass];
+   }
+
+   /// Get the number of passes                                               
+   uint32_t GetPassCount() const noexcept {
+      return static_cast<uint32_t>(mPasses.size());
+   }
+
+   /// Get a resource                                                         
+   const ResourceInfo& GetResource(Resource resource) const noexcept {
+      return mResources[resource];
+   }
+
+   /// Get a use of a pass                                                    
+   ///   @param pass - the pass                                               
+   ///   @param index - the use index, below the pass's mCount                
+   ///   @return the use                                                      
+   const Use& GetUse(Pass pass, uint32_t index) const noexcept {
+      return mUses[mPasses[pass].mStart + index];
+   }
+
+   /// Find how a pass uses a resource                                        
+   ///   @param pass - the pass                                               
+   ///   @param resource - the resource                                       
+   ///   @return the use, or nullptr if the pass doesn't use it               
+   const Use* FindUse(Pass pass, Resource resource) const noexcept {
+      const auto& info = mPasses[pass];
+      for (uint32_t i = info.mStart; i < info.mStart + info.mCount; ++i) {
+         if (mUses[i].mResource == resource)
+            return &mUses[i];
+      }
+      return nullptr;
+   }
+
+   /// Check if a pass is the last one in its group                           
+   ///   @param pass - a pass, that isn't culled                              
+   ///   @return true if the next kept pass starts a new group                
+   bool EndsGroup(Pass pass) const noexcept {
+      for (Pass p = pass + 1; p < mPasses.size(); ++p) {
+         if (not mPasses[p].mCulled)
+            return mPasses[p].mGroup != mPasses[pass].mGroup;
+      }
+      return true;
+   }
+};
@@ -0,0 +1,118 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "SecondaryCommands.hpp"
+#include "../Vulkan.hpp"
+
+
+/// Create a command pool for each worker, for each frame in flight           
+///   @param renderer - the renderer                                          
+///   @param workers - the number of workers                                  
+///   @param frames - the number of frames in flight                          
+void SecondaryCommands::Create(VulkanRenderer* renderer, uint32_t workers, uint32_t frames) {
+   mRenderer = renderer;
+   mWorkerCount = workers;
+   mFrame = 0;
+   mWorkers.resize(workers * frames);
+
+   VkCommandPoolCreateInfo poolInfo {};
+   poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+   poolInfo.queueFamilyIndex = renderer->mGraphicIndex;
+   poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+   for (auto& worker : mWorkers) {
+      if (vkCreateCommandPool(renderer->mDevice, &poolInfo, nullptr, &worker.mPool))
+         LANGULUS_OOPS(Graphics, "Can't create command pool for recording workers");
+   }
+}
+
+/// Destroy all pools, along with their buffers                               
+void SecondaryCommands::Destroy() {
+   for (auto& worker : mWorkers) {
+      if (worker.mPool)
+         vkDestroyCommandPool(mRenderer->mDevice, worker.mPool, nullptr);
+   }
+
+   mWorkers.clear();
+   mWorkerCount = mFrame = 0;
+}
+
+/// Get the workers of the frame being recorded                               
+///   @return the first worker of the frame                                   
+SecondaryCommands::Worker* SecondaryCommands::GetFrame() noexcept {
+   return mWorkers.data() + mFrame * mWorkerCount;
+}
+
+/// Start recording a frame in flight, making all of its buffers available    
+/// for recording again                                                       
+/// The GPU must be done executing the frame's previous buffers               
+///   @param frame - the frame in flight                                      
+void SecondaryCommands::Reset(uint32_t frame) {
+   mFrame = frame;
+   const auto workers = GetFrame();
+   for (uint32_t w = 0; w < mWorkerCount; ++w) {
+      auto& worker = workers[w];
+      if (not worker.mUsed)
+         continue;
+
+      vkResetCommandPool(mRenderer->mDevice, worker.mPool, 0);
+      worker.mUsed = 0;
+   }
+}
+
+/// Make sure any worker can begin a number of buffers, without allocating    
+/// Workers take jobs dynamically, so each must be ready to take them all     
+///   @param count - the number of buffers, about to be recorded              
+void SecondaryCommands::Reserve(Count count) {
+   const auto workers = GetFrame();
+   for (uint32_t w = 0; w < mWorkerCount; ++w) {
+      auto& worker = workers[w];
+      const auto needed = worker.mUsed + count;
+      if (needed <= worker.mBuffers.size())
+         continue;
+
+      const auto previous = worker.mBuffers.size();
+      worker.mBuffers.resize(needed);
+
+      VkCommandBufferAllocateInfo allocInfo {};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.commandPool = worker.mPool;
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+      allocInfo.commandBufferCount = static_cast<uint32_t>(needed - previous);
+
+      if (vkAllocateCommandBuffers(mRenderer->mDevice, &allocInfo, worker.mBuffers.data() + previous)) {
+         worker.mBuffers.resize(previous);
+         LANGULUS_OOPS(Graphics, "Can't allocate secondary command buffers");
+      }
+   }
+}
+
+/// Begin recording a buffer, that continues a render pass                    
+/// Must be called only from the thread of the given worker, and only for as  
+/// many buffers as were reserved                                             
+///   @param worker - the worker index                                        
+///   @param pass - the render pass, whose first subpass is continued         
+///   @param frame - the framebuffer the render pass draws to                 
+///   @return the command buffer, ready for recording                         
+VkCommandBuffer SecondaryCommands::Begin(uint32_t worker, VkRenderPass pass, VkFramebuffer frame) noexcept {
+   auto& w = GetFrame()[worker];
+   const auto buffer = w.mBuffers[w.mUsed++];
+
+   VkCommandBufferInheritanceInfo inheritance {};
+   inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+   inheritance.renderPass = pass;
+   inheritance.subpass = 0;
+   inheritance.framebuffer = frame;
+
+   VkCommandBufferBeginInfo beginInfo {};
+   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+                   | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+   beginInfo.pInheritanceInfo = &inheritance;
+   vkBeginCommandBuffer(buffer, &beginInfo);
+   return buffer;
+}
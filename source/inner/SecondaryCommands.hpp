@@ -0,0 +1,50 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "../Common.hpp"
+
+
+///                                                                           
+///   Secondary command buffers, recorded by workers                          
+///                                                                           
+/// Each worker of the renderer's JobPool gets its own command pool for each  
+/// frame in flight, so that workers can record the contents of a render pass 
+/// in parallel, without locking. The main command buffer then executes them  
+/// in order. Buffers are reused when their frame comes around again, after   
+/// the GPU is done with its previous use                                     
+///                                                                           
+struct SecondaryCommands {
+   /// Least number of draw calls, worth recording on a separate worker       
+   static constexpr Count MinDraws = 256;
+
+private:
+   VulkanRenderer* mRenderer {};
+
+   // A worker's pool for a frame, and the buffers allocated from it    
+   struct Worker {
+      VkCommandPool mPool {};
+      CmdBuffers mBuffers;
+      Count mUsed {};
+   };
+
+   // All workers of the first frame in flight, then of the second...   
+   ::std::vector<Worker> mWorkers;
+   uint32_t mWorkerCount {};
+   // The frame in flight, that is being recorded                       
+   uint32_t mFrame {};
+
+   NOD() Worker* GetFrame() noexcept;
+
+public:
+   void Create(VulkanRenderer*, uint32_t, uint32_t);
+   void Destroy();
+   void Reset(uint32_t);
+   void Reserve(Count);
+
+   NOD() VkCommandBuffer Begin(uint32_t, VkRenderPass, VkFramebuffer) noexcept;
+};
@@ -0,0 +1,634 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "ShadowAtlas.hpp"
+#include "../Vulkan.hpp"
+#include <shaderc/shaderc.hpp>
+
+/// Format of the atlas                                                       
+constexpr VkFormat ShadowFormat = VK_FORMAT_D32_SFLOAT;
+
+/// Transforms caster positions to a cube face - there's no fragment stage    
+static constexpr char ShadowVertexShader[] = R"(
+   #version 450
+   layout(location = 0) in vec3 position;
+
+   layout(push_constant) uniform Constants {
+      mat4 transform;
+   };
+
+   void main() {
+      gl_Position = transform * vec4(position, 1.0);
+   }
+)";
+
+
+/// Create the atlas, its pass, and the shadow shader                         
+///   @param renderer - the renderer                                          
+void ShadowAtlas::Create(VulkanRenderer* renderer) {
+   mRenderer = renderer;
+   const auto device = renderer->mDevice.Get();
+
+   shaderc::Compiler compiler;
+   shaderc::CompileOptions options;
+   const auto assembly = compiler.CompileGlslToSpv(
+      ShadowVertexShader, sizeof(ShadowVertexShader) - 1,
+      shaderc_glsl_vertex_shader, "shadow", options
+   );
+
+   if (assembly.GetCompilationStatus() != shaderc_compilation_status_success) {
+      Logger::Error("Shadow shader compilation error: ", assembly.GetErrorMessage());
+      LANGULUS_THROW(Graphics, "Shadow shader compilation failed");
+   }
+
+   VkShaderModuleCreateInfo moduleInfo {};
+   moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+   moduleInfo.codeSize = (assembly.cend() - assembly.cbegin()) * sizeof(uint32_t);
+   moduleInfo.pCode = assembly.cbegin();
+   if (vkCreateShaderModule(device, &moduleInfo, nullptr, &mShader.Get()))
+      LANGULUS_THROW(Graphics, "vkCreateShaderModule failed for shadow shader");
+
+   // Each caster is pushed as constants, layouts with push constants   
+   // aren't shared, so this one is owned here                          
+   VkPushConstantRange constants {};
+   constants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+   constants.size = sizeof(float) * 16;
+
+   VkPipelineLayoutCreateInfo layoutInfo {};
+   layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+   layoutInfo.pushConstantRangeCount = 1;
+   layoutInfo.pPushConstantRanges = &constants;
+   if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &mPipeLayout.Get()))
+      LANGULUS_THROW(Graphics, "Can't create shadow pipeline layout");
+
+   // Cached shadows are loaded and kept, lights sample the atlas       
+   // outside of the pass - the frame's render graph transitions it     
+   VkAttachmentDescription attachment {};
+   attachment.format = ShadowFormat;
+   attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+   attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+   attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+   attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+   attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+   attachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+   attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+   const VkAttachmentReference depthRef {
+      0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+   };
+
+   VkSubpassDescription subpass {};
+   subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+   subpass.pDepthStencilAttachment = &depthRef;
+
+   // Consecutive shadow passes are grouped by the render graph, which  
+   // places no barriers between them                                   
+   VkSubpassDependency dependency {};
+   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+   dependency.dstSubpass = 0;
+   dependency.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+   dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+   dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                           | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+   dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+                            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+   VkRenderPassCreateInfo passInfo {};
+   passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+   passInfo.attachmentCount = 1;
+   passInfo.pAttachments = &attachment;
+   passInfo.subpassCount = 1;
+   passInfo.pSubpasses = &subpass;
+   passInfo.dependencyCount = 1;
+   passInfo.pDependencies = &dependency;
+   if (vkCreateRenderPass(device, &passInfo, nullptr, &mPass.Get()))
+      LANGULUS_THROW(Graphics, "Can't create shadow pass");
+
+   // Depth is compared in the light shaders, so it's only fetched      
+   VkSamplerCreateInfo samplerInfo {};
+   samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+   samplerInfo.magFilter = VK_FILTER_NEAREST;
+   samplerInfo.minFilter = VK_FILTER_NEAREST;
+   samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+   samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+   samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+   samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+   if (vkCreateSampler(device, &samplerInfo, nullptr, &mSampler.Get()))
+      LANGULUS_THROW(Graphics, "Can't create shadow sampler");
+
+   CreateImage(MinSize);
+   Upload();
+}
+
+/// Create the atlas image, and forget all shadows                            
+///   @param size - the atlas size, must be a power of two                    
+void ShadowAtlas::CreateImage(uint32_t size) {
+   DestroyImage();
+   mSize = size;
+   mAllocator.Reset(size, FaceSize);
+   mEntries.Clear();
+
+   ImageView view {size, size, 1, 1, MetaOf<Depth32>()};
+   mImage = mRenderer->mVRAM.CreateImage(view,
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+   mView = mRenderer->mVRAM.CreateImageView(mImage);
+   mRenderer->mBarriers.Transition(mImage,
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+      VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+   );
+
+   VkFramebufferCreateInfo frameInfo {};
+   frameInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+   frameInfo.renderPass = mPass;
+   frameInfo.attachmentCount = 1;
+   frameInfo.pAttachments = &mView.Get();
+   frameInfo.width = size;
+   frameInfo.height = size;
+   frameInfo.layers = 1;
+   if (vkCreateFramebuffer(mRenderer->mDevice, &frameInfo, nullptr, &mFrame.Get()))
+      LANGULUS_THROW(Graphics, "Can't create shadow atlas framebuffer");
+}
+
+/// Destroy the atlas image                                                   
+void ShadowAtlas::DestroyImage() {
+   const auto device = mRenderer->mDevice.Get();
+   if (mFrame) {
+      vkDestroyFramebuffer(device, mFrame, nullptr);
+      mFrame.Reset();
+   }
+
+   if (mView) {
+      vkDestroyImageView(device, mView, nullptr);
+      mView.Reset();
+   }
+
+   if (mImage.IsValid())
+      mRenderer->mVRAM.DestroyImage(mImage);
+   mSize = 0;
+}
+
+/// Replace the atlas image with nothing, keeping the old one until the       
+/// frames in flight are done sampling it                                     
+void ShadowAtlas::RetireImage() {
+   mRetired << Retired {mImage, mView.Get(), mFrame.Get(), mRenderer->GetFrame()};
+   mImage.Reset();
+   mView.Reset();
+   mFrame.Reset();
+   mSize = 0;
+}
+
+/// Destroy retired atlas images                                              
+///   @param all - whether to destroy all of them, or only the ones, that the 
+///                current frame in flight was the last to sample             
+void ShadowAtlas::Collect(bool all) {
+   const auto device = mRenderer->mDevice.Get();
+   const auto frame = mRenderer->GetFrame();
+   TMany<Retired> kept;
+   for (auto& retired : mRetired) {
+      if (not all and retired.mFrameInFlight != frame) {
+         kept << retired;
+         continue;
+      }
+
+      vkDestroyFramebuffer(device, retired.mFrame, nullptr);
+      vkDestroyImageView(device, retired.mView, nullptr);
+      mRenderer->mVRAM.DestroyImage(retired.mImage);
+   }
+
+   mRetired = Abandon(kept);
+}
+
+/// Destroy everything                                                        
+void ShadowAtlas::Destroy() {
+   if (not mRenderer)
+      return;
+
+   const auto device = mRenderer->mDevice.Get();
+   DestroyImage();
+   Collect(true);
+
+   for (auto& pipeline : mPipelines)
+      vkDestroyPipeline(device, pipeline.mPipeline, nullptr);
+   mPipelines.Reset();
+
+   if (mPipeLayout) {
+      vkDestroyPipelineLayout(device, mPipeLayout, nullptr);
+      mPipeLayout.Reset();
+   }
+
+   if (mShader) {
+      vkDestroyShaderModule(device, mShader, nullptr);
+      mShader.Reset();
+   }
+
+   if (mSampler) {
+      vkDestroySampler(device, mSampler, nullptr);
+      mSampler.Reset();
+   }
+
+   if (mPass) {
+      vkDestroyRenderPass(device, mPass, nullptr);
+      mPass.Reset();
+   }
+
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      if (mRecordBuffer[frame].IsValid())
+         mRenderer->mVRAM.DestroyBuffer(mRecordBuffer[frame]);
+      mRecordsAllocated[frame] = 0;
+   }
+
+   mRecords.Reset();
+   mFresh = 0;
+   mEntries.Reset();
+   mFull = mExhausted = false;
+   mRenderer = nullptr;
+}
+
+/// Start a new frame - forget the shadows of lights, that weren't compiled   
+/// in the previous one, and grow the atlas, if it got full                   
+/// Must be called before any layer is compiled, after the GPU is done with   
+/// the current frame in flight                                               
+void ShadowAtlas::Clear() {
+   // Atlases this frame replaced when it was last drawn aren't sampled 
+   // by anything anymore - later frames use the new ones               
+   Collect(false);
+
+   if (mFull and mSize < MaxSize) {
+      // All shadows are rendered again in the bigger atlas, while the  
+      // other frames in flight still sample the old one                
+      const auto size = mSize * 2;
+      RetireImage();
+      CreateImage(size);
+      mExhausted = false;
+   }
+   else {
+      TMany<Entry> used;
+      for (const auto& entry : mEntries) {
+         if (entry.mUsed)
+            used << entry;
+         else for (const auto& face : entry.mFaces)
+            mAllocator.Free(face);
+      }
+
+      // A full atlas, that can't grow, and where nothing was freed,    
+      // remains full until lights change                               
+      mExhausted = mFull and used.GetCount() == mEntries.GetCount();
+      mEntries = Abandon(used);
+   }
+
+   for (auto& entry : mEntries)
+      entry.mUsed = false;
+   mRecords.Clear();
+   mFresh = 0;
+   mFull = false;
+}
+
+/// Discard the records pushed after some count, keeping the ones before -    
+/// these belong to draw lists, that were kept as they are. Shadows stay      
+/// used, since kept draw lists might sample them, until the next Clear       
+///   @param records - the number of records to keep                          
+void ShadowAtlas::Truncate(Count records) {
+   mRecords.Trim(records);
+   mFresh = 0;
+}
+
+/// Find the shadow of a light                                                
+///   @param key - the light instance                                         
+///   @return the entry index, or -1 if the light has no shadow               
+int32_t ShadowAtlas::Find(const void* key) const noexcept {
+   for (Offset i = 0; i < mEntries.GetCount(); ++i) {
+      if (mEntries[i].mKey == key)
+         return static_cast<int32_t>(i);
+   }
+   return -1;
+}
+
+/// Request a shadow for a light                                              
+///   @param key - the light instance, must be the same every frame           
+///   @param light - the light position in xyz, and its range in w            
+///   @param casters - all casters in the light's level                       
+///   @param touched - [out] casters in the light's range                     
+///   @param dirty - [out] whether the shadow must be rendered again          
+///   @return the entry index, or -1 if the atlas is full                     
+int32_t ShadowAtlas::Request(
+   const void* key, const float* light, const ShadowCasters& casters,
+   ::std::vector<uint32_t>& touched, bool& dirty
+) {
+   const auto signature = ShadowSignature(light, casters, touched);
+   auto index = Find(key);
+   if (index < 0) {
+      // Allocate all six faces, or none                                
+      Entry entry {key};
+      int allocated = 0;
+      while (allocated < 6 and mAllocator.Allocate(FaceSize, entry.mFaces[allocated]))
+         ++allocated;
+
+      if (allocated < 6) {
+         while (allocated)
+            mAllocator.Free(entry.mFaces[--allocated]);
+         mFull = true;
+         dirty = false;
+         return -1;
+      }
+
+      // Signature of a fresh shadow never matches                      
+      entry.mSignature = ~signature;
+      mEntries << entry;
+      index = static_cast<int32_t>(mEntries.GetCount() - 1);
+   }
+
+   auto& entry = mEntries[index];
+   dirty = entry.mSignature != signature;
+   entry.mSignature = signature;
+   entry.mUsed = true;
+   ::std::memcpy(entry.mLight, light, sizeof(entry.mLight));
+   return index;
+}
+
+/// Push the shadow of a light, as seen from a camera                         
+///   @param key - the light instance                                         
+///   @param view - the camera view of the light's level                      
+///   @return the record index, or -1 if the light has no shadow              
+int32_t ShadowAtlas::PushRecord(const void* key, const Mat4& view) {
+   const auto index = Find(key);
+   if (index < 0 or not mEntries[index].mUsed)
+      return -1;
+
+   const auto& entry = mEntries[index];
+   ShadowRecord record;
+   MatrixToFloats(view.Invert(), record.mToLight);
+   for (int i = 0; i < 3; ++i)
+      record.mToLight[12 + i] -= entry.mLight[i];
+
+   const auto scale = 1.0f / mSize;
+   for (int face = 0; face < 6; ++face) {
+      const auto& tile = entry.mFaces[face];
+      record.mFaces[face][0] = tile.mX * scale;
+      record.mFaces[face][1] = tile.mY * scale;
+      record.mFaces[face][2] = tile.mSize * scale;
+      record.mFaces[face][3] = tile.mSize * scale;
+   }
+
+   record.mDepth[0] = entry.mLight[3] * ShadowNearRatio;
+   record.mDepth[1] = entry.mLight[3];
+   record.mDepth[2] = record.mDepth[3] = 0;
+   mRecords << record;
+   return static_cast<int32_t>(mRecords.GetCount() - 1);
+}
+
+/// Get the number of records pushed so far                                   
+///   @return the number of records                                           
+Count ShadowAtlas::GetRecordCount() const noexcept {
+   return mRecords.GetCount();
+}
+
+/// Upload the records of all cameras to the VRAM of the current frame in     
+/// flight, reallocating if required                                          
+/// Records only change along with the draw lists, so they're uploaded only   
+/// if they changed since that frame last used them                           
+void ShadowAtlas::Upload() {
+   const auto frame = mRenderer->GetFrame();
+   const auto bit = 1u << frame;
+   if (not (mFresh & bit)) {
+      mFresh |= bit;
+
+      // Storage buffers can't be empty, so there's always a record     
+      if (not mRecords)
+         mRecords << ShadowRecord {};
+
+      auto& buffer = mRecordBuffer[frame];
+      auto& allocated = mRecordsAllocated[frame];
+      const auto bytes = mRecords.GetCount() * sizeof(ShadowRecord);
+      if (allocated < bytes) {
+         if (buffer.IsValid())
+            mRenderer->mVRAM.DestroyBuffer(buffer);
+
+         allocated = bytes * 2;
+         buffer = mRenderer->mVRAM.CreateBuffer(
+            nullptr, VkDeviceSize {allocated},
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+         );
+      }
+
+      buffer.Upload(0, bytes, mRecords.GetRaw());
+   }
+
+   // Report the atlas                                                  
+   auto& stats = mRenderer->mStats;
+   stats.mShadowMaps = mEntries.GetCount();
+   stats.mShadowAtlasBytes = Size {mSize} * mSize * sizeof(float);
+   stats.mShadowAtlasUsed = mAllocator.GetUsed() * sizeof(float);
+}
+
+/// Get a depth-only pipeline for a vertex position format                    
+///   @param type - the type of the positions                                 
+///   @return the pipeline, or a null handle if the format isn't supported    
+VkPipeline ShadowAtlas::GetPipeline(DMeta type) const {
+   const auto format = AsVkFormat(type);
+   const auto stride = static_cast<uint32_t>(type->mSize);
+   for (const auto& pipeline : mPipelines) {
+      if (pipeline.mFormat == format and pipeline.mStride == stride)
+         return pipeline.mPipeline;
+   }
+
+   VkVertexInputBindingDescription binding {};
+   binding.binding = 0;
+   binding.stride = stride;
+   binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+   VkVertexInputAttributeDescription attribute {};
+   attribute.location = 0;
+   attribute.binding = 0;
+   attribute.format = format;
+
+   VkPipelineVertexInputStateCreateInfo input {};
+   input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+   input.vertexBindingDescriptionCount = 1;
+   input.pVertexBindingDescriptions = &binding;
+   input.vertexAttributeDescriptionCount = 1;
+   input.pVertexAttributeDescriptions = &attribute;
+
+   VkPipelineInputAssemblyStateCreateInfo assembly {};
+   assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+   assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+   VkPipelineViewportStateCreateInfo viewportState {};
+   viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+   viewportState.viewportCount = 1;
+   viewportState.scissorCount = 1;
+
+   // Some cube faces mirror the casters, so nothing is culled, and     
+   // depth is biased to avoid surfaces shadowing themselves            
+   VkPipelineRasterizationStateCreateInfo rasterizer {};
+   rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+   rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+   rasterizer.cullMode = VK_CULL_MODE_NONE;
+   rasterizer.depthBiasEnable = VK_TRUE;
+   rasterizer.depthBiasConstantFactor = 1.25f;
+   rasterizer.depthBiasSlopeFactor = 1.75f;
+   rasterizer.lineWidth = 1.0f;
+
+   VkPipelineMultisampleStateCreateInfo multisampling {};
+   multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+   multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+   VkPipelineDepthStencilStateCreateInfo depthStencil {};
+   depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+   depthStencil.depthTestEnable = VK_TRUE;
+   depthStencil.depthWriteEnable = VK_TRUE;
+   depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+   const VkDynamicState dynamicStates[] {
+      VK_DYNAMIC_STATE_VIEWPORT,
+      VK_DYNAMIC_STATE_SCISSOR
+   };
+
+   VkPipelineDynamicStateCreateInfo dynamicState {};
+   dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+   dynamicState.dynamicStateCount = 2;
+   dynamicState.pDynamicStates = dynamicStates;
+
+   Shader stage {};
+   stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   stage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+   stage.module = mShader;
+   stage.pName = "main";
+
+   VkGraphicsPipelineCreateInfo pipelineInfo {};
+   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+   pipelineInfo.stageCount = 1;
+   pipelineInfo.pStages = &stage;
+   pipelineInfo.pVertexInputState = &input;
+   pipelineInfo.pInputAssemblyState = &assembly;
+   pipelineInfo.pViewportState = &viewportState;
+   pipelineInfo.pRasterizationState = &rasterizer;
+   pipelineInfo.pMultisampleState = &multisampling;
+   pipelineInfo.pDepthStencilState = &depthStencil;
+   pipelineInfo.pDynamicState = &dynamicState;
+   pipelineInfo.layout = mPipeLayout;
+   pipelineInfo.renderPass = mPass;
+
+   VkPipeline pipeline {};
+   if (vkCreateGraphicsPipelines(mRenderer->mDevice, mRenderer->mPipelineCache,
+      1, &pipelineInfo, nullptr, &pipeline)) {
+      Logger::Warning("Can't create shadow pipeline for positions of type ", type);
+      pipeline = {};
+   }
+
+   mPipelines << Pipeline {format, stride, pipeline};
+   return pipeline;
+}
+
+/// Begin rendering shadows                                                   
+/// Must be recorded outside of any render pass                               
+///   @param state - the command buffer state                                 
+void ShadowAtlas::Begin(CommandState& state) const {
+   VkRenderPassBeginInfo passInfo {};
+   passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+   passInfo.renderPass = mPass;
+   passInfo.framebuffer = mFrame;
+   passInfo.renderArea.extent = {mSize, mSize};
+   vkCmdBeginRenderPass(state.GetCommands(), &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+/// Clear a cube face of a shadow, and prepare for rendering its casters      
+///   @param state - the command buffer state                                 
+///   @param index - the entry index, as returned by Request                  
+///   @param face - the cube face                                             
+///   @param viewProjection - [out] the face's column-major view-projection   
+void ShadowAtlas::BeginFace(
+   CommandState& state, int32_t index, int face, float* viewProjection
+) const {
+   const auto& entry = mEntries[index];
+   const auto& tile = entry.mFaces[face];
+   const auto commands = state.GetCommands();
+
+   VkViewport viewport {};
+   viewport.x = static_cast<float>(tile.mX);
+   viewport.y = static_cast<float>(tile.mY);
+   viewport.width = viewport.height = static_cast<float>(tile.mSize);
+   viewport.maxDepth = 1;
+
+   const VkRect2D scissor {
+      {static_cast<int32_t>(tile.mX), static_cast<int32_t>(tile.mY)},
+      {tile.mSize, tile.mSize}
+   };
+
+   vkCmdSetViewport(commands, 0, 1, &viewport);
+   vkCmdSetScissor(commands, 0, 1, &scissor);
+
+   VkClearAttachment clear {};
+   clear.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+   clear.clearValue.depthStencil = {1.0f, 0};
+   const VkClearRect rect {scissor, 0, 1};
+   vkCmdClearAttachments(commands, 1, &clear, 1, &rect);
+
+   ShadowFaceMatrix(face, entry.mLight, viewProjection);
+}
+
+/// Draw a caster to the current cube face                                    
+///   @param state - the command buffer state                                 
+///   @param geometry - the caster's geometry                                 
+///   @param transform - the column-major model-view-projection               
+void ShadowAtlas::Draw(
+   CommandState& state, const VulkanGeometry* geometry, const float* transform
+) const {
+   const auto positions = geometry->GetPositionType();
+   if (not positions)
+      return;
+
+   const auto pipeline = GetPipeline(positions);
+   if (not pipeline)
+      return;
+
+   state.BindPipeline(pipeline);
+   vkCmdPushConstants(state.GetCommands(), mPipeLayout,
+      VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(float) * 16, transform);
+   geometry->Bind(state);
+   geometry->Render(state);
+}
+
+/// Finish rendering shadows                                                  
+///   @param state - the command buffer state                                 
+void ShadowAtlas::End(CommandState& state) const {
+   vkCmdEndRenderPass(state.GetCommands());
+}
+
+/// Check if some shadows didn't fit, and compiling all shadows from scratch  
+/// makes room for them, either by growing the atlas, or by freeing the       
+/// shadows of lights, that aren't compiled anymore. Shadows are freed only   
+/// when compiled from scratch, since draw lists that were kept might still   
+/// sample them                                                               
+///   @return true if all shadows should be compiled from scratch             
+bool ShadowAtlas::IsFull() const noexcept {
+   return mFull and not mExhausted;
+}
+
+/// Get the atlas image                                                       
+///   @return the image                                                       
+const VulkanImage& ShadowAtlas::GetImage() const noexcept {
+   return mImage;
+}
+
+/// Get the atlas image view                                                  
+///   @return the view                                                        
+VkImageView ShadowAtlas::GetView() const noexcept {
+   return mView;
+}
+
+/// Get the sampler, that the light shaders read the atlas with               
+///   @return the sampler                                                     
+VkSampler ShadowAtlas::GetSampler() const noexcept {
+   return mSampler;
+}
+
+/// Get the records of all cameras, in the current frame in flight            
+///   @return the record buffer                                               
+VkBuffer ShadowAtlas::GetRecords() const noexcept {
+   return mRecordBuffer[mRenderer->GetFrame()].GetBuffer();
+}
@@ -0,0 +1,131 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "VulkanBuffer.hpp"
+#include "CommandState.hpp"
+#include "Shadows.hpp"
+
+
+///                                                                           
+///   A light's shadow, as seen by the light shaders                          
+///                                                                           
+/// mToLight brings view-space positions to vectors from the light, in the    
+/// light's level. Each cube face (see ShadowFaceMatrix) is at mFaces.xy of   
+/// the atlas, and spans mFaces.zw of it, in normalized texture coordinates.  
+/// mDepth contains the near and far distances. The layout matches std430     
+///                                                                           
+struct ShadowRecord {
+   float mToLight[16];
+   float mFaces[6][4];
+   float mDepth[4];
+};
+
+
+///                                                                           
+///   Shadow atlas                                                            
+///                                                                           
+/// A single depth image, shared by the shadows of all lights in Shadowed     
+/// layers. Each light owns six squares of it - one for each cube face - for  
+/// as long as it is compiled every frame. A light's shadow is rendered       
+/// again only when the light, or any caster in its range, changes, and is    
+/// reused from the atlas otherwise. The atlas grows when it gets full - the  
+/// old one is destroyed only once the frames in flight are done sampling it. 
+/// Each frame in flight has its own records, uploaded when it comes around   
+///                                                                           
+struct ShadowAtlas {
+   static constexpr uint32_t MinSize = 1024;
+   static constexpr uint32_t MaxSize = 8192;
+   static constexpr uint32_t FaceSize = 256;
+
+private:
+   VulkanRenderer* mRenderer {};
+
+   // The atlas image, and the pass that renders to it                  
+   ShadowAtlasAllocator mAllocator;
+   uint32_t mSize {};
+   VulkanImage mImage;
+   Own<VkImageView> mView;
+   Own<VkSampler> mSampler;
+   Own<VkRenderPass> mPass;
+   Own<VkFramebuffer> mFrame;
+   // Whether an allocation failed, so that the atlas grows next frame, 
+   // and whether the atlas can't grow, and nothing was freed the last  
+   // time shadows were compiled from scratch                           
+   bool mFull {};
+   bool mExhausted {};
+
+   // Atlases replaced by bigger ones, and the frame in flight each was 
+   // replaced in - destroyed when that frame comes around again        
+   struct Retired {
+      VulkanImage mImage;
+      VkImageView mView;
+      VkFramebuffer mFrame;
+      uint32_t mFrameInFlight;
+   };
+
+   TMany<Retired> mRetired;
+
+   // Depth-only pipelines, one for each vertex position format         
+   struct Pipeline {
+      VkFormat mFormat;
+      uint32_t mStride;
+      VkPipeline mPipeline;
+   };
+
+   Own<VkPipelineLayout> mPipeLayout;
+   Own<VkShaderModule> mShader;
+   mutable TMany<Pipeline> mPipelines;
+
+   // Shadows of all lights, and whether they were compiled this frame  
+   struct Entry {
+      const void* mKey;
+      ShadowTile mFaces[6];
+      float mLight[4];
+      uint64_t mSignature;
+      bool mUsed;
+   };
+
+   TMany<Entry> mEntries;
+
+   // Shadows of all lights, for all cameras of the current draw lists  
+   TMany<ShadowRecord> mRecords;
+   // A bit for each frame in flight, whose buffer holds current records
+   uint32_t mFresh {};
+   // The records in the VRAM of each frame in flight                   
+   VulkanBuffer mRecordBuffer[MaxFramesInFlight];
+   Size mRecordsAllocated[MaxFramesInFlight] {};
+
+   void CreateImage(uint32_t);
+   void DestroyImage();
+   void RetireImage();
+   void Collect(bool all);
+   NOD() VkPipeline GetPipeline(DMeta) const;
+   NOD() int32_t Find(const void*) const noexcept;
+
+public:
+   void Create(VulkanRenderer*);
+   void Destroy();
+   void Clear();
+   void Truncate(Count);
+   void Upload();
+
+   NOD() int32_t Request(const void*, const float*, const ShadowCasters&, ::std::vector<uint32_t>&, bool&);
+   NOD() int32_t PushRecord(const void*, const Mat4&);
+   NOD() Count GetRecordCount() const noexcept;
+   NOD() bool IsFull() const noexcept;
+
+   void Begin(CommandState&) const;
+   void BeginFace(CommandState&, int32_t, int, float*) const;
+   void Draw(CommandState&, const VulkanGeometry*, const float*) const;
+   void End(CommandState&) const;
+
+   NOD() const VulkanImage& GetImage() const noexcept;
+   NOD() VkImageView GetView() const noexcept;
+   NOD() VkSampler GetSampler() const noexcept;
+   NOD() VkBuffer GetRecords() const noexcept;
+};
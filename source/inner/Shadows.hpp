@@ -0,0 +1,267 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "Signature.hpp"
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+/// Distance to the near plane of a shadow map, relative to the light range   
+constexpr float ShadowNearRatio = 0.01f;
+
+
+///                                                                           
+///   A square region of the shadow atlas, in texels                          
+///                                                                           
+struct ShadowTile {
+   uint32_t mX;
+   uint32_t mY;
+   uint32_t mSize;
+
+   bool operator == (const ShadowTile&) const = default;
+};
+
+
+///                                                                           
+///   Shadow atlas allocator                                                  
+///                                                                           
+/// Hands out power-of-two squares of a square atlas, by recursively          
+/// splitting bigger squares in four. Freed squares are merged back with      
+/// their siblings, so that the atlas doesn't fragment over time              
+///                                                                           
+struct ShadowAtlasAllocator {
+private:
+   uint32_t mSize {};
+   uint32_t mMinSize {};
+   // Free squares, one list for each size, biggest first               
+   ::std::vector<::std::vector<ShadowTile>> mFree;
+   // Number of texels handed out                                       
+   uint64_t mUsed {};
+
+   /// Get the free list for a square size                                    
+   ///   @param size - the size, must be a power of two in range              
+   ///   @return the index of the free list                                   
+   uint32_t LevelOf(uint32_t size) const noexcept {
+      uint32_t level = 0;
+      while ((mSize >> level) > size)
+         ++level;
+      return level;
+   }
+
+public:
+   /// Reset the allocator, freeing everything                                
+   ///   @param size - the atlas size, must be a power of two                 
+   ///   @param minSize - the smallest square, must be a power of two         
+   void Reset(uint32_t size, uint32_t minSize) {
+      mSize = size;
+      mMinSize = minSize;
+      mFree.assign(LevelOf(minSize) + 1, {});
+      mFree[0].push_back({0, 0, size});
+      mUsed = 0;
+   }
+
+   /// Allocate a square                                                      
+   ///   @param size - the requested size, rounded up to a power of two       
+   ///   @param tile - [out] the square                                       
+   ///   @return false if the atlas is full                                   
+   bool Allocate(uint32_t size, ShadowTile& tile) {
+      size = ::std::max(size, mMinSize);
+      if (size > mSize)
+         return false;
+
+      const auto level = LevelOf(size);
+
+      // Find the smallest free square, that is big enough              
+      auto from = static_cast<int>(level);
+      while (from >= 0 and mFree[from].empty())
+         --from;
+      if (from < 0)
+         return false;
+
+      // Split it down to the requested size                            
+      for (auto l = static_cast<uint32_t>(from); l < level; ++l) {
+         const auto parent = mFree[l].back();
+         mFree[l].pop_back();
+         const auto half = parent.mSize / 2;
+         mFree[l + 1].push_back({parent.mX + half, parent.mY + half, half});
+         mFree[l + 1].push_back({parent.mX, parent.mY + half, half});
+         mFree[l + 1].push_back({parent.mX + half, parent.mY, half});
+         mFree[l + 1].push_back({parent.mX, parent.mY, half});
+      }
+
+      tile = mFree[level].back();
+      mFree[level].pop_back();
+      mUsed += uint64_t {tile.mSize} * tile.mSize;
+      return true;
+   }
+
+   /// Free a square, merging it with its siblings, if they're free too       
+   ///   @param tile - the square, as returned by Allocate                    
+   void Free(ShadowTile tile) {
+      mUsed -= uint64_t {tile.mSize} * tile.mSize;
+      for (auto level = LevelOf(tile.mSize); level > 0; --level) {
+         auto& list = mFree[level];
+         const auto parentSize = tile.mSize * 2;
+         const auto px = tile.mX - tile.mX % parentSize;
+         const auto py = tile.mY - tile.mY % parentSize;
+
+         // All three siblings must be free to merge                    
+         uint32_t siblings = 0;
+         for (const auto& free : list) {
+            if (free.mX - free.mX % parentSize == px
+            and free.mY - free.mY % parentSize == py)
+               ++siblings;
+         }
+
+         if (siblings < 3) {
+            list.push_back(tile);
+            return;
+         }
+
+         ::std::erase_if(list, [&](const ShadowTile& free) {
+            return free.mX - free.mX % parentSize == px
+               and free.mY - free.mY % parentSize == py;
+         });
+         tile = {px, py, parentSize};
+      }
+
+      mFree[0].push_back(tile);
+   }
+
+   /// Get the number of texels, that are handed out                          
+   ///   @return the number of texels                                         
+   uint64_t GetUsed() const noexcept {
+      return mUsed;
+   }
+};
+
+
+///                                                                           
+///   Bounding sphere of a shadow caster, relative to its level               
+///                                                                           
+struct ShadowCaster {
+   float mModel[16];
+   float mCenter[3];
+   float mRadius;
+};
+
+using ShadowCasters = ::std::vector<ShadowCaster>;
+
+
+/// Make a shadow caster from a model transformation                          
+/// The caster is assumed to fit in the [-1;1] box, before transformation     
+///   @param model - the column-major model matrix                            
+///   @return the caster                                                      
+inline ShadowCaster MakeShadowCaster(const float* model) {
+   ShadowCaster result;
+   ::std::memcpy(result.mModel, model, sizeof(result.mModel));
+   result.mCenter[0] = model[12];
+   result.mCenter[1] = model[13];
+   result.mCenter[2] = model[14];
+
+   // The box's diagonal, stretched by the biggest axis scale           
+   float scale = 0;
+   for (int axis = 0; axis < 3; ++axis) {
+      const auto c = model + axis * 4;
+      scale = ::std::max(scale, c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+   }
+   result.mRadius = ::std::sqrt(scale * 3);
+   return result;
+}
+
+/// Find the casters, that might throw shadows in a light's range, and        
+/// make a signature of their placement, along with the light's own           
+/// Shadow maps must be rendered again, only when the signature changes       
+///   @param light - the light position in xyz, and its range in w            
+///   @param casters - all casters in the light's level                       
+///   @param touched - [out] indices of the relevant casters                  
+///   @return the signature                                                   
+inline uint64_t ShadowSignature(
+   const float* light, const ShadowCasters& casters,
+   ::std::vector<uint32_t>& touched
+) {
+   Signature signature;
+   signature.MixBytes(light, sizeof(float) * 4);
+   touched.clear();
+   for (uint32_t i = 0; i < casters.size(); ++i) {
+      const auto& caster = casters[i];
+      const float d[3] {
+         caster.mCenter[0] - light[0],
+         caster.mCenter[1] - light[1],
+         caster.mCenter[2] - light[2]
+      };
+      const auto reach = caster.mRadius + light[3];
+      if (d[0] * d[0] + d[1] * d[1] + d[2] * d[2] > reach * reach)
+         continue;
+
+      touched.push_back(i);
+      signature.Mix(i);
+      signature.Mix(caster.mModel);
+   }
+
+   return signature.mHash;
+}
+
+/// Make the view-projection of a cube face of a point light's shadow         
+/// The faces are +X, -X, +Y, -Y, +Z, -Z, and a vector v from the light       
+/// lands on the face of its major axis, at normalized device coordinates:    
+///   +X: (-v.z, -v.y) / v.x       -X: (v.z, -v.y) / -v.x                     
+///   +Y: (v.x, v.z) / v.y         -Y: (v.x, -v.z) / -v.y                     
+///   +Z: (v.x, -v.y) / v.z        -Z: (-v.x, -v.y) / -v.z                    
+/// Depth is perspective, from the light range times ShadowNearRatio, up to   
+/// the light range                                                           
+///   @param face - the face index                                            
+///   @param light - the light position in xyz, and its range in w            
+///   @param out - [out] the column-major matrix                              
+inline void ShadowFaceMatrix(int face, const float* light, float* out) {
+   // Axis and sign of the face's u, v and major components             
+   static constexpr int8_t table[6][6] {
+      {2, -1, 1, -1, 0, +1},
+      {2, +1, 1, -1, 0, -1},
+      {0, +1, 2, +1, 1, +1},
+      {0, +1, 2, -1, 1, -1},
+      {0, +1, 1, -1, 2, +1},
+      {0, -1, 1, -1, 2, -1}
+   };
+
+   const auto& t = table[face];
+   const auto far = light[3];
+   const auto near = far * ShadowNearRatio;
+   const auto a = far / (far - near);
+   const auto b = -far * near / (far - near);
+
+   // Rows of the projection, applied to the vector from the light      
+   float rows[4][4] {};
+   rows[0][t[0]] = t[1];
+   rows[1][t[2]] = t[3];
+   rows[2][t[4]] = a * t[5];
+   rows[2][3] = b;
+   rows[3][t[4]] = t[5];
+
+   // Translate by the light position, and store column-major           
+   for (int r = 0; r < 4; ++r) {
+      const auto offset = -(rows[r][0] * light[0] + rows[r][1] * light[1] + rows[r][2] * light[2]);
+      for (int c = 0; c < 3; ++c)
+         out[c * 4 + r] = rows[r][c];
+      out[12 + r] = rows[r][3] + offset;
+   }
+}
+
+/// Multiply two column-major matrices                                        
+///   @param a, b - the matrices                                              
+///   @param out - [out] a * b, must not overlap the inputs                   
+inline void MultiplyMatrices(const float* a, const float* b, float* out) {
+   for (int c = 0; c < 4; ++c) {
+      for (int r = 0; r < 4; ++r) {
+         out[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1]
+                        + a[8 + r] * b[c * 4 + 2] + a[12 + r] * b[c * 4 + 3];
+      }
+   }
+}
@@ -0,0 +1,37 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+
+///                                                                           
+///   A signature of some bytes                                               
+///                                                                           
+/// FNV-1a over everything mixed in, used to detect that something changed    
+/// since the last time it was used, without keeping a copy of it             
+///                                                                           
+struct Signature {
+   uint64_t mHash = 14695981039346656037ull;
+
+   /// Mix some bytes into the signature                                      
+   ///   @param data - the bytes                                              
+   ///   @param bytes - the number of bytes                                   
+   void MixBytes(const void* data, size_t bytes) noexcept {
+      const auto b = static_cast<const uint8_t*>(data);
+      for (size_t i = 0; i < bytes; ++i)
+         mHash = (mHash ^ b[i]) * 1099511628211ull;
+   }
+
+   /// Mix a value into the signature, byte by byte                           
+   ///   @param value - the value, must not have any padding                  
+   template<class T>
+   void Mix(const T& value) noexcept {
+      MixBytes(&value, sizeof(T));
+   }
+};
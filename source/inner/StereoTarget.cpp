@@ -0,0 +1,284 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "StereoTarget.hpp"
+#include "../Vulkan.hpp"
+
+
+/// Create the multiview render pass                                          
+/// Images are created on demand, once a stereo camera is planned             
+///   @param renderer - the renderer                                          
+///   @param format - the format of the back buffer                           
+void StereoTarget::Create(VulkanRenderer* renderer, VkFormat format) {
+   mRenderer = renderer;
+   mFormat = format;
+
+   // Color is copied in before the pass, and out after it - the        
+   // frame's render graph transitions it on both sides                 
+   VkAttachmentDescription attachments[2] {};
+   attachments[0].format = format;
+   attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+   attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+   attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+   attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+   attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+   attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+   attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+   // Depth is needed only while drawing                                
+   attachments[1].format = VK_FORMAT_D32_SFLOAT;
+   attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+   attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+   attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+   attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+   attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+   attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+   attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+   const VkAttachmentReference colorRef {
+      0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+   };
+   const VkAttachmentReference depthRef {
+      1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+   };
+
+   VkSubpassDescription subpass {};
+   subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+   subpass.colorAttachmentCount = 1;
+   subpass.pColorAttachments = &colorRef;
+   subpass.pDepthStencilAttachment = &depthRef;
+
+   // Same as the main pass' dependency                                 
+   VkSubpassDependency dependency {};
+   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+   dependency.dstSubpass = 0;
+   dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                           | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+   dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+   dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                           | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+                            | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+                            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+   // Each draw goes to both layers - the eyes see almost the same, so  
+   // implementations can share work between them                       
+   const uint32_t viewMask = ViewMask;
+   const uint32_t correlationMask = ViewMask;
+   VkRenderPassMultiviewCreateInfoKHR multiview {};
+   multiview.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO_KHR;
+   multiview.subpassCount = 1;
+   multiview.pViewMasks = &viewMask;
+   multiview.correlationMaskCount = 1;
+   multiview.pCorrelationMasks = &correlationMask;
+
+   VkRenderPassCreateInfo passInfo {};
+   passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+   passInfo.pNext = &multiview;
+   passInfo.attachmentCount = 2;
+   passInfo.pAttachments = attachments;
+   passInfo.subpassCount = 1;
+   passInfo.pSubpasses = &subpass;
+   passInfo.dependencyCount = 1;
+   passInfo.pDependencies = &dependency;
+   if (vkCreateRenderPass(renderer->mDevice, &passInfo, nullptr, &mPass.Get()))
+      LANGULUS_THROW(Graphics, "Can't create stereo pass");
+}
+
+/// Make sure the images fit an eye of the given size                         
+/// Must be called while no frame in flight uses them - eyes, that outgrow    
+/// the images in between, are cropped                                        
+///   @param width - the width of an eye, in pixels                           
+///   @param height - the height of an eye, in pixels                         
+void StereoTarget::Reserve(uint32_t width, uint32_t height) {
+   width = ::std::max(width, 1u);
+   height = ::std::max(height, 1u);
+   if (mColor.IsValid() and width <= mExtent.width and height <= mExtent.height)
+      return;
+
+   // Grow in both directions, so that resizing doesn't reallocate      
+   // every frame                                                       
+   width = ::std::max(width, mExtent.width);
+   height = ::std::max(height, mExtent.height);
+   DestroyImages();
+   mExtent = {width, height};
+
+   auto& vram = mRenderer->mVRAM;
+   bool reverse;
+   ImageView colorview {
+      width, height, 1, 2, VkFormatToDMeta(mFormat, reverse), reverse
+   };
+   mColor = vram.CreateImage(colorview,
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+    | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+    | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+   );
+   mColorView = vram.CreateImageView(
+      mColor.GetImage(), mColor.GetView(), VK_IMAGE_ASPECT_COLOR_BIT
+   );
+
+   ImageView depthview {width, height, 1, 2, MetaOf<Depth32>()};
+   mDepth = vram.CreateImage(depthview,
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+   mDepthView = vram.CreateImageView(mDepth);
+
+   // Multiview framebuffers have a single layer, the views select the  
+   // layers of the attachments                                         
+   const VkImageView views[] {mColorView, mDepthView};
+   VkFramebufferCreateInfo frameInfo {};
+   frameInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+   frameInfo.renderPass = mPass;
+   frameInfo.attachmentCount = 2;
+   frameInfo.pAttachments = views;
+   frameInfo.width = width;
+   frameInfo.height = height;
+   frameInfo.layers = 1;
+   if (vkCreateFramebuffer(mRenderer->mDevice, &frameInfo, nullptr, &mFrame.Get()))
+      LANGULUS_THROW(Graphics, "Can't create stereo framebuffer");
+}
+
+/// Destroy the images                                                        
+void StereoTarget::DestroyImages() {
+   const auto device = mRenderer->mDevice.Get();
+   if (mFrame) {
+      vkDestroyFramebuffer(device, mFrame, nullptr);
+      mFrame.Reset();
+   }
+
+   if (mColorView) {
+      vkDestroyImageView(device, mColorView, nullptr);
+      mColorView.Reset();
+   }
+
+   if (mDepthView) {
+      vkDestroyImageView(device, mDepthView, nullptr);
+      mDepthView.Reset();
+   }
+
+   if (mColor.IsValid())
+      mRenderer->mVRAM.DestroyImage(mColor);
+   if (mDepth.IsValid())
+      mRenderer->mVRAM.DestroyImage(mDepth);
+   mExtent = {};
+}
+
+/// Destroy everything                                                        
+void StereoTarget::Destroy() {
+   if (not mRenderer)
+      return;
+
+   DestroyImages();
+   if (mPass) {
+      vkDestroyRenderPass(mRenderer->mDevice, mPass, nullptr);
+      mPass.Reset();
+   }
+
+   mRenderer = nullptr;
+}
+
+/// Get the regions of both eyes, in the back buffer and in the layers        
+///   @param area - the camera's scissor in the back buffer                   
+///   @param limit - the size of the layers                                   
+///   @param regions - [out] a copy region for each eye                       
+///   @param in - whether copying from the back buffer to the layers          
+static void GetEyeRegions(
+   const VkRect2D& area, const VkExtent2D& limit, VkImageCopy* regions, bool in
+) {
+   const auto half = area.extent.width / 2;
+   for (uint32_t eye = 0; eye < 2; ++eye) {
+      VkImageSubresourceLayers back {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+      VkImageSubresourceLayers layer {VK_IMAGE_ASPECT_COLOR_BIT, 0, eye, 1};
+      const VkOffset3D backOffset {
+         area.offset.x + static_cast<int32_t>(half * eye), area.offset.y, 0
+      };
+
+      auto& region = regions[eye];
+      region.srcSubresource = in ? back : layer;
+      region.srcOffset = in ? backOffset : VkOffset3D {};
+      region.dstSubresource = in ? layer : back;
+      region.dstOffset = in ? VkOffset3D {} : backOffset;
+      region.extent = {
+         ::std::min(half, limit.width),
+         ::std::min(area.extent.height, limit.height), 1
+      };
+   }
+}
+
+/// Copy the halves of the camera's viewport to the layers of the eyes, so    
+/// that the stereo pass draws over what's already there                      
+/// Must be recorded outside of any render pass                               
+///   @param state - the command buffer state                                 
+///   @param back - the back buffer, in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL  
+///   @param area - the camera's scissor                                      
+void StereoTarget::CopyIn(CommandState& state, const VulkanImage& back, const VkRect2D& area) const {
+   VkImageCopy regions[2] {};
+   GetEyeRegions(area, mExtent, regions, true);
+   vkCmdCopyImage(state.GetCommands(),
+      back.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      mColor.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      2, regions
+   );
+}
+
+/// Copy the drawn eyes back to the halves of the camera's viewport           
+/// Must be recorded outside of any render pass                               
+///   @param state - the command buffer state                                 
+///   @param back - the back buffer, in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL  
+///   @param area - the camera's scissor                                      
+void StereoTarget::CopyOut(CommandState& state, const VulkanImage& back, const VkRect2D& area) const {
+   VkImageCopy regions[2] {};
+   GetEyeRegions(area, mExtent, regions, false);
+   vkCmdCopyImage(state.GetCommands(),
+      mColor.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      back.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      2, regions
+   );
+}
+
+/// Begin the stereo pass, clearing depth of both eyes                        
+///   @param state - the command buffer state                                 
+///   @param extent - the size of an eye, clamped to the reserved images      
+void StereoTarget::Begin(CommandState& state, const VkExtent2D& extent) const {
+   VkClearValue clear[2] {};
+   clear[1].depthStencil = {1.0f, 0};
+
+   VkRenderPassBeginInfo passInfo {};
+   passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+   passInfo.renderPass = mPass;
+   passInfo.framebuffer = mFrame;
+   passInfo.renderArea.extent.width = ::std::min(extent.width, mExtent.width);
+   passInfo.renderArea.extent.height = ::std::min(extent.height, mExtent.height);
+   passInfo.clearValueCount = 2;
+   passInfo.pClearValues = clear;
+   vkCmdBeginRenderPass(state.GetCommands(), &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+/// Finish the stereo pass                                                    
+///   @param state - the command buffer state                                 
+void StereoTarget::End(CommandState& state) const {
+   vkCmdEndRenderPass(state.GetCommands());
+}
+
+/// Get the multiview render pass                                             
+///   @return the pass, or null if the device has no multiview                
+VkRenderPass StereoTarget::GetPass() const noexcept {
+   return mPass;
+}
+
+/// Get the color layers of both eyes                                         
+///   @return the image                                                       
+const VulkanImage& StereoTarget::GetColor() const noexcept {
+   return mColor;
+}
+
+/// Get the depth layers of both eyes                                         
+///   @return the image                                                       
+const VulkanImage& StereoTarget::GetDepth() const noexcept {
+   return mDepth;
+}
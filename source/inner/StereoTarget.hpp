@@ -0,0 +1,58 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "VulkanMemory.hpp"
+#include "CommandState.hpp"
+
+
+///                                                                           
+///   Stereo render target                                                    
+///                                                                           
+/// Stereo cameras of forward batched layers draw both eyes at once, in a     
+/// multiview render pass - each draw call is broadcast to both layers of     
+/// the target, and vertex shaders pick the eye by gl_ViewIndex. The halves   
+/// of the camera's viewport are copied from the back buffer to the layers    
+/// before drawing, and back after it. Depth lives only in the pass, so it    
+/// is cleared, and never stored                                              
+///                                                                           
+struct StereoTarget {
+   // Both eyes are drawn, so both views are enabled and correlated     
+   static constexpr uint32_t ViewMask = 0b11;
+
+private:
+   VulkanRenderer* mRenderer {};
+
+   // The multiview render pass                                         
+   Own<VkRenderPass> mPass;
+   VkFormat mFormat {};
+
+   // Two-layered color and depth, one layer for each eye, and the      
+   // size of each eye                                                  
+   VkExtent2D mExtent {};
+   VulkanImage mColor;
+   VulkanImage mDepth;
+   Own<VkImageView> mColorView;
+   Own<VkImageView> mDepthView;
+   Own<VkFramebuffer> mFrame;
+
+   void DestroyImages();
+
+public:
+   void Create(VulkanRenderer*, VkFormat);
+   void Destroy();
+   void Reserve(uint32_t, uint32_t);
+
+   void CopyIn(CommandState&, const VulkanImage&, const VkRect2D&) const;
+   void CopyOut(CommandState&, const VulkanImage&, const VkRect2D&) const;
+   void Begin(CommandState&, const VkExtent2D&) const;
+   void End(CommandState&) const;
+
+   NOD() VkRenderPass GetPass() const noexcept;
+   NOD() const VulkanImage& GetColor() const noexcept;
+   NOD() const VulkanImage& GetDepth() const noexcept;
+};
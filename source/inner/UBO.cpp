@@ -16,10 +16,12 @@ UBO::~UBO() {
 
 /// Free uniform buffer                                                       
 void UBO::Destroy() {
-   if (not mBuffer.IsValid())
-      return;
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      if (mBuffer[frame].IsValid())
+         mRenderer->mVRAM.DestroyBuffer(mBuffer[frame]);
+      mBufferSize[frame] = 0;
+   }
 
-   mRenderer->mVRAM.DestroyBuffer(mBuffer);
    mRAM.Reset();
 }
 
@@ -27,6 +29,7 @@ void UBO::Destroy() {
 void UBO::CalculateSizes() {
    // Calculate required UBO buffer sizes for the whole pipeline        
    Offset range = 0;
+   Offset largestAlignment = 1;
    for (auto& it : mUniforms) {
       auto concrete = it.mTrait.GetType()->GetMostConcrete();
 
@@ -66,15 +69,27 @@ void UBO::CalculateSizes() {
       LANGULUS_ASSERT(baseAlignment, Graphics, "Bad uniform alignment");
       it.mPosition = Align(range, baseAlignment);
       range = it.mPosition + it.mTrait.GetStride();
+      largestAlignment = ::std::max(largestAlignment, baseAlignment);
    }
 
-   if (range) {
+   if (not range)
+      return;
+
+   if (mStorage) {
+      // Elements of a std430 array are aligned only to the largest     
+      // alignment of their members - the whole region is bound instead 
+      mStride = Align(range, largestAlignment);
+   }
+   else {
       mStride = Align(range, mRenderer->GetOuterUBOAlignment());
-      mDescriptor.range = mStride;
+      for (auto& descriptor : mDescriptor)
+         descriptor.range = mStride;
    }
 }
 
 /// Reallocate a dynamic uniform buffer object                                
+/// Only the RAM grows here - the buffers of the frames in flight grow when   
+/// their frame comes around, so the GPU might still be reading them          
 ///   @param elements - the number of buffer elements to allocate             
 void UBO::Reallocate(const Count elements) {
    if (not IsValid() or mAllocated >= elements) {
@@ -82,23 +97,38 @@ void UBO::Reallocate(const Count elements) {
       return;
    }
 
-   if (mBuffer.IsValid()) {
-      // No way to resize VRAM in place, so free the previous buffer    
-      mRenderer->mVRAM.DestroyBuffer(mBuffer);
-   }
-
-   // Create the buffer in VRAM                                         
    mAllocated = elements;
-   const auto byteSize = mStride * mAllocated;
-   mBuffer = mRenderer->mVRAM.CreateBuffer(
-      nullptr, VkDeviceSize {byteSize},
-      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
+   mRegion = mStride * mAllocated;
+   mFresh = 0;
+
+   // Resize the RAM data, retaining contained data                     
+   mRAM.Reserve(mRegion);
+}
+
+/// Make sure the buffer of a frame in flight can hold all of the RAM         
+/// The GPU must be done with that frame                                      
+///   @param frame - the frame in flight                                      
+void UBO::Prepare(uint32_t frame) const {
+   if (mBufferSize[frame] >= mRegion)
+      return;
+
+   // No way to resize VRAM in place, so free the previous buffer       
+   if (mBuffer[frame].IsValid())
+      mRenderer->mVRAM.DestroyBuffer(mBuffer[frame]);
+
+   mBufferSize[frame] = mRegion;
+   mBuffer[frame] = mRenderer->mVRAM.CreateBuffer(
+      nullptr, VkDeviceSize {mRegion},
+      mStorage ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
    );
-   mDescriptor.buffer = mBuffer.GetBuffer();
 
-   // Resize the RAM data, retaining contained data                     
-   mRAM.Reserve(byteSize);
+   // The frame's set must point to the new buffer                      
+   mDescriptor[frame].buffer = mBuffer[frame].GetBuffer();
+   mDescriptor[frame].offset = 0;
+   if (mStorage)
+      mDescriptor[frame].range = mRegion;
+   mBound &= ~(1u << frame);
 }
 
 /// Initialize a dynamic uniform buffer object                                
@@ -131,14 +161,25 @@ void DataUBO<false>::Create(VulkanRenderer* renderer) {
    }
 }
 
-/// Update a dynamic uniform buffer in VRAM                                   
+/// Update a dynamic uniform buffer in VRAM, if it changed since the last     
+/// time this frame in flight used it - draw lists reused from the previous   
+/// frames don't upload anything                                              
 ///   @param binding - binding index                                          
-///   @param set - the set to update                                          
+///   @param set - the set of the frame in flight                             
+///   @param frame - the frame in flight                                      
 ///   @param output - [out] where updates are registered                      
 template<>
-void DataUBO<true>::Update(uint32_t binding, const VkDescriptorSet& set, BufferUpdates& output) const {
-   if (not IsValid() or not mUsedCount)
+void DataUBO<true>::Update(uint32_t binding, const VkDescriptorSet& set, uint32_t frame, BufferUpdates& output) const {
+   const auto bit = 1u << frame;
+   if (not IsValid() or not mUsedCount or (mFresh & bit))
       return;
+   mFresh |= bit;
+
+   Prepare(frame);
+   mBuffer[frame].Upload(0, mUsedCount * mStride, mRAM.GetRaw());
+   if (mBound & bit)
+      return;
+   mBound |= bit;
 
    output.New();
 
@@ -146,20 +187,31 @@ void DataUBO<true>::Update(uint32_t binding, const VkDescriptorSet& set, BufferU
    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
    write.dstSet = set;
    write.dstBinding = binding;
-   write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+   write.descriptorType = mStorage
+      ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+      : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
    write.descriptorCount = 1;
-   write.pBufferInfo = &mDescriptor;
-   mBuffer.Upload(0, mUsedCount * mStride, mRAM.GetRaw());
+   write.pBufferInfo = &mDescriptor[frame];
 }
 
-/// Update a static uniform buffer in VRAM                                    
+/// Update a static uniform buffer in VRAM, if it changed since the last time 
+/// this frame in flight used it                                              
 ///   @param binding - binding index                                          
-///   @param set - the set to update                                          
+///   @param set - the set of the frame in flight                             
+///   @param frame - the frame in flight                                      
 ///   @param output - [out] where updates are registered                      
 template<>
-void DataUBO<false>::Update(uint32_t binding, const VkDescriptorSet& set, BufferUpdates& output) const {
-   if (not IsValid())
+void DataUBO<false>::Update(uint32_t binding, const VkDescriptorSet& set, uint32_t frame, BufferUpdates& output) const {
+   const auto bit = 1u << frame;
+   if (not IsValid() or (mFresh & bit))
       return;
+   mFresh |= bit;
+
+   Prepare(frame);
+   mBuffer[frame].Upload(0, mStride, mRAM.GetRaw());
+   if (mBound & bit)
+      return;
+   mBound |= bit;
 
    output.New();
 
@@ -169,35 +221,41 @@ void DataUBO<false>::Update(uint32_t binding, const VkDescriptorSet& set, Buffer
    write.dstBinding = binding;
    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
    write.descriptorCount = 1;
-   write.pBufferInfo = &mDescriptor;
-   mBuffer.Upload(0, mStride, mRAM.GetRaw());
+   write.pBufferInfo = &mDescriptor[frame];
 }
 
 /// Explicit abandon-construction                                             
 ///   @param other - the sampler UBO to abandon                               
 SamplerUBO::SamplerUBO(Abandoned<SamplerUBO>&& other) noexcept
    : mRenderer {other->mRenderer}
-   , mPool {other->mPool}
-   , mSamplersUBOSet {other->mSamplersUBOSet}
    , mSamplers {Abandon(other->mSamplers)}
-   , mUniforms {Abandon(other->mUniforms)} {
-   other->mSamplersUBOSet = VkDescriptorSet {};
+   , mUniforms {Abandon(other->mUniforms)}
+   , mFresh {other->mFresh} {
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      mPool[frame] = other->mPool[frame];
+      mSamplersUBOSet[frame] = other->mSamplersUBOSet[frame];
+      other->mSamplersUBOSet[frame] = VkDescriptorSet {};
+   }
 }
 
-/// Free up a sampler set                                                     
+/// Free up the sampler sets                                                  
 SamplerUBO::~SamplerUBO() {
-   if (mSamplersUBOSet) {
-      vkFreeDescriptorSets(mRenderer->mDevice, mPool, 1, &mSamplersUBOSet.Get());
-      mSamplersUBOSet.Reset();
+   for (uint32_t frame = 0; frame < MaxFramesInFlight; ++frame) {
+      if (mSamplersUBOSet[frame]) {
+         vkFreeDescriptorSets(mRenderer->mDevice, mPool[frame], 1, &mSamplersUBOSet[frame].Get());
+         mSamplersUBOSet[frame].Reset();
+      }
    }
 }
 
-/// Initialize a sampler uniform buffer object                                
+/// Initialize a sampler uniform buffer object, with a set for each frame in  
+/// flight                                                                    
 ///   @param renderer - the renderer                                          
-///   @param pool - the pool used for UBOs                                    
-void SamplerUBO::Create(VulkanRenderer* renderer, VkDescriptorPool pool) {
+///   @param layout - the layout of the sets                                  
+void SamplerUBO::Create(VulkanRenderer* renderer, UBOLayout layout) {
    mRenderer = renderer;
-   mPool = pool;
+   for (uint32_t frame = 0; frame < renderer->mFramesInFlight; ++frame)
+      mSamplersUBOSet[frame] = renderer->mLayouts.Allocate(layout, mPool[frame]);
    mSamplers.New(mUniforms.GetCount());
 
    for (Offset id = 0; id < mUniforms.GetCount(); ++id) {
@@ -209,9 +267,16 @@ void SamplerUBO::Create(VulkanRenderer* renderer, VkDescriptorPool pool) {
    }
 }
 
-/// Update the sampler buffer in VRAM                                         
+/// Write the set of a frame in flight, if samplers changed since the last    
+/// time that frame used it                                                   
+///   @param frame - the frame in flight                                      
 ///   @param output - [out] where updates are registered                      
-void SamplerUBO::Update(BufferUpdates& output) const {
+void SamplerUBO::Update(uint32_t frame, BufferUpdates& output) const {
+   const auto bit = 1u << frame;
+   if (mFresh & bit)
+      return;
+   mFresh |= bit;
+
    for (Offset i = 0; i < mSamplers.GetCount(); ++i) {
       if (not mSamplers[i].sampler)
          continue;
@@ -220,7 +285,7 @@ void SamplerUBO::Update(BufferUpdates& output) const {
 
       auto& write = output.Last();
       write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      write.dstSet = mSamplersUBOSet;
+      write.dstSet = mSamplersUBOSet[frame];
       write.dstBinding = static_cast<uint32_t>(i);
       write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
       write.descriptorCount = 1;
@@ -247,4 +312,5 @@ void SamplerUBO::Set(const VulkanTexture* texture, Offset index) {
    sampler.imageView = texture->GetImageView();
    sampler.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
    mSamplers[index] = sampler;
+   mFresh = 0;
 }
@@ -26,20 +26,38 @@ struct Uniform {
 ///                                                                           
 ///   General purpose uniform buffer object                                   
 ///                                                                           
+/// Each frame in flight has its own buffer, so that a frame can be uploaded  
+/// and even grown, while the GPU still reads the previous ones. Instance     
+/// data is in a storage buffer instead, whose blocks are indexed by the      
+/// instance being drawn, so blocks are tightly packed, as std430 lays out    
+/// arrays                                                                    
+///                                                                           
 struct UBO {
    VulkanRenderer* mRenderer {};
    Size mAllocated {};
    Size mStride {};
+   // Bytes each frame in flight holds                                  
+   Size mRegion {};
    Bytes mRAM;
-   VulkanBuffer mBuffer;
-   VkDescriptorBufferInfo mDescriptor {};
+   // Buffers of the frames in flight, and their sizes - each is        
+   // reallocated only when its frame comes around                      
+   mutable VulkanBuffer mBuffer[MaxFramesInFlight];
+   mutable Size mBufferSize[MaxFramesInFlight] {};
+   mutable VkDescriptorBufferInfo mDescriptor[MaxFramesInFlight] {};
    TMany<Uniform> mUniforms;
    VkShaderStageFlags mStages {};
+   // Whether the buffer is a storage buffer, indexed by the instance   
+   bool mStorage {};
+   // A bit for each frame in flight, whose region holds current mRAM   
+   mutable uint32_t mFresh {};
+   // A bit for each frame in flight, whose set points to its region    
+   mutable uint32_t mBound {};
 
    ~UBO();
 
    void CalculateSizes();
    void Reallocate(Count);
+   void Prepare(uint32_t) const;
    void Destroy();
    NOD() bool IsValid() const noexcept {
       return mStride > 0;
@@ -75,7 +93,7 @@ public:
    }
 
    void Create(VulkanRenderer*);
-   void Update(uint32_t, const VkDescriptorSet&, BufferUpdates&) const;
+   void Update(uint32_t, const VkDescriptorSet&, uint32_t, BufferUpdates&) const;
 
    /// Set the value of a trait inside last active block                      
    /// Will set nothing, if trait is not part of the UBO                      
@@ -84,6 +102,18 @@ public:
    ///   @param value - the value to set                                      
    template<CT::Trait TRAIT, CT::Data DATA>
    bool Set(const DATA& value) {
+      return SetAt<TRAIT>(value, mUsedCount);
+   }
+
+   /// Set the value of a trait inside any allocated block, such as the block 
+   /// of an instance, that moved since it was pushed                         
+   /// Will set nothing, if trait is not part of the UBO                      
+   ///   @tparam TRAIT - the trait to search for                              
+   ///   @tparam DATA - the value to set                                      
+   ///   @param value - the value to set                                      
+   ///   @param block - the index of the block                                
+   template<CT::Trait TRAIT, CT::Data DATA>
+   bool SetAt(const DATA& value, Count block) {
       static_assert(CT::Dense<DATA>, "DATA must be dense");
       static_assert(CT::POD<DATA>, "DATA must be POD");
 
@@ -91,8 +121,9 @@ public:
          if (not it.mTrait.template IsTrait<TRAIT>())
             continue;
 
-         const auto offset = mUsedCount * mStride + it.mPosition;
+         const auto offset = block * mStride + it.mPosition;
          ::std::memcpy(mRAM.GetRaw() + offset, &value, sizeof(DATA));
+         mFresh = 0;
          return true;
       }
 
@@ -102,8 +133,10 @@ public:
    /// Allocate another block inside the dynamic UBO                          
    /// Any subsequent Set(s) will be set in the new block                     
    void Push() requires (DYNAMIC) {
-      if (mStride)
+      if (mStride) {
          Reallocate(++mUsedCount);
+         mFresh = 0;
+      }
    }
 };
 
@@ -114,14 +147,18 @@ public:
 ///   Wraps either                                                            
 /// VK_DESCRIPTOR_TYPE_SAMPLER or VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER   
 /// These are updated only at Rate::Renderable, one such is used for          
-/// layout(set = 2)                                                           
+/// layout(set = 2). Each frame in flight has its own set, which is written   
+/// when that frame comes around, so samplers can change while the GPU still  
+/// reads the sets of the other frames                                        
 ///                                                                           
 struct SamplerUBO {
    VulkanRenderer* mRenderer {};
-   VkDescriptorPool mPool;
-   Own<VkDescriptorSet> mSamplersUBOSet;
+   VkDescriptorPool mPool[MaxFramesInFlight] {};
+   Own<VkDescriptorSet> mSamplersUBOSet[MaxFramesInFlight];
    TMany<VkDescriptorImageInfo> mSamplers;
    TMany<Uniform> mUniforms;
+   // A bit for each frame in flight, whose set holds current samplers  
+   mutable uint32_t mFresh {};
 
    SamplerUBO() = default;
    SamplerUBO(const SamplerUBO&) noexcept = default;
@@ -131,7 +168,7 @@ struct SamplerUBO {
 
    bool operator == (const SamplerUBO&) const noexcept;
 
-   void Create(VulkanRenderer*, VkDescriptorPool);
-   void Update(BufferUpdates&) const;
+   void Create(VulkanRenderer*, UBOLayout);
+   void Update(uint32_t, BufferUpdates&) const;
    void Set(const VulkanTexture*, Offset = 0);
 };
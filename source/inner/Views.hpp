@@ -0,0 +1,168 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "Glsl.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+
+///                                                                           
+///   What a pass draws from a camera's point of view                         
+///                                                                           
+enum class Eye : uint8_t {
+   // The camera itself                                                 
+   Mono,
+   // One eye of a stereo camera, to its half of the camera's viewport  
+   Left,
+   Right,
+   // Both eyes at once, to the layers of a multiview render pass       
+   Both
+};
+
+
+///                                                                           
+///   Transforms of the views, a draw call is rendered to                     
+///                                                                           
+/// Material shaders project to the camera's clip space. Vertex shaders then  
+/// move gl_Position to the clip space of the view they're drawing, which is  
+/// selected by gl_ViewIndex in multiview render passes, and is always the    
+/// first one otherwise. An eye is the camera, moved sideways by half of the  
+/// eye separation, so its transform is P * Translate(offset) * P^-1. Views   
+/// are pushed as constants, only to the variants of material pipelines, that 
+/// draw stereo cameras - pipelines of the camera itself don't transform it   
+///                                                                           
+struct ViewTransforms {
+   static constexpr uint32_t MaxViews = 2;
+
+   // Column-major transforms of each view                              
+   float mViews[MaxViews][16];
+
+   /// Get the transforms of a pass, that draws the camera itself, or the     
+   /// default one - all views are identities                                 
+   ///   @return the transforms                                               
+   static ViewTransforms Mono() noexcept {
+      ViewTransforms result;
+      for (auto& view : result.mViews) {
+         for (int i = 0; i < 16; ++i)
+            view[i] = i % 5 == 0 ? 1.0f : 0.0f;
+      }
+      return result;
+   }
+
+   /// Get the transforms of a pass                                           
+   ///   @param eye - what the pass draws                                     
+   ///   @param projection - the camera's column-major projection             
+   ///   @param inverse - the inverse of the projection                       
+   ///   @param separation - distance between the eyes, negative to swap them 
+   ///   @return the transforms                                               
+   static ViewTransforms For(
+      Eye eye, const float* projection, const float* inverse, float separation
+   ) noexcept {
+      ViewTransforms result;
+      const auto half = separation * 0.5f;
+      switch (eye) {
+      case Eye::Left:
+         result = Mono();
+         Shift(projection, inverse, half, result.mViews[0]);
+         break;
+      case Eye::Right:
+         result = Mono();
+         Shift(projection, inverse, -half, result.mViews[0]);
+         break;
+      case Eye::Both:
+         Shift(projection, inverse, half, result.mViews[0]);
+         Shift(projection, inverse, -half, result.mViews[1]);
+         break;
+      default:
+         result = Mono();
+      }
+      return result;
+   }
+
+   /// Get the clip space transform of moving a camera sideways               
+   /// Translating view space along X only touches the projection's first     
+   /// column, so the transform is the identity, plus the offset times the    
+   /// outer product of that column and the inverse's last row                
+   ///   @param projection - the camera's column-major projection             
+   ///   @param inverse - the inverse of the projection                       
+   ///   @param offset - how far the scene moves along view space X           
+   ///   @param out - [out] the column-major transform                        
+   static void Shift(
+      const float* projection, const float* inverse, float offset, float* out
+   ) noexcept {
+      for (int column = 0; column < 4; ++column) {
+         for (int row = 0; row < 4; ++row) {
+            out[column * 4 + row] = (column == row ? 1.0f : 0.0f)
+               + offset * projection[row] * inverse[column * 4 + 3];
+         }
+      }
+   }
+
+   bool operator == (const ViewTransforms& rhs) const noexcept {
+      return 0 == ::std::memcmp(mViews, rhs.mViews, sizeof(mViews));
+   }
+};
+
+/// Check if shader code declares a push constant block of its own            
+///   @param code - the GLSL code                                             
+///   @return true if any layout qualifier contains push_constant             
+inline bool HasPushConstants(::std::string_view code) {
+   constexpr auto npos = ::std::string_view::npos;
+   for (auto i = GlslFindWord(code, "layout"); i != npos; i = GlslFindWord(code, "layout", i + 1)) {
+      const auto open = GlslSkipSpace(code, i + 6);
+      if (open >= code.size() or code[open] != '(')
+         continue;
+      const auto close = code.find(')', open);
+      if (close == npos)
+         break;
+
+      if (GlslFindWord(code.substr(open + 1, close - open - 1), "push_constant") != npos)
+         return true;
+   }
+   return false;
+}
+
+/// Append the view transforms to a vertex shader. Its main function is       
+/// renamed, and called by a new one, that transforms gl_Position afterwards  
+///   @param code - the GLSL code of the vertex shader                        
+///   @param multiview - whether views are selected by gl_ViewIndex           
+///   @return the new code                                                    
+inline ::std::string InjectViews(::std::string_view code, bool multiview) {
+   // Everything must come after the version directive                  
+   auto split = code.find("#version");
+   if (split != ::std::string_view::npos) {
+      split = code.find('\n', split);
+      split = split == ::std::string_view::npos ? code.size() : split + 1;
+   }
+   else split = 0;
+
+   ::std::string result;
+   result.reserve(code.size() + 512);
+   result.append(code.substr(0, split));
+   if (split and result.back() != '\n')
+      result += '\n';
+   if (multiview)
+      result += "#extension GL_EXT_multiview : require\n";
+
+   result += "layout(push_constant) uniform LangulusViews {\n"
+             "   mat4 LangulusView[" + ::std::to_string(ViewTransforms::MaxViews) + "];\n"
+             "};\n"
+             "#define main LangulusMain\n";
+   result.append(code.substr(split));
+
+   result += "\n#undef main\n"
+             "void main() {\n"
+             "   LangulusMain();\n";
+   result += multiview
+      ? "   gl_Position = LangulusView[gl_ViewIndex] * gl_Position;\n"
+      : "   gl_Position = LangulusView[0] * gl_Position;\n";
+   result += "}\n";
+   return result;
+}
@@ -54,12 +54,22 @@ public:
 };
 
 
+/// All accesses, that write memory                                           
+constexpr VkAccessFlags WriteAccess = VK_ACCESS_SHADER_WRITE_BIT
+   | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+   | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+   | VK_ACCESS_TRANSFER_WRITE_BIT
+   | VK_ACCESS_HOST_WRITE_BIT
+   | VK_ACCESS_MEMORY_WRITE_BIT;
+
+
 ///                                                                           
 ///   VRAM image                                                              
 ///                                                                           
 class VulkanImage : public VRAM {
 protected:
    friend struct VulkanMemory;
+   friend struct Barriers;
 
    // Meta                                                              
    ImageView mView;
@@ -68,6 +78,17 @@ protected:
    // VRAM image info                                                   
    VkImageCreateInfo mInfo {};
 
+   // Layout of the image, and the last access to it, as recorded by    
+   // the barriers that transitioned it. Barriers are recorded, before  
+   // they execute, so this is the state the image will be in. Reads    
+   // after a write accumulate, so these are all accesses the last      
+   // write was made visible to, and that write is kept separately      
+   mutable VkImageLayout mLayout {VK_IMAGE_LAYOUT_UNDEFINED};
+   mutable VkAccessFlags mAccess {};
+   mutable VkPipelineStageFlags mStages {};
+   mutable VkAccessFlags mWriteAccess {};
+   mutable VkPipelineStageFlags mWriteStages {};
+
 public:
    static VulkanImage FromSwapchain(const VkDevice&, const VkImage&, const ImageView&) noexcept;
 
@@ -76,6 +97,11 @@ public:
    NOD() const ImageView& GetView() const noexcept;
    NOD() VkImage GetImage() const noexcept;
    NOD() const VkImageCreateInfo& GetImageCreateInfo() const noexcept;
+   NOD() VkImageLayout GetLayout() const noexcept;
+   NOD() VkImageAspectFlags GetAspect() const noexcept;
+   NOD() VkImageSubresourceRange GetRange() const noexcept;
+
+   void Assume(VkImageLayout, VkAccessFlags, VkPipelineStageFlags) const noexcept;
 };
 
 #include "VulkanBuffer.inl"
\ No newline at end of file
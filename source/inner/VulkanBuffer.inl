@@ -96,6 +96,11 @@ void VulkanImage::Reset() noexcept {
    mView = {};
    mInfo = {};
    mBuffer.Reset();
+   mLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+   mAccess = {};
+   mStages = {};
+   mWriteAccess = {};
+   mWriteStages = {};
    VRAM::Reset();
 }
 
@@ -119,3 +124,54 @@ LANGULUS(INLINED)
 const VkImageCreateInfo& VulkanImage::GetImageCreateInfo() const noexcept {
    return mInfo;
 }
+
+/// Get the layout, the image is in after all recorded barriers               
+///   @return the layout                                                      
+LANGULUS(INLINED)
+VkImageLayout VulkanImage::GetLayout() const noexcept {
+   return mLayout;
+}
+
+/// Get the aspects of the image, depending on its format                     
+///   @return the depth and/or stencil aspects for depth formats, or the      
+///           color aspect otherwise (including swapchain images)             
+LANGULUS(INLINED)
+VkImageAspectFlags VulkanImage::GetAspect() const noexcept {
+   switch (mInfo.format) {
+   case VK_FORMAT_D16_UNORM:
+   case VK_FORMAT_X8_D24_UNORM_PACK32:
+   case VK_FORMAT_D32_SFLOAT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT;
+   case VK_FORMAT_D16_UNORM_S8_UINT:
+   case VK_FORMAT_D24_UNORM_S8_UINT:
+   case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+   case VK_FORMAT_S8_UINT:
+      return VK_IMAGE_ASPECT_STENCIL_BIT;
+   default:
+      return VK_IMAGE_ASPECT_COLOR_BIT;
+   }
+}
+
+/// Get the subresource range, that covers all mips and layers of the image   
+///   @return the range                                                       
+LANGULUS(INLINED)
+VkImageSubresourceRange VulkanImage::GetRange() const noexcept {
+   return {GetAspect(), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+}
+
+/// Set the state of the image, when it was changed by something other than   
+/// a barrier, such as the final layout of a render pass                      
+///   @param layout - the layout the image is in                              
+///   @param access - the last access to the image                            
+///   @param stages - the stages of that access                               
+LANGULUS(INLINED)
+void VulkanImage::Assume(VkImageLayout layout, VkAccessFlags access, VkPipelineStageFlags stages) const noexcept {
+   mLayout = layout;
+   mAccess = access;
+   mStages = stages;
+   if (access & WriteAccess) {
+      mWriteAccess = access & WriteAccess;
+      mWriteStages = stages;
+   }
+}
@@ -68,6 +68,7 @@ VulkanGeometry::VulkanGeometry(VulkanRenderer* producer, Describe descriptor)
          auto buffer = vram.Upload(*positions, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
          mVBuffers.push_back(buffer);
          mVOffsets.push_back(0);
+         mPositionType = positions->GetType();
       }
 
       const auto normals = mesh.GetData<Traits::Aim>();
@@ -140,20 +141,14 @@ VulkanGeometry::~VulkanGeometry() {
 }
 
 /// Bind the vertex & index buffers                                           
-void VulkanGeometry::Bind() const {
+///   @param state - the command buffer state, used to skip redundant binds   
+void VulkanGeometry::Bind(CommandState& state) const {
    // Bind each vertex buffers                                          
-   const auto cmdbuffer = mProducer->GetRenderCB();
-   for (uint32_t i = 0; i < mVBuffers.size(); ++i) {
-      vkCmdBindVertexBuffers(
-         cmdbuffer, i, 1, 
-         &mVBuffers[i].GetBuffer(),
-         &mVOffsets[i]
-      );
-   }
+   for (uint32_t i = 0; i < mVBuffers.size(); ++i)
+      state.BindVertexBuffer(i, mVBuffers[i].GetBuffer(), mVOffsets[i]);
 
    for (size_t i = 0; i < mIBuffers.size(); ++i) {
-      vkCmdBindIndexBuffer(
-         cmdbuffer, 
+      state.BindIndexBuffer(
          mIBuffers[i].GetBuffer(),
          mIOffsets[i], 
          AsVkIndexType(mIBuffers[i].GetMeta())
@@ -163,16 +158,19 @@ void VulkanGeometry::Bind() const {
 }
 
 /// Render the vertex & index buffers                                         
-void VulkanGeometry::Render() const {
-   const auto cmdbuffer = mProducer->GetRenderCB();
+///   @param state - the command buffer state to record to                    
+///   @param firstInstance - the first instance to draw                       
+///   @param instances - number of instances to draw                          
+void VulkanGeometry::Render(CommandState& state, uint32_t firstInstance, uint32_t instances) const {
+   const auto cmdbuffer = state.GetCommands();
    if (mIBuffers.empty()) {
       // Draw unindexed                                                 
       vkCmdDraw(
          cmdbuffer, 
          mView.mPrimitiveCount,  // Vertex count                        
-         1,                      // Instance count                      
+         instances,              // Instance count                      
          mView.mPrimitiveStart,  // First vertex                        
-         0                       // First instance                      
+         firstInstance           // First instance                      
       );
    }
    else {
@@ -180,10 +178,55 @@ void VulkanGeometry::Render() const {
       vkCmdDrawIndexed(
          cmdbuffer, 
          mView.mIndexCount,      // Index count                         
-         1,                      // Instance count                      
+         instances,              // Instance count                      
          mView.mIndexStart,      // First index                         
          static_cast<int32_t>(mView.mPrimitiveStart), // Vertex offset (can be negative?)
-         0                       // First instance                      
+         firstInstance           // First instance                      
       );
    }
-}
\ No newline at end of file
+}
+
+/// Push a draw command for the vertex & index buffers                        
+///   @param buffer - the indirect buffer to push to                          
+///   @param instances - number of instances to draw                          
+///   @param firstInstance - the first instance to draw                       
+///   @return the byte offset of the command inside the indirect buffer       
+uint32_t VulkanGeometry::PushIndirect(IndirectBuffer& buffer, uint32_t instances, uint32_t firstInstance) const {
+   if (mIBuffers.empty()) {
+      VkDrawIndirectCommand command {};
+      command.vertexCount = mView.mPrimitiveCount;
+      command.instanceCount = instances;
+      command.firstVertex = mView.mPrimitiveStart;
+      command.firstInstance = firstInstance;
+      return buffer.Push(command);
+   }
+   else {
+      VkDrawIndexedIndirectCommand command {};
+      command.indexCount = mView.mIndexCount;
+      command.instanceCount = instances;
+      command.firstIndex = mView.mIndexStart;
+      command.vertexOffset = static_cast<int32_t>(mView.mPrimitiveStart);
+      command.firstInstance = firstInstance;
+      return buffer.Push(command);
+   }
+}
+
+/// Render the vertex & index buffers, using a command from an indirect       
+/// buffer                                                                    
+///   @param state - the command buffer state to record to                    
+///   @param buffer - the indirect buffer                                     
+///   @param offset - the command's byte offset, as returned by PushIndirect  
+void VulkanGeometry::RenderIndirect(CommandState& state, VkBuffer buffer, uint32_t offset) const {
+   const auto cmdbuffer = state.GetCommands();
+   if (mIBuffers.empty())
+      vkCmdDrawIndirect(cmdbuffer, buffer, offset, 1, 0);
+   else
+      vkCmdDrawIndexedIndirect(cmdbuffer, buffer, offset, 1, 0);
+}
+
+/// Get the type of the vertex positions, which are always in the first       
+/// vertex buffer                                                             
+///   @return the type, or nullptr if the geometry has no positions           
+DMeta VulkanGeometry::GetPositionType() const noexcept {
+   return mPositionType;
+}
@@ -7,6 +7,8 @@
 ///                                                                           
 #pragma once
 #include "VulkanBuffer.hpp"
+#include "CommandState.hpp"
+#include "IndirectBuffer.hpp"
 #include <Langulus/Mesh.hpp>
 
 
@@ -24,6 +26,7 @@ private:
    // Vertex info                                                       
    MeshView mView;
    DMeta mTopology {};
+   DMeta mPositionType {};
 
    // The buffers                                                       
    std::vector<VulkanBuffer> mVBuffers;
@@ -37,6 +40,9 @@ public:
    VulkanGeometry(VulkanRenderer*, Describe);
    ~VulkanGeometry();
 
-   void Bind() const;
-   void Render() const;
+   void Bind(CommandState&) const;
+   void Render(CommandState&, uint32_t = 0, uint32_t = 1) const;
+   void RenderIndirect(CommandState&, VkBuffer, uint32_t) const;
+   NOD() uint32_t PushIndirect(IndirectBuffer&, uint32_t, uint32_t) const;
+   NOD() DMeta GetPositionType() const noexcept;
 };
@@ -0,0 +1,176 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "VulkanGraph.hpp"
+
+
+/// Get how a use accesses memory                                             
+///   @param use - the use                                                    
+///   @param depth - whether the resource is a depth image                    
+///   @param layout - [out] the image layout the use needs                    
+///   @param access - [out] the memory access                                 
+///   @param stages - [out] the pipeline stages of the access                 
+static void GetAccess(
+   GraphUse use, bool depth, VkImageLayout& layout,
+   VkAccessFlags& access, VkPipelineStageFlags& stages
+) {
+   const auto readOnly = depth
+      ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+      : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+   switch (use) {
+   case GraphUse::Color:
+      layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+      access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+             | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+      stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+      return;
+   case GraphUse::Depth:
+      layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+      access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+             | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+      stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+             | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+      return;
+   case GraphUse::Sampled:
+      layout = readOnly;
+      access = VK_ACCESS_SHADER_READ_BIT;
+      stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+      return;
+   case GraphUse::ComputeRead:
+      layout = readOnly;
+      access = VK_ACCESS_SHADER_READ_BIT;
+      stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+      return;
+   case GraphUse::ComputeWrite:
+      // Atomics read what they write                                   
+      layout = VK_IMAGE_LAYOUT_GENERAL;
+      access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+      stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+      return;
+   case GraphUse::Indirect:
+      layout = VK_IMAGE_LAYOUT_GENERAL;
+      access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+      stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+      return;
+   case GraphUse::TransferRead:
+      layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      access = VK_ACCESS_TRANSFER_READ_BIT;
+      stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+      return;
+   case GraphUse::TransferWrite:
+      layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      access = VK_ACCESS_TRANSFER_WRITE_BIT;
+      stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+      return;
+   case GraphUse::HostRead:
+      layout = VK_IMAGE_LAYOUT_GENERAL;
+      access = VK_ACCESS_HOST_READ_BIT;
+      stages = VK_PIPELINE_STAGE_HOST_BIT;
+      return;
+   case GraphUse::Present:
+      layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+      access = 0;
+      stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+      return;
+   default:
+      layout = VK_IMAGE_LAYOUT_UNDEFINED;
+      access = 0;
+      stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+   }
+}
+
+/// Forget all passes and resources, keeping the allocations                  
+void VulkanGraph::Reset() {
+   RenderGraph::Reset();
+   mImages.clear();
+   mBuffers.clear();
+}
+
+/// Add an image, that lives outside of the graph                             
+/// Barriers come from the image's tracked layout, the initial use only       
+/// tells if it has contents. Invalid images can be used, but get no barriers 
+///   @param image - the image                                                
+///   @param initial - how it was last used, or None if it has no contents    
+///   @param output - whether its contents are needed after the graph         
+///   @return the resource                                                    
+VulkanGraph::Resource VulkanGraph::Import(const VulkanImage& image, GraphUse initial, bool output) {
+   const auto resource = RenderGraph::Import(initial, output);
+   mImages.push_back(image.IsValid() ? &image : nullptr);
+   mBuffers.push_back(VK_NULL_HANDLE);
+   return resource;
+}
+
+/// Add a buffer, that lives outside of the graph                             
+///   @param buffer - the buffer                                              
+///   @param initial - how it was last used, before the graph                 
+///   @param output - whether its contents are needed after the graph         
+///   @return the resource                                                    
+VulkanGraph::Resource VulkanGraph::Import(VkBuffer buffer, GraphUse initial, bool output) {
+   const auto resource = RenderGraph::Import(initial, output);
+   mImages.push_back(nullptr);
+   mBuffers.push_back(buffer);
+   return resource;
+}
+
+/// Accumulate the barriers, that a pass needs before it's recorded           
+///   @param pass - the pass                                                  
+void VulkanGraph::Prepare(Pass pass) {
+   const auto& info = GetPass(pass);
+   for (uint32_t i = 0; i < info.mCount; ++i) {
+      const auto& use = GetUse(pass, i);
+      const auto image = mImages[use.mResource];
+
+      VkImageLayout layout;
+      VkAccessFlags access;
+      VkPipelineStageFlags stages;
+      GetAccess(use.mUse, image and image->GetAspect() & VK_IMAGE_ASPECT_DEPTH_BIT,
+         layout, access, stages);
+
+      if (image) {
+         mBarriers.Transition(*image, layout, access, stages);
+         continue;
+      }
+
+      // Buffers need a barrier only if either side writes              
+      if (not mBuffers[use.mResource] or use.mPrevious == GraphUse::None
+      or not (IsWrite(use.mPrevious) or IsWrite(use.mUse)))
+         continue;
+
+      VkImageLayout unused;
+      VkAccessFlags fromAccess;
+      VkPipelineStageFlags fromStages;
+      GetAccess(use.mPrevious, false, unused, fromAccess, fromStages);
+      if (not IsWrite(use.mPrevious))
+         fromAccess = 0;
+
+      mBarriers.Buffer(mBuffers[use.mResource],
+         fromAccess, fromStages, access, stages);
+   }
+}
+
+/// Record all passes, that weren't culled, along with their barriers         
+/// The graph must be compiled                                                
+///   @param commands - the command buffer to record to                       
+void VulkanGraph::Execute(VkCommandBuffer commands) {
+   RenderGraph::Execute([&](Pass pass) {
+      if (GetPass(pass).mGroup != pass)
+         return;
+
+      // Nothing can be placed between the passes of a group            
+      for (Pass p = pass; p < GetPassCount(); ++p) {
+         const auto& info = GetPass(p);
+         if (info.mCulled)
+            continue;
+         if (info.mGroup != pass)
+            break;
+         Prepare(p);
+      }
+
+      mBarriers.Flush(commands);
+   });
+}
@@ -0,0 +1,35 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "RenderGraph.hpp"
+#include "Barriers.hpp"
+
+
+///                                                                           
+///   Render graph of a frame, bound to Vulkan images and buffers             
+///                                                                           
+/// Barriers are derived from the declared uses - images from their tracked   
+/// layouts, buffers from the previous use in the graph. All barriers of a    
+/// group of passes are placed before its first pass, so that the group can   
+/// stay in a single render pass                                              
+///                                                                           
+struct VulkanGraph : RenderGraph {
+private:
+   // The image or buffer behind each resource                          
+   ::std::vector<const VulkanImage*> mImages;
+   ::std::vector<VkBuffer> mBuffers;
+   Barriers mBarriers;
+
+   void Prepare(Pass);
+
+public:
+   void Reset();
+   Resource Import(const VulkanImage&, GraphUse, bool);
+   Resource Import(VkBuffer, GraphUse, bool);
+   void Execute(VkCommandBuffer);
+};
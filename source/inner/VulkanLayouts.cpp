@@ -0,0 +1,191 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "VulkanLayouts.hpp"
+
+/// Number of sets in each descriptor pool                                    
+constexpr uint32_t SetsPerPool = 256;
+
+
+/// Initialize the cache                                                      
+///   @param device - the logical device                                      
+void VulkanLayouts::Initialize(VkDevice device) {
+   mDevice = device;
+   CreatePool();
+}
+
+/// Destroy all layouts and pools                                             
+/// All pipelines that use them must be destroyed before that                 
+void VulkanLayouts::Destroy() {
+   if (not mDevice)
+      return;
+
+   for (auto& it : mPipeLayouts)
+      vkDestroyPipelineLayout(mDevice, it.second, nullptr);
+   mPipeLayouts.clear();
+   mPrefixes.clear();
+   mSetKeys.clear();
+
+   for (auto& it : mSetLayouts)
+      vkDestroyDescriptorSetLayout(mDevice, it.second, nullptr);
+   mSetLayouts.clear();
+
+   // Destroying a pool frees all sets allocated from it                
+   for (auto pool : mPools)
+      vkDestroyDescriptorPool(mDevice, pool, nullptr);
+   mPools.Reset();
+   mDevice = {};
+}
+
+/// Create a new descriptor pool, to be used for new allocations              
+void VulkanLayouts::CreatePool() {
+   static constinit VkDescriptorPoolSize poolSizes[] {
+      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SetsPerPool * RefreshRate::StaticUniformCount },
+      { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, SetsPerPool * RefreshRate::DynamicUniformCount },
+      { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SetsPerPool * 8 },
+      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SetsPerPool * 4 },
+      { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, SetsPerPool },
+      { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, SetsPerPool }
+   };
+
+   VkDescriptorPoolCreateInfo pool {};
+   pool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+   pool.poolSizeCount = sizeof(poolSizes) / sizeof(VkDescriptorPoolSize);
+   pool.pPoolSizes = poolSizes;
+   pool.maxSets = SetsPerPool;
+   pool.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+   VkDescriptorPool result {};
+   if (vkCreateDescriptorPool(mDevice, &pool, nullptr, &result))
+      LANGULUS_OOPS(Graphics, "Can't create descriptor pool");
+   mPools << result;
+}
+
+/// Get a descriptor set layout for a list of bindings                        
+///   @param bindings - the bindings to combine in a single layout            
+///   @return the layout, shared with all sets of the same bindings           
+UBOLayout VulkanLayouts::GetSetLayout(const Bindings& bindings) {
+   // Pack the relevant binding properties into a signature             
+   SetSignature signature;
+   signature.reserve(bindings.GetCount() * 2);
+   for (auto& binding : bindings) {
+      signature.push_back(
+         (static_cast<uint64_t>(binding.binding) << 32)
+       | static_cast<uint64_t>(binding.descriptorType));
+      signature.push_back(
+         (static_cast<uint64_t>(binding.descriptorCount) << 32)
+       | static_cast<uint64_t>(binding.stageFlags));
+   }
+
+   auto found = mSetLayouts.find(signature);
+   if (found != mSetLayouts.end())
+      return found->second;
+
+   VkDescriptorSetLayoutCreateInfo layoutInfo {};
+   layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+   layoutInfo.bindingCount = static_cast<uint32_t>(bindings.GetCount());
+   layoutInfo.pBindings = bindings.GetRaw();
+
+   UBOLayout layout {};
+   if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &layout))
+      LANGULUS_OOPS(Graphics, "vkCreateDescriptorSetLayout failed");
+
+   mSetLayouts.emplace(::std::move(signature), layout);
+   return layout;
+}
+
+/// Get a pipeline layout for a list of descriptor set layouts                
+///   @param sets - the set layouts, in order of their set index              
+///   @param views - whether the view transforms are pushed as constants      
+///   @return the layout, shared with all pipelines of the same sets          
+VkPipelineLayout VulkanLayouts::GetPipelineLayout(const PipeSignature& sets, bool views) {
+   auto key = ::std::make_pair(sets, views);
+   auto found = mPipeLayouts.find(key);
+   if (found != mPipeLayouts.end())
+      return found->second;
+
+   VkPushConstantRange constants {};
+   constants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+   constants.size = sizeof(ViewTransforms::mViews);
+
+   VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
+   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+   pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(sets.size());
+   pipelineLayoutInfo.pSetLayouts = sets.data();
+   if (views) {
+      pipelineLayoutInfo.pushConstantRangeCount = 1;
+      pipelineLayoutInfo.pPushConstantRanges = &constants;
+   }
+
+   VkPipelineLayout layout {};
+   if (vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &layout))
+      LANGULUS_OOPS(Graphics, "Can't create pipeline layout");
+
+   // Each set is keyed by the push constants, and the layouts of all   
+   // sets up to it                                                     
+   SetKeys keys {};
+   for (size_t i = 0; i < sets.size() and i < MaxSets; ++i) {
+      auto prefix = ::std::make_pair(PipeSignature {sets.begin(), sets.begin() + i + 1}, views);
+      const auto next = static_cast<uint32_t>(mPrefixes.size() + 1);
+      keys[i] = mPrefixes.try_emplace(::std::move(prefix), next).first->second;
+   }
+
+   mSetKeys.emplace(layout, keys);
+   mPipeLayouts.emplace(::std::move(key), layout);
+   return layout;
+}
+
+/// Get the compatibility keys of the sets of a pipeline layout               
+///   @param layout - the pipeline layout                                     
+///   @return the keys, or nullptr if the layout isn't from this cache        
+auto VulkanLayouts::GetSetKeys(VkPipelineLayout layout) const noexcept -> const SetKeys* {
+   const auto found = mSetKeys.find(layout);
+   return found != mSetKeys.end() ? &found->second : nullptr;
+}
+
+/// Allocate a descriptor set, creating a new pool if current one is full     
+///   @param layout - the layout of the set                                   
+///   @param pool - [out] the pool the set was allocated from                 
+///   @return the descriptor set                                              
+VkDescriptorSet VulkanLayouts::Allocate(UBOLayout layout, VkDescriptorPool& pool) {
+   VkDescriptorSetAllocateInfo allocInfo {};
+   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+   allocInfo.descriptorSetCount = 1;
+   allocInfo.pSetLayouts = &layout;
+
+   // Sets are freed back to older pools, so try them in reverse order  
+   // before resorting to making a new one                              
+   VkDescriptorSet set {};
+   for (Offset i = mPools.GetCount(); i > 0; --i) {
+      allocInfo.descriptorPool = mPools[i - 1];
+      const auto result = vkAllocateDescriptorSets(mDevice, &allocInfo, &set);
+      if (result == VK_SUCCESS) {
+         pool = allocInfo.descriptorPool;
+         return set;
+      }
+
+      if (result != VK_ERROR_OUT_OF_POOL_MEMORY
+      and result != VK_ERROR_FRAGMENTED_POOL)
+         LANGULUS_OOPS(Graphics, "vkAllocateDescriptorSets failed");
+   }
+
+   CreatePool();
+   allocInfo.descriptorPool = mPools.Last();
+   if (vkAllocateDescriptorSets(mDevice, &allocInfo, &set))
+      LANGULUS_OOPS(Graphics, "vkAllocateDescriptorSets failed on a new pool");
+
+   pool = allocInfo.descriptorPool;
+   return set;
+}
+
+/// Free a descriptor set back to the pool it was allocated from              
+///   @param pool - the pool                                                  
+///   @param set - the set to free                                            
+void VulkanLayouts::Free(VkDescriptorPool pool, VkDescriptorSet set) {
+   if (pool and set)
+      vkFreeDescriptorSets(mDevice, pool, 1, &set);
+}
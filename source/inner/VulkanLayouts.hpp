@@ -0,0 +1,67 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#pragma once
+#include "../Common.hpp"
+#include "Views.hpp"
+#include <map>
+#include <unordered_map>
+#include <array>
+#include <vector>
+
+using Bindings = TMany<VkDescriptorSetLayoutBinding>;
+
+
+///                                                                           
+///   Layout cache                                                            
+///                                                                           
+/// Deduplicates descriptor set layouts and pipeline layouts across all       
+/// pipelines of a renderer, by keying them by their binding signature.       
+/// Pipelines with identical signatures get identical layouts, which makes    
+/// them layout-compatible, so bound descriptor sets remain valid when        
+/// switching between them. Layouts of the stereo variants of material        
+/// pipelines also have the view transforms as push constants, which stay     
+/// valid between all of them. Pipeline layouts are compatible for a set, if  
+/// they have the same push constants, and the same layouts of all sets up to 
+/// it, so each of their sets gets a key of that prefix, that is compared     
+/// instead. Also allocates descriptor sets from a shared list of pools, that 
+/// grows on demand                                                           
+///                                                                           
+struct VulkanLayouts {
+   static constexpr uint32_t MaxSets = 4;
+
+   // Compatibility keys of each set of a pipeline layout, zero if the  
+   // layout doesn't have the set                                       
+   using SetKeys = ::std::array<uint32_t, MaxSets>;
+
+private:
+   using SetSignature = ::std::vector<uint64_t>;
+   using PipeSignature = ::std::vector<UBOLayout>;
+
+   VkDevice mDevice {};
+   ::std::map<SetSignature, UBOLayout> mSetLayouts;
+   ::std::map<::std::pair<PipeSignature, bool>, VkPipelineLayout> mPipeLayouts;
+   // Keys of the prefixes of pipeline layouts, and the keys of each    
+   // layout's sets                                                     
+   ::std::map<::std::pair<PipeSignature, bool>, uint32_t> mPrefixes;
+   ::std::unordered_map<VkPipelineLayout, SetKeys> mSetKeys;
+   // Descriptor pools, the last one is used for new allocations        
+   TMany<VkDescriptorPool> mPools;
+
+   void CreatePool();
+
+public:
+   void Initialize(VkDevice);
+   void Destroy();
+
+   NOD() UBOLayout GetSetLayout(const Bindings&);
+   NOD() VkPipelineLayout GetPipelineLayout(const PipeSignature&, bool = false);
+   NOD() const SetKeys* GetSetKeys(VkPipelineLayout) const noexcept;
+
+   NOD() VkDescriptorSet Allocate(UBOLayout, VkDescriptorPool&);
+   void Free(VkDescriptorPool, VkDescriptorSet);
+};
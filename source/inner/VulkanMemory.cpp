@@ -202,6 +202,7 @@ VulkanImage VulkanMemory::CreateImage(const ImageView& view, VkImageUsageFlags f
 
    // Bind memory with the image                                        
    vkBindImageMemory(mDevice, image.mBuffer, image.mMemory, 0);
+   image.mLayout = image.mInfo.initialLayout;
    return image;
 }
 
@@ -327,144 +328,6 @@ VulkanBuffer VulkanMemory::CreateBuffer(DMeta meta, VkDeviceSize size, VkBufferU
    return result;
 }
 
-/// Transfer an image in VRAM from one layout to another                      
-///   @param img - VRAM image                                                 
-///   @param from - starting layout                                           
-///   @param to - ending layout                                               
-void VulkanMemory::ImageTransfer(const VulkanImage& img, VkImageLayout from, VkImageLayout to) {
-   ImageTransfer(img.mBuffer, from, to);
-}
-
-/// Transfer a VRAM image from one layout to another                          
-///   @param img - VRAM image                                                 
-///   @param from - starting layout                                           
-///   @param to - ending layout                                               
-void VulkanMemory::ImageTransfer(const VkImage& img, VkImageLayout from, VkImageLayout to) {
-   // Copy data to VRAM                                                 
-   VkCommandBufferBeginInfo beginInfo {};
-   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-   vkBeginCommandBuffer(mTransferBuffer, &beginInfo);
-
-   VkImageMemoryBarrier barrier {};
-   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-   barrier.oldLayout = from;
-   barrier.newLayout = to;
-   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   barrier.image = img;
-   barrier.subresourceRange.baseMipLevel = 0;
-   barrier.subresourceRange.levelCount = 1;
-   barrier.subresourceRange.baseArrayLayer = 0;
-   barrier.subresourceRange.layerCount = 1;
-   barrier.srcAccessMask = 0;
-   barrier.dstAccessMask = 0;
-
-   // Pick optimal and non-conflicting transition                       
-   VkPipelineStageFlags sourceStage;
-   VkPipelineStageFlags destinationStage;
-
-   if (from == VK_IMAGE_LAYOUT_UNDEFINED) {
-      if (to == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-         // Prepare an undefined (probably external) image for filling  
-         barrier.srcAccessMask = 0;
-         barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-         sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-         destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-      }
-      else if (to == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-         // Turn the undefined image to a depth attachment              
-         barrier.srcAccessMask = 0;
-         barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-         sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-         destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-      }
-      else if (to == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-         // Turn the undefined image to a color attachment              
-         barrier.srcAccessMask = 0;
-         barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-         sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-         destinationStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      }
-      else LANGULUS_THROW(Graphics, "Unsupported layout transition");
-   }
-   else if (
-      from == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && 
-      to == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-      sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-      destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-   }
-   else if (from == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) {
-      if (to == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-         // Transfers render target from display to rendering           
-         barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-         barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-         sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-         destinationStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      }
-      else if (to == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
-         // Transfers a render target for CPU read                      
-         // Useful for screenshots                                      
-         barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-         barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-         destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      }
-      else LANGULUS_THROW(Graphics, "Unsupported layout transition");
-   }
-   else if (from == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-      if (to == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) {
-         // Transfers a render target to be ready for display           
-         barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-         barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-         sourceStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-         destinationStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      }
-      else if (to == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
-         // Transfers a render target for CPU read                      
-         // Useful for screenshots                                      
-         barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-         barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-         destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      }
-      else LANGULUS_THROW(Graphics, "Unsupported layout transition");
-   }
-   else if (from == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
-      if (to == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) {
-         // Move a transfer source to display                           
-         barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-         barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-         destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-      }
-      else LANGULUS_THROW(Graphics, "Unsupported layout transition");
-   }
-   else LANGULUS_THROW(Graphics, "Unsupported layout transition");
-   
-   // Create the barrier                                                
-   vkCmdPipelineBarrier(mTransferBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-   vkEndCommandBuffer(mTransferBuffer);
-
-   // Submit                                                            
-   VkSubmitInfo submitInfo {};
-   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-   submitInfo.commandBufferCount = 1;
-   submitInfo.pCommandBuffers = &mTransferBuffer;
-   vkQueueSubmit(mTransferer, 1, &submitInfo, VK_NULL_HANDLE);
-   vkQueueWaitIdle(mTransferer);
-}
-
 /// Upload a memory block to VRAM                                             
 ///   @param memory - the memory block to upload                              
 ///   @param usage - the intended use for the memory                          
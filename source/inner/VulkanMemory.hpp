@@ -45,8 +45,5 @@ public:
    VkImageView CreateImageView(const VulkanImage&, const ImageView&, VkImageAspectFlags);
    VkImageView CreateImageView(const VulkanImage&);
 
-   void ImageTransfer(const VulkanImage&, VkImageLayout from, VkImageLayout to);
-   void ImageTransfer(const VkImage&, VkImageLayout from, VkImageLayout to);
-
    VulkanBuffer Upload(const Block<>&, VkBufferUsageFlags);
 };
\ No newline at end of file
@@ -6,8 +6,10 @@
 /// SPDX-License-Identifier: GPL-3.0-or-later                                 
 ///                                                                           
 #include "../Vulkan.hpp"
+#include "Instances.hpp"
 #include <Langulus/IO.hpp>
 #include <shaderc/shaderc.hpp>
+#include <mutex>
 
 #if 0
    #define VERBOSE_SHADER(...) Logger::Verbose(Self(), __VA_ARGS__)
@@ -56,20 +58,36 @@ VulkanShader::VulkanShader(VulkanRenderer* producer, Describe descriptor)
 
 /// Component destruction                                                     
 VulkanShader::~VulkanShader() {
-   if (mStageDescription.module) {
-      vkDestroyShaderModule(
-         mProducer->mDevice, 
-         mStageDescription.module, 
-         nullptr
-      );
+   for (auto& description : mStageDescription) {
+      if (description.module) {
+         vkDestroyShaderModule(
+            mProducer->mDevice, 
+            description.module, 
+            nullptr
+         );
+      }
    }
 }
 
+/// Guards publishing of compiled shader modules, because pipelines can be    
+/// compiled on background jobs, and shaders are shared between pipelines     
+static ::std::mutex CompilationGuard;
+
 /// Compile the shader code                                                   
+/// This is safe to call from a pipeline compilation job. The compilation     
+/// itself runs unguarded - if two jobs race to compile the same shader,      
+/// only the first module is kept                                             
+///   @param views - whether to move gl_Position to the view being drawn, as  
+///                  the pipelines of stereo cameras do - ignored for stages  
+///                  other than the vertex one                                
 ///   @return the compiled vulkan shader                                      
-const Shader& VulkanShader::Compile() const {
-   if (mCompiled)
-      return mStageDescription;
+const Shader& VulkanShader::Compile(bool views) const {
+   views = views and mStage == ShaderStage::Vertex;
+   {
+      const ::std::lock_guard lock {CompilationGuard};
+      if (mCompiled[views])
+         return mStageDescription[views];
+   }
 
    const auto device = mProducer->mDevice;
    //const auto startTime = SteadyClock::Now();
@@ -98,9 +116,51 @@ const Shader& VulkanShader::Compile() const {
    if (optimize)
       options.SetOptimizationLevel(shaderc_optimization_level_size);
 
+   // Instance data is read from a storage buffer, indexed by the       
+   // instance being drawn, so that instances are drawn together -      
+   // vertex shaders find it among the indices in the indirect buffer   
+   InstanceStage stage;
+   switch (mStage) {
+   case ShaderStage::Vertex:
+      stage = InstanceStage::Vertex;
+      break;
+   case ShaderStage::Geometry:
+      stage = InstanceStage::Geometry;
+      break;
+   case ShaderStage::Pixel:
+      stage = InstanceStage::Pixel;
+      break;
+   default:
+      stage = InstanceStage::Other;
+   }
+
+   ::std::string injected = InjectInstances(
+      {mCode.GetRaw(), mCode.GetCount()}, stage, 1,
+      static_cast<int>(Rate::Instance.GetDynamicUniformIndex()),
+      static_cast<int>(IndirectBuffer::InstancesBinding)
+   );
+
+   // Vertex shaders of stereo pipelines move gl_Position to the view   
+   // they're drawing, and select it by gl_ViewIndex, if the device has 
+   // multiview - it is zero in render passes without it. The views are 
+   // push constants, so they'd clash with the material's own           
+   if (HasPushConstants(injected))
+      LANGULUS_THROW(Graphics, "Shaders can't declare push constants");
+   if (views)
+      injected = InjectViews(injected, mProducer->mMultiview);
+
+   // Pixel shaders, that light surfaces in place, read the clustered   
+   // lights of their fragment                                          
+   if (mStage == ShaderStage::Pixel)
+      injected = InjectClusters(injected, LightClusters::SetIndex);
+   const char* code = injected.data();
+   size_t size = injected.size();
+
    // Compile to binary                                                 
+   // Code is passed with its size, so that no termination (and thus    
+   // no allocation through the managed memory) is required here        
    const auto assembly = compiler.CompileGlslToSpv(
-      mCode.Terminate().GetRaw(), kind, "whatever", options
+      code, size, kind, "whatever", options
    );
 
    if (assembly.GetCompilationStatus() != shaderc_compilation_status_success) {
@@ -120,17 +180,25 @@ const Shader& VulkanShader::Compile() const {
    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
       LANGULUS_THROW(Graphics, "vkCreateShaderModule failed");
 
+   const ::std::lock_guard lock {CompilationGuard};
+   auto& description = mStageDescription[views];
+   if (mCompiled[views]) {
+      // Another job compiled the same shader in the meantime           
+      vkDestroyShaderModule(device, shaderModule, nullptr);
+      return description;
+   }
+
    // Create the shader stage                                           
-   mStageDescription = {};
-   mStageDescription.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-   mStageDescription.stage = AsVkStage(mStage);
-   mStageDescription.module = shaderModule;
-   mStageDescription.pName = "main";
-   mCompiled = true;
+   description = {};
+   description.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+   description.stage = AsVkStage(mStage);
+   description.module = shaderModule;
+   description.pName = "main";
+   mCompiled[views] = true;
    
    VERBOSE_SHADER(Logger::Green, "Compiled shader in ", SteadyClock::now() - startTime);
    VERBOSE_SHADER(Logger::Green, mCode.Pretty());
-   return mStageDescription;
+   return description;
 }
 
 /// Bind vertex input                                                         
@@ -22,10 +22,10 @@ private:
 
    // Shader code                                                       
    Text mCode;
-   // Shader stage description                                          
-   mutable Shader mStageDescription {};
-   // Shader stage description                                          
-   mutable bool mCompiled {};
+   // Shader stage descriptions, without and with the view transforms   
+   // of stereo cameras - only vertex shaders use the latter            
+   mutable Shader mStageDescription[2] {};
+   mutable bool mCompiled[2] {};
    // Shader stage                                                      
    ShaderStage::Enum mStage {ShaderStage::Pixel};
    // Uniform/input bindings for each shader stage                      
@@ -38,7 +38,7 @@ public:
    NOD() RefreshRate GetRate() const noexcept;
    NOD() VertexInput CreateVertexInputState() const noexcept;
 
-   const Shader& Compile() const;
+   const Shader& Compile(bool views = false) const;
    void AddInput(const Trait&);
    VkShaderStageFlagBits GetStageFlagBit() const noexcept;
    ShaderStage::Enum GetStage() const noexcept;
@@ -15,12 +15,12 @@
 VulkanSwapchain::VulkanSwapchain(VulkanRenderer& renderer) noexcept
    : mRenderer {renderer} {}
 
-/// Create the swapchain                                                      
+/// Create the swapchain, or the images to draw to offscreen, if the renderer 
+/// has no surface                                                            
 ///   @param format - surface format                                          
 ///   @param families - set of queue families to use                          
 void VulkanSwapchain::Create(const VkSurfaceFormatKHR& format, const QueueFamilies& families) {
    // Resolution                                                        
-   const auto adapter = mRenderer.GetAdapter();
    const Real resx = (*mRenderer.mResolution)[0];
    const Real resy = (*mRenderer.mResolution)[1];
    const auto resxuint = static_cast<uint32_t>(resx);
@@ -28,6 +28,183 @@ void VulkanSwapchain::Create(const VkSurfaceFormatKHR& format, const QueueFamili
    if (resxuint == 0 or resyuint == 0)
       LANGULUS_OOPS(Graphics, "Bad resolution");
 
+   mFormat = format;
+   mOffscreen = not mRenderer.GetSurface();
+
+   // Get the images from the swapchain, or make our own                
+   VkExtent2D extent {resxuint, resyuint};
+   TMany<VkImage> swapChainImages;
+   if (not mOffscreen)
+      CreateSwapchain(format, families, extent, swapChainImages);
+
+   // Create the image views for the swap chain. They will all be       
+   // single layer, 2D images, with no mipmaps                          
+   const auto count = mOffscreen ? mRenderer.mBackBuffers
+      : static_cast<uint32_t>(swapChainImages.GetCount());
+   bool reverseFormat;
+   const auto viewf = VkFormatToDMeta(format.format, reverseFormat);
+   ImageView colorview {
+      extent.width, extent.height, 1, 1, viewf, reverseFormat
+   };
+
+   mFrameViews.New(count);
+   mFrameImages.New(count);
+
+   // Images aren't transitioned here - render passes take them from    
+   // any layout, since they clear them                                 
+   for (uint32_t i = 0; i < count; i++) {
+      if (mOffscreen) {
+         // Offscreen images are always copied from, when taking a      
+         // screenshot, and stereo cameras copy to them, too            
+         mFrameImages[i] = mRenderer.mVRAM.CreateImage(colorview,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+          | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+          | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+         );
+         mFrameViews[i] = mRenderer.mVRAM.CreateImageView(
+            mFrameImages[i].GetImage(), colorview, VK_IMAGE_ASPECT_COLOR_BIT
+         );
+         continue;
+      }
+
+      auto& image = swapChainImages[i];
+
+      // Add the view                                                   
+      mFrameViews[i] = mRenderer.mVRAM.CreateImageView(
+         image, colorview, VK_IMAGE_ASPECT_COLOR_BIT
+      );
+
+      // Add the image                                                  
+      mFrameImages[i] = VulkanImage::FromSwapchain(
+         mRenderer.mDevice, image, colorview
+      );
+   }
+
+   // Our own images can always be copied from and to                   
+   if (mOffscreen)
+      mCopyable = true;
+   
+   // Create the depth buffer image and view                            
+   ImageView depthview {
+      extent.width, extent.height, 1, 1, MetaOf<Depth32>()
+   };
+   // Depth is also sampled, when capturing occluders, and read by      
+   // the deferred lights                                               
+   mDepthImage = mRenderer.mVRAM.CreateImage(depthview,
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+    | VK_IMAGE_USAGE_SAMPLED_BIT
+    | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT
+   );
+   mDepthImageView = mRenderer.mVRAM.CreateImageView(mDepthImage);
+      
+   // Create the G-buffer images and views - they're only ever used     
+   // inside the deferred lights pass, so they're transient             
+   constexpr auto gbufferUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+      | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT
+      | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+   const auto& gbuffer = mRenderer.mLightPass.GetGBuffer();
+
+   bool reverseAlbedo;
+   ImageView albedoview {
+      extent.width, extent.height, 1, 1,
+      VkFormatToDMeta(gbuffer[0].format, reverseAlbedo), reverseAlbedo
+   };
+   mAlbedoImage = mRenderer.mVRAM.CreateImage(albedoview, gbufferUsage);
+   mAlbedoImageView = mRenderer.mVRAM.CreateImageView(mAlbedoImage);
+
+   bool reverseNormal;
+   ImageView normalview {
+      extent.width, extent.height, 1, 1,
+      VkFormatToDMeta(gbuffer[1].format, reverseNormal), reverseNormal
+   };
+   mNormalImage = mRenderer.mVRAM.CreateImage(normalview, gbufferUsage);
+   mNormalImageView = mRenderer.mVRAM.CreateImageView(mNormalImage);
+
+   // Create framebuffers                                               
+   mFrameBuffers.New(count);
+   for (Offset i = 0; i < count; ++i) {
+      VkImageView attachments[] {mFrameViews[i], mDepthImageView};
+      VkFramebufferCreateInfo framebufferInfo {};
+      framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+      framebufferInfo.renderPass = mRenderer.mPass;
+      framebufferInfo.attachmentCount = 2;
+      framebufferInfo.pAttachments = attachments;
+      framebufferInfo.width = resxuint;
+      framebufferInfo.height = resyuint;
+      framebufferInfo.layers = 1;
+
+      if (vkCreateFramebuffer(mRenderer.mDevice, &framebufferInfo, nullptr, &mFrameBuffers[i]))
+         LANGULUS_OOPS(Graphics, "Can't create framebuffer");
+   }
+
+   // Create framebuffers for the deferred lights pass                  
+   mDeferredFrameBuffers.New(count);
+   for (Offset i = 0; i < count; ++i) {
+      VkImageView attachments[] {
+         mFrameViews[i], mDepthImageView, mAlbedoImageView, mNormalImageView
+      };
+      VkFramebufferCreateInfo framebufferInfo {};
+      framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+      framebufferInfo.renderPass = mRenderer.mLightPass.GetPass();
+      framebufferInfo.attachmentCount = 4;
+      framebufferInfo.pAttachments = attachments;
+      framebufferInfo.width = resxuint;
+      framebufferInfo.height = resyuint;
+      framebufferInfo.layers = 1;
+
+      if (vkCreateFramebuffer(mRenderer.mDevice, &framebufferInfo, nullptr, &mDeferredFrameBuffers[i]))
+         LANGULUS_OOPS(Graphics, "Can't create deferred framebuffer");
+   }
+
+   // Create the frames in flight - a command buffer, and the sync      
+   // primitives for each. Fences start signaled, as if each frame was  
+   // already drawn once                                                
+   mFrames.resize(mRenderer.mFramesInFlight);
+   for (auto& frame : mFrames) {
+      VkCommandBufferAllocateInfo allocInfo {};
+      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocInfo.commandPool = mRenderer.mCommandPool;
+      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocInfo.commandBufferCount = 1;
+
+      if (vkAllocateCommandBuffers(mRenderer.mDevice, &allocInfo, &frame.mCommands))
+         LANGULUS_OOPS(Graphics, "Can't create command buffers");
+
+      VkFenceCreateInfo fenceInfo {};
+      fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+      fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+      if (vkCreateFence(mRenderer.mDevice, &fenceInfo, nullptr, &frame.mDone))
+         LANGULUS_OOPS(Graphics, "Can't create frame fence");
+
+      // Offscreen images are neither acquired, nor presented           
+      if (mOffscreen)
+         continue;
+
+      VkSemaphoreCreateInfo semaphoreInfo {};
+      semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+      if (vkCreateSemaphore(mRenderer.mDevice, &semaphoreInfo, nullptr, &frame.mAcquired))
+         LANGULUS_OOPS(Graphics, "Can't create image acquired semaphore");
+      if (vkCreateSemaphore(mRenderer.mDevice, &semaphoreInfo, nullptr, &frame.mRendered))
+         LANGULUS_OOPS(Graphics, "Can't create frame finished semaphore");
+   }
+
+   mCurrentFrame = 0;
+   mFrame = 0;
+}
+
+/// Create the swapchain of the renderer's surface, and get its images        
+///   @param format - surface format                                          
+///   @param families - set of queue families to use                          
+///   @param extent - [in/out] the requested size, and the one used           
+///   @param images - [out] the images of the swapchain                       
+void VulkanSwapchain::CreateSwapchain(
+   const VkSurfaceFormatKHR& format, const QueueFamilies& families,
+   VkExtent2D& extent, TMany<VkImage>& images
+) {
+   const auto adapter = mRenderer.GetAdapter();
+
    // Create swap chain                                                 
    VkSurfaceCapabilitiesKHR surface_caps;
    memset(&surface_caps, 0, sizeof(VkSurfaceCapabilitiesKHR));
@@ -56,7 +233,6 @@ void VulkanSwapchain::Create(const VkSurfaceFormatKHR& format, const QueueFamili
          surfacePresentMode = availablePresentMode;
    }
 
-   VkExtent2D extent {resxuint, resyuint};
    if (surface_caps.currentExtent.width != VK_INDEFINITELY)
       extent = surface_caps.currentExtent;
    else {
@@ -98,6 +274,14 @@ void VulkanSwapchain::Create(const VkSurfaceFormatKHR& format, const QueueFamili
    // Allow us to copy swapchain images when testing                    
    IF_LANGULUS_TESTING(swapInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
 
+   // Stereo cameras copy their viewport in and out of the back buffer, 
+   // if the surface allows it, and draw one eye after another otherwise
+   constexpr VkImageUsageFlags copies = VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                                      | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+   mCopyable = (surface_caps.supportedUsageFlags & copies) == copies;
+   if (mCopyable)
+      swapInfo.imageUsage |= copies;
+
    if (vkCreateSwapchainKHR(mRenderer.mDevice, &swapInfo, nullptr, &mSwapChain.Get()))
       LANGULUS_OOPS(Graphics, "Can't create swap chain");
 
@@ -105,126 +289,18 @@ void VulkanSwapchain::Create(const VkSurfaceFormatKHR& format, const QueueFamili
    if (vkGetSwapchainImagesKHR(mRenderer.mDevice, mSwapChain, &imageCount, nullptr))
       LANGULUS_OOPS(Graphics, "vkGetSwapchainImagesKHR fails");
 
-   TMany<VkImage> swapChainImages;
-   swapChainImages.New(imageCount);
-   if (vkGetSwapchainImagesKHR(mRenderer.mDevice, mSwapChain, &imageCount, swapChainImages.GetRaw()))
+   images.New(imageCount);
+   if (vkGetSwapchainImagesKHR(mRenderer.mDevice, mSwapChain, &imageCount, images.GetRaw()))
       LANGULUS_OOPS(Graphics, "vkGetSwapchainImagesKHR fails");
-
-   // Create the image views for the swap chain. They will all be       
-   // single layer, 2D images, with no mipmaps                          
-   const auto count = imageCount;
-   bool reverseFormat;
-   const auto viewf = VkFormatToDMeta(format.format, reverseFormat);
-   ImageView colorview {
-      extent.width, extent.height, 1, 1, viewf, reverseFormat
-   };
-
-   mFrameViews.New(count);
-   mFrameImages.New(count);
-
-   for (uint32_t i = 0; i < count; i++) {
-      auto& image = swapChainImages[i];
-      mRenderer.mVRAM.ImageTransfer(
-         image,
-         VK_IMAGE_LAYOUT_UNDEFINED, 
-         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-      );
-      mRenderer.mVRAM.ImageTransfer(
-         image, 
-         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 
-         VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-      );
-
-      // Add the view                                                   
-      mFrameViews[i] = mRenderer.mVRAM.CreateImageView(
-         image, colorview, VK_IMAGE_ASPECT_COLOR_BIT
-      );
-
-      // Add the image                                                  
-      mFrameImages[i] = VulkanImage::FromSwapchain(
-         mRenderer.mDevice, image, colorview
-      );
-   }
-   
-   // Create the depth buffer image and view                            
-   ImageView depthview {
-      extent.width, extent.height, 1, 1, MetaOf<Depth32>()
-   };
-   mDepthImage = mRenderer.mVRAM.CreateImage(
-      depthview, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
-   );
-   mDepthImageView = mRenderer.mVRAM.CreateImageView(mDepthImage);
-   mRenderer.mVRAM.ImageTransfer(mDepthImage,
-      VK_IMAGE_LAYOUT_UNDEFINED, 
-      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-   );
-      
-   // Create framebuffers                                               
-   mFrameBuffers.New(count);
-   for (Offset i = 0; i < count; ++i) {
-      VkImageView attachments[] {mFrameViews[i], mDepthImageView};
-      VkFramebufferCreateInfo framebufferInfo {};
-      framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-      framebufferInfo.renderPass = mRenderer.mPass;
-      framebufferInfo.attachmentCount = 2;
-      framebufferInfo.pAttachments = attachments;
-      framebufferInfo.width = resxuint;
-      framebufferInfo.height = resyuint;
-      framebufferInfo.layers = 1;
-
-      if (vkCreateFramebuffer(mRenderer.mDevice, &framebufferInfo, nullptr, &mFrameBuffers[i]))
-         LANGULUS_OOPS(Graphics, "Can't create framebuffer");
-   }
-
-   // Create a command buffer for each framebuffer                      
-   mCommandBuffer.resize(count);
-   VkCommandBufferAllocateInfo allocInfo {};
-   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-   allocInfo.commandPool = mRenderer.mCommandPool;
-   allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-   allocInfo.commandBufferCount = count;
-
-   if (vkAllocateCommandBuffers(mRenderer.mDevice, &allocInfo, mCommandBuffer.data()))
-      LANGULUS_OOPS(Graphics, "Can't create command buffers");
-
-   // Create command buffer fences                                      
-   if (not mNewBufferFence) {
-      TMany<VkFenceCreateInfo> fenceInfo;
-      fenceInfo.New(count);
-      mNewBufferFence.Reserve(count);
-
-      for (auto& it : fenceInfo) {
-         it.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-         VkFence result {};
-         if (vkCreateFence(mRenderer.mDevice, &it, nullptr, &result))
-            LANGULUS_OOPS(Graphics, "Can't create buffer fence");
-
-         mNewBufferFence << result;
-      }
-   }
-   
-   // Create sync primitives                                            
-   VkSemaphoreCreateInfo fenceInfo {};
-   fenceInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-   if (vkCreateSemaphore(mRenderer.mDevice, &fenceInfo, nullptr, &mNewFrameFence.Get()))
-      LANGULUS_OOPS(Graphics, "Can't create new frame semaphore");
-
-   VkSemaphoreCreateInfo semaphoreInfo {};
-   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-   if (vkCreateSemaphore(mRenderer.mDevice, &semaphoreInfo, nullptr, &mFrameFinished.Get()))
-      LANGULUS_OOPS(Graphics, "Can't create frame finished semaphore");
-
-   mCurrentFrame = 0;
 }
 
-/// Recreate the swapchain (usually on window resize)                         
+/// Recreate the swapchain (usually on window resize, or when the size of an  
+/// offscreen renderer changes)                                               
 ///   @param families - a set of queue families                               
 void VulkanSwapchain::Recreate(const QueueFamilies& families) {
    Destroy();
 
-   try { Create(GetSurfaceFormat(), families); }
+   try { Create(mOffscreen ? mFormat : GetSurfaceFormat(), families); }
    catch (...) {
       Destroy();
       throw;
@@ -238,49 +314,52 @@ void VulkanSwapchain::Destroy() {
 
    vkDeviceWaitIdle(mRenderer.mDevice);
 
-   if (mFrameFinished) {
-      vkDestroySemaphore(mRenderer.mDevice, mFrameFinished, nullptr);
-      mFrameFinished.Reset();
-   }
-
-   if (mNewFrameFence) {
-      vkDestroySemaphore(mRenderer.mDevice, mNewFrameFence, nullptr);
-      mNewFrameFence.Reset();
+   // Destroy the frames in flight                                      
+   for (auto& frame : mFrames) {
+      if (frame.mRendered)
+         vkDestroySemaphore(mRenderer.mDevice, frame.mRendered, nullptr);
+      if (frame.mAcquired)
+         vkDestroySemaphore(mRenderer.mDevice, frame.mAcquired, nullptr);
+      if (frame.mDone)
+         vkDestroyFence(mRenderer.mDevice, frame.mDone, nullptr);
+      if (frame.mCommands)
+         vkFreeCommandBuffers(mRenderer.mDevice, mRenderer.mCommandPool, 1, &frame.mCommands);
    }
-
-   // Destroy fences                                                    
-   for (auto& it : mNewBufferFence)
-      vkDestroyFence(mRenderer.mDevice, it, nullptr);
-   mNewBufferFence.Clear();
+   mFrames.clear();
 
    // Destroy the depth buffer images                                   
    vkDestroyImageView(mRenderer.mDevice, mDepthImageView, nullptr);
    mDepthImageView.Reset();
    mRenderer.mVRAM.DestroyImage(mDepthImage);
 
+   // Destroy the G-buffer images                                       
+   vkDestroyImageView(mRenderer.mDevice, mAlbedoImageView, nullptr);
+   mAlbedoImageView.Reset();
+   mRenderer.mVRAM.DestroyImage(mAlbedoImage);
+   vkDestroyImageView(mRenderer.mDevice, mNormalImageView, nullptr);
+   mNormalImageView.Reset();
+   mRenderer.mVRAM.DestroyImage(mNormalImage);
+
    // Destroy framebuffers                                              
    for (auto& it : mFrameBuffers)
       vkDestroyFramebuffer(mRenderer.mDevice, it, nullptr);
    mFrameBuffers.Clear();
-   
-   // Destroy command buffers                                           
-   if (mCommandBuffer.size()) {
-      vkFreeCommandBuffers(
-         mRenderer.mDevice,
-         mRenderer.mCommandPool,
-         static_cast<uint32_t>(mCommandBuffer.size()),
-         mCommandBuffer.data()
-      );
-      mCommandBuffer.clear();
-   }
+   for (auto& it : mDeferredFrameBuffers)
+      vkDestroyFramebuffer(mRenderer.mDevice, it, nullptr);
+   mDeferredFrameBuffers.Clear();
    
    // Destroy image views                                               
    for (auto& it : mFrameViews)
       vkDestroyImageView(mRenderer.mDevice, it, nullptr);
    mFrameViews.Clear();
    
-   // Destroy swapchain                                                 
-   vkDestroySwapchainKHR(mRenderer.mDevice, mSwapChain, nullptr);
+   // Destroy swapchain, or our own images                              
+   if (mOffscreen) {
+      for (auto& it : mFrameImages)
+         mRenderer.mVRAM.DestroyImage(it);
+   }
+   else if (mSwapChain)
+      vkDestroySwapchainKHR(mRenderer.mDevice, mSwapChain, nullptr);
    mSwapChain.Reset();
    mFrameImages.Clear();
 }
@@ -334,70 +413,128 @@ VkSurfaceFormatKHR VulkanSwapchain::GetSurfaceFormat() const noexcept {
    return surfaceFormat;
 }
 
+/// Move on to the next frame in flight, waiting only until the GPU is done   
+/// with that frame's previous use - the other frames keep drawing            
+void VulkanSwapchain::NextFrame() {
+   if (mFrames.empty())
+      return;
+
+   mFrame = (mFrame + 1) % static_cast<uint32_t>(mFrames.size());
+   vkWaitForFences(mRenderer.mDevice, 1, &mFrames[mFrame].mDone, VK_TRUE, UINT64_MAX);
+}
+
+/// Wait until the GPU is done with all frames in flight, so that resources   
+/// shared between them can be changed                                        
+void VulkanSwapchain::WaitAll() {
+   if (mFrames.empty())
+      return;
+
+   ::std::vector<VkFence> fences;
+   for (const auto& frame : mFrames)
+      fences.push_back(frame.mDone);
+
+   vkWaitForFences(mRenderer.mDevice,
+      static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+}
+
+/// Get the frame in flight, that is being prepared                           
+///   @return the frame index, below the renderer's number of frames in flight
+uint32_t VulkanSwapchain::GetFrame() const noexcept {
+   return mFrame;
+}
+
+/// Check if back buffers can be copied from and to                           
+///   @return true if the surface allows transfers                            
+bool VulkanSwapchain::IsCopyable() const noexcept {
+   return mCopyable;
+}
+
+/// Check if images are drawn offscreen, instead of being presented           
+///   @return true if the renderer has no surface, but has images to draw to  
+bool VulkanSwapchain::IsOffscreen() const noexcept {
+   return mOffscreen and not mFrames.empty();
+}
+
 /// Pick a back buffer and start writing the command buffer                   
 ///   @return true if something was rendered                                  
 bool VulkanSwapchain::StartRendering() {
    // Set next frame from the swapchain                                 
    // This changes mCurrentFrame globally for this renderer             
-   auto result = vkAcquireNextImageKHR(
-      mRenderer.mDevice, mSwapChain, VK_INDEFINITELY,
-      mFrameFinished, VK_NULL_HANDLE, &mCurrentFrame
-   );
-
-   // Check if resolution has changed                                   
-   if (result == VK_ERROR_OUT_OF_DATE_KHR
-   or (result and result != VK_SUBOPTIMAL_KHR)) {
-      // Le strange error occurs                                        
-      Logger::Error(Self(), "Vulkan failed to resize swapchain");
-      return false;
+   const auto& frame = mFrames[mFrame];
+   if (mOffscreen) {
+      // There are at least as many images as frames in flight, so the  
+      // next one isn't used by the GPU anymore                         
+      mCurrentFrame = (mCurrentFrame + 1)
+         % static_cast<uint32_t>(mFrameImages.GetCount());
    }
+   else {
+      auto result = vkAcquireNextImageKHR(
+         mRenderer.mDevice, mSwapChain, VK_INDEFINITELY,
+         frame.mAcquired, VK_NULL_HANDLE, &mCurrentFrame
+      );
 
-   // Turn the present source to color attachment                       
-   mRenderer.mVRAM.ImageTransfer(
-      mFrameImages[mCurrentFrame],
-      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-   );
+      // Check if resolution has changed                                
+      if (result == VK_ERROR_OUT_OF_DATE_KHR
+      or (result and result != VK_SUBOPTIMAL_KHR)) {
+         // Le strange error occurs                                     
+         Logger::Error(Self(), "Vulkan failed to resize swapchain");
+         return false;
+      }
+   }
 
-   // Begin writing to command buffer                                   
+   // Begin writing to command buffer - there's no need to turn the     
+   // present source to a color attachment, the first render pass does  
+   // it, since its color attachment starts undefined                   
    VkCommandBufferBeginInfo beginInfo {};
    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-   vkBeginCommandBuffer(mCommandBuffer[mCurrentFrame], &beginInfo);
+   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+   vkBeginCommandBuffer(frame.mCommands, &beginInfo);
    return true;
 }
 
 /// Submit command buffers and present                                        
+/// The frame's render graph must have turned the back buffer to a present    
+/// source, as its last pass - or to a transfer source offscreen, where       
+/// nothing is presented                                                      
 ///   @return true if something was rendered                                  
 bool VulkanSwapchain::EndRendering() {
+   const auto& frame = mFrames[mFrame];
+
    // Command buffer ends                                               
-   if (vkEndCommandBuffer(mCommandBuffer[mCurrentFrame])) {
+   if (vkEndCommandBuffer(frame.mCommands)) {
       Logger::Error(Self(), "Can't end command buffer");
       return false;
    }
 
    // Submit command buffer to GPU                                      
-   VkSemaphore waitSemaphores[]   {mFrameFinished};
-   VkSemaphore signalSemaphores[] {mNewFrameFence};
+   VkSemaphore waitSemaphores[]   {frame.mAcquired};
+   VkSemaphore signalSemaphores[] {frame.mRendered};
    VkPipelineStageFlags waitStages[] {
       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
    };
 
    VkSubmitInfo submitInfo {};
    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-   submitInfo.waitSemaphoreCount = 1;
-   submitInfo.pWaitSemaphores = waitSemaphores;
-   submitInfo.pWaitDstStageMask = waitStages;
    submitInfo.commandBufferCount = 1;
-   submitInfo.pCommandBuffers = &mCommandBuffer[mCurrentFrame];
-   submitInfo.signalSemaphoreCount = 1;
-   submitInfo.pSignalSemaphores = signalSemaphores;
+   submitInfo.pCommandBuffers = &frame.mCommands;
+   if (not mOffscreen) {
+      submitInfo.waitSemaphoreCount = 1;
+      submitInfo.pWaitSemaphores = waitSemaphores;
+      submitInfo.pWaitDstStageMask = waitStages;
+      submitInfo.signalSemaphoreCount = 1;
+      submitInfo.pSignalSemaphores = signalSemaphores;
+   }
 
-   if (vkQueueSubmit(mRenderer.mRenderQueue, 1, &submitInfo, VK_NULL_HANDLE)) {
+   // The fence tells when this frame's resources can be reused         
+   vkResetFences(mRenderer.mDevice, 1, &frame.mDone);
+   if (vkQueueSubmit(mRenderer.mRenderQueue, 1, &submitInfo, frame.mDone)) {
       Logger::Error(Self(), "Vulkan failed to submit render buffer");
       return false;
    }
 
+   if (mOffscreen)
+      return true;
+
    // Present and return                                                
    VkSwapchainKHR swapChains[] {mSwapChain};
    VkPresentInfoKHR presentInfo {};
@@ -408,12 +545,6 @@ bool VulkanSwapchain::EndRendering() {
    presentInfo.pSwapchains = swapChains;
    presentInfo.pImageIndices = &mCurrentFrame;
 
-   mRenderer.mVRAM.ImageTransfer(
-      mFrameImages[mCurrentFrame],
-      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 
-      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-   );
-
    if (vkQueuePresentKHR(mRenderer.mPresentQueue, &presentInfo)) {
       Logger::Error(Self(), "Vulkan failed to present - the frame will be lost");
    }
@@ -429,7 +560,7 @@ Text VulkanSwapchain::Self() const {
 /// Get the command buffer for the current frame                              
 ///   @return the command buffer                                              
 VkCommandBuffer VulkanSwapchain::GetRenderCB() const noexcept {
-   return mCommandBuffer[mCurrentFrame];
+   return mFrames[mFrame].mCommands;
 }
 
 /// Get the frame buffer for the current frame                                
@@ -438,19 +569,51 @@ VkFramebuffer VulkanSwapchain::GetFramebuffer() const noexcept {
    return mFrameBuffers[mCurrentFrame];
 }
 
+/// Get the deferred lights pass frame buffer for the current frame           
+///   @return the frame buffer                                                
+VkFramebuffer VulkanSwapchain::GetDeferredFramebuffer() const noexcept {
+   return mDeferredFrameBuffers[mCurrentFrame];
+}
+
 /// Get currently bound swapchain image                                       
 ///   @return the image                                                       
 const VulkanImage& VulkanSwapchain::GetCurrentImage() const noexcept {
    return mFrameImages[mCurrentFrame];
 }
 
+/// Get the depth image                                                       
+///   @return the image                                                       
+const VulkanImage& VulkanSwapchain::GetDepthImage() const noexcept {
+   return mDepthImage;
+}
+
+/// Get the depth image view                                                  
+///   @return the view                                                        
+VkImageView VulkanSwapchain::GetDepthView() const noexcept {
+   return mDepthImageView;
+}
+
+/// Get the G-buffer albedo image view                                        
+///   @return the view                                                        
+VkImageView VulkanSwapchain::GetAlbedoView() const noexcept {
+   return mAlbedoImageView;
+}
+
+/// Get the G-buffer normals image view                                       
+///   @return the view                                                        
+VkImageView VulkanSwapchain::GetNormalView() const noexcept {
+   return mNormalImageView;
+}
+
 /// Take a screenshot                                                         
 Ref<A::Image> VulkanSwapchain::TakeScreenshot() {
    // The stager is used to copy from current back buffer               
-   // (VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) to a                   
-   // VK_BUFFER_USAGE_TRANSFER_DST_BIT buffer, that is later copied to  
-   // a RAM buffer                                                      
-   const auto source = GetCurrentImage();
+   // (VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, or already a transfer source    
+   // offscreen) to a VK_BUFFER_USAGE_TRANSFER_DST_BIT buffer, that is  
+   // later copied to a RAM buffer                                      
+   // The back buffer might still be drawn, as part of a frame in flight
+   WaitAll();
+   const auto& source = GetCurrentImage();
    const auto bytesize = source.GetView().GetBytesize();
    auto& vram = mRenderer.mVRAM;
    auto stager = vram.CreateBuffer(
@@ -459,13 +622,6 @@ Ref<A::Image> VulkanSwapchain::TakeScreenshot() {
       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
    );
 
-   // Transfer provided source to a VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-   mRenderer.mVRAM.ImageTransfer(
-      source,
-      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-   );
-
    // Copy bytes                                                        
    auto& cmdbuffer = vram.mTransferBuffer;
    VkCommandBufferBeginInfo beginInfo {};
@@ -473,6 +629,14 @@ Ref<A::Image> VulkanSwapchain::TakeScreenshot() {
    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
    vkBeginCommandBuffer(cmdbuffer, &beginInfo);
 
+   // Turn the back buffer to a transfer source, and back to a present  
+   // source after the copy, in the same submission. Offscreen images   
+   // are left as transfer sources by each frame, so they stay as such  
+   Barriers barriers;
+   barriers.Transition(source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+   barriers.Flush(cmdbuffer);
+
    VkBufferImageCopy region {};
    region.bufferOffset = 0;
    region.bufferRowLength = 0;
@@ -494,6 +658,15 @@ Ref<A::Image> VulkanSwapchain::TakeScreenshot() {
       stager.GetBuffer(),
       1, &region
    );
+
+   if (not mOffscreen) {
+      barriers.Transition(source, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+         0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+   }
+   barriers.Buffer(stager.GetBuffer(),
+      VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+   barriers.Flush(cmdbuffer);
    vkEndCommandBuffer(cmdbuffer);
 
    // Submit                                                            
@@ -504,13 +677,6 @@ Ref<A::Image> VulkanSwapchain::TakeScreenshot() {
    vkQueueSubmit(vram.mTransferer, 1, &submitInfo, VK_NULL_HANDLE);
    vkQueueWaitIdle(vram.mTransferer);
 
-   // Transfer source back to its original layout                       
-   mRenderer.mVRAM.ImageTransfer(
-      source.GetImage(),
-      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-   );
-
    // Copy the data from the buffer to a RAM texture                    
    Byte* input;
    auto err = vkMapMemory(
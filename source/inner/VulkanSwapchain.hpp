@@ -20,6 +20,11 @@ protected:
 
    // Swap chain                                                        
    Own<VkSwapchainKHR> mSwapChain;
+   // Format of the images                                              
+   VkSurfaceFormatKHR mFormat {};
+   // Whether images are our own, because there's no surface to present 
+   // to - they're drawn one after another, and never presented         
+   bool mOffscreen {};
 
    // Images for the swap chain framebuffers                            
    TMany<VulkanImage> mFrameImages;
@@ -27,27 +32,45 @@ protected:
    FrameViews mFrameViews;
    // Framebuffers                                                      
    FrameBuffers mFrameBuffers;
-   // Fence for each framebuffer                                        
-   TMany<VkFence> mNewBufferFence;
 
-   // I think this is not used                                          
-   Own<VkSemaphore> mNewFrameFence;
-   // Frame finished                                                    
-   Own<VkSemaphore> mFrameFinished;
-
-   // Current frame index                                               
+   // Index of the swapchain image being drawn                          
    uint32_t mCurrentFrame {};
 
-   // Command buffers                                                   
-   CmdBuffers mCommandBuffer;
+   // Everything a frame in flight needs for itself                     
+   struct Frame {
+      // Commands of the frame                                          
+      VkCommandBuffer mCommands {};
+      // Signaled when the GPU is done with the frame                   
+      VkFence mDone {};
+      // Signaled when the swapchain image is acquired                  
+      VkSemaphore mAcquired {};
+      // Signaled when the image is drawn, and can be presented         
+      VkSemaphore mRendered {};
+   };
+
+   // Frames in flight, and the one being prepared                      
+   ::std::vector<Frame> mFrames;
+   uint32_t mFrame {};
+
    // Depth image                                                       
    VulkanImage mDepthImage;
    // Depth image view                                                  
    Own<VkImageView> mDepthImageView;
+   // G-buffer images and views, for layers with deferred lights        
+   VulkanImage mAlbedoImage;
+   Own<VkImageView> mAlbedoImageView;
+   VulkanImage mNormalImage;
+   Own<VkImageView> mNormalImageView;
+   // Framebuffers of the deferred lights pass                          
+   FrameBuffers mDeferredFrameBuffers;
+   // Whether images can be copied from and to                          
+   bool mCopyable {};
 
    // Always keep a reference to a screenshot, to avoid reallocation    
    Ref<A::Image> mScreenshot;
 
+   void CreateSwapchain(const VkSurfaceFormatKHR&, const QueueFamilies&, VkExtent2D&, TMany<VkImage>&);
+
 public:
    VulkanSwapchain() = delete;
    VulkanSwapchain(VulkanRenderer&) noexcept;
@@ -56,12 +79,23 @@ public:
    void Recreate(const QueueFamilies&);
    void Destroy();
 
+   void NextFrame();
+   void WaitAll();
    bool StartRendering();
    bool EndRendering();
 
+   NOD() uint32_t GetFrame() const noexcept;
+   NOD() bool IsCopyable() const noexcept;
+   NOD() bool IsOffscreen() const noexcept;
+
    NOD() VkSurfaceFormatKHR GetSurfaceFormat() const noexcept;
    NOD() VkCommandBuffer GetRenderCB() const noexcept;
    NOD() VkFramebuffer GetFramebuffer() const noexcept;
+   NOD() VkFramebuffer GetDeferredFramebuffer() const noexcept;
    NOD() const VulkanImage& GetCurrentImage() const noexcept;
+   NOD() const VulkanImage& GetDepthImage() const noexcept;
+   NOD() VkImageView GetDepthView() const noexcept;
+   NOD() VkImageView GetAlbedoView() const noexcept;
+   NOD() VkImageView GetNormalView() const noexcept;
    NOD() Ref<A::Image> TakeScreenshot();
 };
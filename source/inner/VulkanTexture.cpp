@@ -98,30 +98,10 @@ void VulkanTexture::Upload(const A::Image& content) {
    vkBeginCommandBuffer(cmdbuffer, &beginInfo);
 
    // Transition to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL layout         
-   VkImageMemoryBarrier barrier {};
-   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-   barrier.oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
-   barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   barrier.image = mImage.GetImage();
-   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-   barrier.subresourceRange.baseMipLevel = 0;
-   barrier.subresourceRange.levelCount = 1;
-   barrier.subresourceRange.baseArrayLayer = 0;
-   barrier.subresourceRange.layerCount = 1;
-   barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-   barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-   vkCmdPipelineBarrier(
-      cmdbuffer,
-      VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
-      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-      0,
-      0, nullptr,
-      0, nullptr,
-      1, &barrier
-   );
+   Barriers barriers;
+   barriers.Transition(mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+   barriers.Flush(cmdbuffer);
 
    // Copy bytes                                                        
    VkBufferImageCopy region {};
@@ -144,27 +124,9 @@ void VulkanTexture::Upload(const A::Image& content) {
    );
 
    // Transition to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL            
-   barrier = {};
-   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-   barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-   barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   barrier.image = mImage.GetImage();
-   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-   barrier.subresourceRange.baseMipLevel = 0;
-   barrier.subresourceRange.levelCount = 1;
-   barrier.subresourceRange.baseArrayLayer = 0;
-   barrier.subresourceRange.layerCount = 1;
-   barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-   barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-   vkCmdPipelineBarrier(
-      cmdbuffer,
-      VK_PIPELINE_STAGE_TRANSFER_BIT,
-      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-      0, 0, nullptr, 0, nullptr, 1, &barrier
-   );
+   barriers.Transition(mImage, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+   barriers.Flush(cmdbuffer);
 
    // Submit                                                            
    vkEndCommandBuffer(cmdbuffer);
@@ -0,0 +1,122 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/BVH.hpp"
+#include <catch2/catch.hpp>
+#include <random>
+
+/// Visit spheres, the way CompileLevelBatched did before it had an index     
+///   @param frustum - the frustum                                            
+///   @param spheres - the spheres                                            
+///   @return the indices of the visible spheres                              
+static ::std::vector<uint32_t> BruteForce(const CullFrustum& frustum, const BoundingSpheres& spheres) {
+   ::std::vector<uint32_t> result;
+   for (uint32_t i = 0; i < spheres.size(); ++i) {
+      CullCandidate candidate {};
+      ::std::copy(spheres[i].mCenter, spheres[i].mCenter + 3, candidate.mCenter);
+      candidate.mRadius = spheres[i].mRadius;
+      if (IsVisible(frustum, candidate))
+         result.push_back(i);
+   }
+   return result;
+}
+
+/// Gather the visible spheres from the tree, in ascending order              
+///   @param tree - the tree                                                  
+///   @param frustum - the frustum                                            
+///   @param spheres - the spheres                                            
+///   @return the indices of the visible spheres                              
+static ::std::vector<uint32_t> Query(const BVH& tree, const CullFrustum& frustum, const BoundingSpheres& spheres) {
+   ::std::vector<uint32_t> result;
+   tree.Query(frustum, spheres, [&](uint32_t i) { result.push_back(i); });
+   ::std::sort(result.begin(), result.end());
+   return result;
+}
+
+
+SCENARIO("Querying a bounding volume hierarchy with a frustum", "[bvh]") {
+   GIVEN("Ten thousand spheres scattered in a big box") {
+      ::std::mt19937 random {42};
+      ::std::uniform_real_distribution<float> position {-500, 500};
+      ::std::uniform_real_distribution<float> size {0.1f, 5};
+
+      BoundingSpheres spheres(10000);
+      for (auto& sphere : spheres) {
+         for (auto& c : sphere.mCenter)
+            c = position(random);
+         sphere.mRadius = size(random);
+      }
+
+      BVH tree;
+      tree.Build(spheres);
+
+      // An orthographic frustum of the [-50;50] box                    
+      const float viewProjection[16] {
+         0.02f, 0, 0, 0,
+         0, 0.02f, 0, 0,
+         0, 0, 0.01f, 0,
+         0, 0, 0.5f, 1
+      };
+      const auto frustum = MakeCullFrustum(viewProjection, 0);
+
+      THEN("It visits exactly the visible spheres") {
+         const auto expected = BruteForce(frustum, spheres);
+         REQUIRE(expected.size() > 0);
+         REQUIRE(expected.size() < spheres.size() / 10);
+         REQUIRE(Query(tree, frustum, spheres) == expected);
+      }
+
+      WHEN("The spheres move a bit, and the tree is refit") {
+         ::std::uniform_real_distribution<float> offset {-2, 2};
+         for (auto& sphere : spheres) {
+            for (auto& c : sphere.mCenter)
+               c += offset(random);
+         }
+
+         THEN("It still visits exactly the visible spheres") {
+            REQUIRE(tree.Refit(spheres));
+            REQUIRE(Query(tree, frustum, spheres) == BruteForce(frustum, spheres));
+         }
+      }
+
+      WHEN("The spheres scatter far away, and the tree is refit") {
+         for (auto& sphere : spheres) {
+            for (auto& c : sphere.mCenter)
+               c *= 10;
+         }
+
+         THEN("It asks to be rebuilt") {
+            REQUIRE_FALSE(tree.Refit(spheres));
+            tree.Build(spheres);
+            REQUIRE(Query(tree, frustum, spheres) == BruteForce(frustum, spheres));
+         }
+      }
+
+      BENCHMARK("Culling 10000 spheres one by one") {
+         return BruteForce(frustum, spheres).size();
+      };
+
+      BENCHMARK("Culling 10000 spheres in a hierarchy") {
+         uint32_t visible = 0;
+         tree.Query(frustum, spheres, [&](uint32_t) { ++visible; });
+         return visible;
+      };
+   }
+
+   GIVEN("No spheres at all") {
+      BoundingSpheres spheres;
+      BVH tree;
+      tree.Build(spheres);
+
+      THEN("Nothing is visited") {
+         const float viewProjection[16] {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+         REQUIRE(Query(tree, MakeCullFrustum(viewProjection, 0), spheres).empty());
+         REQUIRE(tree.Refit(spheres));
+      }
+   }
+}
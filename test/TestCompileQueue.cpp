@@ -0,0 +1,82 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/CompileQueue.hpp"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+using namespace ::std::chrono_literals;
+
+
+SCENARIO("Compiling in the background, a few jobs per frame", "[compile]") {
+   for (uint32_t threads : {1u, 3u}) {
+      GIVEN("A queue with " + ::std::to_string(threads) + " threads") {
+         // Jobs refer to these, so they must outlive the queue         
+         ::std::atomic<uint32_t> running = 0, peak = 0, done = 0;
+         CompileQueue queue {threads};
+         REQUIRE(queue.GetThreads() == threads);
+
+         ::std::vector<::std::future<int>> results;
+         ::std::vector<CompileQueue::Ticket> tickets;
+         for (int i = 0; i < 10; ++i) {
+            ::std::packaged_task<int()> job {[&, i] {
+               const auto now = ++running;
+               auto seen = peak.load();
+               while (now > seen and not peak.compare_exchange_weak(seen, now));
+               ::std::this_thread::sleep_for(1ms);
+               --running;
+               ++done;
+               return i * i;
+            }};
+
+            results.push_back(job.get_future());
+            tickets.push_back(queue.Submit(::std::packaged_task<void()> {::std::move(job)}));
+         }
+
+         WHEN("Nothing is released") {
+            ::std::this_thread::sleep_for(10ms);
+
+            THEN("No job starts") {
+               REQUIRE(done == 0);
+               REQUIRE(queue.GetQueued() == 10);
+            }
+         }
+
+         WHEN("Jobs are released a few at a time") {
+            REQUIRE(queue.Release(4) == 4);
+            for (int i = 0; i < 4; ++i)
+               REQUIRE(results[i].get() == i * i);
+
+            THEN("Only the released jobs run, on at most all threads") {
+               ::std::this_thread::sleep_for(10ms);
+               REQUIRE(done == 4);
+               REQUIRE(queue.GetQueued() == 6);
+               REQUIRE(peak <= threads);
+            }
+         }
+
+         WHEN("Jobs are cancelled before and after they're released") {
+            queue.Cancel(tickets[1]);
+            REQUIRE(queue.Release(3) == 3);
+            queue.Cancel(tickets[3]);
+            queue.Cancel(tickets[0]);
+            REQUIRE(queue.Release(100) == 6);
+            for (int i = 4; i < 10; ++i)
+               REQUIRE(results[i].get() == i * i);
+
+            THEN("Cancelled jobs that didn't start break their promise") {
+               REQUIRE_THROWS_AS(results[1].get(), ::std::future_error);
+               REQUIRE(results[2].get() == 4);
+               REQUIRE(queue.GetQueued() == 0);
+            }
+         }
+      }
+   }
+}
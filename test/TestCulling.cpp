@@ -0,0 +1,213 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/Culling.hpp"
+#include <catch2/catch.hpp>
+#include <memory>
+#include <random>
+
+/// Make a column-major matrix, that translates and uniformly scales          
+///   @param x, y, z - the translation                                        
+///   @param scale - the scale                                                
+///   @return the matrix                                                      
+static ::std::vector<float> MakeModel(float x, float y, float z, float scale) {
+   return {
+      scale, 0, 0, 0,
+      0, scale, 0, 0,
+      0, 0, scale, 0,
+      x, y, z, 1
+   };
+}
+
+
+SCENARIO("Culling instances against camera levels", "[culling]") {
+   GIVEN("An orthographic frustum of the [-1;1] box at level 0") {
+      // Maps x and y from [-1;1] as is, and z from [-1;1] to [0;1]     
+      const float viewProjection[16] {
+         1, 0, 0, 0,
+         0, 1, 0, 0,
+         0, 0, 0.5f, 0,
+         0, 0, 0.5f, 1
+      };
+
+      CullFrustums frustums {MakeCullFrustum(viewProjection, 0)};
+      CullCandidates candidates;
+      const ::std::vector<float> models[] {
+         MakeModel(0, 0, 0, 1),        // Inside
+         MakeModel(1.2f, 0, 0, 1),     // Intersects the right plane
+         MakeModel(3, 0, 0, 1),        // Outside on the right
+         MakeModel(0, 0, -3, 1),       // Outside behind the near plane
+         MakeModel(0, 0, 0, 1),        // Inside, but on another level
+      };
+
+      // All candidates append to a single command - its instance count 
+      // is word 0, and its instances start at word 1                   
+      for (uint32_t i = 0; i < 5; ++i) {
+         candidates.push_back(MakeCullCandidate(models[i].data(), i == 4 ? 1 : 0, 0));
+         candidates.back().mCommand = 0;
+         candidates.back().mFirst = 1;
+         candidates.back().mInstance = 10 + i;
+      }
+
+      WHEN("Culled on the CPU") {
+         uint32_t words[6] {0, ~0u, ~0u, ~0u, ~0u, ~0u};
+         CullReference(frustums, candidates, words);
+
+         THEN("Only visible candidates are appended to the command") {
+            REQUIRE(words[0] == 2);
+            REQUIRE(words[1] == 10);
+            REQUIRE(words[2] == 11);
+            REQUIRE(words[3] == ~0u);
+         }
+      }
+
+      WHEN("Some candidates aren't assigned to commands") {
+         candidates[0].mCommand = CullNoCommand;
+         uint32_t words[6] {0, ~0u, ~0u, ~0u, ~0u, ~0u};
+         CullReference(frustums, candidates, words);
+
+         THEN("They append nothing") {
+            REQUIRE(words[0] == 1);
+            REQUIRE(words[1] == 11);
+            REQUIRE(words[2] == ~0u);
+         }
+      }
+
+      WHEN("Results are appended in another order") {
+         uint32_t expected[6] {0, ~0u, ~0u, ~0u, ~0u, ~0u};
+         CullReference(frustums, candidates, expected);
+         uint32_t swapped[6] {2, 11, 10, ~0u, ~0u, ~0u};
+         uint32_t wrong[6] {2, 10, 12, ~0u, ~0u, ~0u};
+         uint32_t fewer[6] {1, 10, ~0u, ~0u, ~0u, ~0u};
+
+         THEN("Only different instances are mismatches") {
+            REQUIRE(CullMismatches(candidates, expected, swapped) == 0);
+            REQUIRE(CullMismatches(candidates, expected, wrong) == 1);
+            REQUIRE(CullMismatches(candidates, expected, fewer) == 1);
+         }
+      }
+   }
+}
+
+SCENARIO("Testing instances against a depth pyramid", "[culling]") {
+   GIVEN("A reduced depth buffer, half way through the [-1;1] box") {
+      const float viewProjection[16] {
+         1, 0, 0, 0,
+         0, 1, 0, 0,
+         0, 0, 0.5f, 0,
+         0, 0, 0.5f, 1
+      };
+
+      ::std::vector<float> texels(8 * 8, 0.5f);
+      DepthPyramid pyramid;
+      pyramid.Build(texels.data(), 8, 8);
+
+      THEN("The pyramid goes down to a single texel") {
+         REQUIRE(pyramid.mLevels.size() == 4);
+         REQUIRE(pyramid.mLevels.back().mWidth == 1);
+         REQUIRE(pyramid.mLevels.back().mHeight == 1);
+         REQUIRE(pyramid.mLevels.back().At(0, 0) == 0.5f);
+      }
+
+      WHEN("Testing instances in front and behind the depth") {
+         const float behind[3] {0.2f, 0.2f, 0.8f};
+         const float front[3] {0.2f, 0.2f, -0.5f};
+         const float crossing[3] {0.2f, 0.2f, 0.05f};
+
+         THEN("Only the one behind is occluded") {
+            REQUIRE(pyramid.IsOccluded(viewProjection, behind, 0.1f));
+            REQUIRE_FALSE(pyramid.IsOccluded(viewProjection, front, 0.1f));
+            REQUIRE_FALSE(pyramid.IsOccluded(viewProjection, crossing, 0.1f));
+         }
+      }
+
+      WHEN("There is a hole in the depth, where an instance is") {
+         // x and y of 0.2 map to texel 4 of 8                          
+         texels[4 * 8 + 4] = 1.0f;
+         pyramid.Build(texels.data(), 8, 8);
+         const float behind[3] {0.2f, 0.2f, 0.8f};
+         const float elsewhere[3] {-0.6f, -0.6f, 0.8f};
+
+         THEN("The instance is visible through it") {
+            REQUIRE_FALSE(pyramid.IsOccluded(viewProjection, behind, 0.1f));
+            REQUIRE(pyramid.IsOccluded(viewProjection, elsewhere, 0.1f));
+         }
+      }
+   }
+}
+
+/// Stands in for A::Instance, which culls itself through a virtual call      
+struct CullableInstance {
+   CullCandidate mBounds;
+
+   virtual ~CullableInstance() = default;
+   virtual bool Cull(const CullFrustum& frustum) const {
+      return not IsVisible(frustum, mBounds);
+   }
+};
+
+SCENARIO("Culling boxes four at a time", "[culling]") {
+   GIVEN("Ten thousand instances scattered in a big box") {
+      ::std::mt19937 random {42};
+      ::std::uniform_real_distribution<float> position {-500, 500};
+      ::std::uniform_real_distribution<float> size {0.1f, 5};
+
+      CullBoxes boxes;
+      boxes.Resize(10001);
+      ::std::vector<::std::unique_ptr<CullableInstance>> instances;
+      for (size_t i = 0; i < boxes.mCount; ++i) {
+         const auto model = MakeModel(position(random), position(random), position(random), size(random));
+         boxes.Set(i, model.data());
+         instances.push_back(::std::make_unique<CullableInstance>());
+         instances.back()->mBounds = MakeCullCandidate(model.data(), 0, 0);
+      }
+
+      // An orthographic frustum of the [-50;50] box                    
+      const float viewProjection[16] {
+         0.02f, 0, 0, 0,
+         0, 0.02f, 0, 0,
+         0, 0, 0.01f, 0,
+         0, 0, 0.5f, 1
+      };
+      const auto frustum = MakeCullFrustum(viewProjection, 0);
+      ::std::vector<uint32_t> visible(boxes.mCount);
+
+      THEN("Both paths find exactly the boxes that are visible one by one") {
+         ::std::vector<uint32_t> expected;
+         for (uint32_t i = 0; i < boxes.mCount; ++i) {
+            if (IsVisible(frustum, boxes, i))
+               expected.push_back(i);
+         }
+
+         REQUIRE(expected.size() > 0);
+         REQUIRE(expected.size() < boxes.mCount / 10);
+
+         visible.resize(CullBatch(frustum, boxes, visible.data(), false));
+         REQUIRE(visible == expected);
+
+         visible.resize(boxes.mCount);
+         visible.resize(CullBatch(frustum, boxes, visible.data(), true));
+         REQUIRE(visible == expected);
+      }
+
+      BENCHMARK("Culling 10001 instances through a virtual call") {
+         uint32_t count = 0;
+         for (const auto& instance : instances)
+            count += not instance->Cull(frustum);
+         return count;
+      };
+
+      BENCHMARK("Culling 10001 boxes one at a time") {
+         return CullBatch(frustum, boxes, visible.data(), false);
+      };
+
+      BENCHMARK("Culling 10001 boxes four at a time") {
+         return CullBatch(frustum, boxes, visible.data(), true);
+      };
+   }
+}
@@ -0,0 +1,111 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/DepthSlice.hpp"
+#include <catch2/catch.hpp>
+
+/// Transform a point by a column-major matrix                                
+///   @param m - the matrix                                                   
+///   @param p - the homogeneous point                                        
+///   @param out - [out] the transformed point                                
+static void Transform(const float* m, const float* p, float* out) {
+   for (int r = 0; r < 4; ++r)
+      out[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r] * p[3];
+}
+
+
+SCENARIO("Splitting the depth range between levels", "[depth]") {
+   GIVEN("Three levels") {
+      const auto biggest = DepthSlice::Of(0, 3);
+      const auto middle = DepthSlice::Of(1, 3);
+      const auto nearest = DepthSlice::Of(2, 3);
+
+      THEN("Each level is drawn nearer than the ones before it, and all of them cover the whole range") {
+         REQUIRE(biggest.mMax == 1.0f);
+         REQUIRE(biggest.mMin == Approx(middle.mMax));
+         REQUIRE(middle.mMin == Approx(nearest.mMax));
+         REQUIRE(nearest.mMin == 0.0f);
+      }
+   }
+
+   GIVEN("A single level") {
+      THEN("It gets the whole range") {
+         REQUIRE(DepthSlice::Of(0, 1) == DepthSlice {});
+      }
+   }
+}
+
+SCENARIO("Projecting into a depth slice", "[depth]") {
+   GIVEN("A perspective projection with near plane 1 and far plane 10") {
+      // Column-major, depth mapped to [0, 1], w = z                    
+      const float near = 1, far = 10;
+      const float projection[16] {
+         1, 0, 0, 0,
+         0, 1, 0, 0,
+         0, 0, far / (far - near), 1,
+         0, 0, -far * near / (far - near), 0
+      };
+
+      // Its inverse                                                    
+      const float inverse[16] {
+         1, 0, 0, 0,
+         0, 1, 0, 0,
+         0, 0, 0, -(far - near) / (far * near),
+         0, 0, 1, 1 / near
+      };
+
+      const DepthSlice slice {0.25f, 0.5f};
+
+      WHEN("The slice is applied to the projection") {
+         float sliced[16];
+         for (int i = 0; i < 16; ++i)
+            sliced[i] = projection[i];
+         slice.Apply(sliced);
+
+         THEN("Depth ends up exactly where a viewport with the slice's range would put it") {
+            for (const float z : {1.0f, 2.0f, 5.0f, 10.0f}) {
+               const float point[4] {0.5f, -0.5f, z, 1};
+               float clip[4], slicedClip[4];
+               Transform(projection, point, clip);
+               Transform(sliced, point, slicedClip);
+
+               const auto depth = clip[2] / clip[3];
+               REQUIRE(slicedClip[2] / slicedClip[3] == Approx(slice.mMin + depth * (slice.mMax - slice.mMin)));
+               REQUIRE(slicedClip[3] == Approx(clip[3]));
+            }
+         }
+      }
+
+      WHEN("The slice is undone on the inverse projection") {
+         float unsliced[16];
+         for (int i = 0; i < 16; ++i)
+            unsliced[i] = inverse[i];
+         slice.Unapply(unsliced);
+
+         THEN("Depth read back from the slice unprojects to the same point") {
+            for (const float z : {1.0f, 3.0f, 10.0f}) {
+               const float point[4] {0.25f, 0.75f, z, 1};
+               float clip[4];
+               Transform(projection, point, clip);
+
+               const auto depth = clip[2] / clip[3];
+               const float stored[4] {
+                  clip[0] / clip[3], clip[1] / clip[3],
+                  slice.mMin + depth * (slice.mMax - slice.mMin), 1
+               };
+
+               float view[4];
+               Transform(unsliced, stored, view);
+               REQUIRE(view[0] / view[3] == Approx(point[0]));
+               REQUIRE(view[1] / view[3] == Approx(point[1]));
+               REQUIRE(view[2] / view[3] == Approx(point[2]));
+            }
+         }
+      }
+   }
+}
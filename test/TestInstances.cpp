@@ -0,0 +1,136 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/Instances.hpp"
+#include <catch2/catch.hpp>
+
+/// Check if code contains a piece of text                                    
+static bool Contains(const ::std::string& code, const char* what) {
+   return code.find(what) != ::std::string::npos;
+}
+
+
+SCENARIO("Finding uniform blocks in shader code", "[instances]") {
+   GIVEN("Code with blocks at different bindings") {
+      const ::std::string code =
+         "#version 450\n"
+         "layout(set = 1, binding = 2) uniform Renderable { vec4 Color; };\n"
+         "layout(std140, set=1, binding=3) uniform Instance {\n"
+         "   mat4 Transform;\n"
+         "} instance;\n"
+         "void main() {}\n";
+
+      WHEN("The block at the instance binding is searched for") {
+         const auto block = FindUniformBlock(code, 1, 3);
+
+         THEN("Only that block is found, with its members and name") {
+            REQUIRE(block);
+            REQUIRE(code.substr(block.mBegin, 6) == "layout");
+            REQUIRE(code[block.mEnd - 1] == ';');
+            REQUIRE(block.mMembers.find("mat4 Transform;") != ::std::string_view::npos);
+            REQUIRE(block.mInstance == "instance");
+         }
+      }
+
+      WHEN("A binding nothing uses is searched for") {
+         THEN("Nothing is found") {
+            REQUIRE_FALSE(FindUniformBlock(code, 1, 1));
+            REQUIRE_FALSE(FindUniformBlock(code, 0, 3));
+         }
+      }
+   }
+}
+
+SCENARIO("Injecting instance data into shaders", "[instances]") {
+   GIVEN("A vertex shader, reading instance data directly") {
+      const ::std::string code =
+         "#version 450\n"
+         "layout(set = 1, binding = 3) uniform Instance {\n"
+         "   layout(offset = 0) mat4 Transform;\n"
+         "   vec4 Tint[2];\n"
+         "};\n"
+         "layout(location = 0) in vec3 position;\n"
+         "void main() {\n"
+         "   gl_Position = Transform * vec4(position, 1.0);\n"
+         "}\n";
+
+      WHEN("Instances are injected") {
+         const auto result = InjectInstances(code, InstanceStage::Vertex, 1, 3, 4);
+
+         THEN("The block becomes an array in a storage buffer, indexed by the instance") {
+            REQUIRE_FALSE(Contains(result, "uniform Instance"));
+            REQUIRE_FALSE(Contains(result, "offset = 0"));
+            REQUIRE(Contains(result, "struct LangulusInstanceData {\n   mat4 Transform;\n   vec4 Tint[2];\n};"));
+            REQUIRE(Contains(result, "layout(std430, set = 1, binding = 3) readonly buffer"));
+            REQUIRE(Contains(result, "layout(std430, set = 1, binding = 4) readonly buffer LangulusDrawnBuffer"));
+            REQUIRE(Contains(result, "#define LangulusInstance LangulusDrawn[gl_InstanceIndex]\n"));
+            REQUIRE(Contains(result, "#define Transform LangulusInstances[LangulusInstance].Transform\n"));
+            REQUIRE(Contains(result, "#define Tint LangulusInstances[LangulusInstance].Tint\n"));
+         }
+
+         THEN("The original main is called by a new one, that passes the instance on") {
+            REQUIRE(result.rfind("#version 450\nlayout(std430, set = 1, binding = 4)", 0) == 0);
+            REQUIRE(Contains(result, "void LangulusInstancedMain() {\n   gl_Position"));
+            REQUIRE(Contains(result, "flat out uint LangulusInstanceOut"));
+            REQUIRE(result.find("LangulusInstanceOut = LangulusInstance;") > result.find("LangulusInstancedMain"));
+         }
+      }
+   }
+
+   GIVEN("A pixel shader, reading instance data through an instance name") {
+      const ::std::string code =
+         "#version 450\n"
+         "layout(set = 1, binding = 3) uniform Instance { vec4 Tint; } instance;\n"
+         "layout(location = 0) out vec4 color;\n"
+         "void main() { color = instance.Tint; }\n";
+
+      WHEN("Instances are injected") {
+         const auto result = InjectInstances(code, InstanceStage::Pixel, 1, 3, 4);
+
+         THEN("The instance comes from the vertex stage, and the name maps to its element") {
+            REQUIRE(Contains(result, "layout(location = 15) flat in uint LangulusInstance;"));
+            REQUIRE(Contains(result, "#define instance LangulusInstances[LangulusInstance]\n"));
+            REQUIRE(Contains(result, "void main() { color = instance.Tint; }"));
+         }
+      }
+   }
+
+   GIVEN("A geometry shader without instance data") {
+      const ::std::string code =
+         "#version 450\n"
+         "#extension GL_EXT_geometry_shader : enable\n"
+         "layout(points) in;\n"
+         "void main() { EmitVertex(); }\n";
+
+      WHEN("Instances are injected") {
+         const auto result = InjectInstances(code, InstanceStage::Geometry, 1, 3, 4);
+
+         THEN("Emitted vertices forward the instance, declared after the directives") {
+            REQUIRE(result.rfind("#version 450\n#extension GL_EXT_geometry_shader : enable\nlayout(location = 15) flat in uint LangulusInstanceIn[];", 0) == 0);
+            REQUIRE(Contains(result, "#define EmitVertex() do { LangulusInstanceOut = LangulusInstanceIn[0]; EmitVertex(); } while (false)"));
+            REQUIRE_FALSE(Contains(result, "LangulusInstanceData"));
+         }
+      }
+   }
+
+   GIVEN("A vertex shader, whose main function is already wrapped") {
+      const ::std::string code =
+         "#define main Inner\n"
+         "void main() {}\n"
+         "#undef main\n"
+         "void main() { Inner(); }\n";
+
+      WHEN("Instances are injected") {
+         const auto result = InjectInstances(code, InstanceStage::Vertex, 1, 3, 4);
+
+         THEN("The last main is the one renamed") {
+            REQUIRE(Contains(result, "#define main Inner\nvoid main() {}\n#undef main\nvoid LangulusInstancedMain() { Inner(); }"));
+         }
+      }
+   }
+}
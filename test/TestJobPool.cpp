@@ -0,0 +1,135 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/JobPool.hpp"
+#include "../source/inner/BVH.hpp"
+#include <catch2/catch.hpp>
+#include <random>
+#include <string>
+
+/// A level of a synthetic scene, as staged by a batched layer                
+struct SyntheticLevel {
+   BoundingSpheres mSpheres;
+   CullBoxes mBoxes;
+   BVH mTree;
+};
+
+/// Stage a level, the way VulkanLayer::StageLevel does it                    
+///   @param level - the level                                                
+///   @param frustum - the camera's frustum in the level                      
+///   @param survivors, visible, gathered - the worker's scratch              
+///   @return the number of visible instances                                 
+static size_t Stage(
+   const SyntheticLevel& level, const CullFrustum& frustum,
+   ::std::vector<uint32_t>& survivors, ::std::vector<uint32_t>& visible,
+   CullBoxes& gathered
+) {
+   survivors.clear();
+   level.mTree.Query(frustum, level.mSpheres, [&](uint32_t i) {
+      survivors.push_back(i);
+   });
+
+   gathered.Resize(survivors.size());
+   for (size_t i = 0; i < survivors.size(); ++i)
+      gathered.Copy(i, level.mBoxes, survivors[i]);
+
+   visible.resize(survivors.size());
+   return CullBatch(frustum, gathered, visible.data());
+}
+
+
+SCENARIO("Running batches of jobs on a pool", "[jobs]") {
+   for (uint32_t workers : {1u, 2u, 5u}) {
+      GIVEN("A pool of " + ::std::to_string(workers) + " workers") {
+         JobPool pool {workers};
+
+         THEN("Each job of any batch runs exactly once, on a valid worker") {
+            for (uint32_t count : {0u, 1u, 3u, 1000u}) {
+               ::std::vector<::std::atomic<uint32_t>> runs(count);
+               ::std::atomic<bool> badWorker = false;
+               pool.Run(count, [&](uint32_t i, uint32_t worker) {
+                  ++runs[i];
+                  if (worker >= workers)
+                     badWorker = true;
+               });
+
+               REQUIRE(::std::all_of(runs.begin(), runs.end(), [](const auto& r) { return r == 1; }));
+               REQUIRE_FALSE(badWorker);
+            }
+         }
+      }
+   }
+}
+
+SCENARIO("Staging camera levels of a large scene in parallel", "[jobs]") {
+   GIVEN("Sixty four levels with twenty thousand instances each") {
+      ::std::mt19937 random {42};
+      ::std::uniform_real_distribution<float> position {-500, 500};
+      ::std::uniform_real_distribution<float> size {0.1f, 5};
+
+      ::std::vector<SyntheticLevel> levels(64);
+      for (auto& level : levels) {
+         level.mSpheres.resize(20000);
+         level.mBoxes.Resize(20000);
+         for (uint32_t i = 0; i < 20000; ++i) {
+            const float scale = size(random);
+            const float m[16] {
+               scale, 0, 0, 0,
+               0, scale, 0, 0,
+               0, 0, scale, 0,
+               position(random), position(random), position(random), 1
+            };
+
+            const auto candidate = MakeCullCandidate(m, 0, 0);
+            ::std::copy(candidate.mCenter, candidate.mCenter + 3, level.mSpheres[i].mCenter);
+            level.mSpheres[i].mRadius = candidate.mRadius;
+            level.mBoxes.Set(i, m);
+         }
+
+         level.mTree.Build(level.mSpheres);
+      }
+
+      // An orthographic frustum of the [-200;200] box                  
+      const float viewProjection[16] {
+         0.005f, 0, 0, 0,
+         0, 0.005f, 0, 0,
+         0, 0, 0.0025f, 0,
+         0, 0, 0.5f, 1
+      };
+      const auto frustum = MakeCullFrustum(viewProjection, 0);
+
+      // Stages all levels, returning the visible instances of each     
+      const auto stageAll = [&](JobPool& pool) {
+         const auto workers = pool.GetWorkers();
+         ::std::vector<::std::vector<uint32_t>> survivors(workers), visible(workers);
+         ::std::vector<CullBoxes> gathered(workers);
+         ::std::vector<size_t> results(levels.size());
+         pool.Run(static_cast<uint32_t>(levels.size()), [&](uint32_t i, uint32_t w) {
+            results[i] = Stage(levels[i], frustum, survivors[w], visible[w], gathered[w]);
+         });
+         return results;
+      };
+
+      JobPool serial {1};
+      const auto expected = stageAll(serial);
+
+      THEN("Any number of workers finds the same instances") {
+         JobPool parallel {4};
+         REQUIRE(stageAll(parallel) == expected);
+      }
+
+      // Scaling from one worker, up to one per hardware thread         
+      const auto threads = ::std::max(1u, ::std::thread::hardware_concurrency());
+      for (uint32_t workers = 1; workers <= threads; workers *= 2) {
+         JobPool pool {workers};
+         BENCHMARK("Staging 64 levels on " + ::std::to_string(workers) + " workers") {
+            return stageAll(pool).size();
+         };
+      }
+   }
+}
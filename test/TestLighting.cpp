@@ -0,0 +1,203 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/Lighting.hpp"
+#include <catch2/catch.hpp>
+
+
+SCENARIO("Finding the screen area of a light", "[lighting]") {
+   GIVEN("A perspective projection, looking down +Z") {
+      // 90 degree field of view, near plane at 1, w = z                
+      const float projection[16] {
+         1, 0, 0, 0,
+         0, 1, 0, 0,
+         0, 0, 1, 1,
+         0, 0, -1, 0
+      };
+
+      WHEN("A small light is right in front of the camera") {
+         const float center[3] {0, 0, 10};
+         float rect[4];
+
+         THEN("It covers a small rectangle in the middle") {
+            REQUIRE(ProjectSphere(projection, center, 1, rect));
+            REQUIRE(rect[0] < 0);
+            REQUIRE(rect[1] < 0);
+            REQUIRE(rect[2] > 0);
+            REQUIRE(rect[3] > 0);
+            REQUIRE(rect[2] - rect[0] < 0.5f);
+            REQUIRE(rect[3] - rect[1] < 0.5f);
+         }
+      }
+
+      WHEN("A light is off to the side") {
+         const float center[3] {30, 0, 10};
+         float rect[4];
+
+         THEN("It covers nothing") {
+            REQUIRE_FALSE(ProjectSphere(projection, center, 1, rect));
+         }
+      }
+
+      WHEN("A light is behind the camera") {
+         const float center[3] {0, 0, -10};
+         float rect[4];
+
+         THEN("It covers nothing") {
+            REQUIRE_FALSE(ProjectSphere(projection, center, 1, rect));
+         }
+      }
+
+      WHEN("The camera is inside a light's range") {
+         const float center[3] {0, 0, 1};
+         float rect[4];
+
+         THEN("It covers the whole screen") {
+            REQUIRE(ProjectSphere(projection, center, 5, rect));
+            REQUIRE(rect[0] == -1);
+            REQUIRE(rect[1] == -1);
+            REQUIRE(rect[2] == 1);
+            REQUIRE(rect[3] == 1);
+         }
+      }
+   }
+}
+
+SCENARIO("Assigning lights to clusters", "[lighting]") {
+   GIVEN("A perspective projection, looking down +Z from 1 to 100") {
+      // 90 degree field of view, depth mapped to [0;1]                 
+      constexpr float n = 1, f = 100;
+      constexpr float a = f / (f - n), b = -f * n / (f - n);
+      const float projection[16] {
+         1, 0, 0, 0,
+         0, 1, 0, 0,
+         0, 0, a, 1,
+         0, 0, b, 0
+      };
+      const float inverse[16] {
+         1, 0, 0, 0,
+         0, 1, 0, 0,
+         0, 0, 0, 1 / b,
+         0, 0, 1, -a / b
+      };
+
+      ClusterGrid grid;
+      grid.Build(projection, inverse);
+
+      THEN("Slices span the frustum along +Z, and shaders get the projection") {
+         REQUIRE(::std::equal(projection, projection + 16, grid.mHeader.mProjection));
+         REQUIRE(grid.mHeader.mAxis[2] == Approx(1));
+         REQUIRE(grid.mHeader.mNear == Approx(n));
+         REQUIRE(grid.SliceOf(0.5f) == 0);
+         REQUIRE(grid.SliceOf(n * 1.01f) == 0);
+         REQUIRE(grid.SliceOf(f * 0.99f) == ClusterGrid::Depth - 1);
+         REQUIRE(grid.SliceOf(f * 2) == ClusterGrid::Depth - 1);
+      }
+
+      WHEN("A small light is right in front of the camera") {
+         const LightSources lights {{{0, 0, 10, 1}, {1, 1, 1, 1}}};
+         grid.Assign(lights);
+
+         THEN("Only the clusters around it have it") {
+            const auto z = grid.SliceOf(10);
+            const auto& center = grid.mRanges[ClusterGrid::Index(
+               ClusterGrid::Width / 2, ClusterGrid::Height / 2, z)];
+            REQUIRE(center.mCount == 1);
+            REQUIRE(grid.mIndices[center.mOffset] == 0);
+
+            const auto& corner = grid.mRanges[ClusterGrid::Index(0, 0, z)];
+            REQUIRE(corner.mCount == 0);
+            REQUIRE(grid.mIndices.size() < ClusterGrid::Count / 10);
+         }
+      }
+
+      WHEN("Lights are behind the camera, or beyond the far plane") {
+         const LightSources lights {
+            {{0, 0, -10, 1}, {1, 1, 1, 1}},
+            {{0, 0, 200, 1}, {1, 1, 1, 1}}
+         };
+         grid.Assign(lights);
+
+         THEN("No cluster has them") {
+            REQUIRE(grid.mIndices.empty());
+         }
+      }
+
+      WHEN("Hundreds of lights are assigned four clusters at once, and one by one") {
+         LightSources lights;
+         for (int i = 0; i < 512; ++i) {
+            const auto x = static_cast<float>((i * 37) % 41 - 20);
+            const auto y = static_cast<float>((i * 13) % 23 - 11);
+            const auto z = static_cast<float>((i * 7) % 90 + 2);
+            const auto r = static_cast<float>(i % 5 + 1);
+            lights.push_back({{x, y, z, r}, {1, 1, 1, 1}});
+         }
+
+         grid.Assign(lights, true);
+         const auto ranges = grid.mRanges;
+         const auto indices = grid.mIndices;
+         grid.Assign(lights, false);
+
+         THEN("Both produce the same clusters") {
+            REQUIRE(indices.size() > 0);
+            REQUIRE(indices == grid.mIndices);
+            for (uint32_t i = 0; i < ClusterGrid::Count; ++i) {
+               REQUIRE(ranges[i].mOffset == grid.mRanges[i].mOffset);
+               REQUIRE(ranges[i].mCount == grid.mRanges[i].mCount);
+            }
+         }
+
+         BENCHMARK("Binning 512 lights, four clusters at once") {
+            grid.Assign(lights, true);
+            return grid.mIndices.size();
+         };
+
+         BENCHMARK("Binning 512 lights, one cluster at a time") {
+            grid.Assign(lights, false);
+            return grid.mIndices.size();
+         };
+      }
+   }
+}
+
+SCENARIO("Injecting clustered lights into pixel shaders", "[lighting]") {
+   GIVEN("A pixel shader, that lights its surface by the clustered lights") {
+      const ::std::string code =
+         "#version 450\n"
+         "#extension GL_EXT_multiview : enable\n"
+         "layout(location = 0) in vec3 position;\n"
+         "layout(location = 0) out vec4 color;\n"
+         "void main() { color = vec4(LangulusLights(position, vec3(0, 0, -1)), 1); }\n";
+
+      WHEN("Clusters are injected") {
+         const auto result = InjectClusters(code, 3);
+
+         THEN("The buffers and the lookup are declared after the directives, before anything uses them") {
+            REQUIRE(result.rfind("#version 450\n#extension GL_EXT_multiview : enable\nstruct LangulusLight {", 0) == 0);
+            REQUIRE(result.find("layout(std430, set = 3, binding = 0) readonly buffer LangulusClusterHeader") != ::std::string::npos);
+            REQUIRE(result.find("layout(std430, set = 3, binding = 1) readonly buffer LangulusClusterRanges") != ::std::string::npos);
+            REQUIRE(result.find("layout(std430, set = 3, binding = 2) readonly buffer LangulusClusterIndices") != ::std::string::npos);
+            REQUIRE(result.find("vec3 LangulusLights(vec3 position, vec3 normal) {") < result.find("void main()"));
+            REQUIRE(result.find("void main() { color = vec4(LangulusLights(position, vec3(0, 0, -1)), 1); }") != ::std::string::npos);
+         }
+      }
+   }
+
+   GIVEN("A pixel shader, that doesn't read lights") {
+      const ::std::string code =
+         "#version 450\n"
+         "layout(location = 0) out vec4 color;\n"
+         "void main() { color = vec4(1); }\n";
+
+      WHEN("Clusters are injected") {
+         THEN("Nothing changes, so the shader works in any layer") {
+            REQUIRE(InjectClusters(code, 3) == code);
+         }
+      }
+   }
+}
@@ -0,0 +1,86 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/RadixSort.hpp"
+#include <algorithm>
+#include <random>
+#include <catch2/catch.hpp>
+
+
+SCENARIO("Sorting draw keys", "[sort]") {
+   GIVEN("Keys that differ only in a few of their bits") {
+      ::std::mt19937_64 random {42};
+      RadixEntries entries, scratch;
+      for (uint32_t i = 0; i < 1000; ++i) {
+         const auto geometry = random() % 16;
+         const auto sampler = random() % 4;
+         entries.push_back({(geometry << 44) | (sampler << 24), i});
+      }
+
+      WHEN("Radix sorted") {
+         auto expected = entries;
+         ::std::stable_sort(expected.begin(), expected.end(),
+            [](const RadixEntry& a, const RadixEntry& b) {
+               return a.mKey < b.mKey;
+            }
+         );
+
+         RadixSort(entries, scratch);
+
+         THEN("Order matches a stable sort") {
+            REQUIRE(entries.size() == expected.size());
+            for (size_t i = 0; i < entries.size(); ++i) {
+               REQUIRE(entries[i].mKey == expected[i].mKey);
+               REQUIRE(entries[i].mIndex == expected[i].mIndex);
+            }
+         }
+      }
+   }
+}
+
+SCENARIO("Sorting instances by depth", "[sort]") {
+   GIVEN("Instances scattered at random distances") {
+      ::std::mt19937_64 random {42};
+      ::std::uniform_real_distribution<float> distance {0.1f, 1000.0f};
+      RadixEntries entries, scratch;
+      for (uint32_t i = 0; i < 10000; ++i) {
+         const uint64_t depth = DepthToKey(distance(random));
+         entries.push_back({(depth << 32) | (random() % 16 << 16), i});
+      }
+
+      WHEN("Radix sorted") {
+         auto sorted = entries;
+         RadixSort(sorted, scratch);
+
+         THEN("Instances are ordered front-to-back") {
+            for (size_t i = 1; i < sorted.size(); ++i)
+               REQUIRE((sorted[i - 1].mKey >> 32) <= (sorted[i].mKey >> 32));
+         }
+      }
+
+      BENCHMARK_ADVANCED("Radix sort of 10000 depth keys") (Catch::Benchmark::Chronometer meter) {
+         ::std::vector<RadixEntries> copies(meter.runs(), entries);
+         meter.measure([&](int i) {
+            RadixSort(copies[i], scratch);
+            return copies[i].size();
+         });
+      };
+
+      BENCHMARK_ADVANCED("std::sort of 10000 depth keys") (Catch::Benchmark::Chronometer meter) {
+         ::std::vector<RadixEntries> copies(meter.runs(), entries);
+         meter.measure([&](int i) {
+            ::std::sort(copies[i].begin(), copies[i].end(),
+               [](const RadixEntry& a, const RadixEntry& b) {
+                  return a.mKey < b.mKey;
+               }
+            );
+            return copies[i].size();
+         });
+      };
+   }
+}
@@ -0,0 +1,215 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/RenderGraph.hpp"
+#include <catch2/catch.hpp>
+
+
+SCENARIO("Culling render graph passes", "[graph]") {
+   GIVEN("A graph, where one pass writes a resource nobody reads") {
+      RenderGraph graph;
+      const auto color = graph.Import(GraphUse::None, false);
+      const auto unused = graph.Import(GraphUse::None, false);
+
+      ::std::vector<RenderGraph::Pass> recorded;
+      const auto wasted = graph.AddPass([&](RenderGraph::Pass p) { recorded.push_back(p); });
+      graph.Write(unused, GraphUse::ComputeWrite, true);
+      const auto draw = graph.AddPass([&](RenderGraph::Pass p) { recorded.push_back(p); });
+      graph.Write(color, GraphUse::Color, true);
+      const auto present = graph.AddPass([&](RenderGraph::Pass p) { recorded.push_back(p); }, true);
+      graph.Read(color, GraphUse::Present);
+
+      WHEN("Compiled and executed") {
+         graph.Compile();
+         graph.Execute([](RenderGraph::Pass) {});
+
+         THEN("Only the passes that lead to presenting are recorded, and know which they are") {
+            REQUIRE(graph.GetPass(wasted).mCulled);
+            REQUIRE_FALSE(graph.GetPass(draw).mCulled);
+            REQUIRE_FALSE(graph.GetPass(present).mCulled);
+            REQUIRE(recorded == ::std::vector<RenderGraph::Pass> {draw, present});
+         }
+      }
+   }
+
+   GIVEN("A graph, where a write is cleared before it is read") {
+      RenderGraph graph;
+      const auto color = graph.Import(GraphUse::None, true);
+      const auto overwritten = graph.AddPass({});
+      graph.Write(color, GraphUse::Color, true);
+      const auto cleared = graph.AddPass({});
+      graph.Write(color, GraphUse::Color, true);
+      const auto loaded = graph.AddPass({});
+      graph.Write(color, GraphUse::Color);
+
+      WHEN("Compiled") {
+         graph.Compile();
+
+         THEN("The overwritten pass is culled, the others load and store") {
+            REQUIRE(graph.GetPass(overwritten).mCulled);
+            REQUIRE(graph.GetUse(cleared, 0).mLoad == GraphLoad::Clear);
+            REQUIRE(graph.GetUse(cleared, 0).mStore);
+            REQUIRE(graph.GetUse(loaded, 0).mLoad == GraphLoad::Load);
+            REQUIRE(graph.GetUse(loaded, 0).mStore);
+         }
+      }
+   }
+}
+
+SCENARIO("Load and store ops of render graph attachments", "[graph]") {
+   GIVEN("Depth, that is drawn to, sampled once, and thrown away") {
+      RenderGraph graph;
+      const auto color = graph.Import(GraphUse::None, true);
+      const auto depth = graph.Import(GraphUse::None, false);
+
+      const auto first = graph.AddPass({});
+      graph.Write(color, GraphUse::Color);
+      graph.Write(depth, GraphUse::Depth);
+      const auto reduce = graph.AddPass({}, true);
+      graph.Read(depth, GraphUse::ComputeRead);
+      const auto last = graph.AddPass({});
+      graph.Write(color, GraphUse::Color);
+      graph.Write(depth, GraphUse::Depth, true);
+
+      WHEN("Compiled") {
+         graph.Compile();
+
+         THEN("Contents are loaded only if they exist, and stored only if read later") {
+            REQUIRE(graph.GetUse(first, 0).mLoad == GraphLoad::DontCare);
+            REQUIRE(graph.GetUse(first, 0).mStore);
+            REQUIRE(graph.GetUse(first, 1).mLoad == GraphLoad::DontCare);
+            REQUIRE(graph.GetUse(first, 1).mStore);
+            REQUIRE(graph.GetUse(last, 0).mLoad == GraphLoad::Load);
+            REQUIRE(graph.GetUse(last, 1).mLoad == GraphLoad::Clear);
+            REQUIRE_FALSE(graph.GetUse(last, 1).mStore);
+         }
+
+         THEN("Each use knows the previous one, for deriving barriers") {
+            REQUIRE(graph.GetUse(first, 1).mPrevious == GraphUse::None);
+            REQUIRE(graph.GetUse(reduce, 0).mPrevious == GraphUse::Depth);
+            REQUIRE(graph.GetUse(last, 1).mPrevious == GraphUse::ComputeRead);
+         }
+      }
+   }
+
+   GIVEN("An imported buffer, that was read by the previous frame") {
+      RenderGraph graph;
+      const auto commands = graph.Import(GraphUse::Indirect, true);
+      const auto cull = graph.AddPass({});
+      graph.Write(commands, GraphUse::ComputeWrite, true);
+
+      WHEN("Compiled") {
+         graph.Compile();
+
+         THEN("The first use follows the imported one") {
+            REQUIRE(graph.GetUse(cull, 0).mPrevious == GraphUse::Indirect);
+         }
+      }
+   }
+}
+
+SCENARIO("Grouping render graph passes", "[graph]") {
+   GIVEN("Several passes, drawing to the same attachments") {
+      RenderGraph graph;
+      const auto color = graph.Import(GraphUse::None, true);
+      const auto depth = graph.Import(GraphUse::None, false);
+      const auto atlas = graph.Import(GraphUse::Sampled, true);
+      const auto commands = graph.Import(GraphUse::Indirect, true);
+
+      const auto a = graph.AddPass({});
+      graph.Write(color, GraphUse::Color, true);
+      graph.Write(depth, GraphUse::Depth, true);
+      const auto b = graph.AddPass({});
+      graph.Write(color, GraphUse::Color);
+      graph.Write(depth, GraphUse::Depth);
+      graph.Read(commands, GraphUse::Indirect);
+      const auto shadows = graph.AddPass({});
+      graph.Write(atlas, GraphUse::Depth);
+      const auto c = graph.AddPass({});
+      graph.Read(atlas, GraphUse::Sampled);
+      graph.Write(color, GraphUse::Color);
+      graph.Write(depth, GraphUse::Depth);
+      const auto d = graph.AddPass({});
+      graph.Write(color, GraphUse::Color);
+      graph.Write(depth, GraphUse::Depth);
+      const auto e = graph.AddPass({});
+      graph.Write(color, GraphUse::Color);
+
+      WHEN("Compiled") {
+         graph.Compile();
+
+         THEN("Passes with the same attachments share a group, until something else comes between") {
+            REQUIRE(graph.GetPass(a).mGroup == a);
+            REQUIRE(graph.GetPass(b).mGroup == a);
+            REQUIRE(graph.EndsGroup(b));
+            REQUIRE(graph.GetPass(shadows).mGroup == shadows);
+            REQUIRE(graph.GetPass(c).mGroup == c);
+            REQUIRE(graph.GetPass(d).mGroup == c);
+            REQUIRE_FALSE(graph.EndsGroup(c));
+            REQUIRE(graph.GetPass(e).mGroup == e);
+         }
+      }
+   }
+
+   GIVEN("A pass, that samples what its group drew") {
+      RenderGraph graph;
+      const auto color = graph.Import(GraphUse::None, true);
+      const auto gbuffer = graph.Import(GraphUse::None, false);
+
+      const auto a = graph.AddPass({});
+      graph.Write(color, GraphUse::Color);
+      graph.Write(gbuffer, GraphUse::Color, true);
+      const auto b = graph.AddPass({});
+      graph.Write(color, GraphUse::Color);
+      graph.Write(gbuffer, GraphUse::Color);
+      const auto c = graph.AddPass({});
+      graph.Write(color, GraphUse::Color);
+      graph.Write(gbuffer, GraphUse::Color);
+      graph.Read(gbuffer, GraphUse::Sampled);
+
+      WHEN("Compiled") {
+         graph.Compile();
+
+         THEN("It can't join, it needs a barrier") {
+            REQUIRE(graph.GetPass(b).mGroup == a);
+            REQUIRE(graph.GetPass(c).mGroup == c);
+         }
+      }
+   }
+}
+
+SCENARIO("Compiling a frame's render graph", "[graph][!benchmark]") {
+   GIVEN("A frame with many layers") {
+      RenderGraph graph;
+
+      BENCHMARK("Declare and compile 64 layers") {
+         graph.Reset();
+         const auto color = graph.Import(GraphUse::None, false);
+         const auto depth = graph.Import(GraphUse::None, false);
+         const auto atlas = graph.Import(GraphUse::Sampled, true);
+         const auto commands = graph.Import(GraphUse::Indirect, true);
+
+         graph.AddPass({});
+         graph.Write(commands, GraphUse::ComputeWrite, true);
+         for (int layer = 0; layer < 64; ++layer) {
+            graph.AddPass({});
+            graph.Write(atlas, GraphUse::Depth);
+            graph.AddPass({});
+            graph.Read(commands, GraphUse::Indirect);
+            graph.Read(atlas, GraphUse::Sampled);
+            graph.Write(color, GraphUse::Color);
+            graph.Write(depth, GraphUse::Depth);
+         }
+
+         graph.AddPass({}, true);
+         graph.Read(color, GraphUse::Present);
+         graph.Compile();
+         return graph.GetPassCount();
+      };
+   }
+}
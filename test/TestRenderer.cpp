@@ -218,3 +218,217 @@ SCENARIO("Drawing solid polygons", "[renderer]") {
    REQUIRE(memoryState.Assert());
 }
 
+
+SCENARIO("Drawing solid polygons offscreen", "[renderer]") {
+   static Allocator::State memoryState;
+
+   GIVEN("A renderer without a window") {
+      // Create the scene - there's no window, so the renderer draws to 
+      // its own images, of the given size                              
+      auto root = Thing::Root<false>(
+         "Vulkan",
+         "FileSystem",
+         "AssetsImages",
+         "AssetsGeometry",
+         "AssetsMaterials",
+         "Physics"
+      );
+
+      root.CreateUnit<A::Renderer>(Traits::Size(640, 480));
+      root.CreateUnit<A::Layer>();
+      root.CreateUnit<A::World>();
+
+      auto rect = root.CreateChild(Traits::Size {100}, "Rectangles");
+      auto renderable = rect->CreateUnit<A::Renderable>();
+      auto mesh = rect->CreateUnit<A::Mesh>(Math::Box2 {});
+      auto topLeft  = rect->CreateUnit<A::Instance>(Traits::Place(100, 100), Colors::Black);
+      auto topRight = rect->CreateUnit<A::Instance>(Traits::Place(540, 100), Colors::Green);
+      auto botLeft  = rect->CreateUnit<A::Instance>(Traits::Place(100, 380), Colors::Blue);
+      auto botRight = rect->CreateUnit<A::Instance>(Traits::Place(540, 380), Colors::White);
+
+      static Allocator::State memoryState2;
+
+      for (int repeat = 0; repeat != 10; ++repeat) {
+         WHEN(std::string("Update cycle #") + std::to_string(repeat)) {
+            // Update the scene                                         
+            root.Update(16ms);
+
+            // And interpret the scene as an image, i.e. taking a       
+            // screenshot of the last drawn image                       
+            Verbs::InterpretAs<A::Image*> interpret;
+            root.Run(interpret);
+
+            REQUIRE(root.GetUnits().GetCount() == 3);
+            REQUIRE_FALSE(root.HasUnits<A::Image>());
+            REQUIRE(interpret.IsDone());
+            REQUIRE(interpret->GetCount() == 1);
+            REQUIRE(interpret->template CastsTo<A::Image>());
+
+            // It is the same as the one drawn in a window              
+            Verbs::Compare compare {"polygons.png"};
+            interpret.Then(compare);
+
+            REQUIRE(compare.IsDone());
+            REQUIRE(compare.GetOutput() == Compared::Equal);
+
+            // Check for memory leaks after each update cycle           
+            REQUIRE(memoryState2.Assert());
+         }
+      }
+   }
+
+   // Check for memory leaks after each initialization cycle            
+   REQUIRE(memoryState.Assert());
+}
+
+
+SCENARIO("Lighting a forward layer with clustered lights", "[renderer]") {
+   static Allocator::State memoryState;
+
+   GIVEN("A layer without deferred lights, and a surface lit in place") {
+      auto root = Thing::Root<false>(
+         "Vulkan",
+         "FileSystem",
+         "AssetsImages",
+         "AssetsGeometry",
+         "AssetsMaterials",
+         "Physics"
+      );
+
+      // Batched and multilevel, but without DeferredLights - the       
+      // style trait and the light are the module's own, so they're     
+      // given as code                                                  
+      root.CreateUnit<A::Renderer>(Traits::Size(640, 480));
+      root.CreateUnit<A::Layer>(Code {"LayerStyle(2)"}.Parse());
+      root.CreateUnit<A::World>();
+
+      // The surface faces the eye, and is as bright as the light that  
+      // reaches it - its view-space position is unprojected from depth 
+      auto rect = root.CreateChild(Traits::Size {400}, "Surface");
+      rect->CreateUnit<A::Renderable>();
+      rect->CreateUnit<A::Mesh>(Math::Box2 {});
+      rect->CreateUnit<A::Material>(Text {
+         "#version 450\n"
+         "layout(location = 0) out vec4 color;\n"
+         "void main() {\n"
+         "   const vec2 ndc = gl_FragCoord.xy / vec2(640.0, 480.0) * 2.0 - 1.0;\n"
+         "   const vec4 view = inverse(LangulusClusterProjection) * vec4(ndc, gl_FragCoord.z, 1.0);\n"
+         "   const vec3 position = view.xyz / view.w;\n"
+         "   color = vec4(LangulusLights(position, normalize(-position)), 1.0);\n"
+         "}\n"
+      });
+      rect->CreateUnit<A::Instance>(Traits::Place(320, 240), Colors::White);
+
+      // Sum of the color channels of the pixel in the middle of a      
+      // screenshot - the screenshot image is reused between frames,    
+      // so it must be sampled before the next one is taken             
+      const auto brightness = [](const Many& output) {
+         const auto image = output.As<A::Image*>();
+         const auto& view = image->GetView();
+         const auto pixels = image->GetDataList<Traits::Color>();
+         REQUIRE(pixels);
+         REQUIRE(*pixels);
+
+         const auto stride = view.GetPixelBytesize();
+         const auto pixel = pixels->GetRaw()
+            + ((view.mHeight / 2) * view.mWidth + view.mWidth / 2) * stride;
+         unsigned sum = 0;
+         for (int channel = 0; channel < 3; ++channel)
+            sum += static_cast<unsigned>(pixel[channel]);
+         return sum;
+      };
+
+      WHEN("A light is placed in front of the surface") {
+         root.Update(16ms);
+         Verbs::InterpretAs<A::Image*> dark;
+         root.Run(dark);
+         REQUIRE(dark.IsDone());
+         const auto darkCentre = brightness(dark.GetOutput());
+
+         auto lamp = root.CreateChild(Traits::Size {1}, "Lamp");
+         lamp->CreateUnit<A::Instance>(Traits::Place(320, 240, -100));
+         Verbs::Create light {
+            Code {"VulkanLight(Color(1, 1, 1), Size(1000))"}.Parse()
+         };
+         lamp->Run(light);
+         REQUIRE(light.IsDone());
+
+         root.Update(16ms);
+         Verbs::InterpretAs<A::Image*> lit;
+         root.Run(lit);
+         REQUIRE(lit.IsDone());
+
+         THEN("The middle of the surface is brighter than before") {
+            REQUIRE(brightness(lit.GetOutput()) > darkCentre);
+         }
+      }
+   }
+
+   // Check for memory leaks after each initialization cycle            
+   REQUIRE(memoryState.Assert());
+}
+
+
+SCENARIO("Drawing overlapping polygons, with and without sorting", "[renderer][!benchmark]") {
+   // Batched | Multilevel | DeferredLights is the default style, and   
+   // Sorted is 8 - styles are the module's own, so they're given as    
+   // code                                                              
+   for (auto style : {"LayerStyle(6)", "LayerStyle(14)"}) {
+      GIVEN(::std::string("A renderer without a window, and a layer with ") + style) {
+         auto root = Thing::Root<false>(
+            "Vulkan",
+            "FileSystem",
+            "AssetsImages",
+            "AssetsGeometry",
+            "AssetsMaterials",
+            "Physics"
+         );
+
+         root.CreateUnit<A::Renderer>(Traits::Size(640, 480));
+         root.CreateUnit<A::Layer>(Code {style}.Parse());
+         root.CreateUnit<A::World>();
+
+         // Hundreds of screen-sized polygons, created from the farthest 
+         // to the nearest one, so that unsorted layers draw each pixel 
+         // once for every polygon                                      
+         auto rect = root.CreateChild(Traits::Size {600}, "Overdraw");
+         rect->CreateUnit<A::Renderable>();
+         rect->CreateUnit<A::Mesh>(Math::Box2 {});
+         for (int i = 0; i < 256; ++i)
+            rect->CreateUnit<A::Instance>(Traits::Place(320, 240, 256 - i), Colors::Green);
+
+         // Let pipelines compile, and the frames in flight fill up     
+         for (int i = 0; i < 10; ++i)
+            root.Update(16ms);
+
+         WHEN("Frames are drawn") {
+            Time total {};
+            int measured = 0;
+            for (int i = 0; i < 100; ++i) {
+               root.Update(16ms);
+
+               Verbs::InterpretAs<Time> interpret;
+               root.Run(interpret);
+               REQUIRE(interpret.IsDone());
+
+               const auto gpu = interpret->template As<Time>();
+               if (gpu != Time {}) {
+                  total += gpu;
+                  ++measured;
+               }
+            }
+
+            THEN("The GPU time is reported, if the device can measure it") {
+               if (measured)
+                  Logger::Info(style, " GPU time per frame: ", total / measured);
+               else
+                  Logger::Warning(style, " GPU time can't be measured on this device");
+            }
+
+            BENCHMARK("Drawing a frame") {
+               return root.Update(16ms);
+            };
+         }
+      }
+   }
+}
@@ -0,0 +1,161 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/Shadows.hpp"
+#include <catch2/catch.hpp>
+
+/// Transform a point by a column-major matrix, and divide by w               
+///   @param m - the matrix                                                   
+///   @param p - the point                                                    
+///   @param out - [out] the normalized device coordinates                    
+static void Project(const float* m, const float* p, float* out) {
+   float clip[4];
+   for (int r = 0; r < 4; ++r)
+      clip[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+   for (int r = 0; r < 3; ++r)
+      out[r] = clip[r] / clip[3];
+}
+
+
+SCENARIO("Allocating shadow maps in an atlas", "[shadows]") {
+   GIVEN("A 1024 atlas of 256 squares") {
+      ShadowAtlasAllocator atlas;
+      atlas.Reset(1024, 256);
+
+      WHEN("Filled with the smallest squares") {
+         ShadowTile tiles[16];
+         for (auto& tile : tiles)
+            REQUIRE(atlas.Allocate(256, tile));
+
+         THEN("They don't overlap, and there's no room for more") {
+            for (int i = 0; i < 16; ++i) {
+               REQUIRE(tiles[i].mSize == 256);
+               for (int j = i + 1; j < 16; ++j)
+                  REQUIRE_FALSE(tiles[i] == tiles[j]);
+            }
+
+            ShadowTile extra;
+            REQUIRE(atlas.GetUsed() == 1024 * 1024);
+            REQUIRE_FALSE(atlas.Allocate(256, extra));
+         }
+
+         THEN("Freeing all of them merges them back into the whole atlas") {
+            for (const auto& tile : tiles)
+               atlas.Free(tile);
+
+            ShadowTile whole;
+            REQUIRE(atlas.GetUsed() == 0);
+            REQUIRE(atlas.Allocate(1024, whole));
+            REQUIRE(whole == ShadowTile {0, 0, 1024});
+         }
+      }
+
+      WHEN("A square is requested, that is bigger than the atlas") {
+         ShadowTile tile;
+
+         THEN("It fails") {
+            REQUIRE_FALSE(atlas.Allocate(2048, tile));
+         }
+      }
+   }
+}
+
+SCENARIO("Deciding when a shadow must be rendered again", "[shadows]") {
+   GIVEN("A light at the origin, with a range of 10") {
+      const float light[4] {0, 0, 0, 10};
+      const float near[16] {
+         1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  5, 0, 0, 1
+      };
+      const float far[16] {
+         1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  50, 0, 0, 1
+      };
+
+      ShadowCasters casters {MakeShadowCaster(near), MakeShadowCaster(far)};
+      ::std::vector<uint32_t> touched;
+      const auto signature = ShadowSignature(light, casters, touched);
+
+      THEN("Only the caster in range is relevant") {
+         REQUIRE(touched == ::std::vector<uint32_t> {0});
+         REQUIRE(ShadowSignature(light, casters, touched) == signature);
+      }
+
+      WHEN("The caster outside the range moves") {
+         casters[1] = MakeShadowCaster(near);
+         casters[1].mCenter[0] = casters[1].mModel[12] = 60;
+
+         THEN("The shadow stays the same") {
+            REQUIRE(ShadowSignature(light, casters, touched) == signature);
+         }
+      }
+
+      WHEN("The caster inside the range moves") {
+         casters[0].mCenter[1] = casters[0].mModel[13] = 1;
+
+         THEN("The shadow changes") {
+            REQUIRE(ShadowSignature(light, casters, touched) != signature);
+         }
+      }
+
+      WHEN("The light moves") {
+         const float moved[4] {0, 0.5f, 0, 10};
+
+         THEN("The shadow changes") {
+            REQUIRE(ShadowSignature(moved, casters, touched) != signature);
+         }
+      }
+   }
+}
+
+SCENARIO("Projecting to the cube faces of a shadow", "[shadows]") {
+   GIVEN("A light at (1, 2, 3), with a range of 10") {
+      const float light[4] {1, 2, 3, 10};
+      const float near = 10 * ShadowNearRatio;
+
+      THEN("Each face sees the point along its axis in the middle") {
+         const float axes[6][3] {
+            {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
+         };
+
+         for (int face = 0; face < 6; ++face) {
+            float m[16];
+            ShadowFaceMatrix(face, light, m);
+
+            float p[3], ndc[3];
+            for (int i = 0; i < 3; ++i)
+               p[i] = light[i] + axes[face][i] * 5;
+            Project(m, p, ndc);
+            REQUIRE(ndc[0] == Approx(0).margin(1e-5));
+            REQUIRE(ndc[1] == Approx(0).margin(1e-5));
+            REQUIRE(ndc[2] > 0);
+            REQUIRE(ndc[2] < 1);
+
+            // Depth spans from the near plane to the light range       
+            for (int i = 0; i < 3; ++i)
+               p[i] = light[i] + axes[face][i] * near;
+            Project(m, p, ndc);
+            REQUIRE(ndc[2] == Approx(0).margin(1e-5));
+
+            for (int i = 0; i < 3; ++i)
+               p[i] = light[i] + axes[face][i] * 10;
+            Project(m, p, ndc);
+            REQUIRE(ndc[2] == Approx(1));
+         }
+      }
+
+      THEN("Points off the major axis land where the light shaders look") {
+         // +X face: (-v.z, -v.y) / v.x                                 
+         float m[16];
+         ShadowFaceMatrix(0, light, m);
+         const float p[3] {light[0] + 4, light[1] + 1, light[2] + 2};
+         float ndc[3];
+         Project(m, p, ndc);
+         REQUIRE(ndc[0] == Approx(-0.5f));
+         REQUIRE(ndc[1] == Approx(-0.25f));
+      }
+   }
+}
@@ -0,0 +1,197 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include "Main.hpp"
+#include "../source/inner/Views.hpp"
+#include <catch2/catch.hpp>
+
+/// Transform a point by a column-major matrix                                
+///   @param m - the matrix                                                   
+///   @param p - the homogeneous point                                        
+///   @param out - [out] the transformed point                                
+static void Transform(const float* m, const float* p, float* out) {
+   for (int r = 0; r < 4; ++r)
+      out[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r] * p[3];
+}
+
+
+SCENARIO("Transforming clip space to the eyes of a stereo camera", "[views]") {
+   GIVEN("A perspective projection with near plane 1 and far plane 10") {
+      // Column-major, depth mapped to [0, 1], w = z                    
+      const float near = 1, far = 10;
+      const float projection[16] {
+         2, 0, 0, 0,
+         0, 1.5f, 0, 0,
+         0, 0, far / (far - near), 1,
+         0, 0, -far * near / (far - near), 0
+      };
+
+      // Its inverse                                                    
+      const float inverse[16] {
+         0.5f, 0, 0, 0,
+         0, 1 / 1.5f, 0, 0,
+         0, 0, 0, -(far - near) / (far * near),
+         0, 0, 1, 1 / near
+      };
+
+      const float separation = 0.064f;
+
+      WHEN("Views of both eyes are made") {
+         const auto views = ViewTransforms::For(Eye::Both, projection, inverse, separation);
+
+         THEN("Each eye sees the scene, as if the camera moved half the separation sideways") {
+            for (const float z : {1.0f, 2.5f, 10.0f}) {
+               const float point[4] {0.3f, -0.2f, z, 1};
+               float clip[4];
+               Transform(projection, point, clip);
+
+               const float sign[2] {1, -1};
+               for (int eye = 0; eye < 2; ++eye) {
+                  const float moved[4] {
+                     point[0] + sign[eye] * separation * 0.5f, point[1], point[2], 1
+                  };
+                  float expected[4], actual[4];
+                  Transform(projection, moved, expected);
+                  Transform(views.mViews[eye], clip, actual);
+
+                  for (int i = 0; i < 4; ++i)
+                     REQUIRE(actual[i] == Approx(expected[i]));
+               }
+            }
+         }
+
+         THEN("One eye undoes the other") {
+            float both[4];
+            const float clip[4] {0.5f, 0.25f, 0.75f, 2};
+            float left[4];
+            Transform(views.mViews[0], clip, left);
+            Transform(views.mViews[1], left, both);
+            for (int i = 0; i < 4; ++i)
+               REQUIRE(both[i] == Approx(clip[i]));
+         }
+      }
+
+      WHEN("Views of a single eye are made") {
+         const auto left = ViewTransforms::For(Eye::Left, projection, inverse, separation);
+         const auto right = ViewTransforms::For(Eye::Right, projection, inverse, separation);
+         const auto both = ViewTransforms::For(Eye::Both, projection, inverse, separation);
+         const auto mono = ViewTransforms::For(Eye::Mono, projection, inverse, separation);
+
+         THEN("The eye is always the first view, because that's the one drawn without multiview") {
+            REQUIRE(0 == ::std::memcmp(left.mViews[0], both.mViews[0], sizeof(float) * 16));
+            REQUIRE(0 == ::std::memcmp(right.mViews[0], both.mViews[1], sizeof(float) * 16));
+            REQUIRE(0 == ::std::memcmp(left.mViews[1], mono.mViews[0], sizeof(float) * 16));
+         }
+
+         THEN("Mono views don't move anything") {
+            for (int i = 0; i < 16; ++i)
+               REQUIRE(mono.mViews[0][i] == (i % 5 == 0 ? 1.0f : 0.0f));
+            REQUIRE(mono == ViewTransforms::For(Eye::Mono, projection, inverse, 0));
+            REQUIRE(mono == ViewTransforms::Mono());
+         }
+      }
+   }
+}
+
+SCENARIO("Injecting view transforms into vertex shaders", "[views]") {
+   GIVEN("A vertex shader") {
+      const ::std::string code =
+         "#version 450\n"
+         "layout(location = 0) in vec3 position;\n"
+         "void main() {\n"
+         "   gl_Position = vec4(position, 1.0);\n"
+         "}\n";
+
+      WHEN("Views are injected for multiview") {
+         const auto result = InjectViews(code, true);
+
+         THEN("The version stays first, and the original main is called by a new one") {
+            REQUIRE(result.rfind("#version 450\n#extension GL_EXT_multiview : require\n", 0) == 0);
+            REQUIRE(result.find("#define main LangulusMain") < result.find("void main() {\n   gl_Position"));
+            REQUIRE(result.find("#undef main") > result.find("void main() {\n   gl_Position"));
+            REQUIRE(result.find("LangulusView[gl_ViewIndex] * gl_Position") != ::std::string::npos);
+         }
+      }
+
+      WHEN("Views are injected without multiview") {
+         const auto result = InjectViews(code, false);
+
+         THEN("The first view is always used, and no extension is required") {
+            REQUIRE(result.find("#extension") == ::std::string::npos);
+            REQUIRE(result.find("gl_ViewIndex") == ::std::string::npos);
+            REQUIRE(result.find("LangulusView[0] * gl_Position") != ::std::string::npos);
+         }
+      }
+   }
+
+   GIVEN("A vertex shader without a version directive") {
+      WHEN("Views are injected") {
+         const auto result = InjectViews("void main() {}", false);
+
+         THEN("The declarations come first") {
+            REQUIRE(result.rfind("layout(push_constant)", 0) == 0);
+            REQUIRE(result.find("#define main LangulusMain\nvoid main() {}") != ::std::string::npos);
+         }
+      }
+   }
+}
+
+SCENARIO("Finding push constant blocks in shader code", "[views]") {
+   GIVEN("Code with a push constant block of its own") {
+      const ::std::string code =
+         "#version 450\n"
+         "layout(set = 0, binding = 0) uniform Time { float time; };\n"
+         "layout(std430, push_constant) uniform Constants {\n"
+         "   vec4 tint;\n"
+         "};\n"
+         "void main() {}\n";
+
+      THEN("The block is found") {
+         REQUIRE(HasPushConstants(code));
+      }
+   }
+
+   GIVEN("A vertex shader without one") {
+      const ::std::string code = "#version 450\nvoid main() {}\n";
+      REQUIRE_FALSE(HasPushConstants(code));
+
+      WHEN("Views are injected") {
+         const auto result = InjectViews(code, false);
+
+         THEN("The views are the block that is found") {
+            REQUIRE(HasPushConstants(result));
+         }
+      }
+   }
+
+   GIVEN("Code that only mentions push constants outside of layouts") {
+      const ::std::string code =
+         "#version 450\n"
+         "layout(location = 0) in vec3 push_constants;\n"
+         "#define push_constant 1\n"
+         "void main() {}\n";
+
+      THEN("Nothing is found") {
+         REQUIRE_FALSE(HasPushConstants(code));
+      }
+   }
+}
+
+SCENARIO("Making view transforms", "[views][!benchmark]") {
+   GIVEN("A projection") {
+      const float projection[16] {
+         2, 0, 0, 0,  0, 1.5f, 0, 0,  0, 0, 1.1f, 1,  0, 0, -1.1f, 0
+      };
+      const float inverse[16] {
+         0.5f, 0, 0, 0,  0, 1 / 1.5f, 0, 0,  0, 0, 0, -0.9f,  0, 0, 1, 1
+      };
+
+      BENCHMARK("Views of both eyes") {
+         return ViewTransforms::For(Eye::Both, projection, inverse, 0.064f);
+      };
+   }
+}
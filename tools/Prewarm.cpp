@@ -0,0 +1,46 @@
+///                                                                           
+/// Langulus::Module::Vulkan                                                  
+/// Copyright (c) 2020 Dimo Markov <team@langulus.com>                        
+/// Part of the Langulus framework, see https://langulus.com                  
+///                                                                           
+/// SPDX-License-Identifier: GPL-3.0-or-later                                 
+///                                                                           
+#include <Langulus.hpp>
+#include <Langulus/Graphics.hpp>
+
+using namespace Langulus;
+
+LANGULUS_RTTI_BOUNDARY(RTTI::MainBoundary)
+
+
+/// Offline pipeline cache prewarmer                                          
+/// Creates a device-only renderer (without opening a window), that replays   
+/// a pipeline manifest, and saves the resulting pipeline cache on exit       
+///   Usage: LangulusModVulkanPrewarm <manifest> [cache]                      
+int main(int argc, char* argv[]) {
+   if (argc < 2) {
+      Logger::Error("Usage: LangulusModVulkanPrewarm <manifest> [cache]");
+      return 1;
+   }
+
+   try {
+      auto root = Thing::Root<false>(
+         "Vulkan",
+         "FileSystem",
+         "AssetsMaterials"
+      );
+
+      // The renderer prewarms the manifest on creation, and writes     
+      // the pipeline cache when destroyed                              
+      root.CreateUnit<A::Renderer>(
+         Traits::PipelineManifest {Text {argv[1]}},
+         Traits::PipelineCache {Text {argc > 2 ? argv[2] : "pipelines.cache"}}
+      );
+   }
+   catch (const Exception& e) {
+      Logger::Error("Prewarming failed: ", e);
+      return 2;
+   }
+
+   return 0;
+}